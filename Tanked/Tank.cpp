@@ -2,31 +2,147 @@
 #include "Tank.h"
 
 Tank::Tank()
+	: planner_(0),
+	  facts_(0),
+	  ticket_(0),
+	  step_(0)
 {
 	position = POINT2(0, 0);
 }
 Tank::Tank(int x, int y)
+	: planner_(0),
+	  facts_(0),
+	  ticket_(0),
+	  step_(0)
 {
 	position = POINT2(x, y);
 }
 
 Tank::~Tank()
 {
+	if (planner_ && ticket_)
+		planner_->release(ticket_);
+}
+
+Tank::Tank(Tank && t)
+	: position(t.position),
+	  planner_(t.planner_),
+	  facts_(t.facts_),
+	  goal_(t.goal_),
+	  ticket_(t.ticket_),
+	  plan_(std::move(t.plan_)),
+	  step_(t.step_)
+{
+	t.ticket_ = 0;
+}
+
+Tank & Tank::operator=(Tank && t)
+{
+	if (this != &t)
+	{
+		if (planner_ && ticket_)
+			planner_->release(ticket_);
+		position = t.position;
+		planner_ = t.planner_;
+		facts_ = t.facts_;
+		goal_ = t.goal_;
+		ticket_ = t.ticket_;
+		plan_ = std::move(t.plan_);
+		step_ = t.step_;
+		t.ticket_ = 0;
+	}
+	return *this;
+}
 
+void Tank::setTactics(ai::Planner * planner, ai::WorldState facts, ai::Condition const & goal)
+{
+	if (planner_ && ticket_)
+		planner_->release(ticket_);
+	planner_ = planner;
+	facts_ = facts;
+	goal_ = goal;
+	ticket_ = 0;
+	plan_.clear();
+	step_ = 0;
 }
 
 void Tank::update()
 {
+	if (!planner_)
+		return;
+
+	// A plan asked for on an earlier tick
+	if (ticket_)
+	{
+		ai::Planner::STATUS s = planner_->status(ticket_);
+		if (s == ai::Planner::PLAN_PENDING)
+			return;
+		planner_->plan(ticket_, plan_);
+		planner_->release(ticket_);
+		ticket_ = 0;
+		step_ = 0;
+		if (s != ai::Planner::PLAN_FOUND)
+			return;
+	}
+
+	if (goal_.holds(facts_))
+		return;
+
+	// Replan when the plan ran out or the world moved under it
+	if (step_ >= plan_.size() || !planner_->precondition(plan_[step_]).holds(facts_))
+	{
+		plan_.clear();
+		ticket_ = planner_->request(facts_, goal_);
+		return;
+	}
 
+	ai::Planner::ActionId a = plan_[step_];
+	switch (planner_->perform(a, this, 0))
+	{
+		case ai::STATUS_SUCCESS:
+			facts_ = planner_->effect(a).apply(facts_);
+			++step_;
+			break;
+		case ai::STATUS_FAILURE:
+			plan_.clear();
+			break;
+		default:
+			break;
+	}
 }
 
-void Tank::render(WinCanvas &wc)
+ai::Script Tank::patrol(ai::ScriptScheduler & s, float left, float right, float pause)
+{
+	for (;;)
+	{
+		co_await driveTo(s, left, 0.1f);
+		co_await s.sleep(pause);
+		co_await driveTo(s, right, 0.1f);
+		co_await s.sleep(pause);
+	}
+}
+
+ai::Script Tank::driveTo(ai::ScriptScheduler & s, float x, float step)
+{
+	while (fabs(position.x - x) > step)
+	{
+		position.x += position.x < x ? step : -step;
+		co_await s.yield();
+	}
+	position.x = x;
+}
+
+static void draw_tank(WinCanvas &wc, POINT2 const &position)
 {
 	wc.DrawPoly(Triangle(position+POINT2(0, 0), 
 						position + POINT2(60, 30), 
 						position + POINT2(30, 60)),
 		LRGB(0, 0, 0), 1);
+}
 
+void Tank::render(WinCanvas &wc)
+{
+	draw_tank(wc, position);
 }
 
 void Tank::handleInput(InputState &is)
@@ -40,3 +156,37 @@ void Tank::handleInput(InputState &is)
 		position = position - POINT2(0.1, 0);
 	}
 }
+
+/*
+ * ECS form
+ */
+
+core::Entity spawn_tank(core::World &world, int x, int y, bool keyboard)
+{
+	TankBody body = { POINT2(x, y) };
+	if (!keyboard)
+		return world.create(body);
+
+	KeyboardDriven driven = { 0.1f };
+	return world.create(body, driven);
+}
+
+void tank_input_system(core::World &world, InputState &is)
+{
+	float dir = (is.isActive('D') ? 1.0f : 0.0f) - (is.isActive('A') ? 1.0f : 0.0f);
+	if (dir == 0.0f)
+		return;
+
+	world.each<TankBody, KeyboardDriven>([dir](TankBody &body, KeyboardDriven &driven)
+	{
+		body.position = body.position + POINT2(dir * driven.step, 0);
+	});
+}
+
+void tank_render_system(core::World &world, WinCanvas &wc)
+{
+	world.each<TankBody>([&wc](TankBody &body)
+	{
+		draw_tank(wc, body.position);
+	});
+}
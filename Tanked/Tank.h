@@ -1,16 +1,75 @@
 #pragma once
 
+#include <vector>
+#include "core/ECS.h"
+#include "ai/Planner.h"
+#include "ai/Script.h"
+
 class Tank
 {
 private:
 	POINT2	position;
 
+	// Tactics: facts about the tank and a goal, planned by a shared Planner
+	ai::Planner *					planner_;
+	ai::WorldState					facts_;
+	ai::Condition					goal_;
+	ai::Planner::Ticket				ticket_;
+	std::vector<ai::Planner::ActionId>	plan_;
+	size_t							step_;
+
 public:
 	Tank();
 	Tank(int x, int y);
 	~Tank();
 
+	// A pending plan request belongs to one Tank: moves hand it over, copies are not allowed
+	Tank(Tank && t);
+	Tank & operator=(Tank && t);
+
+	/*
+	 * Plan towards goal with planner. Actions' Leafs are run with the Tank
+	 * as context; a successful one applies its effect to the facts. Without
+	 * a planner update() does nothing.
+	 */
+	void setTactics(ai::Planner * planner, ai::WorldState facts, ai::Condition const & goal);
+	void setFacts(ai::WorldState facts)		{ facts_ = facts; }
+	ai::WorldState facts() const			{ return facts_; }
+
 	void update();
+
+	/*
+	 * Drive between two x positions, pausing at each end. A script for a
+	 * ScriptScheduler instead of a state machine in update(); the Tank must
+	 * outlive it.
+	 */
+	ai::Script patrol(ai::ScriptScheduler & s, float left, float right, float pause);
+	ai::Script driveTo(ai::ScriptScheduler & s, float x, float step);
+
 	void handleInput(InputState &is);
 	void render(WinCanvas &wc);
-};
\ No newline at end of file
+
+private:
+	Tank(Tank const &);
+	Tank & operator=(Tank const &);
+};
+
+/*
+ * The same tank as ECS data: components for what a tank is, and systems
+ * that run over every entity having them, chunk by chunk.
+ */
+struct TankBody
+{
+	POINT2	position;
+};
+
+// Moved by the A/D keys
+struct KeyboardDriven
+{
+	float	step;
+};
+
+core::Entity	spawn_tank(core::World & world, int x, int y, bool keyboard);
+
+void	tank_input_system(core::World & world, InputState & is);
+void	tank_render_system(core::World & world, WinCanvas & wc);
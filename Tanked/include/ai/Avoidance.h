@@ -0,0 +1,111 @@
+/* ********************************************************************************* *
+ * *  File: Avoidance.h                                                            * *
+ * *  -----------------                                                            * *
+ * *  COPYRIGHT NOTICE                                                             * *
+ * *  ----------------                                                             * *
+ * *  (C)[2012] - [2015] Deakin University                                         * *
+ * *  All rights reserved.                                                         * *
+ * *  All information contained herein is, and remains the property of Deakin      * *
+ * *  University and the author (Tim Wilkin).                                      * *
+ * *  Dissemination of this information or reproduction of this material is        * *
+ * *  strictly forbidden unless prior written permission is obtained from Deakin   * *
+ * *  University.The right to create derivative works from this material is        * *
+ * *  hereby granted to students enrolled in SIT255, but only for the purposes of  * *
+ * *  assessment while an enrolled student at Deakin University.                   * *
+ * *                                                                               * *
+ * ********************************************************************************* */
+
+#ifndef AVOIDANCE_H
+#define AVOIDANCE_H
+
+#include <stdint.h>
+#include <vector>
+#include "math/Geometry.h"
+#include "ai/SpatialHash.h"
+
+/*
+ * Open namespace: ai
+ */
+namespace ai { // open namespace 'ai'
+
+	/*
+	 * Avoidance	Reciprocal collision avoidance (ORCA) between disc agents.
+	 *
+	 * Each tick every agent gives its preferred velocity (from its path or
+	 * steering). For each neighbour the set of velocities that would collide
+	 * within the time horizon is cut off by a half-plane, each side taking
+	 * half the responsibility, and the agent picks the velocity closest to
+	 * its preferred one inside all half-planes and its speed limit: a 2D
+	 * linear program over at most max_neighbours constraints. When the
+	 * constraints leave nothing feasible, the velocity that least violates
+	 * them is used instead.
+	 *
+	 * Agent state is SoA. Neighbours come from a SpatialHash built once per
+	 * solve(), nearest first and capped, so an agent's cost does not grow
+	 * with crowd density. Agents are solved in parallel; each reads only
+	 * the previous tick's state and writes only its own new velocity, and
+	 * neighbour order is fixed by distance then index, so the result is the
+	 * same for any thread count.
+	 */
+	class Avoidance
+	{
+		public:
+			// Hard cap on max_neighbours (sizes the per-agent constraint arrays)
+			static const size_t	MAX_NEIGHBOURS = 32;
+
+			Avoidance(float time_horizon = 2.0f, float neighbour_dist = 16.0f, size_t max_neighbours = 10);
+
+			size_t	add(POINT2 const & p, float radius, float max_speed);
+			void	clear();
+			size_t	size() const	{ return x_.size(); }
+
+			void	setPosition(size_t i, POINT2 const & p)		{ x_[i] = p.x; y_[i] = p.y; }
+			void	setVelocity(size_t i, VECTOR2 const & v)	{ vx_[i] = v.x; vy_[i] = v.y; }
+			void	setPreferred(size_t i, VECTOR2 const & v)	{ pref_x_[i] = v.x; pref_y_[i] = v.y; }
+
+			POINT2	position(size_t i) const	{ return POINT2(x_[i], y_[i]); }
+			VECTOR2	velocity(size_t i) const	{ return VECTOR2(vx_[i], vy_[i]); }
+
+			// New velocities for every agent from the current state
+			void	solve(float dt);
+
+			// Adopt the solved velocities and move by them
+			void	integrate(float dt);
+
+			// SoA views, for batch consumers
+			float const *	x() const	{ return x_.empty() ? 0 : &x_[0]; }
+			float const *	y() const	{ return y_.empty() ? 0 : &y_[0]; }
+			float const *	vx() const	{ return vx_.empty() ? 0 : &vx_[0]; }
+			float const *	vy() const	{ return vy_.empty() ? 0 : &vy_[0]; }
+
+		private:
+			struct Line
+			{
+				float	px, py;		// point on the boundary
+				float	dx, dy;		// unit direction; permitted side is to the left
+			};
+
+			float					horizon_;
+			float					neighbour_dist_;
+			size_t					max_neighbours_;
+
+			std::vector<float>		x_, y_, vx_, vy_;
+			std::vector<float>		radius_, max_speed_;
+			std::vector<float>		pref_x_, pref_y_;
+			std::vector<float>		new_vx_, new_vy_;
+
+			SpatialHash				hash_;
+
+			void	solveAgent(size_t i, float inv_dt);
+
+			static bool		program1(Line const * lines, size_t n, float radius, float ox, float oy,
+									 bool direction, float & rx, float & ry);
+			static size_t	program2(Line const * lines, size_t n, float radius, float ox, float oy,
+									 bool direction, float & rx, float & ry);
+			static void		program3(Line const * lines, size_t n, size_t begin, float radius,
+									 float & rx, float & ry);
+	};
+
+} // close namespace 'ai'
+
+#endif
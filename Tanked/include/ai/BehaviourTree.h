@@ -0,0 +1,197 @@
+/* ********************************************************************************* *
+ * *  File: BehaviourTree.h                                                        * *
+ * *  ---------------------                                                        * *
+ * *  COPYRIGHT NOTICE                                                             * *
+ * *  ----------------                                                             * *
+ * *  (C)[2012] - [2015] Deakin University                                         * *
+ * *  All rights reserved.                                                         * *
+ * *  All information contained herein is, and remains the property of Deakin      * *
+ * *  University and the author (Tim Wilkin).                                      * *
+ * *  Dissemination of this information or reproduction of this material is        * *
+ * *  strictly forbidden unless prior written permission is obtained from Deakin   * *
+ * *  University.The right to create derivative works from this material is        * *
+ * *  hereby granted to students enrolled in SIT255, but only for the purposes of  * *
+ * *  assessment while an enrolled student at Deakin University.                   * *
+ * *                                                                               * *
+ * ********************************************************************************* */
+
+#ifndef BEHAVIOURTREE_H
+#define BEHAVIOURTREE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+/*
+ * Open namespace: ai
+ */
+namespace ai { // open namespace 'ai'
+
+	enum STATUS
+	{
+		STATUS_SUCCESS,
+		STATUS_FAILURE,
+		STATUS_RUNNING
+	};
+
+	/*
+	 * Leaf		Condition or action: fn(context, agent, param). Conditions
+	 *			return success or failure; actions may also return running to
+	 *			be resumed on the next tick.
+	 */
+	typedef STATUS (*Leaf)(void * context, uint32_t agent, int32_t param);
+
+	class BehaviourState;
+
+	/*
+	 * BehaviourTree	A behaviour tree compiled to a flat node array.
+	 *
+	 * Nodes are stored in pre-order, each holding the index just past its
+	 * subtree and its parent, so evaluation walks the array with an explicit
+	 * loop: no recursion, no pointers, no allocation. One tree is shared by
+	 * every agent using it; the per-agent part lives in a BehaviourState.
+	 *
+	 * Built with begin/end calls in tree order:
+	 *
+	 *	BehaviourTree t;
+	 *	t.selector();
+	 *		t.sequence();
+	 *			t.condition(&enemy_visible, 0, EVENT_SIGHT);
+	 *			t.cooldown(30);
+	 *				t.action(&fire);
+	 *		t.end();
+	 *		t.action(&patrol);
+	 *	t.end();
+	 *
+	 * Decorators (inverter, succeeder, repeat, cooldown) take the next node
+	 * as their only child and close by themselves.
+	 *
+	 * An agent whose action returned running resumes at that action on the
+	 * next tick without evaluating anything before it. It is evaluated from
+	 * the root again only when an event is posted to it that one of the
+	 * conditions earlier in the tree listens for, so unchanged subtrees are
+	 * skipped. A cooldown that blocked the way counts as a condition that
+	 * listens for EVENT_TIMER, which is posted when the cooldown expires.
+	 * Re-evaluation that reaches the running action again (or any node
+	 * above it) continues it rather than starting it over.
+	 */
+	class BehaviourTree
+	{
+		public:
+			static const uint32_t	ALL_EVENTS = 0xffffffffu;
+			static const uint32_t	EVENT_TIMER = 0x80000000u;		// reserved; user events use the other bits
+
+			BehaviourTree();
+
+			void	sequence();		// children in order until one fails
+			void	selector();		// children in order until one succeeds
+			void	end();			// close the innermost sequence or selector
+
+			void	inverter();					// swap success and failure
+			void	succeeder();				// always succeed once the child finishes
+			void	repeat(uint16_t times);		// run the child until it has succeeded times times
+			void	cooldown(uint16_t ticks);	// fail for ticks after the child succeeds
+
+			// A condition is re-checked when any of events is posted
+			void	condition(Leaf fn, int32_t param = 0, uint32_t events = ALL_EVENTS);
+			void	action(Leaf fn, int32_t param = 0);
+			void	wait(uint16_t ticks);		// running for ticks, then success
+
+			size_t	size() const		{ return nodes_.size(); }
+			size_t	slots() const		{ return slots_; }		// state words per agent
+
+			/*
+			 * Tick agents [first, last) in order, or every agent of state
+			 * spread over the job system (leaves must then be safe to call
+			 * for different agents at once). Events are consumed.
+			 */
+			void	tick(BehaviourState & state, void * context, uint32_t first, uint32_t last) const;
+			void	tick(BehaviourState & state, void * context) const;
+
+			// Status of the last tick of agent
+			STATUS	run(BehaviourState & state, void * context, uint32_t agent) const;
+
+		private:
+			enum OP
+			{
+				OP_SEQUENCE,
+				OP_SELECTOR,
+				OP_INVERTER,
+				OP_SUCCEEDER,
+				OP_REPEAT,
+				OP_COOLDOWN,
+				OP_CONDITION,
+				OP_ACTION,
+				OP_WAIT
+			};
+
+			static const uint8_t	NO_SLOT = 0xff;
+
+			struct Node
+			{
+				uint8_t		op;
+				uint8_t		slot;		// state column, or NO_SLOT
+				uint16_t	skip;		// index just past the subtree
+				uint16_t	parent;
+				uint16_t	arg;		// leaf index, repeat count or ticks
+			};
+
+			struct LeafEntry
+			{
+				Leaf		fn;
+				int32_t		param;
+			};
+
+			std::vector<Node>		nodes_;
+			std::vector<uint32_t>	watch_;		// events that reopen evaluation of anything before a node
+			std::vector<LeafEntry>	leaves_;
+			std::vector<uint16_t>	open_;		// nodes whose subtree is not yet closed
+			uint32_t				seen_;		// events of the conditions added so far
+			size_t					slots_;
+
+			void	add(uint8_t op, uint16_t arg, bool stateful);
+			void	close();
+	};
+
+	/*
+	 * BehaviourState	Per-agent state of one tree, SoA: the running node,
+	 *					pending events, when a blocking cooldown expires and
+	 *					one 32 bit word per stateful node (repeat counts,
+	 *					cooldown and wait timers). A few bytes per agent.
+	 *
+	 * Ticks are 32 bit and compared modulo 2^31 (a year at 60 Hz). A
+	 * cooldown word is 0 when not cooling and cleared once its window has
+	 * passed, so a stale expiry never reads as being in the future.
+	 */
+	class BehaviourState
+	{
+		public:
+			static const uint16_t	IDLE = 0xffff;
+
+			explicit BehaviourState(BehaviourTree const & tree, size_t agents = 0);
+
+			uint32_t	add();
+			size_t		size() const		{ return running_.size(); }
+
+			void		post(uint32_t agent, uint32_t events)	{ events_[agent] |= events; }
+			void		post(uint32_t events);
+
+			uint16_t	running(uint32_t agent) const	{ return running_[agent]; }
+			uint32_t	now() const						{ return tick_; }
+
+			// Called once per game tick before the tree ticks: timers count these
+			void		advance()			{ ++tick_; }
+
+		private:
+			friend class BehaviourTree;
+
+			std::vector<uint16_t>				running_;
+			std::vector<uint32_t>				events_;
+			std::vector<uint32_t>				wake_;		// 0, or the tick to post EVENT_TIMER
+			std::vector<std::vector<uint32_t>>	slots_;		// one column per stateful node
+			uint32_t							tick_;
+	};
+
+} // close namespace 'ai'
+
+#endif
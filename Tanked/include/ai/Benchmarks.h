@@ -0,0 +1,60 @@
+/* ********************************************************************************* *
+ * *  File: Benchmarks.h                                                           * *
+ * *  ------------------                                                           * *
+ * *  COPYRIGHT NOTICE                                                             * *
+ * *  ----------------                                                             * *
+ * *  (C)[2012] - [2015] Deakin University                                         * *
+ * *  All rights reserved.                                                         * *
+ * *  All information contained herein is, and remains the property of Deakin      * *
+ * *  University and the author (Tim Wilkin).                                      * *
+ * *  Dissemination of this information or reproduction of this material is        * *
+ * *  strictly forbidden unless prior written permission is obtained from Deakin   * *
+ * *  University.The right to create derivative works from this material is        * *
+ * *  hereby granted to students enrolled in SIT255, but only for the purposes of  * *
+ * *  assessment while an enrolled student at Deakin University.                   * *
+ * *                                                                               * *
+ * ********************************************************************************* */
+
+#ifndef BENCHMARKS_H
+#define BENCHMARKS_H
+
+#include <ostream>
+
+/*
+ * Open namespace: ai
+ */
+namespace ai { // open namespace 'ai'
+
+	/*
+	 * Timing runs on generated levels, printed as tables. Run from the demo
+	 * with the -bench argument; build in Release for meaningful numbers.
+	 */
+
+	// Every PathService search mode over a maze and an open field, same queries for each
+	void	benchmarkPathfinding(std::ostream & out);
+
+	// Steering crowds of tens of thousands: flocking, wandering, chasing, inside walls
+	void	benchmarkSteering(std::ostream & out);
+
+	// AI every tick against LodScheduler tiers, as the world and its population grow
+	void	benchmarkLod(std::ostream & out);
+
+	// Utility scoring of 100k agents against growing action sets
+	void	benchmarkUtility(std::ostream & out);
+
+	// Planner replanning for hundreds of tanks, every search against the plan cache
+	void	benchmarkPlanning(std::ostream & out);
+
+	// Scripted tanks on a ScriptScheduler: cost per tick as most of them wait
+	void	benchmarkScripts(std::ostream & out);
+
+	/*
+	 * The same double-buffered ticks, with damage folded through a
+	 * Reduction, on 1 to 8 threads; each final state is compared byte for
+	 * byte with the one-thread run. Makes its own JobSystems, so run last.
+	 */
+	void	benchmarkDeterministicTicks(std::ostream & out);
+
+} // close namespace 'ai'
+
+#endif
@@ -0,0 +1,130 @@
+/* ********************************************************************************* *
+ * *  File: ClusterGraph.h                                                         * *
+ * *  --------------------                                                         * *
+ * *  COPYRIGHT NOTICE                                                             * *
+ * *  ----------------                                                             * *
+ * *  (C)[2012] - [2015] Deakin University                                         * *
+ * *  All rights reserved.                                                         * *
+ * *  All information contained herein is, and remains the property of Deakin      * *
+ * *  University and the author (Tim Wilkin).                                      * *
+ * *  Dissemination of this information or reproduction of this material is        * *
+ * *  strictly forbidden unless prior written permission is obtained from Deakin   * *
+ * *  University.The right to create derivative works from this material is        * *
+ * *  hereby granted to students enrolled in SIT255, but only for the purposes of  * *
+ * *  assessment while an enrolled student at Deakin University.                   * *
+ * *                                                                               * *
+ * ********************************************************************************* */
+
+#ifndef CLUSTER_GRAPH_H
+#define CLUSTER_GRAPH_H
+
+#include <stdint.h>
+#include <utility>
+#include <vector>
+#include "math/Geometry.h"
+#include "level/OccupancyGrid.h"
+#include "level/Terrain.h"
+
+/*
+ * Open namespace: ai
+ */
+namespace ai { // open namespace 'ai'
+
+	/*
+	 * ClusterGraph		Hierarchical path planning (HPA*) over an OccupancyGrid.
+	 *
+	 * The grid is cut into square clusters. Where two clusters share a run
+	 * of free cells across their border, an entrance is placed (the middle
+	 * of a short run, both ends of a long one) and its cell on each side
+	 * becomes an abstract node. The cost between every pair of nodes of a
+	 * cluster is precomputed by searching inside that cluster only.
+	 *
+	 * A query connects start and goal to the nodes of their own clusters,
+	 * searches the small abstract graph, and returns the node cells along
+	 * the way. Each leg can then be refine()d into grid cells by a search
+	 * confined to one cluster, so only the legs an agent actually walks
+	 * are ever expanded. Movement rules match GridSpace (8-connected, no
+	 * corner cutting) and so do the cell ids.
+	 *
+	 * update() recomputes the entrances and node costs of the clusters a
+	 * changed region touches plus their neighbours. As a TerrainListener it
+	 * must be added after the listener that re-stamps the grid.
+	 */
+	class ClusterGraph : public level::TerrainListener
+	{
+		public:
+			ClusterGraph();
+
+			void	build(level::OccupancyGrid const & grid, int cluster = 16);
+			void	update(AABB const & region);
+			void	terrainChanged(level::Terrain const & terrain, AABB const & region);
+
+			/*
+			 * Abstract path from start to goal as grid cell ids: the start
+			 * cell, the entrance cells passed through, the goal cell. false
+			 * if either end is blocked or there is no path.
+			 */
+			bool	findPath(POINT2 const & start, POINT2 const & goal, std::vector<int32_t> & cells, float * cost = 0);
+
+			/*
+			 * Append the cells after path[leg] up to and including
+			 * path[leg + 1], searched inside their common cluster.
+			 */
+			bool	refine(std::vector<int32_t> const & path, size_t leg, std::vector<int32_t> & cells);
+
+			// Abstract nodes currently in the graph
+			size_t		nodes() const;
+			uint32_t	version() const		{ return version_; }
+			int			clusterSize() const	{ return size_; }
+
+		private:
+			struct Transition
+			{
+				int32_t		a, b;		// cell on the low side, cell on the high side
+			};
+
+			struct Cluster
+			{
+				int						x0, y0, x1, y1;		// inclusive cell bounds
+				std::vector<int32_t>	cells;				// node cells
+				std::vector<float>		cost;				// cells.size()^2, FLT_MAX if unreachable
+				std::vector<Transition>	east, north;		// entrances to the +x / +y neighbour
+			};
+
+			typedef std::pair<float, int32_t>	OpenNode;
+
+			level::OccupancyGrid const *	grid_;
+			int						size_;
+			int						cw_, ch_;			// clusters across / down
+			int						max_nodes_;			// node id stride per cluster
+			std::vector<Cluster>	clusters_;
+			uint32_t				version_;
+
+			// Abstract search pools (two extra ids for start and goal)
+			std::vector<float>		g_;
+			std::vector<int32_t>	parent_;
+			std::vector<uint32_t>	seen_, closed_;
+			std::vector<OpenNode>	open_;
+			uint32_t				stamp_;
+
+			// In-cluster search pools, indexed by cell within the cluster
+			std::vector<float>		local_g_;
+			std::vector<int32_t>	local_parent_;
+			std::vector<uint32_t>	local_seen_, local_closed_;
+			std::vector<OpenNode>	local_open_;
+			uint32_t				local_stamp_;
+
+			std::vector<std::pair<int32_t, float>>	start_links_, goal_links_, links_;
+
+			int		clusterOf(int32_t cell) const;
+			void	entrances(int cx, int cy);
+			void	connect(int c);
+			void	search(Cluster const & c, int32_t from, int32_t to);
+			float	localCost(Cluster const & c, int32_t cell) const;
+			int32_t	cellAt(POINT2 const & p) const;
+			void	links(int c, int local, std::vector<std::pair<int32_t, float>> & out) const;
+	};
+
+} // close namespace 'ai'
+
+#endif
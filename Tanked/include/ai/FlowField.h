@@ -0,0 +1,103 @@
+/* ********************************************************************************* *
+ * *  File: FlowField.h                                                            * *
+ * *  -----------------                                                            * *
+ * *  COPYRIGHT NOTICE                                                             * *
+ * *  ----------------                                                             * *
+ * *  (C)[2012] - [2015] Deakin University                                         * *
+ * *  All rights reserved.                                                         * *
+ * *  All information contained herein is, and remains the property of Deakin      * *
+ * *  University and the author (Tim Wilkin).                                      * *
+ * *  Dissemination of this information or reproduction of this material is        * *
+ * *  strictly forbidden unless prior written permission is obtained from Deakin   * *
+ * *  University.The right to create derivative works from this material is        * *
+ * *  hereby granted to students enrolled in SIT255, but only for the purposes of  * *
+ * *  assessment while an enrolled student at Deakin University.                   * *
+ * *                                                                               * *
+ * ********************************************************************************* */
+
+#ifndef FLOW_FIELD_H
+#define FLOW_FIELD_H
+
+#include <stdint.h>
+#include <utility>
+#include <vector>
+#include "math/Geometry.h"
+#include "level/OccupancyGrid.h"
+#include "level/Terrain.h"
+
+/*
+ * Open namespace: ai
+ */
+namespace ai { // open namespace 'ai'
+
+	/*
+	 * FlowField	Direction to a shared goal for every cell of an
+	 *				OccupancyGrid, so any number of agents can steer to it by
+	 *				lookup.
+	 *
+	 * The integration field is the travel distance to the goal, solved as an
+	 * eikonal equation (|grad u| = 1, Godunov upwind update) rather than a
+	 * graph search, so directions are not quantised to eight headings. The
+	 * grid is split into tiles and solved like the Fast Iterative Method: each
+	 * active tile is swept to convergence, and a tile whose border values drop
+	 * activates its neighbours. Tiles of one checkerboard colour never share
+	 * an edge and the stencil only reads edge neighbours, so each colour is
+	 * solved in parallel.
+	 *
+	 * After an obstacle change only some tiles are recomputed. The changed
+	 * cells are reset, along with every cell downstream of them that took its
+	 * value from a reset cell: it was upwind of that cell and the lower
+	 * neighbour on its axis. The tiles holding reset cells are then re-solved
+	 * from the values kept around them. When an opening shortens paths, the
+	 * drop reaches the kept tiles through the usual activation.
+	 */
+	class FlowField : public level::TerrainListener
+	{
+		public:
+			FlowField();
+
+			void	reset(level::OccupancyGrid const & grid, int tile = 16);
+
+			// Solve the whole field for a new goal
+			void	setGoal(POINT2 const & goal);
+
+			// Re-solve after the grid changed inside region
+			void	update(AABB const & region);
+			void	terrainChanged(level::Terrain const & terrain, AABB const & region);
+
+			// Unit direction towards the goal; zero at the goal, in blocked or unreachable cells
+			VECTOR2	direction(POINT2 const & p) const;
+			void	direction(float const * x, float const * y, size_t n, float * dx, float * dy) const;
+
+			// Travel distance to the goal, FLT_MAX if unreachable
+			float	cost(POINT2 const & p) const;
+
+			POINT2 const &	goal() const		{ return goal_; }
+
+			// Tiles swept by the last setGoal/update (one tile may be swept several times)
+			size_t			tilesSolved() const	{ return solved_; }
+
+		private:
+			level::OccupancyGrid const *	grid_;
+			int						tile_;
+			int						tw_, th_;
+			POINT2					goal_;
+			int32_t					goal_cell_;
+			std::vector<float>		cost_;
+			std::vector<float>		dir_x_, dir_y_;
+			std::vector<uint8_t>	active_;
+			std::vector<uint8_t>	touched_;		// values changed since directions were derived
+			std::vector<int>		batch_;
+			std::vector<uint8_t>	spread_;		// per batch entry: border values dropped
+			std::vector<std::pair<int32_t, float>>	raise_;	// cells reset by an update, with their old cost
+			size_t					solved_;
+
+			int32_t	cellAt(POINT2 const & p) const;
+			void	solve();
+			bool	sweep(int t);
+			void	directions();
+	};
+
+} // close namespace 'ai'
+
+#endif
@@ -0,0 +1,155 @@
+/* ********************************************************************************* *
+ * *  File: LodScheduler.h                                                         * *
+ * *  --------------------                                                         * *
+ * *  COPYRIGHT NOTICE                                                             * *
+ * *  ----------------                                                             * *
+ * *  (C)[2012] - [2015] Deakin University                                         * *
+ * *  All rights reserved.                                                         * *
+ * *  All information contained herein is, and remains the property of Deakin      * *
+ * *  University and the author (Tim Wilkin).                                      * *
+ * *  Dissemination of this information or reproduction of this material is        * *
+ * *  strictly forbidden unless prior written permission is obtained from Deakin   * *
+ * *  University.The right to create derivative works from this material is        * *
+ * *  hereby granted to students enrolled in SIT255, but only for the purposes of  * *
+ * *  assessment while an enrolled student at Deakin University.                   * *
+ * *                                                                               * *
+ * ********************************************************************************* */
+
+#ifndef LODSCHEDULER_H
+#define LODSCHEDULER_H
+
+#include <stdint.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include "math/Geometry.h"
+#include "core/Parallel.h"
+
+/*
+ * Open namespace: ai
+ */
+namespace ai { // open namespace 'ai'
+
+	/*
+	 * LodScheduler		Decides which agents run their AI on each tick.
+	 *
+	 * Every agent sits in a tier chosen by its distance to the nearest
+	 * viewer (camera or player) divided by its importance, so an important
+	 * agent is treated as if it were nearer. A tier with period p updates
+	 * its agents every p ticks; agents entering a tier are dealt round-robin
+	 * into its p buckets and bucket b runs on ticks where tick % p == b, so
+	 * each tick carries an even share. Moving to a slower tier needs 10%
+	 * more distance than the boundary, so agents near one do not flap.
+	 *
+	 * tick() runs the due updates, most overdue first, in parallel batches
+	 * until the time budget is spent; the rest carry over to the next tick.
+	 * Each update is told how much time it covers. Between updates the
+	 * agent's last reported position and velocity are extrapolated.
+	 */
+	class LodScheduler
+	{
+		public:
+			struct Tier
+			{
+				float		distance;		// effective distance this tier reaches out to
+				uint32_t	period;			// ticks between updates
+			};
+
+			static const size_t		MAX_TIERS = 8;
+			static const size_t		BATCH = 64;		// updates between budget checks
+
+			explicit LodScheduler(float tick_seconds = 1.0f / 60.0f);
+
+			// Ascending distances; the last tier also takes everything beyond it
+			void	setTiers(Tier const * tiers, size_t n);
+			void	setViewers(POINT2 const * viewers, size_t n);
+			void	setBudget(double milliseconds)		{ budget_ms_ = milliseconds; }		// 0: no limit
+
+			uint32_t	add(POINT2 const & position, float importance = 1.0f);
+			size_t		size() const	{ return x_.size(); }
+
+			void	setImportance(uint32_t agent, float importance)	{ importance_[agent] = (std::max)(importance, 1.0e-3f); }
+
+			// Report the state an update produced; safe from inside update
+			void	setState(uint32_t agent, POINT2 const & position, VECTOR2 const & velocity);
+
+			// Last reported state carried forward to the current tick
+			POINT2		position(uint32_t agent) const;
+			uint32_t	tier(uint32_t agent) const		{ return tier_[agent]; }
+			uint64_t	now() const						{ return tick_; }
+
+			/*
+			 * Advance one tick: re-tier every agent, then call
+			 * update(agent, seconds since its last update) for the due
+			 * agents, from several threads. Returns the number run.
+			 */
+			template <typename Fn>
+			size_t	tick(Fn update);
+
+			size_t	deferred() const	{ return carried_.size(); }		// due but out of budget
+
+		private:
+			Tier					tiers_[MAX_TIERS];
+			size_t					tier_count_;
+			uint32_t				cursor_[MAX_TIERS];		// next bucket to deal into
+			std::vector<POINT2>		viewers_;
+			float					tick_seconds_;
+			double					budget_ms_;
+			uint64_t				tick_;
+
+			// Per agent
+			std::vector<float>		x_, y_, vx_, vy_;		// last reported state
+			std::vector<uint64_t>	stamp_;					// tick of that report
+			std::vector<uint64_t>	last_;					// tick of the last update
+			std::vector<float>		importance_;
+			std::vector<uint8_t>	tier_;
+			std::vector<uint32_t>	bucket_;
+			std::vector<uint8_t>	queued_;				// in carried_ already
+
+			std::vector<uint8_t>		next_tier_;			// classify() scratch
+			std::vector<uint32_t>	due_, carried_;
+
+			void	classify();
+			void	collect();
+	};
+
+	template <typename Fn>
+	size_t LodScheduler::tick(Fn update)
+	{
+		++tick_;
+		classify();
+		collect();
+
+		typedef std::chrono::steady_clock clock;
+		clock::time_point start = clock::now();
+
+		size_t done = 0;
+		while (done < due_.size())
+		{
+			size_t end = (std::min)(due_.size(), done + BATCH);
+			core::parallel_for(done, end, 8, [this, &update](size_t first, size_t last)
+			{
+				for (size_t k = first; k < last; ++k)
+				{
+					uint32_t a = due_[k];
+					update(a, (float)(tick_ - last_[a]) * tick_seconds_);
+					last_[a] = tick_;
+				}
+			});
+			done = end;
+
+			if (budget_ms_ > 0.0 &&
+				std::chrono::duration<double, std::milli>(clock::now() - start).count() >= budget_ms_)
+				break;
+		}
+
+		// Out of budget: the rest go first next tick
+		carried_.assign(due_.begin() + done, due_.end());
+		for (size_t k = 0; k < carried_.size(); ++k)
+			queued_[carried_[k]] = 1;
+		return done;
+	}
+
+} // close namespace 'ai'
+
+#endif
@@ -0,0 +1,177 @@
+/* ********************************************************************************* *
+ * *  File: NavMesh.h                                                              * *
+ * *  ---------------                                                              * *
+ * *  COPYRIGHT NOTICE                                                             * *
+ * *  ----------------                                                             * *
+ * *  (C)[2012] - [2015] Deakin University                                         * *
+ * *  All rights reserved.                                                         * *
+ * *  All information contained herein is, and remains the property of Deakin      * *
+ * *  University and the author (Tim Wilkin).                                      * *
+ * *  Dissemination of this information or reproduction of this material is        * *
+ * *  strictly forbidden unless prior written permission is obtained from Deakin   * *
+ * *  University.The right to create derivative works from this material is        * *
+ * *  hereby granted to students enrolled in SIT255, but only for the purposes of  * *
+ * *  assessment while an enrolled student at Deakin University.                   * *
+ * *                                                                               * *
+ * ********************************************************************************* */
+
+#ifndef NAV_MESH_H
+#define NAV_MESH_H
+
+#include <stdint.h>
+#include <vector>
+#include "math/Geometry.h"
+#include "level/Terrain.h"
+
+/*
+ * Open namespace: ai
+ */
+namespace ai { // open namespace 'ai'
+
+	/*
+	 * NavMesh		Constrained Delaunay triangulation of the level with the wall
+	 *				Segments as constraints.
+	 *
+	 * The area is cut into square tiles, each triangulated on its own (walls
+	 * clipped to the tile are inserted as constraints, crossings between
+	 * walls become vertices) and stitched to its neighbours along the shared
+	 * tile border. A change of walls re-triangulates only the tiles it
+	 * touches.
+	 *
+	 * Triangles, vertices and adjacency live in flat arrays indexed by id;
+	 * ids freed by a rebuild are reused. Triangles are counter clockwise and
+	 * edge i runs from v[i] to v[i+1], with adj[i] the triangle across it.
+	 *
+	 * Walkable space is found by flooding across non-wall edges: a connected
+	 * region is walkable if it lies in front of (on the normal side of) any
+	 * of its walls, or has no walls at all. Closed wall outlines with outward
+	 * normals therefore enclose unwalkable solids.
+	 *
+	 * Region labels are kept between updates. An update forgets only the
+	 * regions that reached into the rebuilt tiles, re-floods them from the
+	 * tile border and merges whatever the new triangles join up with, so a
+	 * local change costs the regions it touches rather than the whole map.
+	 *
+	 * A grid of a few cells per tile, each holding a triangle near its
+	 * centre, is the starting point for point location by walking.
+	 */
+	class NavMesh : public level::TerrainListener
+	{
+		public:
+
+			enum TRI_FLAGS
+			{
+				TRI_ALIVE		= 1,
+				TRI_WALKABLE	= 2
+			};
+
+			enum EDGE_FLAGS
+			{
+				EDGE_WALL		= 1,	// constrained by a wall
+				EDGE_FRONT		= 2,	// wall edge with this triangle on its normal side
+				EDGE_TILE		= 4		// on a tile border
+			};
+
+			struct Tri
+			{
+				int32_t		v[3];		// vertex ids, counter clockwise
+				int32_t		adj[3];		// triangle across edge v[i] -> v[i+1], -1 at the map edge
+				int32_t		tile;
+				uint8_t		flags;
+				uint8_t		edge[3];	// EDGE_FLAGS per edge
+			};
+
+			NavMesh();
+
+			/*
+			 * Triangulate the walkable space of area.
+			 *	tile	tile size in world units (the unit of local rebuilds)
+			 */
+			void	build(std::vector<Segment> const & walls, AABB const & area, float tile);
+
+			/*
+			 * Re-triangulate every tile overlapping region. walls must contain
+			 * (at least) all walls overlapping those tiles.
+			 */
+			void	update(std::vector<Segment> const & walls, AABB const & region);
+
+			void	terrainChanged(level::Terrain const & terrain, AABB const & region);
+
+			// Triangle containing p, -1 outside the area
+			int32_t	locate(POINT2 const & p) const;
+
+			size_t			size()	const				{ return tris_.size(); }
+			Tri const &		tri(size_t i) const			{ return tris_[i]; }
+			POINT2 const &	vertex(size_t i) const		{ return verts_[i]; }
+			bool			alive(size_t i) const		{ return (tris_[i].flags & TRI_ALIVE) != 0; }
+			bool			walkable(size_t i) const	{ return (tris_[i].flags & TRI_WALKABLE) != 0; }
+
+			// Can an agent step from triangle i across edge e?
+			bool			crossable(size_t i, int e) const
+			{
+				Tri const & t = tris_[i];
+				return t.adj[e] >= 0 && !(t.edge[e] & EDGE_WALL) && (tris_[t.adj[e]].flags & TRI_WALKABLE);
+			}
+
+			POINT2			centroid(size_t i) const;
+			Triangle		triangle(size_t i) const;
+
+			// Bumped by every build/update so that derived data (paths) can be invalidated
+			uint32_t		version() const		{ return version_; }
+			AABB const &	area()	const		{ return area_; }
+			float			tileSize() const	{ return tile_; }
+
+			// Bounds of the tiles a region touches (what an update of region rebuilds)
+			AABB			tileBounds(AABB const & region) const;
+
+		private:
+			struct Tile
+			{
+				std::vector<int32_t>	tris;
+				std::vector<int32_t>	verts;
+			};
+
+			// A connected set of triangles between walls
+			struct Region
+			{
+				int32_t		size;		// triangles, 0 once the label is free
+				uint8_t		front;		// has a wall edge facing into it
+				uint8_t		walled;		// has any wall edge
+			};
+
+			static const int		GRID_PER_TILE = 4;
+
+			AABB					area_;
+			float					tile_;
+			int						tw_, th_;
+			std::vector<POINT2>		verts_;
+			std::vector<Tri>		tris_;
+			std::vector<int32_t>	free_tris_;
+			std::vector<int32_t>	free_verts_;
+			std::vector<Tile>		tiles_;
+			std::vector<int32_t>	grid_;			// GRID_PER_TILE^2 cells per tile
+			float					grid_cell_;
+			int						gw_, gh_;
+			uint32_t				version_;
+			std::vector<int32_t>	region_;		// label per triangle, -1 if dead
+			std::vector<Region>		regions_;
+			std::vector<int32_t>	free_regions_;
+
+			AABB	tileRect(int tx, int ty) const;
+			void	tileRange(AABB const & region, int & x0, int & y0, int & x1, int & y1) const;
+			void	clearTile(int tx, int ty);
+			void	buildTile(int tx, int ty, std::vector<Segment> const & walls);
+			void	stitch(int tx, int ty);
+			void	classify();
+			void	reclassify(std::vector<int32_t> const & seeds);
+			int32_t	newRegion();
+			void	flood(int32_t seed, int32_t r, std::vector<int32_t> & out, std::vector<int32_t> * met);
+			void	relabel(int32_t seed, int32_t from, int32_t to, std::vector<int32_t> & out);
+			void	freeRegion(int32_t r);
+			void	setWalkable(int32_t t);
+			int32_t	walk(int32_t start, POINT2 const & p) const;
+	};
+
+} // close namespace 'ai'
+
+#endif
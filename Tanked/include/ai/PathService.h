@@ -0,0 +1,182 @@
+/* ********************************************************************************* *
+ * *  File: PathService.h                                                          * *
+ * *  -------------------                                                          * *
+ * *  COPYRIGHT NOTICE                                                             * *
+ * *  ----------------                                                             * *
+ * *  (C)[2012] - [2015] Deakin University                                         * *
+ * *  All rights reserved.                                                         * *
+ * *  All information contained herein is, and remains the property of Deakin      * *
+ * *  University and the author (Tim Wilkin).                                      * *
+ * *  Dissemination of this information or reproduction of this material is        * *
+ * *  strictly forbidden unless prior written permission is obtained from Deakin   * *
+ * *  University.The right to create derivative works from this material is        * *
+ * *  hereby granted to students enrolled in SIT255, but only for the purposes of  * *
+ * *  assessment while an enrolled student at Deakin University.                   * *
+ * *                                                                               * *
+ * ********************************************************************************* */
+
+#ifndef PATH_SERVICE_H
+#define PATH_SERVICE_H
+
+#include <stdint.h>
+#include <deque>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "ai/SearchSpace.h"
+
+/*
+ * Open namespace: ai
+ */
+namespace ai { // open namespace 'ai'
+
+	/*
+	 * PathService	A* path requests from many agents, answered over
+	 *				several ticks.
+	 *
+	 * Agents request() a path and get a ticket to poll. Requests are keyed
+	 * by their (search, start node, goal node) and resolved in order:
+	 *	- an entry with the same key (a finished path or a search still
+	 *	  queued) is shared, so agents heading the same way cost one search;
+	 *	- a finished path to the same goal passing through the start node
+	 *	  gives its suffix (sub-paths of shortest paths are shortest);
+	 *	- otherwise a search is queued.
+	 * Entries form an LRU cache of cache_size paths; entries referenced by
+	 * live tickets are never evicted, and entries from an older
+	 * SearchSpace::version() are not reused.
+	 *
+	 * update() runs the queued searches one after another until the time
+	 * budget is spent, suspending the current one mid-search if needed.
+	 * All search state (g, parent, open heap, visit stamps) lives in pools
+	 * sized to the node count, so a query allocates nothing.
+	 *
+	 * Each request picks its search:
+	 *	- SEARCH_ASTAR		plain A* over SearchSpace::neighbours();
+	 *	- SEARCH_JPS		A* over SearchSpace::successors(), which on a grid
+	 *						are jump points: the same optimal paths with far
+	 *						fewer nodes touched;
+	 *	- SEARCH_JPS_PLUS	the same using precomputed jump distances, when
+	 *						the space has them up to date (online JPS if not);
+	 *	- SEARCH_THETA		any-angle: a node may take its parent's parent
+	 *						when there is line of sight, giving shorter paths
+	 *						that aren't tied to the grid's eight directions;
+	 *	- SEARCH_LAZY_THETA	Theta* that assumes line of sight when relaxing
+	 *						and checks it once, when the node is expanded.
+	 * JPS and Theta paths list only their corners.
+	 */
+	class PathService
+	{
+		public:
+			typedef uint32_t	Ticket;		// 0 is never issued
+
+			enum SEARCH
+			{
+				SEARCH_ASTAR,
+				SEARCH_JPS,
+				SEARCH_JPS_PLUS,
+				SEARCH_THETA,
+				SEARCH_LAZY_THETA
+			};
+
+			enum STATUS
+			{
+				PATH_PENDING,
+				PATH_FOUND,
+				PATH_FAILED,		// no path, or start/goal not on walkable space
+				PATH_INVALID		// unknown or released ticket
+			};
+
+			struct Stats
+			{
+				uint32_t	requests;
+				uint32_t	cached;			// answered by a cached or queued entry
+				uint32_t	suffixes;		// answered by the tail of a cached path
+				uint32_t	searches;		// searches completed
+				uint32_t	expansions;		// nodes expanded
+				uint32_t	sight_checks;	// line of sight tests (Theta*)
+			};
+
+			explicit PathService(SearchSpace const & space, size_t cache_size = 256);
+
+			Ticket		request(POINT2 const & start, POINT2 const & goal, SEARCH search = SEARCH_ASTAR);
+			STATUS		status(Ticket t) const;
+
+			// Waypoints from the request's start to its goal; false unless PATH_FOUND
+			bool		path(Ticket t, std::vector<POINT2> & out) const;
+
+			// Node path; false unless PATH_FOUND
+			bool		nodes(Ticket t, std::vector<int32_t> & out) const;
+
+			void		release(Ticket t);
+
+			// Search for at most budget_us microseconds
+			void		update(float budget_us);
+
+			size_t			pending() const		{ return queue_.size(); }
+			Stats const &	stats()	const		{ return stats_; }
+			void			resetStats();
+
+		private:
+			enum ENTRY_STATE { ENTRY_FREE, ENTRY_PENDING, ENTRY_FOUND, ENTRY_FAILED };
+
+			struct Entry
+			{
+				uint64_t				key;
+				int32_t					start, goal;
+				uint32_t				version;
+				uint8_t					state;
+				uint8_t					search;
+				uint32_t				pins;			// live tickets
+				int32_t					prev, next;		// LRU list, most recent first
+				std::vector<int32_t>	path;
+			};
+
+			struct Request
+			{
+				POINT2		start, goal;
+				int32_t		entry;			// -1 for a request that failed outright
+				uint32_t	generation;
+				bool		live;
+			};
+
+			typedef std::pair<float, int32_t>	OpenNode;	// (f, node)
+
+			SearchSpace const &		space_;
+			size_t					cache_size_;
+
+			std::vector<Entry>		entries_;
+			std::vector<int32_t>	free_entries_;
+			std::unordered_map<uint64_t, int32_t>	index_;
+			int32_t					head_, tail_;
+
+			std::vector<Request>	requests_;
+			std::vector<uint32_t>	free_requests_;
+
+			std::deque<int32_t>		queue_;			// entries waiting to be searched
+			int32_t					active_;		// entry whose search is in the pools
+			uint32_t				active_version_;
+
+			// Search pools
+			std::vector<float>		g_;
+			std::vector<int32_t>	parent_;
+			std::vector<uint32_t>	seen_, closed_;	// == stamp_ when set for this search
+			std::vector<OpenNode>	open_;
+			uint32_t				stamp_;
+
+			Stats					stats_;
+
+			Request const *	find(Ticket t) const;
+			int32_t	allocate(uint64_t key, int32_t start, int32_t goal, SEARCH search);
+			void	touch(int32_t e);
+			void	unlink(int32_t e);
+			bool	suffix(int32_t e);
+			void	begin(int32_t e);
+			bool	search(int32_t e, int64_t deadline_us);
+			float	estimate(Entry const & en, int32_t n) const;
+
+			PathService & operator=(PathService const &);
+	};
+
+} // close namespace 'ai'
+
+#endif
@@ -0,0 +1,239 @@
+/* ********************************************************************************* *
+ * *  File: Planner.h                                                              * *
+ * *  ---------------                                                              * *
+ * *  COPYRIGHT NOTICE                                                             * *
+ * *  ----------------                                                             * *
+ * *  (C)[2012] - [2015] Deakin University                                         * *
+ * *  All rights reserved.                                                         * *
+ * *  All information contained herein is, and remains the property of Deakin      * *
+ * *  University and the author (Tim Wilkin).                                      * *
+ * *  Dissemination of this information or reproduction of this material is        * *
+ * *  strictly forbidden unless prior written permission is obtained from Deakin   * *
+ * *  University.The right to create derivative works from this material is        * *
+ * *  hereby granted to students enrolled in SIT255, but only for the purposes of  * *
+ * *  assessment while an enrolled student at Deakin University.                   * *
+ * *                                                                               * *
+ * ********************************************************************************* */
+
+#ifndef PLANNER_H
+#define PLANNER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "ai/BehaviourTree.h"
+
+/*
+ * Open namespace: ai
+ */
+namespace ai { // open namespace 'ai'
+
+	/*
+	 * World states are 64 facts, one bit each. A Condition holds on a state
+	 * when the bits in mask have the values in value.
+	 */
+	typedef uint64_t	WorldState;
+
+	struct Condition
+	{
+		WorldState	mask, value;
+
+		Condition() : mask(0), value(0) {}
+		Condition(WorldState m, WorldState v) : mask(m), value(v & m) {}
+
+		bool	holds(WorldState s) const	{ return (s & mask) == value; }
+		WorldState	apply(WorldState s) const	{ return (s & ~mask) | value; }		// as an effect
+	};
+
+	/*
+	 * Planner	Goal-oriented action planning shared by many agents.
+	 *
+	 * Actions have a cost, a precondition and an effect over the facts, and
+	 * optionally a Leaf that performs them. request() asks for the cheapest
+	 * action sequence from a state to a goal and returns a ticket to poll,
+	 * in the manner of PathService:
+	 *	- requests are keyed by (start state, goal); an entry with the same
+	 *	  key, finished or still queued, is shared, so agents in the same
+	 *	  situation cost one search;
+	 *	- entries form an LRU cache of cache_size plans; entries referenced
+	 *	  by live tickets are never evicted.
+	 *
+	 * update() expands at most budget nodes per call, suspending a search
+	 * mid-way, so hundreds of agents replanning at once spread over ticks
+	 * instead of spiking one. A search holds at most max_nodes states; past
+	 * that it opens no new ones and fails (PLAN_FAILED) unless one it has
+	 * reaches the goal. Nodes, the open heap and the visited table are pools
+	 * reused by every search.
+	 *
+	 * Each action names world-change flags it depends on (e.g. a flag
+	 * raised when the map or an ammo depot changes). A plan records the
+	 * flags of every action usable from a state its search expanded, and
+	 * invalidate(flags) drops the cached plans that could have come out
+	 * differently. Changing an action's cost or enabling it invalidates its
+	 * flags; for an action without flags, and for adding an action, every
+	 * cached plan is dropped. Tickets already holding a dropped plan keep it.
+	 *
+	 * The heuristic counts unmet goal facts, scaled by the cheapest cost
+	 * per fact any action can set, so it never overestimates.
+	 */
+	class Planner
+	{
+		public:
+			typedef uint32_t	Ticket;		// 0 is never issued
+			typedef uint16_t	ActionId;
+
+			enum STATUS
+			{
+				PLAN_PENDING,
+				PLAN_FOUND,
+				PLAN_FAILED,		// unreachable, or over max_nodes
+				PLAN_INVALID		// unknown or released ticket
+			};
+
+			struct Stats
+			{
+				uint32_t	requests;
+				uint32_t	cached;			// answered by a cached or queued entry
+				uint32_t	searches;		// searches completed
+				uint32_t	expansions;		// nodes expanded
+			};
+
+			explicit Planner(size_t cache_size = 256, size_t max_nodes = 4096);
+
+			ActionId	addAction(char const * name, float cost, Condition const & pre, Condition const & effect,
+							uint32_t flags = 0, Leaf perform = 0, int32_t param = 0);
+
+			void		setCost(ActionId a, float cost);
+			void		setEnabled(ActionId a, bool enabled);
+
+			std::string const &	name(ActionId a) const				{ return actions_[a].name; }
+			Condition const &	precondition(ActionId a) const		{ return actions_[a].pre; }
+			Condition const &	effect(ActionId a) const			{ return actions_[a].effect; }
+
+			// Run an action's Leaf; actions without one succeed at once
+			ai::STATUS	perform(ActionId a, void * context, uint32_t agent) const;
+
+			Ticket		request(WorldState start, Condition const & goal);
+			STATUS		status(Ticket t) const;
+
+			// Actions in order; false unless PLAN_FOUND
+			bool		plan(Ticket t, std::vector<ActionId> & out) const;
+
+			void		release(Ticket t);
+
+			// Drop cached plans depending on any of flags
+			void		invalidate(uint32_t flags);
+
+			// Expand at most budget nodes
+			void		update(size_t budget);
+
+			size_t			pending() const		{ return queue_.size(); }
+			Stats const &	stats() const		{ return stats_; }
+			void			resetStats();
+
+		private:
+			enum ENTRY_STATE { ENTRY_FREE, ENTRY_PENDING, ENTRY_FOUND, ENTRY_FAILED };
+
+			struct Action
+			{
+				std::string		name;
+				float			cost;
+				Condition		pre, effect;
+				uint32_t		flags;
+				Leaf			perform;
+				int32_t			param;
+				bool			enabled;
+			};
+
+			struct Key
+			{
+				WorldState	start, mask, value;
+
+				bool operator==(Key const & k) const	{ return start == k.start && mask == k.mask && value == k.value; }
+			};
+
+			struct KeyHash
+			{
+				size_t operator()(Key const & k) const;
+			};
+
+			struct Entry
+			{
+				Key						key;
+				uint32_t				version;		// of the action set
+				uint32_t				depends;		// flags of actions the search could use
+				uint8_t					state;
+				uint32_t				pins;			// live tickets
+				int32_t					prev, next;		// LRU list, most recent first
+				std::vector<ActionId>	plan;
+			};
+
+			struct Request
+			{
+				int32_t		entry;
+				uint32_t	generation;
+				bool		live;
+			};
+
+			struct Node
+			{
+				WorldState	state;
+				float		g;
+				int32_t		parent;
+				ActionId	action;
+				bool		closed;
+			};
+
+			typedef std::pair<float, int32_t>	OpenNode;	// (f, node)
+
+			std::vector<Action>		actions_;
+			float					per_fact_;		// heuristic cost of one unmet fact
+			uint32_t				version_;		// bumped when actions are added
+			size_t					cache_size_;
+			size_t					max_nodes_;
+
+			std::vector<Entry>		entries_;
+			std::vector<int32_t>	free_entries_;
+			std::unordered_map<Key, int32_t, KeyHash>	index_;
+			int32_t					head_, tail_;
+
+			std::vector<Request>	requests_;
+			std::vector<uint32_t>	free_requests_;
+
+			std::deque<int32_t>		queue_;			// entries waiting to be searched
+			int32_t					active_;		// entry whose search is in the pools
+
+			// Search pools
+			std::vector<Node>		nodes_;
+			std::vector<OpenNode>	open_;
+			std::vector<WorldState>	visit_state_;	// open addressed: state -> best node
+			std::vector<int32_t>	visit_node_;
+			std::vector<uint32_t>	visit_stamp_;	// == stamp_ when the slot is used this search
+			uint32_t				stamp_;
+			uint32_t				active_version_;
+			uint32_t				depends_;		// of the active search
+
+			Stats					stats_;
+
+			Request const *	find(Ticket t) const;
+			int32_t	allocate(Key const & key);
+			void	touch(int32_t e);
+			void	unlink(int32_t e);
+			void	forget(int32_t e);
+			void	begin(int32_t e);
+			bool	search(int32_t e, size_t & budget);
+			float	estimate(WorldState s, Condition const & goal) const;
+			size_t	visit(WorldState s);
+			void	rescale();
+
+			Planner(Planner const &);
+			Planner & operator=(Planner const &);
+	};
+
+} // close namespace 'ai'
+
+#endif
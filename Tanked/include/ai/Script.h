@@ -0,0 +1,264 @@
+/* ********************************************************************************* *
+ * *  File: Script.h                                                               * *
+ * *  --------------                                                               * *
+ * *  COPYRIGHT NOTICE                                                             * *
+ * *  ----------------                                                             * *
+ * *  (C)[2012] - [2015] Deakin University                                         * *
+ * *  All rights reserved.                                                         * *
+ * *  All information contained herein is, and remains the property of Deakin      * *
+ * *  University and the author (Tim Wilkin).                                      * *
+ * *  Dissemination of this information or reproduction of this material is        * *
+ * *  strictly forbidden unless prior written permission is obtained from Deakin   * *
+ * *  University.The right to create derivative works from this material is        * *
+ * *  hereby granted to students enrolled in SIT255, but only for the purposes of  * *
+ * *  assessment while an enrolled student at Deakin University.                   * *
+ * *                                                                               * *
+ * ********************************************************************************* */
+
+#ifndef SCRIPT_H
+#define SCRIPT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <coroutine>
+#include <exception>
+#include <vector>
+
+/*
+ * Open namespace: ai
+ */
+namespace ai { // open namespace 'ai'
+
+	class ScriptScheduler;
+
+	/*
+	 * Coroutine frames come from size-class free lists carved from large
+	 * blocks, not the heap; frames too big for the classes fall back to it.
+	 * Each thread has its own pool, so it takes no lock: a script must be
+	 * created and destroyed on one thread (its scheduler's), and the
+	 * scheduler destroyed before that thread exits.
+	 */
+	void *	allocate_frame(size_t size);
+	void	free_frame(void * p, size_t size);
+
+	/*
+	 * Script	An agent routine written as a C++20 coroutine:
+	 *
+	 *		Script patrol(ScriptScheduler & s, Tank & tank)
+	 *		{
+	 *			for (;;)
+	 *			{
+	 *				co_await drive_to(s, tank, waypoint);		// another Script
+	 *				co_await s.sleep(2.0f);
+	 *				for (int i = 0; i < 3; ++i)
+	 *				{
+	 *					tank.fire();
+	 *					co_await s.wait(reloaded);
+	 *				}
+	 *			}
+	 *		}
+	 *
+	 * A Script starts suspended and runs once given to ScriptScheduler::start.
+	 * Awaiting a Script runs it as a subroutine on the same agent; a script
+	 * must be started or awaited, never both.
+	 */
+	class Script
+	{
+		public:
+			struct promise_type;
+			typedef std::coroutine_handle<promise_type>	Handle;
+
+			struct promise_type
+			{
+				ScriptScheduler *			scheduler;
+				int32_t						record;			// scheduler slot of the agent running it
+				std::coroutine_handle<>		caller;			// the script awaiting this one, if any
+
+				promise_type() : scheduler(0), record(-1) {}
+
+				Script					get_return_object()		{ return Script(Handle::from_promise(*this)); }
+				std::suspend_always		initial_suspend()		{ return std::suspend_always(); }
+				void					return_void()			{}
+				void					unhandled_exception()	{ std::terminate(); }
+
+				// Finishing returns to the caller; a started script stays suspended for the scheduler
+				struct Final
+				{
+					bool	await_ready() noexcept		{ return false; }
+					void	await_resume() noexcept		{}
+					std::coroutine_handle<> await_suspend(Handle h) noexcept;
+				};
+
+				Final	final_suspend() noexcept		{ return Final(); }
+
+				static void *	operator new(size_t size)				{ return allocate_frame(size); }
+				static void		operator delete(void * p, size_t size)	{ free_frame(p, size); }
+			};
+
+			Script() {}
+			Script(Script && s) : handle_(s.handle_)	{ s.handle_ = Handle(); }
+			~Script()									{ if (handle_) handle_.destroy(); }
+
+			Script & operator=(Script && s);
+
+			// Awaiting a script runs it to completion before resuming the caller
+			bool	await_ready() const		{ return !handle_ || handle_.done(); }
+			void	await_resume() const	{}
+			template <typename P>
+			std::coroutine_handle<> await_suspend(std::coroutine_handle<P> caller);
+
+		private:
+			Handle	handle_;
+
+			explicit Script(Handle h) : handle_(h) {}
+
+			Script(Script const &);
+			Script & operator=(Script const &);
+
+			friend class ScriptScheduler;
+	};
+
+	/*
+	 * ScriptScheduler	Runs Scripts, resuming only those whose wait is over.
+	 *
+	 * A suspended script is a record linked into exactly one list:
+	 *	- timers:	a two level timer wheel of 256 slots each, one slot per
+	 *				tick then one per 256 ticks, with an overflow list past
+	 *				65536 ticks. Each tick fires one slot, and every 256th
+	 *				tick spreads the next second-level slot over the first;
+	 *	- events:	one list per EventId, emptied by signal();
+	 *	- ready:	scripts to resume on the next update().
+	 *
+	 * update() touches only the slot whose time has come and the ready
+	 * list, so a suspended script costs nothing until its wait ends.
+	 * Conditions are not polled every tick: until(event, test) re-tests only
+	 * when event is signalled, and until(test, period) only every period.
+	 *
+	 * Scripts are resumed on the calling thread in the order their waits
+	 * ended. A script signalling an event resumes its waiters on the next
+	 * update(), never recursively.
+	 */
+	class ScriptScheduler
+	{
+		public:
+			typedef uint32_t	Id;			// 0 is never issued
+			typedef uint32_t	EventId;
+			typedef bool		(*Test)(void * context, uint32_t agent);
+
+			static const uint32_t	WHEEL_BITS = 8;
+			static const uint32_t	WHEEL_SIZE = 1u << WHEEL_BITS;
+
+			explicit ScriptScheduler(float tick = 1.0f / 60.0f);
+			~ScriptScheduler();
+
+			// Take a script to run for agent; it first runs on the next update()
+			Id			start(Script && script, uint32_t agent = 0);
+
+			// Destroy a script (and the scripts it awaits) where it is suspended
+			void		kill(Id id);
+			bool		running(Id id) const;
+
+			EventId		event();
+			void		signal(EventId e);
+
+			// Advance time by dt and resume scripts whose waits ended
+			void		update(float dt);
+
+			uint32_t	now() const			{ return now_; }		// ticks
+			float		tick() const		{ return tick_; }
+			size_t		scripts() const		{ return live_; }
+
+			/*
+			 * Awaitables, for use inside scripts run by this scheduler
+			 */
+			struct Awaiter
+			{
+				ScriptScheduler *	scheduler;
+				uint32_t			kind, arg;
+				Test				test;
+				void *				context;
+
+				bool	await_ready() const		{ return false; }
+				void	await_resume() const	{}
+				template <typename P>
+				bool	await_suspend(std::coroutine_handle<P> h)
+				{
+					return scheduler->suspend(h.promise().record, h, *this);
+				}
+			};
+
+			// Resume after seconds (at least one tick)
+			Awaiter		sleep(float seconds);
+			Awaiter		ticks(uint32_t n);
+			Awaiter		yield()				{ return ticks(1); }
+
+			// Resume when e is signalled
+			Awaiter		wait(EventId e);
+
+			// Resume once test(context, agent) holds, testing it when e is signalled
+			Awaiter		until(EventId e, Test test, void * context);
+
+			// Resume once test(context, agent) holds, testing it every period seconds
+			Awaiter		until(Test test, void * context, float period);
+
+		private:
+			enum WAIT { WAIT_TIMER, WAIT_EVENT, WAIT_POLL };
+
+			struct Record
+			{
+				Script::Handle				root;
+				std::coroutine_handle<>		resume;			// innermost script awaiting
+				uint32_t					agent;
+				uint32_t					generation;
+				int32_t						list;			// -1 when running
+				int32_t						prev, next;
+				uint32_t					due;			// tick, for timers
+				uint32_t					period;			// ticks, for polls
+				Test						test;
+				void *						context;
+			};
+
+			struct List
+			{
+				int32_t		head, tail;
+			};
+
+			float					tick_;
+			float					elapsed_;		// time not yet a whole tick
+			uint32_t				now_;
+
+			std::vector<Record>		records_;
+			std::vector<uint32_t>	free_records_;
+			size_t					live_;
+			int32_t					running_;		// record being resumed
+
+			// ready, resuming, first wheel, second wheel, overflow, then one per event
+			std::vector<List>		lists_;
+
+			void	link(int32_t r, int32_t list);
+			void	unlink(int32_t r);
+			void	schedule(int32_t r, uint32_t due);
+			void	advance();
+			void	run(int32_t r);
+			bool	suspend(int32_t r, std::coroutine_handle<> h, Awaiter const & a);
+			Record const *	find(Id id) const;
+
+			ScriptScheduler(ScriptScheduler const &);
+			ScriptScheduler & operator=(ScriptScheduler const &);
+
+			friend class Script;
+	};
+
+	template <typename P>
+	std::coroutine_handle<> Script::await_suspend(std::coroutine_handle<P> caller)
+	{
+		promise_type & p = handle_.promise();
+		p.scheduler = caller.promise().scheduler;
+		p.record = caller.promise().record;
+		p.caller = caller;
+		return handle_;
+	}
+
+} // close namespace 'ai'
+
+#endif
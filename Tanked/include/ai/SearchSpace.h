@@ -0,0 +1,177 @@
+/* ********************************************************************************* *
+ * *  File: SearchSpace.h                                                          * *
+ * *  -------------------                                                          * *
+ * *  COPYRIGHT NOTICE                                                             * *
+ * *  ----------------                                                             * *
+ * *  (C)[2012] - [2015] Deakin University                                         * *
+ * *  All rights reserved.                                                         * *
+ * *  All information contained herein is, and remains the property of Deakin      * *
+ * *  University and the author (Tim Wilkin).                                      * *
+ * *  Dissemination of this information or reproduction of this material is        * *
+ * *  strictly forbidden unless prior written permission is obtained from Deakin   * *
+ * *  University.The right to create derivative works from this material is        * *
+ * *  hereby granted to students enrolled in SIT255, but only for the purposes of  * *
+ * *  assessment while an enrolled student at Deakin University.                   * *
+ * *                                                                               * *
+ * ********************************************************************************* */
+
+#ifndef SEARCH_SPACE_H
+#define SEARCH_SPACE_H
+
+#include <stdint.h>
+#include <vector>
+#include "math/Geometry.h"
+#include "level/OccupancyGrid.h"
+#include "ai/NavMesh.h"
+
+/*
+ * Open namespace: ai
+ */
+namespace ai { // open namespace 'ai'
+
+	/*
+	 * SearchSpace	Graph view of the level for the path searches.
+	 *
+	 * Nodes are dense integer ids (grid cells, navmesh triangles), so
+	 * searches can keep their per-node state in flat arrays indexed by id.
+	 */
+	class SearchSpace
+	{
+		public:
+			static const size_t	MAX_NEIGHBOURS = 8;
+
+			virtual ~SearchSpace() {}
+
+			// Upper bound on node ids
+			virtual size_t		nodes()	const = 0;
+
+			// Node an agent at p is in, -1 if p is not on walkable space
+			virtual int32_t		nodeAt(POINT2 const & p) const = 0;
+
+			virtual POINT2		position(int32_t n) const = 0;
+
+			// Fills up to MAX_NEIGHBOURS ids and step costs, returns the count
+			virtual size_t		neighbours(int32_t n, int32_t * out, float * cost) const = 0;
+
+			// Admissible estimate of the cost from a to b
+			virtual float		heuristic(int32_t a, int32_t b) const = 0;
+
+			// Changes whenever the graph does; cached paths from another version are stale
+			virtual uint32_t	version() const = 0;
+
+			/*
+			 * Jump point successors of n, entered from parent (-1 at the
+			 * start). precomputed asks for table lookups where the space has
+			 * them. Spaces without jump points return neighbours().
+			 */
+			virtual size_t		successors(int32_t n, int32_t parent, int32_t goal, bool precomputed,
+										   int32_t * out, float * cost) const;
+
+			// Is the straight line between two node positions walkable? (any-angle searches)
+			virtual bool		lineOfSight(int32_t /*a*/, int32_t /*b*/) const	{ return false; }
+
+			// Straight-line distance between node positions
+			virtual float		distance(int32_t a, int32_t b) const;
+
+			/*
+			 * Turn a node path into world waypoints from start to goal. The
+			 * default visits every node position.
+			 */
+			virtual void		waypoints(std::vector<int32_t> const & path, POINT2 const & start, POINT2 const & goal,
+										  std::vector<POINT2> & out) const;
+	};
+
+	/*
+	 * GridSpace	8-connected cells of an OccupancyGrid. Diagonal steps may
+	 *				not cut the corner of a blocked cell.
+	 *
+	 * Jump point search follows the same no-corner-cutting rules. Horizontal
+	 * jumps scan the grid's 64-bit row words, with the rows above and below
+	 * supplying the forced-neighbour test, so a jump over open ground costs
+	 * a few word operations per 64 cells. prepareJumps() precomputes the
+	 * jump distance in all eight directions for every cell (JPS+). The table
+	 * is used only while neither the static nor the dynamic layer of the grid
+	 * has changed since; otherwise searches fall back to online jumps. Line
+	 * of sight first asks the grid's pyramid whether the bounding box is
+	 * empty, and only walks the cells when it is not.
+	 */
+	class GridSpace : public SearchSpace
+	{
+		public:
+			explicit GridSpace(level::OccupancyGrid const & grid)
+				: grid_(grid),
+				  jump_version_(0),
+				  jump_dynamic_(0)
+			{}
+
+			size_t		nodes()	const;
+			int32_t		nodeAt(POINT2 const & p) const;
+			POINT2		position(int32_t n) const;
+			size_t		neighbours(int32_t n, int32_t * out, float * cost) const;
+			float		heuristic(int32_t a, int32_t b) const;
+			uint32_t	version() const	{ return grid_.version(); }
+			size_t		successors(int32_t n, int32_t parent, int32_t goal, bool precomputed,
+								   int32_t * out, float * cost) const;
+			bool		lineOfSight(int32_t a, int32_t b) const;
+
+			// Build the JPS+ jump distance table for the grid as it is now
+			void		prepareJumps();
+			bool		jumpsReady() const
+			{
+				return !jumps_.empty() && jump_version_ == grid_.version() && jump_dynamic_ == grid_.dynamicVersion();
+			}
+
+			// Cell centres with the interior points of straight runs removed
+			void		waypoints(std::vector<int32_t> const & path, POINT2 const & start, POINT2 const & goal,
+								  std::vector<POINT2> & out) const;
+
+			level::OccupancyGrid const &	grid() const	{ return grid_; }
+
+		private:
+			level::OccupancyGrid const &	grid_;
+			std::vector<int16_t>			jumps_;		// 8 per cell: steps to the jump point, or -(steps to a wall)
+			uint32_t						jump_version_;
+			uint32_t						jump_dynamic_;
+
+			bool		open(int x, int y) const	{ return !grid_.blocked(x, y); }
+			int32_t		jumpRow(int x, int y, int dx, int32_t goal) const;
+			int32_t		jumpColumn(int x, int y, int dy, int32_t goal) const;
+			int32_t		jumpDiagonal(int x, int y, int dx, int dy, int32_t goal) const;
+			int32_t		jumpTable(int x, int y, int d, int32_t goal) const;
+
+			GridSpace & operator=(GridSpace const &);
+	};
+
+	/*
+	 * NavMeshSpace	Walkable triangles of a NavMesh, stepping between
+	 *				centroids. Waypoints are pulled tight through the shared
+	 *				edges (simple stupid funnel), giving any-angle paths.
+	 */
+	class NavMeshSpace : public SearchSpace
+	{
+		public:
+			explicit NavMeshSpace(NavMesh const & mesh)
+				: mesh_(mesh)
+			{}
+
+			size_t		nodes()	const	{ return mesh_.size(); }
+			int32_t		nodeAt(POINT2 const & p) const;
+			POINT2		position(int32_t n) const	{ return mesh_.centroid(n); }
+			size_t		neighbours(int32_t n, int32_t * out, float * cost) const;
+			float		heuristic(int32_t a, int32_t b) const;
+			uint32_t	version() const	{ return mesh_.version(); }
+
+			void		waypoints(std::vector<int32_t> const & path, POINT2 const & start, POINT2 const & goal,
+								  std::vector<POINT2> & out) const;
+
+			NavMesh const &	mesh() const	{ return mesh_; }
+
+		private:
+			NavMesh const &	mesh_;
+
+			NavMeshSpace & operator=(NavMeshSpace const &);
+	};
+
+} // close namespace 'ai'
+
+#endif
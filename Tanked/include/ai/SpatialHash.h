@@ -0,0 +1,110 @@
+/* ********************************************************************************* *
+ * *  File: SpatialHash.h                                                          * *
+ * *  -------------------                                                          * *
+ * *  COPYRIGHT NOTICE                                                             * *
+ * *  ----------------                                                             * *
+ * *  (C)[2012] - [2015] Deakin University                                         * *
+ * *  All rights reserved.                                                         * *
+ * *  All information contained herein is, and remains the property of Deakin      * *
+ * *  University and the author (Tim Wilkin).                                      * *
+ * *  Dissemination of this information or reproduction of this material is        * *
+ * *  strictly forbidden unless prior written permission is obtained from Deakin   * *
+ * *  University.The right to create derivative works from this material is        * *
+ * *  hereby granted to students enrolled in SIT255, but only for the purposes of  * *
+ * *  assessment while an enrolled student at Deakin University.                   * *
+ * *                                                                               * *
+ * ********************************************************************************* */
+
+#ifndef SPATIAL_HASH_H
+#define SPATIAL_HASH_H
+
+#include <stdint.h>
+#include <cmath>
+#include <vector>
+#include "math/Geometry.h"
+
+/*
+ * Open namespace: ai
+ */
+namespace ai { // open namespace 'ai'
+
+	/*
+	 * SpatialHash	Neighbour queries over moving points held as SoA x and y
+	 *				arrays, rebuilt from scratch every tick.
+	 *
+	 * Points are bucketed by a hash of their grid cell with a counting sort,
+	 * so a build is two linear passes and no allocation once the table has
+	 * grown. The table has a power of two buckets, at least one per point,
+	 * and covers unbounded space. Cells that share a bucket are told apart
+	 * by recomputing each point's cell.
+	 *
+	 * Queries only read, so any number of threads may query at once.
+	 * nearest() orders ties by index, so its answer does not depend on
+	 * bucket layout or thread count.
+	 */
+	class SpatialHash
+	{
+		public:
+			explicit SpatialHash(float cell = 8.0f);
+
+			void	build(float const * x, float const * y, size_t n);
+
+			/*
+			 * Up to max points within radius of (px, py), nearest first,
+			 * skipping index self, with their squared distances in dist_sqr.
+			 * Returns the count written.
+			 */
+			size_t	nearest(float px, float py, float radius, int32_t self, size_t max,
+							int32_t * out, float * dist_sqr) const;
+
+			// Call fn(index) for every point within radius of (px, py), in no particular order
+			template <typename Fn>
+			void	query(float px, float py, float radius, Fn fn) const;
+
+			float	cell() const	{ return cell_; }
+			size_t	size() const	{ return items_.size(); }
+
+		private:
+			float					cell_, inv_cell_;
+			float const *			x_;
+			float const *			y_;
+			uint32_t				mask_;
+			std::vector<uint32_t>	first_;			// bucket start in items_, mask_ + 2 entries
+			std::vector<int32_t>	items_;			// point indices grouped by bucket
+			std::vector<uint32_t>	bucket_;		// per point, during build
+
+			int			cellOf(float v) const		{ return (int)floor(v * inv_cell_); }
+			uint32_t	hash(int cx, int cy) const
+			{
+				return (((uint32_t)cx * 73856093u) ^ ((uint32_t)cy * 19349663u)) & mask_;
+			}
+	};
+
+	template <typename Fn>
+	void SpatialHash::query(float px, float py, float radius, Fn fn) const
+	{
+		if (items_.empty())
+			return;
+
+		float r2 = radius * radius;
+		int cx0 = cellOf(px - radius), cx1 = cellOf(px + radius);
+		int cy0 = cellOf(py - radius), cy1 = cellOf(py + radius);
+		for (int cy = cy0; cy <= cy1; ++cy)
+			for (int cx = cx0; cx <= cx1; ++cx)
+			{
+				uint32_t b = hash(cx, cy);
+				for (uint32_t k = first_[b]; k < first_[b + 1]; ++k)
+				{
+					int32_t i = items_[k];
+					if (cellOf(x_[i]) != cx || cellOf(y_[i]) != cy)
+						continue;		// another cell in the same bucket
+					float dx = x_[i] - px, dy = y_[i] - py;
+					if (dx * dx + dy * dy <= r2)
+						fn(i);
+				}
+			}
+	}
+
+} // close namespace 'ai'
+
+#endif
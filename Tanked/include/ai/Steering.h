@@ -0,0 +1,132 @@
+/* ********************************************************************************* *
+ * *  File: Steering.h                                                             * *
+ * *  ----------------                                                             * *
+ * *  COPYRIGHT NOTICE                                                             * *
+ * *  ----------------                                                             * *
+ * *  (C)[2012] - [2015] Deakin University                                         * *
+ * *  All rights reserved.                                                         * *
+ * *  All information contained herein is, and remains the property of Deakin      * *
+ * *  University and the author (Tim Wilkin).                                      * *
+ * *  Dissemination of this information or reproduction of this material is        * *
+ * *  strictly forbidden unless prior written permission is obtained from Deakin   * *
+ * *  University.The right to create derivative works from this material is        * *
+ * *  hereby granted to students enrolled in SIT255, but only for the purposes of  * *
+ * *  assessment while an enrolled student at Deakin University.                   * *
+ * *                                                                               * *
+ * ********************************************************************************* */
+
+#ifndef STEERING_H
+#define STEERING_H
+
+#include <stdint.h>
+#include <vector>
+#include "math/Geometry.h"
+#include "level/DistanceField.h"
+#include "ai/SpatialHash.h"
+
+/*
+ * Open namespace: ai
+ */
+namespace ai { // open namespace 'ai'
+
+	enum BEHAVIOUR
+	{
+		STEER_SEEK,			// head for the target at full speed
+		STEER_FLEE,			// head away from the target
+		STEER_ARRIVE,		// seek, slowing to a stop at the target
+		STEER_PURSUE,		// seek where the quarry will be
+		STEER_EVADE,		// flee from where the quarry will be
+		STEER_WANDER,		// wander: a target jittering on a circle ahead
+		STEER_WALLS,		// push away from walls closer than wall_range
+		STEER_SEPARATION,	// away from neighbours, harder the closer they are
+		STEER_ALIGNMENT,	// match the neighbours' mean velocity
+		STEER_COHESION,		// seek the neighbours' centre
+		STEER_BEHAVIOURS
+	};
+
+	/*
+	 * Steering		Reynolds steering behaviours for a crowd of point agents.
+	 *
+	 * Agent state is SoA and padded to a whole number of four-lane SSE
+	 * blocks. Each update():
+	 *	- rebuilds a SpatialHash of the positions and gathers up to
+	 *	  max_neighbours neighbours per agent for the flocking terms;
+	 *	- evaluates every behaviour four agents per SSE pass, scaling
+	 *	  each by the agent's weight for it, and sums them;
+	 *	- truncates the blend to the agent's max force;
+	 *	- integrates velocity (truncated to max speed) and position.
+	 * Wall avoidance samples a DistanceField with its batched SSE lookup.
+	 * Forces are all computed from the state at the start of the update,
+	 * with blocks split across threads, so results do not depend on the
+	 * thread count.
+	 *
+	 * Behaviours with zero weight for a whole block are skipped, so agents
+	 * that only wander pay nothing for pursuit or flocking.
+	 */
+	class Steering
+	{
+		public:
+			struct Params
+			{
+				float	slowing_radius;		// arrive starts braking inside this
+				float	wander_radius;		// circle the wander target moves on
+				float	wander_distance;	// how far ahead the circle is
+				float	wander_jitter;		// largest random step per second
+				float	wall_range;			// walls closer than this push back
+				float	neighbour_radius;	// flocking neighbourhood
+				size_t	max_neighbours;		// at most MAX_NEIGHBOURS
+
+				Params();
+			};
+
+			static const size_t	MAX_NEIGHBOURS = 16;
+
+			explicit Steering(Params const & params = Params());
+
+			size_t	add(POINT2 const & p, float max_speed, float max_force);
+			void	clear();
+			size_t	size() const	{ return count_; }
+
+			void	setWalls(level::DistanceField const * field)	{ walls_ = field; }
+			void	setWeight(size_t i, BEHAVIOUR b, float w)		{ weight_[b][i] = w; }
+			void	setTarget(size_t i, POINT2 const & t)			{ target_x_[i] = t.x; target_y_[i] = t.y; }
+			void	setQuarry(size_t i, int32_t agent)				{ quarry_[i] = agent; }
+			void	setPosition(size_t i, POINT2 const & p)			{ x_[i] = p.x; y_[i] = p.y; }
+			void	setVelocity(size_t i, VECTOR2 const & v)		{ vx_[i] = v.x; vy_[i] = v.y; }
+
+			POINT2	position(size_t i) const	{ return POINT2(x_[i], y_[i]); }
+			VECTOR2	velocity(size_t i) const	{ return VECTOR2(vx_[i], vy_[i]); }
+			VECTOR2	force(size_t i) const		{ return VECTOR2(fx_[i], fy_[i]); }
+
+			// Compute the blended forces, then move every agent by them
+			void	update(float dt);
+
+			// The two halves of update(), for callers that post-process forces
+			void	computeForces(float dt);
+			void	integrate(float dt);
+
+		private:
+			Params					params_;
+			size_t					count_;
+			level::DistanceField const *	walls_;
+
+			std::vector<float>		x_, y_, vx_, vy_;
+			std::vector<float>		max_speed_, max_force_;
+			std::vector<float>		target_x_, target_y_;
+			std::vector<int32_t>	quarry_;
+			std::vector<float>		wander_x_, wander_y_;
+			std::vector<uint32_t>	seed_;
+			std::vector<float>		weight_[STEER_BEHAVIOURS];
+			std::vector<float>		fx_, fy_;
+
+			std::vector<int32_t>	neighbours_;		// max_neighbours per agent, -1 padded
+			SpatialHash				hash_;
+
+			void	resize(size_t n);
+			void	block(size_t b, float dt);
+			bool	any(BEHAVIOUR k, size_t b) const;
+	};
+
+} // close namespace 'ai'
+
+#endif
@@ -0,0 +1,128 @@
+/* ********************************************************************************* *
+ * *  File: Utility.h                                                              * *
+ * *  ---------------                                                              * *
+ * *  COPYRIGHT NOTICE                                                             * *
+ * *  ----------------                                                             * *
+ * *  (C)[2012] - [2015] Deakin University                                         * *
+ * *  All rights reserved.                                                         * *
+ * *  All information contained herein is, and remains the property of Deakin      * *
+ * *  University and the author (Tim Wilkin).                                      * *
+ * *  Dissemination of this information or reproduction of this material is        * *
+ * *  strictly forbidden unless prior written permission is obtained from Deakin   * *
+ * *  University.The right to create derivative works from this material is        * *
+ * *  hereby granted to students enrolled in SIT255, but only for the purposes of  * *
+ * *  assessment while an enrolled student at Deakin University.                   * *
+ * *                                                                               * *
+ * ********************************************************************************* */
+
+#ifndef UTILITY_H
+#define UTILITY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+/*
+ * Open namespace: ai
+ */
+namespace ai { // open namespace 'ai'
+
+	enum CURVE
+	{
+		CURVE_LINEAR,		// slope * x + offset
+		CURVE_QUADRATIC,	// slope * (x - centre)^2 + offset
+		CURVE_LOGISTIC,		// 1 / (1 + e^(-slope * (x - centre)))
+		CURVE_TABLE			// piecewise linear through TABLE_POINTS values
+	};
+
+	/*
+	 * Curve	Response curve of one consideration. The raw input is mapped
+	 *			from [lo, hi] to x in [0, 1] (clamped, and reversed if
+	 *			hi < lo), the curve is applied and the score clamped to [0, 1].
+	 */
+	struct Curve
+	{
+		static const size_t	TABLE_POINTS = 17;		// 16 even segments over [0, 1]
+
+		CURVE	type;
+		float	lo, hi;
+		float	slope, centre, offset;
+		float	table[TABLE_POINTS];
+
+		static Curve	linear(float lo, float hi, float slope = 1.0f, float offset = 0.0f);
+		static Curve	quadratic(float lo, float hi, float slope = 1.0f, float centre = 0.0f, float offset = 0.0f);
+		static Curve	logistic(float lo, float hi, float steepness = 10.0f, float midpoint = 0.5f);
+		static Curve	lookup(float lo, float hi, float const (&values)[TABLE_POINTS]);
+
+		float	evaluate(float input) const;		// one score, for tools and checks
+	};
+
+	/*
+	 * Utility		Utility-based action choice for many agents at once.
+	 *
+	 * Inputs (distance to enemy, health, ammo, ...) are SoA columns, one
+	 * float per agent. An action's score is its weight times the product of
+	 * its considerations' curve outputs, with the usual compensation so
+	 * actions with many considerations are not punished for it. decide()
+	 * scores every action for blocks of agents four lanes at a time with
+	 * SSE, keeping a running arg-max per agent, so the inputs of a block
+	 * stay in cache across all the actions. Blocks run on the job system.
+	 *
+	 * Inertia multiplies the score of each agent's previous choice by
+	 * (1 + inertia), so agents do not flip between near-equal actions.
+	 */
+	class Utility
+	{
+		public:
+			typedef uint32_t	InputId;
+			typedef uint32_t	ActionId;
+
+			static const uint32_t	NONE = 0xffffffffu;
+
+			explicit Utility(size_t agents = 0);
+
+			void		resize(size_t agents);
+			size_t		size() const	{ return count_; }
+
+			InputId		addInput();
+			void		setInput(InputId input, size_t agent, float value)	{ inputs_[input][agent] = value; }
+			float *		input(InputId input)	{ return &inputs_[input][0]; }		// size() values, for bulk fills
+
+			ActionId	addAction(float weight = 1.0f);
+			void		addConsideration(ActionId action, InputId input, Curve const & curve);
+			size_t		actions() const		{ return actions_.size(); }
+
+			// Pick each agent's best action; NONE where every score is zero
+			void		decide(float inertia = 0.0f);
+
+			ActionId	choice(size_t agent) const	{ return choice_[agent]; }
+			float		score(size_t agent) const	{ return score_[agent]; }
+
+		private:
+			static const size_t		BLOCK = 256;		// agents scored together
+
+			struct Consideration
+			{
+				InputId		input;
+				Curve		curve;
+			};
+
+			struct Action
+			{
+				float						weight;
+				std::vector<Consideration>	considerations;
+			};
+
+			size_t					count_;			// agents
+			size_t					padded_;		// to a multiple of four
+			std::vector<std::vector<float>>		inputs_;
+			std::vector<Action>		actions_;
+			std::vector<ActionId>	choice_;
+			std::vector<float>		score_;
+
+			void	block(size_t first, size_t last, float inertia);
+	};
+
+} // close namespace 'ai'
+
+#endif
@@ -0,0 +1,100 @@
+/* ********************************************************************************* *
+ * *  File: VisibilityGraph.h                                                      * *
+ * *  -----------------------                                                      * *
+ * *  COPYRIGHT NOTICE                                                             * *
+ * *  ----------------                                                             * *
+ * *  (C)[2012] - [2015] Deakin University                                         * *
+ * *  All rights reserved.                                                         * *
+ * *  All information contained herein is, and remains the property of Deakin      * *
+ * *  University and the author (Tim Wilkin).                                      * *
+ * *  Dissemination of this information or reproduction of this material is        * *
+ * *  strictly forbidden unless prior written permission is obtained from Deakin   * *
+ * *  University.The right to create derivative works from this material is        * *
+ * *  hereby granted to students enrolled in SIT255, but only for the purposes of  * *
+ * *  assessment while an enrolled student at Deakin University.                   * *
+ * *                                                                               * *
+ * ********************************************************************************* */
+
+#ifndef VISIBILITY_GRAPH_H
+#define VISIBILITY_GRAPH_H
+
+#include <stdint.h>
+#include <utility>
+#include <vector>
+#include "math/Geometry.h"
+#include "level/ConfigSpace.h"
+
+/*
+ * Open namespace: ai
+ */
+namespace ai { // open namespace 'ai'
+
+	/*
+	 * VisibilityGraph	Shortest paths among a few dozen walls, for an agent
+	 *					planned as a point against InflatedWalls.
+	 *
+	 * Each wall's capsule is enclosed in a convex hull: its two sides plus a
+	 * few tangents round each end cap. The hull corners, nudged just
+	 * outside, are the graph nodes; corners inside another hull are
+	 * dropped. Two nodes are linked when the segment between them crosses
+	 * no hull edge. Paths are therefore shortest around the hulls and never
+	 * enter a capsule, though they turn a little wide of its caps.
+	 *
+	 * Links are found by a rotational sweep around each node: the other
+	 * nodes sorted by angle, hull edges entering and leaving an active list
+	 * as the sweep passes their angular span, each node tested only against
+	 * the active edges. Hulls of joined walls overlap, so the active edges
+	 * are a flat list rather than a tree ordered by distance. Nodes are swept
+	 * in parallel, each writing only its own links.
+	 *
+	 * A query tests start and goal against every node in one batched
+	 * InflatedWalls::lineOfSight() call, then runs A* over the graph.
+	 */
+	class VisibilityGraph
+	{
+		public:
+			VisibilityGraph();
+
+			// inflated must outlive the graph, built from the same walls
+			void	build(std::vector<Segment> const & walls, level::InflatedWalls const & inflated);
+
+			/*
+			 * Waypoints from start to goal, both included. false if either is
+			 * inside the inflated walls or there is no way round.
+			 */
+			bool	findPath(POINT2 const & start, POINT2 const & goal, std::vector<POINT2> & out, float * cost = 0);
+
+			size_t			nodes() const				{ return nodes_.size(); }
+			size_t			links() const				{ return adj_.size() / 2; }
+			POINT2 const &	node(size_t i) const		{ return nodes_[i]; }
+			uint32_t		expansions() const			{ return expansions_; }		// by the last query
+
+		private:
+			typedef std::pair<float, int32_t>	OpenNode;
+
+			level::InflatedWalls const *	inflated_;
+			std::vector<POINT2>		nodes_;
+			std::vector<POINT2>		corners_;			// hull of each wall, counter clockwise
+
+			// Links as compressed rows
+			std::vector<uint32_t>	first_;
+			std::vector<int32_t>	adj_;
+			std::vector<float>		length_;
+
+			// Query pools (start and goal take the two ids after the nodes)
+			std::vector<POINT2>		from_, to_;
+			std::vector<uint8_t>	visible_;
+			std::vector<float>		g_;
+			std::vector<int32_t>	parent_;
+			std::vector<uint32_t>	seen_, closed_;
+			std::vector<OpenNode>	open_;
+			uint32_t				stamp_;
+			uint32_t				expansions_;
+
+			bool	inside(POINT2 const & p) const;
+			void	sweep(int32_t v, std::vector<int32_t> & out) const;
+	};
+
+} // close namespace 'ai'
+
+#endif
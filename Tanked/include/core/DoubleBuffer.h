@@ -0,0 +1,180 @@
+/* ********************************************************************************* *
+ * *  File: DoubleBuffer.h                                                         * *
+ * *  --------------------                                                         * *
+ * *  COPYRIGHT NOTICE                                                             * *
+ * *  ----------------                                                             * *
+ * *  (C)[2012] - [2015] Deakin University                                         * *
+ * *  All rights reserved.                                                         * *
+ * *  All information contained herein is, and remains the property of Deakin      * *
+ * *  University and the author (Tim Wilkin).                                      * *
+ * *  Dissemination of this information or reproduction of this material is        * *
+ * *  strictly forbidden unless prior written permission is obtained from Deakin   * *
+ * *  University.The right to create derivative works from this material is        * *
+ * *  hereby granted to students enrolled in SIT255, but only for the purposes of  * *
+ * *  assessment while an enrolled student at Deakin University.                   * *
+ * *                                                                               * *
+ * ********************************************************************************* */
+
+#ifndef DOUBLEBUFFER_H
+#define DOUBLEBUFFER_H
+
+#include <stdint.h>
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+#include "core/Parallel.h"
+
+/*
+ * Open namespace: core
+ */
+namespace core { // open namespace 'core'
+
+	/*
+	 * DoubleBuffer		Two copies of per-entity state for deterministic ticks.
+	 *
+	 * A tick reads only previous() and writes only next(i) for the entity it
+	 * is updating, so no update sees another's result from the same tick and
+	 * the outcome cannot depend on update order or thread count. Writes that
+	 * land on other entities go through a Reduction. swap() then makes next
+	 * the new previous by flipping an index; nothing is copied.
+	 *
+	 *	state.update([](size_t i, std::vector<Agent> const & prev, Agent & next) { ... });
+	 *	hits.reduce([&](uint32_t target, float damage) { state.next(target).health -= damage; });
+	 *	state.swap();
+	 */
+	template <typename T>
+	class DoubleBuffer
+	{
+		public:
+			explicit DoubleBuffer(size_t n = 0, T const & value = T())
+				: front_(0)
+			{
+				buffers_[0].assign(n, value);
+				buffers_[1].assign(n, value);
+			}
+
+			size_t		size() const				{ return buffers_[front_].size(); }
+
+			std::vector<T> const &	previous() const		{ return buffers_[front_]; }
+			T const &				previous(size_t i) const	{ return buffers_[front_][i]; }
+
+			std::vector<T> &		next()					{ return buffers_[front_ ^ 1]; }
+			T &						next(size_t i)			{ return buffers_[front_ ^ 1][i]; }
+
+			// Add an entity with the same state in both copies
+			void	push_back(T const & value)
+			{
+				buffers_[0].push_back(value);
+				buffers_[1].push_back(value);
+			}
+
+			void	resize(size_t n, T const & value = T())
+			{
+				buffers_[0].resize(n, value);
+				buffers_[1].resize(n, value);
+			}
+
+			void	swap()		{ front_ ^= 1; }
+
+			/*
+			 * fn(i, previous(), next(i)) for every entity, spread over the
+			 * job system. Does not swap, so reductions can still be applied
+			 * to next().
+			 */
+			template <typename Fn>
+			void	update(JobSystem & jobs, Fn fn, size_t grain = 64)
+			{
+				std::vector<T> const & prev = buffers_[front_];
+				std::vector<T> & next = buffers_[front_ ^ 1];
+				parallel_for(jobs, 0, prev.size(), grain, [&prev, &next, &fn](size_t first, size_t last)
+				{
+					for (size_t i = first; i < last; ++i)
+						fn(i, prev, next[i]);
+				});
+			}
+
+			template <typename Fn>
+			void	update(Fn fn, size_t grain = 64)
+			{
+				update(JobSystem::instance(), fn, grain);
+			}
+
+		private:
+			std::vector<T>	buffers_[2];
+			unsigned		front_;
+	};
+
+	/*
+	 * Reduction	Writes that entities make to other entities during a tick.
+	 *
+	 * Each range of a parallel update takes a Writer and emits
+	 * (source, target, value) triples; they are merged when the Writer goes
+	 * out of scope. reduce() then folds them ordered by target, source and
+	 * emission order, which depend only on entity ids, so even floating point
+	 * sums come out bit-identical for any number of threads. Every triple of
+	 * one source must be emitted through one Writer, as happens when the
+	 * ranges partition the entities.
+	 */
+	template <typename V>
+	class Reduction
+	{
+		public:
+			struct Entry
+			{
+				uint32_t	target, source;
+				V			value;
+			};
+
+			class Writer
+			{
+				public:
+					explicit Writer(Reduction & owner) : owner_(owner) {}
+					~Writer()	{ owner_.commit(entries_); }
+
+					void	emit(uint32_t source, uint32_t target, V const & value)
+					{
+						Entry e = { target, source, value };
+						entries_.push_back(e);
+					}
+
+				private:
+					Reduction &			owner_;
+					std::vector<Entry>	entries_;
+
+					Writer(Writer const &);
+					Writer & operator=(Writer const &);
+			};
+
+			size_t	size() const	{ return entries_.size(); }
+
+			// fold(target, value) for every entry in canonical order, then clear
+			template <typename Fn>
+			void	reduce(Fn fold)
+			{
+				// Stable, so one source's entries for a target keep emission order
+				std::stable_sort(entries_.begin(), entries_.end(), &Reduction::before);
+				for (size_t i = 0; i < entries_.size(); ++i)
+					fold(entries_[i].target, entries_[i].value);
+				entries_.clear();
+			}
+
+		private:
+			std::mutex			lock_;
+			std::vector<Entry>	entries_;
+
+			void	commit(std::vector<Entry> const & e)
+			{
+				std::lock_guard<std::mutex> lock(lock_);
+				entries_.insert(entries_.end(), e.begin(), e.end());
+			}
+
+			static bool	before(Entry const & a, Entry const & b)
+			{
+				return a.target < b.target || (a.target == b.target && a.source < b.source);
+			}
+	};
+
+} // close namespace 'core'
+
+#endif
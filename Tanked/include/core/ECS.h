@@ -0,0 +1,404 @@
+/* ********************************************************************************* *
+ * *  File: ECS.h                                                                  * *
+ * *  -----------                                                                  * *
+ * *  COPYRIGHT NOTICE                                                             * *
+ * *  ----------------                                                             * *
+ * *  (C)[2012] - [2015] Deakin University                                         * *
+ * *  All rights reserved.                                                         * *
+ * *  All information contained herein is, and remains the property of Deakin      * *
+ * *  University and the author (Tim Wilkin).                                      * *
+ * *  Dissemination of this information or reproduction of this material is        * *
+ * *  strictly forbidden unless prior written permission is obtained from Deakin   * *
+ * *  University.The right to create derivative works from this material is        * *
+ * *  hereby granted to students enrolled in SIT255, but only for the purposes of  * *
+ * *  assessment while an enrolled student at Deakin University.                   * *
+ * *                                                                               * *
+ * ********************************************************************************* */
+
+#ifndef ECS_H
+#define ECS_H
+
+#include <stdint.h>
+#include <cassert>
+#include <functional>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/*
+ * Open namespace: core
+ */
+namespace core { // open namespace 'core'
+
+	/*
+	 * Entity	Generational handle. A destroyed entity's index is reused with a
+	 *			new generation, so stale handles are detected, not aliased.
+	 */
+	struct Entity
+	{
+		uint32_t	index;
+		uint32_t	generation;		// 0 is never issued
+
+		Entity() : index(0), generation(0) {}
+		Entity(uint32_t i, uint32_t g) : index(i), generation(g) {}
+
+		bool operator==(Entity const & e) const	{ return index == e.index && generation == e.generation; }
+		bool operator!=(Entity const & e) const	{ return !(*this == e); }
+	};
+
+	/*
+	 * Component types are plain structs, numbered on first use. A component
+	 * must be default constructible and movable.
+	 */
+	typedef uint32_t	ComponentId;
+	typedef uint64_t	ComponentMask;
+
+	const ComponentId	MAX_COMPONENTS = 64;
+
+	struct ComponentInfo
+	{
+		size_t	size, align;
+		void	(*construct)(void * p);
+		void	(*move)(void * dst, void * src);		// move construct, then destroy src
+		void	(*destroy)(void * p);
+	};
+
+	ComponentId				register_component(ComponentInfo const & info);
+	ComponentInfo const &	component_info(ComponentId id);
+
+	template <typename T>
+	struct Component
+	{
+		static ComponentId id()
+		{
+			static const ComponentId i = register_component(info());
+			return i;
+		}
+
+		static ComponentMask mask()	{ return (ComponentMask)1 << id(); }
+
+		private:
+			static void construct(void * p)				{ new (p) T(); }
+			static void move(void * dst, void * src)	{ new (dst) T(std::move(*(T *)src)); ((T *)src)->~T(); }
+			static void destroy(void * p)				{ ((T *)p)->~T(); }
+
+			static ComponentInfo info()
+			{
+				ComponentInfo c = { sizeof(T), std::alignment_of<T>::value, &construct, &move, &destroy };
+				return c;
+			}
+	};
+
+	template <typename... Cs>
+	inline ComponentMask mask_of()
+	{
+		ComponentMask m = 0;
+		ComponentMask bits[] = { 0, Component<Cs>::mask()... };
+		for (size_t i = 1; i < sizeof(bits) / sizeof(bits[0]); ++i)
+			m |= bits[i];
+		return m;
+	}
+
+	/*
+	 * Archetype	Storage for every entity with exactly one set of components.
+	 *
+	 * Entities live in 16 KB chunks. A chunk holds the entity handles and
+	 * then one packed array per component, so a query walks each array
+	 * linearly. Rows are kept dense: a removal moves the archetype's last
+	 * row into the hole, so every chunk but the last is full.
+	 */
+	class Archetype
+	{
+		public:
+			static const size_t		CHUNK_BYTES = 16 * 1024;
+
+			// 16 byte aligned (allocated with aligned new), as the component arrays in data assume
+			struct alignas(16) Chunk
+			{
+				uint32_t	count;
+				uint32_t	pad[3];
+				uint8_t		data[CHUNK_BYTES - 16];
+			};
+
+			explicit Archetype(ComponentMask mask);
+
+			ComponentMask	mask() const		{ return mask_; }
+			size_t			size() const		{ return size_; }
+			size_t			capacity() const	{ return capacity_; }		// rows per chunk
+			size_t			chunks() const		{ return chunks_.size(); }
+			size_t			chunkSize(size_t c) const	{ return chunks_[c]->count; }
+
+			Entity *		entities(size_t c)	{ return (Entity *)chunks_[c]->data; }
+			void *			column(size_t c, ComponentId id)
+			{
+				return chunks_[c]->data + offset_[id];
+			}
+			template <typename T>
+			T *				column(size_t c)	{ return (T *)column(c, Component<T>::id()); }
+
+			bool	has(ComponentId id) const	{ return (mask_ >> id) & 1; }
+			std::vector<ComponentId> const &	types() const	{ return types_; }
+
+			// Append an uninitialised row for e; returns its (chunk, row)
+			std::pair<uint32_t, uint32_t>	push(Entity e);
+
+			/*
+			 * Remove a row by moving the last row into it. Components are
+			 * destroyed first unless the caller already moved them out.
+			 * Returns the entity that now occupies the row (or an invalid one).
+			 */
+			Entity	erase(uint32_t chunk, uint32_t row, bool destroy);
+
+			void *	at(uint32_t chunk, uint32_t row, ComponentId id)
+			{
+				return chunks_[chunk]->data + offset_[id] + row * stride_[id];
+			}
+
+			~Archetype();
+
+		private:
+			ComponentMask				mask_;
+			std::vector<ComponentId>	types_;
+			size_t						offset_[MAX_COMPONENTS];		// of each column in a chunk
+			size_t						stride_[MAX_COMPONENTS];		// component sizes
+			size_t						capacity_;
+			size_t						size_;
+			std::vector<std::unique_ptr<Chunk>>	chunks_;
+
+			Archetype(Archetype const &);
+			Archetype & operator=(Archetype const &);
+	};
+
+	class CommandBuffer;
+
+	/*
+	 * World	Entities and their components, grouped into archetypes.
+	 *
+	 *	create<A, B>(a, b)			one entity
+	 *	spawn<A, B>(n, a, b)		n entities filled chunk by chunk
+	 *	add<T>(e, v) / remove<T>(e)	move e to the archetype with / without T
+	 *	each<A, B>(fn)				fn(A &, B &) for every entity having both
+	 *	chunks<A, B>(fn)			fn(n, entities, A *, B *) per chunk
+	 *
+	 * Queries find their archetypes through a cache keyed by component mask,
+	 * refreshed only when new archetypes appear. Structural changes (create,
+	 * destroy, add, remove) must not happen inside a query; record them in
+	 * a CommandBuffer and apply it afterwards.
+	 */
+	class World
+	{
+		public:
+			World();
+
+			template <typename... Cs>
+			Entity	create(Cs const &... values);
+
+			template <typename... Cs>
+			void	spawn(size_t n, std::vector<Entity> * out, Cs const &... values);
+
+			void	destroy(Entity e);
+			void	destroy(Entity const * e, size_t n);
+			bool	alive(Entity e) const;
+			size_t	size() const		{ return alive_; }
+
+			template <typename T>
+			T *		get(Entity e);
+
+			template <typename T>
+			bool	has(Entity e) const;
+
+			template <typename T>
+			void	add(Entity e, T const & value);
+
+			template <typename T>
+			void	remove(Entity e);
+
+			template <typename... Cs, typename Fn>
+			void	each(Fn fn);
+
+			template <typename... Cs, typename Fn>
+			void	chunks(Fn fn);
+
+			// Archetypes holding every component in mask
+			std::vector<Archetype *> const &	query(ComponentMask mask);
+
+		private:
+			struct Record
+			{
+				Archetype *		archetype;
+				uint32_t		chunk, row;
+				uint32_t		generation;
+			};
+
+			struct Query
+			{
+				size_t						seen;		// archetypes_.size() when built
+				std::vector<Archetype *>	matches;
+			};
+
+			std::vector<std::unique_ptr<Archetype>>			archetypes_;
+			std::unordered_map<ComponentMask, Archetype *>	by_mask_;
+			std::unordered_map<ComponentMask, Query>		queries_;
+			std::vector<Record>		records_;
+			std::vector<uint32_t>	free_;
+			size_t					alive_;
+
+			Archetype *	archetype(ComponentMask mask);
+			Entity		allocate();
+			void		place(Entity e, Archetype * a);
+			void		move(Entity e, ComponentMask mask);
+
+			template <typename T>
+			static void	write(Archetype * a, uint32_t chunk, uint32_t row, T const & value)
+			{
+				new (a->at(chunk, row, Component<T>::id())) T(value);
+			}
+
+			World(World const &);
+			World & operator=(World const &);
+	};
+
+	/*
+	 * CommandBuffer	Structural changes recorded during a query (or on
+	 *					another thread) and applied in order later.
+	 *
+	 * Entities created through the buffer do not exist until apply();
+	 * created() then holds the handles of those the last apply() made.
+	 */
+	class CommandBuffer
+	{
+		public:
+			template <typename... Cs>
+			void	create(Cs const &... values)
+			{
+				commands_.push_back([values...](World & w, std::vector<Entity> & made)
+				{
+					made.push_back(w.create(values...));
+				});
+			}
+
+			void	destroy(Entity e)
+			{
+				commands_.push_back([e](World & w, std::vector<Entity> &) { w.destroy(e); });
+			}
+
+			template <typename T>
+			void	add(Entity e, T const & value)
+			{
+				commands_.push_back([e, value](World & w, std::vector<Entity> &) { w.add(e, value); });
+			}
+
+			template <typename T>
+			void	remove(Entity e)
+			{
+				commands_.push_back([e](World & w, std::vector<Entity> &) { w.template remove<T>(e); });
+			}
+
+			void	apply(World & w);
+			bool	empty() const	{ return commands_.empty(); }
+
+			std::vector<Entity> const &	created() const	{ return created_; }
+
+		private:
+			std::vector<std::function<void(World &, std::vector<Entity> &)>>	commands_;
+			std::vector<Entity>		created_;
+	};
+
+	/*
+	 * World templates
+	 */
+
+	template <typename... Cs>
+	Entity World::create(Cs const &... values)
+	{
+		Archetype * a = archetype(mask_of<Cs...>());
+		Entity e = allocate();
+		place(e, a);
+		Record const & r = records_[e.index];
+		int expand[] = { 0, (write(a, r.chunk, r.row, values), 0)... };
+		(void)expand;
+		return e;
+	}
+
+	template <typename... Cs>
+	void World::spawn(size_t n, std::vector<Entity> * out, Cs const &... values)
+	{
+		Archetype * a = archetype(mask_of<Cs...>());
+		for (size_t i = 0; i < n; ++i)
+		{
+			Entity e = allocate();
+			place(e, a);
+			Record const & r = records_[e.index];
+			int expand[] = { 0, (write(a, r.chunk, r.row, values), 0)... };
+			(void)expand;
+			if (out)
+				out->push_back(e);
+		}
+	}
+
+	template <typename T>
+	T * World::get(Entity e)
+	{
+		if (!alive(e))
+			return 0;
+		Record const & r = records_[e.index];
+		if (!r.archetype->has(Component<T>::id()))
+			return 0;
+		return (T *)r.archetype->at(r.chunk, r.row, Component<T>::id());
+	}
+
+	template <typename T>
+	bool World::has(Entity e) const
+	{
+		return alive(e) && records_[e.index].archetype->has(Component<T>::id());
+	}
+
+	template <typename T>
+	void World::add(Entity e, T const & value)
+	{
+		if (!alive(e))
+			return;
+		Record const & r = records_[e.index];
+		if (r.archetype->has(Component<T>::id()))
+		{
+			*(T *)r.archetype->at(r.chunk, r.row, Component<T>::id()) = value;
+			return;
+		}
+		move(e, r.archetype->mask() | Component<T>::mask());
+		Record const & moved = records_[e.index];
+		*(T *)moved.archetype->at(moved.chunk, moved.row, Component<T>::id()) = value;
+	}
+
+	template <typename T>
+	void World::remove(Entity e)
+	{
+		if (has<T>(e))
+			move(e, records_[e.index].archetype->mask() & ~Component<T>::mask());
+	}
+
+	template <typename... Cs, typename Fn>
+	void World::each(Fn fn)
+	{
+		chunks<Cs...>([&fn](size_t n, Entity const *, Cs *... columns)
+		{
+			for (size_t i = 0; i < n; ++i)
+				fn(columns[i]...);
+		});
+	}
+
+	template <typename... Cs, typename Fn>
+	void World::chunks(Fn fn)
+	{
+		std::vector<Archetype *> const & matches = query(mask_of<Cs...>());
+		for (size_t a = 0; a < matches.size(); ++a)
+			for (size_t c = 0; c < matches[a]->chunks(); ++c)
+				if (matches[a]->chunkSize(c) > 0)
+					fn(matches[a]->chunkSize(c), matches[a]->entities(c), matches[a]->template column<Cs>(c)...);
+	}
+
+} // close namespace 'core'
+
+#endif
@@ -0,0 +1,150 @@
+/* ********************************************************************************* *
+ * *  File: FrameGraph.h                                                           * *
+ * *  ------------------                                                           * *
+ * *  COPYRIGHT NOTICE                                                             * *
+ * *  ----------------                                                             * *
+ * *  (C)[2012] - [2015] Deakin University                                         * *
+ * *  All rights reserved.                                                         * *
+ * *  All information contained herein is, and remains the property of Deakin      * *
+ * *  University and the author (Tim Wilkin).                                      * *
+ * *  Dissemination of this information or reproduction of this material is        * *
+ * *  strictly forbidden unless prior written permission is obtained from Deakin   * *
+ * *  University.The right to create derivative works from this material is        * *
+ * *  hereby granted to students enrolled in SIT255, but only for the purposes of  * *
+ * *  assessment while an enrolled student at Deakin University.                   * *
+ * *                                                                               * *
+ * ********************************************************************************* */
+
+#ifndef FRAMEGRAPH_H
+#define FRAMEGRAPH_H
+
+#include <stdint.h>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "core/Jobs.h"
+
+/*
+ * Open namespace: core
+ */
+namespace core { // open namespace 'core'
+
+	typedef uint32_t	ResourceId;
+	typedef uint32_t	StageId;
+
+	enum VERSION { VERSION_CURRENT, VERSION_PREVIOUS };
+
+	/*
+	 * Frame	Passed to every stage. A buffered resource has two copies; in
+	 *			frame n the current one is copy n & 1 and the previous frame's
+	 *			is the other.
+	 */
+	struct Frame
+	{
+		uint64_t	number;
+
+		unsigned	current() const		{ return (unsigned)(number & 1); }
+		unsigned	previous() const	{ return (unsigned)((number + 1) & 1); }
+	};
+
+	/*
+	 * FrameGraph	Stages of a frame and the resources each reads and writes.
+	 *
+	 * Stages are declared in the order a serial loop would run them. Two
+	 * stages touching the same copy of a resource, at least one writing it,
+	 * keep that order; anything else runs concurrently on the job system.
+	 * Frames overlap: frame n+1 is launched while frame n finishes, and its
+	 * stages wait only for the frame n stages they conflict with (and for
+	 * their own instance in frame n). Double buffering a resource therefore
+	 * lets simulation of frame n+1 write one copy while rendering of frame
+	 * n reads the other. At most two frames are in flight.
+	 *
+	 *	FrameGraph g;
+	 *	ResourceId world = g.resource("world", true);
+	 *	StageId sim = g.stage("sim", simulate);
+	 *	g.reads(sim, world, VERSION_PREVIOUS);
+	 *	g.writes(sim, world);
+	 *	...
+	 *	while (running)
+	 *		g.submit();
+	 *	g.finish();
+	 */
+	class FrameGraph
+	{
+		public:
+			typedef std::function<void(Frame const &)>	StageFn;
+
+			explicit FrameGraph(JobSystem & jobs = JobSystem::instance());
+			~FrameGraph();
+
+			ResourceId	resource(char const * name, bool buffered = false);
+			StageId		stage(char const * name, StageFn fn);
+
+			void	reads(StageId s, ResourceId r, VERSION v = VERSION_CURRENT);
+			void	writes(StageId s, ResourceId r, VERSION v = VERSION_CURRENT);
+
+			/*
+			 * Launch the next frame, first waiting (and helping) until the
+			 * frame before the previous one is done. The graph is frozen by
+			 * the first call.
+			 */
+			void		submit();
+
+			// Wait for every submitted frame
+			void		finish();
+
+			uint64_t	frames() const		{ return next_; }
+
+			std::string const &	name(StageId s) const	{ return stages_[s].name; }
+
+		private:
+			struct Access
+			{
+				ResourceId	resource;
+				VERSION		version;
+				bool		write;
+			};
+
+			struct Stage
+			{
+				std::string				name;
+				StageFn					fn;
+				std::vector<Access>		access;
+				std::vector<StageId>	next;			// later stages of the same frame waiting on this
+				std::vector<StageId>	after[2];		// stages of the following frame waiting on this, by its parity
+				int						deps;			// same frame stages this waits on
+			};
+
+			struct Slot
+			{
+				uint64_t			number;
+				std::vector<int>	pending;		// unfinished dependencies per stage
+				std::vector<bool>	done;
+				Counter				finished;
+			};
+
+			JobSystem &					jobs_;
+			std::vector<std::string>	resources_;
+			std::vector<bool>			buffered_;
+			std::vector<Stage>			stages_;
+			bool						compiled_;
+			uint64_t					next_;
+			Slot						slots_[2];		// frame n uses slot n & 1
+			std::mutex					lock_;
+
+			void	compile();
+			bool	conflict(Access const & a, uint64_t fa, Access const & b, uint64_t fb) const;
+			bool	conflict(StageId a, uint64_t fa, StageId b, uint64_t fb) const;
+			void	execute(unsigned slot, StageId s);
+
+			static void	run(Job const & job);
+
+			FrameGraph(FrameGraph const &);
+			FrameGraph & operator=(FrameGraph const &);
+	};
+
+} // close namespace 'core'
+
+#endif
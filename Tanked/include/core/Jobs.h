@@ -0,0 +1,196 @@
+/* ********************************************************************************* *
+ * *  File: Jobs.h                                                                 * *
+ * *  ------------                                                                 * *
+ * *  COPYRIGHT NOTICE                                                             * *
+ * *  ----------------                                                             * *
+ * *  (C)[2012] - [2015] Deakin University                                         * *
+ * *  All rights reserved.                                                         * *
+ * *  All information contained herein is, and remains the property of Deakin      * *
+ * *  University and the author (Tim Wilkin).                                      * *
+ * *  Dissemination of this information or reproduction of this material is        * *
+ * *  strictly forbidden unless prior written permission is obtained from Deakin   * *
+ * *  University.The right to create derivative works from this material is        * *
+ * *  hereby granted to students enrolled in SIT255, but only for the purposes of  * *
+ * *  assessment while an enrolled student at Deakin University.                   * *
+ * *                                                                               * *
+ * ********************************************************************************* */
+
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <stdint.h>
+#include <atomic>
+#include <deque>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * Open namespace: core
+ */
+namespace core { // open namespace 'core'
+
+	inline unsigned hardware_threads()
+	{
+		unsigned n = std::thread::hardware_concurrency();
+		return (n > 0) ? n : 1;
+	}
+
+	class Counter;
+	class JobSystem;
+
+	/*
+	 * Job		One unit of work: fn(job) with an opaque data pointer and an
+	 *			index range the function may interpret as it likes. Jobs are
+	 *			copied into the scheduler, so they must not point at themselves.
+	 */
+	struct Job
+	{
+		void		(*fn)(Job const & job);
+		void *		data;
+		size_t		first, last;
+		Counter *	counter;		// decremented when fn returns (may be 0)
+	};
+
+	/*
+	 * Counter	Number of unfinished jobs submitted against it. Waiting on a
+	 *			counter runs other jobs until it reaches zero; a job submitted
+	 *			"after" a counter is parked on it until then.
+	 *
+	 * A counter may be reused once it has been waited on.
+	 */
+	class Counter
+	{
+		public:
+			Counter() : value_(0) {}
+
+			int		value() const	{ return value_.load(std::memory_order_acquire); }
+			bool	done() const	{ return value() == 0; }
+
+		private:
+			friend class JobSystem;
+
+			std::atomic<int>	value_;
+			std::mutex			lock_;
+			std::vector<Job>	waiting_;	// released when value_ reaches 0
+
+			Counter(Counter const &);
+			Counter & operator=(Counter const &);
+	};
+
+	/*
+	 * WorkQueue	Chase-Lev work-stealing deque of fixed capacity. The owning
+	 *				thread pushes and pops at the bottom; any other thread may
+	 *				steal from the top.
+	 */
+	class WorkQueue
+	{
+		public:
+			static const size_t		CAPACITY = 4096;		// power of two
+
+			WorkQueue();
+
+			bool	push(Job * job);		// false when full
+			Job *	pop();
+			Job *	steal();
+
+			bool	empty() const;
+
+		private:
+			std::atomic<int64_t>	top_;
+			char					pad_[64 - sizeof(std::atomic<int64_t>)];	// keep thieves off the owner's line
+			std::atomic<int64_t>	bottom_;
+			std::atomic<Job *>		items_[CAPACITY];
+
+			WorkQueue(WorkQueue const &);
+			WorkQueue & operator=(WorkQueue const &);
+	};
+
+	/*
+	 * JobSystem	Work-stealing scheduler with one deque per thread.
+	 *
+	 * The thread that constructs the system is worker 0 and only runs jobs
+	 * while it waits; hardware_threads() - 1 background workers run them
+	 * all the time and sleep when there is nothing to steal. Other threads
+	 * may submit and wait too; their jobs go through a shared queue.
+	 *
+	 * instance() is created on first use, so call it from the main thread
+	 * before anything else does. Shutdown finishes every queued job before
+	 * joining the workers; jobs submitted after that run inline.
+	 */
+	class JobSystem
+	{
+		public:
+			static JobSystem &	instance();
+
+			explicit JobSystem(unsigned threads = hardware_threads());
+			~JobSystem();
+
+			unsigned	threads() const		{ return (unsigned)workers_.size(); }
+
+			/*
+			 * Queue job, counting it against job.counter now. If after is
+			 * given and not yet done the job is held back until it is.
+			 */
+			void	submit(Job const & job, Counter * after = 0);
+
+			// Run jobs on this thread until c reaches zero
+			void	wait(Counter & c);
+
+			/*
+			 * Count n units of work that are not jobs against c, e.g. stages
+			 * queued later; each is retired by signal(), which releases any
+			 * jobs held back on c as a job finishing would.
+			 */
+			void	hold(Counter & c, int n = 1);
+			void	signal(Counter & c);
+
+			void	shutdown();
+
+		private:
+			static const size_t		POOL = WorkQueue::CAPACITY;
+
+			struct Slot
+			{
+				Job					job;
+				std::atomic<bool>	busy;
+			};
+
+			struct Worker
+			{
+				WorkQueue				queue;
+				std::unique_ptr<Slot[]>	pool;		// jobs referenced by queue
+				size_t					next;
+				uint32_t				seed;		// victim selection
+				std::thread				thread;
+			};
+
+			std::vector<std::unique_ptr<Worker>>	workers_;
+			std::deque<Job>			shared_;		// submitted by other threads
+			std::mutex				shared_lock_;
+			std::atomic<size_t>		shared_size_;
+
+			std::atomic<uint32_t>	epoch_;			// bumped on every submit
+			std::atomic<unsigned>	sleepers_;
+			std::mutex				sleep_lock_;
+			std::condition_variable	wake_;
+			std::atomic<bool>		quit_;
+			std::atomic<bool>		stopped_;
+
+			int		self() const;
+			void	enqueue(Job const & job);
+			bool	take(int self, Job & job);
+			void	execute(Job const & job);
+			void	release(Counter * c);
+			void	notify();
+			void	loop(unsigned index);
+
+			JobSystem(JobSystem const &);
+			JobSystem & operator=(JobSystem const &);
+	};
+
+} // close namespace 'core'
+
+#endif
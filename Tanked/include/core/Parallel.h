@@ -0,0 +1,103 @@
+/* ********************************************************************************* *
+ * *  File: Parallel.h                                                             * *
+ * *  ----------------                                                             * *
+ * *  COPYRIGHT NOTICE                                                             * *
+ * *  ----------------                                                             * *
+ * *  (C)[2012] - [2015] Deakin University                                         * *
+ * *  All rights reserved.                                                         * *
+ * *  All information contained herein is, and remains the property of Deakin      * *
+ * *  University and the author (Tim Wilkin).                                      * *
+ * *  Dissemination of this information or reproduction of this material is        * *
+ * *  strictly forbidden unless prior written permission is obtained from Deakin   * *
+ * *  University.The right to create derivative works from this material is        * *
+ * *  hereby granted to students enrolled in SIT255, but only for the purposes of  * *
+ * *  assessment while an enrolled student at Deakin University.                   * *
+ * *                                                                               * *
+ * ********************************************************************************* */
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+
+#include "core/Jobs.h"
+
+/*
+ * Open namespace: core
+ */
+namespace core { // open namespace 'core'
+
+	/*
+	 * ParallelFor		Shared state of one parallel_for call. Each job halves its
+	 *					range, queues the upper half and keeps the lower, so idle
+	 *					workers always steal the largest pieces left.
+	 */
+	template <typename Fn>
+	struct ParallelFor
+	{
+		Fn *			fn;
+		size_t			grain;
+		JobSystem *		jobs;
+		Counter			done;
+
+		static void run(Job const & job)
+		{
+			ParallelFor & p = *(ParallelFor *)job.data;
+			size_t first = job.first,
+				   last  = job.last;
+
+			while (last - first > p.grain)
+			{
+				size_t mid = first + (last - first) / 2;
+				Job half = { &run, &p, mid, last, &p.done };
+				p.jobs->submit(half);
+				last = mid;
+			}
+			(*p.fn)(first, last);
+		}
+	};
+
+	/*
+	 * parallel_for		Split [begin, end) into contiguous ranges of at least
+	 *					grain indices and call fn(first, last) for each range on
+	 *					the job system, the calling thread included. Returns once
+	 *					every range has completed.
+	 *
+	 * The grain is raised so that no more than about eight ranges are made
+	 * per thread; small loops stay on the calling thread. Ranges are
+	 * disjoint, so fn may write to per-index output without locking, and
+	 * fn may itself call parallel_for.
+	 */
+	template <typename Fn>
+	void parallel_for(JobSystem & jobs, size_t begin, size_t end, size_t grain, Fn fn)
+	{
+		if (end <= begin)
+			return;
+
+		size_t count = end - begin;
+		grain = (std::max)((std::max<size_t>)(grain, 1), count / (jobs.threads() * 8));
+		if (jobs.threads() == 1 || count <= grain)
+		{
+			fn(begin, end);
+			return;
+		}
+
+		ParallelFor<Fn> p;
+		p.fn	= &fn;
+		p.grain	= grain;
+		p.jobs	= &jobs;
+
+		Job root = { &ParallelFor<Fn>::run, &p, begin, end, 0 };
+		ParallelFor<Fn>::run(root);
+		jobs.wait(p.done);
+	}
+
+	template <typename Fn>
+	void parallel_for(size_t begin, size_t end, size_t grain, Fn fn)
+	{
+		parallel_for(JobSystem::instance(), begin, end, grain, fn);
+	}
+
+} // close namespace 'core'
+
+#endif
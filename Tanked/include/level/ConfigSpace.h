@@ -0,0 +1,149 @@
+/* ********************************************************************************* *
+ * *  File: ConfigSpace.h                                                          * *
+ * *  -------------------                                                          * *
+ * *  COPYRIGHT NOTICE                                                             * *
+ * *  ----------------                                                             * *
+ * *  (C)[2012] - [2015] Deakin University                                         * *
+ * *  All rights reserved.                                                         * *
+ * *  All information contained herein is, and remains the property of Deakin      * *
+ * *  University and the author (Tim Wilkin).                                      * *
+ * *  Dissemination of this information or reproduction of this material is        * *
+ * *  strictly forbidden unless prior written permission is obtained from Deakin   * *
+ * *  University.The right to create derivative works from this material is        * *
+ * *  hereby granted to students enrolled in SIT255, but only for the purposes of  * *
+ * *  assessment while an enrolled student at Deakin University.                   * *
+ * *                                                                               * *
+ * ********************************************************************************* */
+
+#ifndef CONFIG_SPACE_H
+#define CONFIG_SPACE_H
+
+#include <stdint.h>
+#include <map>
+#include <memory>
+#include <vector>
+#include "math/Geometry.h"
+#include "physics/Raycast.h"
+#include "level/Terrain.h"
+
+/*
+ * Open namespace: level
+ */
+namespace level { // open namespace 'level'
+
+	/*
+	 * InflatedWalls	Configuration space obstacles for a disc agent of a given
+	 *					radius: the Minkowski sum of every wall Segment with the
+	 *					disc, so that the agent can be planned for as a point.
+	 *
+	 * Each wall becomes a capsule, stored as its two offset sides (ids 2i and
+	 * 2i+1 in a SegmentBVH, normals facing out) and rounded end caps (one
+	 * Circle per distinct end point, in a uniform grid). Rays are traced
+	 * against the sides with the packet tracer and against the caps by
+	 * walking the grid cells along the ray. Where capsules overlap, the
+	 * first surface met from free space is always on the outer boundary.
+	 *
+	 * update() re-inflates only the walls of a changed region. Replacement
+	 * walls reuse the ids of the walls they replace, the sides tree is
+	 * refitted rather than rebuilt, and caps are reference counted by the
+	 * wall ends meeting at them.
+	 */
+	class InflatedWalls
+	{
+		public:
+			InflatedWalls();
+			InflatedWalls(std::vector<Segment> const & walls, float radius);
+
+			void	build(std::vector<Segment> const & walls, float radius);
+
+			// Replace every wall whose bounds overlap region by near, the walls there now
+			void	update(std::vector<Segment> const & near, AABB const & region);
+
+			float						radius() const	{ return radius_; }
+			physics::SegmentBVH const &	sides()	const	{ return sides_; }
+			std::vector<Circle> const &	caps()	const	{ return caps_; }
+
+			// True if a point agent at p overlaps a wall (the disc agent would)
+			bool	blocked(POINT2 const & p) const;
+
+			/*
+			 * First contact of a point moving along the ray with the inflated
+			 * walls. hit.segment is the index of the original wall. A ray
+			 * starting inside is hit at distance 0.
+			 */
+			bool	cast(physics::Ray const & ray, physics::RayHit & hit) const;
+
+			// Can the agent move in a straight line from a to b?
+			bool	lineOfSight(POINT2 const & a, POINT2 const & b) const;
+			void	lineOfSight(POINT2 const * a, POINT2 const * b, uint8_t * visible, size_t n) const;
+
+		private:
+			float					radius_;
+			std::vector<Segment>	walls_;
+			physics::SegmentBVH		sides_;
+			std::vector<int32_t>	free_walls_;	// ids whose sides were removed by update()
+			std::vector<Circle>		caps_;
+			std::vector<int32_t>	cap_wall_;		// wall owning each cap
+			std::vector<uint32_t>	cap_ends_;		// wall ends at each cap, 0 for a free slot
+			std::vector<int32_t>	free_caps_;
+
+			// Uniform grid over the caps
+			AABB								grid_area_;
+			float								grid_cell_;
+			int									gw_, gh_;
+			std::vector<std::vector<int32_t>>	grid_;
+
+			int32_t	overlap(POINT2 const & p) const;		// wall containing p, -1 if none
+			bool	castCaps(POINT2 const & o, VECTOR2 const & d, float max_t, float & t, int32_t & cap) const;
+
+			void	link(int32_t cap, bool on);				// add to / remove from the grid cells
+			int32_t	findCap(POINT2 const & p) const;
+			void	claim(POINT2 const & p, int32_t wall);
+			void	release(POINT2 const & p, int32_t wall, std::vector<int32_t> & orphans);
+	};
+
+	/*
+	 * InflationCache	InflatedWalls per agent radius class, built on first use
+	 *					and shared by every agent of that class.
+	 *
+	 * Radii are rounded up to a multiple of quantum so that agents of similar
+	 * size share one set of obstacles (never smaller than the agent). As a
+	 * TerrainListener the cache grows a changed region per class; the next
+	 * get() of a class re-inflates only the walls overlapping that region,
+	 * once per batch of changes. Call get() from the thread that owns the
+	 * terrain.
+	 */
+	class InflationCache : public TerrainListener
+	{
+		public:
+			explicit InflationCache(float quantum = 4.0f);
+
+			void	reset(std::vector<Segment> const & walls);
+
+			InflatedWalls const &	get(float radius);
+
+			float	classRadius(float radius) const;
+			size_t	classes() const		{ return classes_.size(); }
+
+			void	terrainChanged(Terrain const & terrain, AABB const & region);
+
+		private:
+			struct Class
+			{
+				std::unique_ptr<InflatedWalls>	walls;
+				uint32_t						version;	// of walls_ it was built from
+				AABB							changed;	// terrain changes not yet applied
+			};
+
+			float					quantum_;
+			std::vector<Segment>	walls_;
+			uint32_t				version_;
+			Terrain const *			terrain_;		// source of walls once stale
+			bool					stale_;			// walls_ is behind the terrain
+			std::map<int, Class>	classes_;
+			std::vector<Segment>	near_;
+	};
+
+} // close namespace 'level'
+
+#endif
@@ -0,0 +1,107 @@
+/* ********************************************************************************* *
+ * *  File: DistanceField.h                                                        * *
+ * *  ---------------------                                                        * *
+ * *  COPYRIGHT NOTICE                                                             * *
+ * *  ----------------                                                             * *
+ * *  (C)[2012] - [2015] Deakin University                                         * *
+ * *  All rights reserved.                                                         * *
+ * *  All information contained herein is, and remains the property of Deakin      * *
+ * *  University and the author (Tim Wilkin).                                      * *
+ * *  Dissemination of this information or reproduction of this material is        * *
+ * *  strictly forbidden unless prior written permission is obtained from Deakin   * *
+ * *  University.The right to create derivative works from this material is        * *
+ * *  hereby granted to students enrolled in SIT255, but only for the purposes of  * *
+ * *  assessment while an enrolled student at Deakin University.                   * *
+ * *                                                                               * *
+ * ********************************************************************************* */
+
+#ifndef DISTANCE_FIELD_H
+#define DISTANCE_FIELD_H
+
+#include <stdint.h>
+#include <vector>
+#include "math/Geometry.h"
+
+/*
+ * Open namespace: level
+ */
+namespace level { // open namespace 'level'
+
+	/*
+	 * DistanceField	Signed distance to the nearest wall Segment, sampled on a
+	 *					regular grid of cell centres.
+	 *
+	 * The sign comes from the nearest wall's normal: positive on the side the
+	 * normal faces, negative behind it (inside closed wall outlines). Where
+	 * walls share an end point the sum of their normals is used, so cells off
+	 * a corner get a consistent sign. Values are clamped to +/- band, which
+	 * keeps local updates local: a wall change can only affect cells within
+	 * band of it.
+	 *
+	 * Baking rasterises the walls into seed cells and runs a Euclidean
+	 * distance transform over the seed cell centres (Felzenszwalb &
+	 * Huttenlocher, separable column/row passes, each parallelised) that also
+	 * tracks the nearest seed. Each cell then takes the distance to the
+	 * closest of the walls crossing the nearest seeds of its 3x3 block. This
+	 * is approximate: seed centres are up to half a cell off their walls, so
+	 * a wall whose seeds are never nearest to the block can be missed and the
+	 * value overestimated by up to about a cell. update() measures the walls
+	 * near the region directly and has no such error.
+	 */
+	class DistanceField
+	{
+		public:
+			DistanceField();
+
+			/*
+			 * Bake the field for the walls over area.
+			 *	cell	grid spacing in world units
+			 *	band	distance clamp (typically a few agent radii)
+			 */
+			void bake(std::vector<Segment> const & walls, AABB const & area, float cell, float band);
+
+			/*
+			 * Recompute the cells affected by a change of walls inside region.
+			 * walls is the complete, updated wall list.
+			 */
+			void update(std::vector<Segment> const & walls, AABB const & region);
+
+			// Bilinearly interpolated distance
+			float distance(POINT2 const & p) const;
+
+			// Distance and its gradient (unit-ish direction away from the nearest wall)
+			float sample(POINT2 const & p, VECTOR2 & gradient) const;
+
+			// Batched sampling, four points per SSE pass; gx/gy may be null
+			void sample(float const * x, float const * y, size_t n, float * d, float * gx, float * gy) const;
+
+			int				width()	const	{ return w_; }
+			int				height() const	{ return h_; }
+			float			cell()	const	{ return cell_; }
+			float			band()	const	{ return band_; }
+			AABB const &	area()	const	{ return area_; }
+			float			at(int x, int y) const	{ return field_[(size_t)y * w_ + x]; }
+
+		private:
+			AABB				area_;
+			float				cell_, band_;
+			int					w_, h_;
+			std::vector<float>	field_;
+
+			POINT2	centre(int x, int y) const
+			{
+				return POINT2(area_.lo.x + (x + 0.5f) * cell_, area_.lo.y + (y + 0.5f) * cell_);
+			}
+
+			/*
+			 * Sign is taken from the wall normal, or from the pseudo-normal of
+			 * the end point (pn[0] start, pn[1] end) when that is the closest
+			 * point, so points off a corner get the same sign from both walls.
+			 */
+			float	signedDistance(POINT2 const & p, Segment const & s, VECTOR2 const * pn) const;
+			void	pseudoNormals(std::vector<Segment const *> const & walls, std::vector<VECTOR2> & pn) const;
+	};
+
+} // close namespace 'level'
+
+#endif
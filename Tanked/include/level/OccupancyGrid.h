@@ -0,0 +1,137 @@
+/* ********************************************************************************* *
+ * *  File: OccupancyGrid.h                                                        * *
+ * *  ---------------------                                                        * *
+ * *  COPYRIGHT NOTICE                                                             * *
+ * *  ----------------                                                             * *
+ * *  (C)[2012] - [2015] Deakin University                                         * *
+ * *  All rights reserved.                                                         * *
+ * *  All information contained herein is, and remains the property of Deakin      * *
+ * *  University and the author (Tim Wilkin).                                      * *
+ * *  Dissemination of this information or reproduction of this material is        * *
+ * *  strictly forbidden unless prior written permission is obtained from Deakin   * *
+ * *  University.The right to create derivative works from this material is        * *
+ * *  hereby granted to students enrolled in SIT255, but only for the purposes of  * *
+ * *  assessment while an enrolled student at Deakin University.                   * *
+ * *                                                                               * *
+ * ********************************************************************************* */
+
+#ifndef OCCUPANCY_GRID_H
+#define OCCUPANCY_GRID_H
+
+#include <stdint.h>
+#include <vector>
+#include "math/Geometry.h"
+
+/*
+ * Open namespace: level
+ */
+namespace level { // open namespace 'level'
+
+	/*
+	 * OccupancyGrid	One bit per cell "is this cell blocked?" map of the level.
+	 *
+	 * Rows are padded to whole 64-bit words so that rectangle and run queries
+	 * test 64 cells per operation. Two layers are kept: static geometry
+	 * stamped at load time, and dynamic obstacles stamped/unstamped as they
+	 * move (with a per-cell count so overlapping obstacles clear correctly).
+	 * The query bitmap is their union.
+	 *
+	 * A pyramid of coarser levels is maintained on top of the query bitmap.
+	 * At level L each bit covers 2^L x 2^L cells and two maps are kept:
+	 *	any_	some cell below is blocked (max)  - rejects empty regions
+	 *	all_	every cell below is blocked (min)  - skips solid regions
+	 */
+	class OccupancyGrid
+	{
+		public:
+			OccupancyGrid();
+			OccupancyGrid(AABB const & area, float cell);
+
+			void	reset(AABB const & area, float cell);
+
+			// Static layer
+			void	stamp(Rect const & r);
+			void	stamp(Circle const & c);
+			void	stamp(Segment const & s);
+			void	stamp(ConvexPolygon const & p);
+			void	stamp(std::vector<Segment> const & walls);
+
+			// Clear the static layer in every cell overlapping box (for re-stamping after an edit)
+			void	clearStatic(AABB const & box);
+
+			// Dynamic layer: stamp when an obstacle arrives, unstamp the same shape when it leaves
+			void	stampDynamic(Circle const & c);
+			void	unstampDynamic(Circle const & c);
+			void	stampDynamic(Rect const & r);
+			void	unstampDynamic(Rect const & r);
+
+			// Cell queries
+			bool	blocked(int x, int y) const;
+			bool	blocked(POINT2 const & p) const;
+
+			// True if any cell in the inclusive cell rectangle is blocked
+			bool	occupied(int x0, int y0, int x1, int y1) const;
+			bool	occupied(AABB const & box) const;
+
+			/*
+			 * First free cell in row-major order inside the inclusive cell
+			 * rectangle; false if the whole rectangle is blocked.
+			 */
+			bool	firstFree(int x0, int y0, int x1, int y1, int & fx, int & fy) const;
+
+			/*
+			 * Free cell nearest (Euclidean) to the given cell, searching
+			 * Chebyshev rings out to max_radius cells - for spawn placement.
+			 */
+			bool	nearestFree(int cx, int cy, int max_radius, int & fx, int & fy) const;
+
+			// Raw access for searches working directly on the bitset
+			int				width()	const	{ return w_; }
+			int				height() const	{ return h_; }
+			int				words()	const	{ return words_; }		// 64-bit words per row
+			float			cell()	const	{ return cell_; }
+			AABB const &	area()	const	{ return area_; }
+			uint64_t const *	row(int y) const	{ return &bits_[(size_t)y * words_]; }
+
+			// Bumped by every change to the static layer (dynamic obstacles come and go without it)
+			uint32_t		version() const	{ return version_; }
+
+			// Bumped whenever a dynamic stamp changes the query bitmap
+			uint32_t		dynamicVersion() const	{ return dynamic_version_; }
+
+			int		toCellX(float x) const	{ return (int)floor((x - area_.lo.x) / cell_); }
+			int		toCellY(float y) const	{ return (int)floor((y - area_.lo.y) / cell_); }
+			POINT2	centre(int x, int y) const
+			{
+				return POINT2(area_.lo.x + (x + 0.5f) * cell_, area_.lo.y + (y + 0.5f) * cell_);
+			}
+
+		private:
+			struct Level
+			{
+				int						w, h, words;
+				std::vector<uint64_t>	any, all;
+			};
+
+			AABB					area_;
+			float					cell_;
+			int						w_, h_, words_;
+			uint32_t				version_;
+			uint32_t				dynamic_version_;
+			std::vector<uint64_t>	static_;		// static layer
+			std::vector<uint8_t>	dynamic_;		// dynamic obstacle count per cell
+			std::vector<uint64_t>	bits_;			// static | dynamic
+			std::vector<Level>		pyramid_;		// pyramid_[0] covers 2x2 cells
+
+			enum STAMP_MODE { STAMP_STATIC, STAMP_CLEAR, STAMP_ADD, STAMP_REMOVE };
+
+			void	stampSpan(int y, int x0, int x1, STAMP_MODE mode);
+			void	stampCircle(Circle const & c, STAMP_MODE mode);
+			void	stampRect(Rect const & r, STAMP_MODE mode);
+			void	refresh(int x0, int y0, int x1, int y1);
+			bool	rowRange(uint64_t const * row, int x0, int x1, bool any) const;
+	};
+
+} // close namespace 'level'
+
+#endif
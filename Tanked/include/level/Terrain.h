@@ -0,0 +1,167 @@
+/* ********************************************************************************* *
+ * *  File: Terrain.h                                                              * *
+ * *  ---------------                                                              * *
+ * *  COPYRIGHT NOTICE                                                             * *
+ * *  ----------------                                                             * *
+ * *  (C)[2012] - [2015] Deakin University                                         * *
+ * *  All rights reserved.                                                         * *
+ * *  All information contained herein is, and remains the property of Deakin      * *
+ * *  University and the author (Tim Wilkin).                                      * *
+ * *  Dissemination of this information or reproduction of this material is        * *
+ * *  strictly forbidden unless prior written permission is obtained from Deakin   * *
+ * *  University.The right to create derivative works from this material is        * *
+ * *  hereby granted to students enrolled in SIT255, but only for the purposes of  * *
+ * *  assessment while an enrolled student at Deakin University.                   * *
+ * *                                                                               * *
+ * ********************************************************************************* */
+
+#ifndef TERRAIN_H
+#define TERRAIN_H
+
+#include <stdint.h>
+#include <vector>
+#include "math/Geometry.h"
+#include "physics/Raycast.h"
+#include "level/DistanceField.h"
+#include "level/OccupancyGrid.h"
+
+/*
+ * Open namespace: level
+ */
+namespace level { // open namespace 'level'
+
+	class Terrain;
+
+	/*
+	 * TerrainListener	Interface for structures derived from the terrain that
+	 *					must be patched when it changes (fields, grids, navigation).
+	 */
+	class TerrainListener
+	{
+		public:
+			virtual ~TerrainListener() {}
+
+			// region bounds every wall removed or added by the change
+			virtual void terrainChanged(Terrain const & terrain, AABB const & region) = 0;
+	};
+
+	/*
+	 * Terrain	Destructible solid terrain made of non-overlapping convex pieces.
+	 *
+	 * Wall Segments are generated from the piece outlines: edges shared by two
+	 * pieces (collinear, opposite winding) cancel, so only the exposed
+	 * boundary becomes walls, each with its normal facing out of the solid.
+	 * The walls live in a SegmentBVH which is patched in place.
+	 *
+	 * A blast subtracts a convex N-gon (circumscribing the blast circle) from
+	 * every piece it touches by successive half-plane clips: the part of the
+	 * piece outside each blast edge is kept as a new convex piece and the
+	 * rest is clipped further. Only the touched pieces and their immediate
+	 * neighbours (found through a bucket grid) have their walls regenerated,
+	 * so the cost follows the damaged area rather than the map size.
+	 */
+	class Terrain
+	{
+		public:
+			Terrain();
+
+			/*
+			 * Start a new terrain over area.
+			 *	bucket		size of the piece lookup grid cells
+			 *	min_area	fragments smaller than this are discarded
+			 */
+			void	reset(AABB const & area, float bucket, float min_area = 1.0f);
+
+			// Load time: add solid pieces (they must not overlap), then build the walls once
+			size_t	add(ConvexPolygon const & piece);
+			void	build();
+
+			/*
+			 * Remove the blast circle (approximated by a sides-gon) from the
+			 * terrain. Returns the region of changed walls, empty if nothing was
+			 * hit. Listeners are notified with the same region.
+			 */
+			AABB	blast(Circle const & c, size_t sides = 16);
+
+			void	addListener(TerrainListener * l);
+			void	removeListener(TerrainListener * l);
+
+			physics::SegmentBVH const &	walls() const	{ return bvh_; }
+			AABB const &				area()	const	{ return area_; }
+
+			// Live walls / pieces whose bounds overlap box
+			void	wallsNear(AABB const & box, std::vector<Segment> & out) const;
+			void	piecesNear(AABB const & box, std::vector<size_t> & out) const;
+
+			// Piece ids are reused after a piece is destroyed
+			size_t					pieces() const			{ return pieces_.size(); }
+			bool					alive(size_t i) const	{ return pieces_[i].alive; }
+			ConvexPolygon const &	piece(size_t i) const	{ return pieces_[i].shape; }
+
+		private:
+			struct Piece
+			{
+				ConvexPolygon		shape;
+				AABB				bounds;
+				std::vector<size_t>	walls;		// ids in bvh_
+				bool				alive;
+			};
+
+			AABB							area_;
+			float							bucket_, min_area_;
+			int								bw_, bh_;
+			std::vector<Piece>				pieces_;
+			std::vector<size_t>				free_;
+			std::vector<std::vector<int32_t>>	buckets_;
+			mutable std::vector<uint32_t>	mark_;
+			mutable uint32_t				epoch_;
+			physics::SegmentBVH				bvh_;
+			bool							built_;
+			std::vector<TerrainListener *>	listeners_;
+
+			size_t	insert(ConvexPolygon const & shape);
+			void	erase(size_t id);
+			void	link(size_t id, bool on);
+			void	gather(AABB const & box, std::vector<size_t> & out) const;
+			void	outline(size_t id, std::vector<Segment> & out) const;
+			void	patch(AABB const & damaged, AABB & changed);
+			void	notify(AABB const & changed);
+			void	subtract(ConvexPolygon const & piece, POINT2 const * blast, size_t sides,
+							 std::vector<ConvexPolygon> & out, bool & touched) const;
+	};
+
+	/*
+	 * Listener adapters keeping baked level data in step with the terrain
+	 */
+	class DistanceFieldUpdater : public TerrainListener
+	{
+		public:
+			explicit DistanceFieldUpdater(DistanceField & field)
+				: field_(field)
+			{}
+
+			void terrainChanged(Terrain const & terrain, AABB const & region);
+
+		private:
+			DistanceField &			field_;
+			std::vector<Segment>	near_;
+	};
+
+	// The grid's static layer holds the solid pieces
+	class OccupancyUpdater : public TerrainListener
+	{
+		public:
+			explicit OccupancyUpdater(OccupancyGrid & grid)
+				: grid_(grid)
+			{}
+
+			void terrainChanged(Terrain const & terrain, AABB const & region);
+
+		private:
+			OccupancyGrid &			grid_;
+			std::vector<size_t>		near_;
+	};
+
+} // close namespace 'level'
+
+#endif
@@ -51,7 +51,8 @@ enum class POLYGON_TYPE
 {
 	CIRCLE = 1,
 	RECTANGLE,
-	TRIANGLE
+	TRIANGLE,
+	CONVEX
 };
 
 class Polytype
@@ -137,6 +138,120 @@ public:
 
 };
 
+/*
+ * ConvexPolygon	Convex polygon of up to MAX_VERTICES vertices, stored inline
+ *					in hull order with no collinear vertices.
+ */
+class ConvexPolygon : public Polytype
+{
+	public:
+		static const size_t	MAX_VERTICES = 16;
+
+	protected:
+		POINT2		v[MAX_VERTICES];
+		size_t		n;
+
+	public:
+		ConvexPolygon()
+			: Polytype(POLYGON_TYPE::CONVEX),
+			  n(0)
+		{}
+
+		// Convex hull of a point set, simplified to MAX_VERTICES by dropping the flattest corners
+		ConvexPolygon(POINT2 const * pts, size_t count);
+
+		// An empty polygon (built from no points) answers every index with v[0]
+		size_t				size()	const			{ return n; }
+		POINT2 const &		vertex(size_t i) const	{ return v[(n > 0) ? i % n : 0]; }
+		POINT2 &			vertex(size_t i)		{ return v[(n > 0) ? i % n : 0]; }
+
+		POINT2				centre() const;
+		float				area()	const;
+		void				translate(VECTOR2 const & d);
+
+		/*
+		 * Index of the vertex furthest in direction d. Hill-climbs from the
+		 * hint vertex, so passing last frame's answer makes coherent queries
+		 * (GJK warm starts) O(1).
+		 */
+		size_t				support(VECTOR2 const & d, size_t hint = 0) const;
+};
+
+/*
+ * AABB		Axis aligned bounding box. A plain value type (no Polytype base) so
+ *			that it can be stored densely in spatial index nodes.
+ */
+struct AABB
+{
+	POINT2		lo,		// minimum corner
+				hi;		// maximum corner
+
+	// Default construction gives an empty (inverted) box
+	AABB()
+		: lo(FLT_MAX, FLT_MAX),
+		  hi(-FLT_MAX, -FLT_MAX)
+	{}
+
+	AABB(POINT2 const & _lo, POINT2 const & _hi)
+		: lo(_lo),
+		  hi(_hi)
+	{}
+
+	explicit AABB(Segment const & s)
+		: lo(math::min(s.start().x, s.end().x), math::min(s.start().y, s.end().y)),
+		  hi(math::max(s.start().x, s.end().x), math::max(s.start().y, s.end().y))
+	{}
+
+	explicit AABB(Circle const & c)
+		: lo(c.origin().x - c.radius(), c.origin().y - c.radius()),
+		  hi(c.origin().x + c.radius(), c.origin().y + c.radius())
+	{}
+
+	explicit AABB(Rect const & r)
+		: lo(math::min(r.start().x, r.end().x), math::min(r.start().y, r.end().y)),
+		  hi(math::max(r.start().x, r.end().x), math::max(r.start().y, r.end().y))
+	{}
+
+	explicit AABB(ConvexPolygon const & c)
+		: lo(FLT_MAX, FLT_MAX),
+		  hi(-FLT_MAX, -FLT_MAX)
+	{
+		for (size_t i = 0; i < c.size(); ++i)
+			grow(c.vertex(i));
+	}
+
+	bool	empty()	const	{ return lo.x > hi.x || lo.y > hi.y; }
+	POINT2	centre() const	{ return POINT2((lo.x + hi.x) * 0.5f, (lo.y + hi.y) * 0.5f); }
+	VECTOR2	extent() const	{ return hi - lo; }
+
+	void grow(POINT2 const & p)
+	{
+		lo.x = math::min(lo.x, p.x);	lo.y = math::min(lo.y, p.y);
+		hi.x = math::max(hi.x, p.x);	hi.y = math::max(hi.y, p.y);
+	}
+
+	void grow(AABB const & b)
+	{
+		lo.x = math::min(lo.x, b.lo.x);	lo.y = math::min(lo.y, b.lo.y);
+		hi.x = math::max(hi.x, b.hi.x);	hi.y = math::max(hi.y, b.hi.y);
+	}
+
+	AABB inflate(float r) const
+	{
+		return AABB(POINT2(lo.x - r, lo.y - r), POINT2(hi.x + r, hi.y + r));
+	}
+
+	bool overlaps(AABB const & b) const
+	{
+		return !(b.lo.x > hi.x || b.hi.x < lo.x || b.lo.y > hi.y || b.hi.y < lo.y);
+	}
+
+	bool contains(POINT2 const & p) const
+	{
+		return p.x >= lo.x && p.x <= hi.x && p.y >= lo.y && p.y <= hi.y;
+	}
+};
+
 /*
  * Consider adding functionality to test for collisions between Geometry objects
  */
@@ -105,6 +105,13 @@ namespace math { // open namespace 'math'
 			return  U( u.x*v.x + u.y*v.y );
 		}
 
+		// z-component of the 3D cross product of (u,0) and (v,0)
+		template <typename U>
+		friend inline U const perp_product(_vector_2<U> const& u, _vector_2<U> const& v)
+		{
+			return  U( u.x*v.y - u.y*v.x );
+		}
+
 	};
 
 
@@ -0,0 +1,96 @@
+/* ********************************************************************************* *
+ * *  File: GJK.h                                                                  * *
+ * *  -----------                                                                  * *
+ * *  COPYRIGHT NOTICE                                                             * *
+ * *  ----------------                                                             * *
+ * *  (C)[2012] - [2015] Deakin University                                         * *
+ * *  All rights reserved.                                                         * *
+ * *  All information contained herein is, and remains the property of Deakin      * *
+ * *  University and the author (Tim Wilkin).                                      * *
+ * *  Dissemination of this information or reproduction of this material is        * *
+ * *  strictly forbidden unless prior written permission is obtained from Deakin   * *
+ * *  University.The right to create derivative works from this material is        * *
+ * *  hereby granted to students enrolled in SIT255, but only for the purposes of  * *
+ * *  assessment while an enrolled student at Deakin University.                   * *
+ * *                                                                               * *
+ * ********************************************************************************* */
+
+#ifndef GJK_H
+#define GJK_H
+
+#include <stdint.h>
+#include "math/Geometry.h"
+
+/*
+ * Open namespace: physics
+ */
+namespace physics { // open namespace 'physics'
+
+	/*
+	 * ConvexProxy	Vertex view of any Polytype used by the GJK/EPA queries.
+	 *				Circles become a single vertex with a rounding radius, so
+	 *				every shape is "core polygon + radius". An empty
+	 *				ConvexPolygon gives no vertices; the queries below treat
+	 *				it as overlapping nothing, at FLT_MAX distance.
+	 */
+	struct ConvexProxy
+	{
+		POINT2		v[ConvexPolygon::MAX_VERTICES];
+		size_t		count;
+		float		radius;
+
+		explicit ConvexProxy(Polytype const & p);
+
+		size_t			support(VECTOR2 const & d, size_t hint = 0) const;
+		POINT2 const &	vertex(size_t i) const	{ return v[i]; }
+	};
+
+	/*
+	 * GJKCache		Simplex vertex indices from the previous query of a shape pair.
+	 *				Keep one per contact pair and pass it back each frame: GJK
+	 *				restarts from last frame's simplex and the support searches
+	 *				hill-climb from the cached vertices, so coherent pairs
+	 *				usually converge in one or two iterations.
+	 */
+	struct GJKCache
+	{
+		uint8_t		count;
+		uint8_t		indexA[3];
+		uint8_t		indexB[3];
+
+		GJKCache()
+			: count(0)
+		{}
+	};
+
+	/*
+	 * DistanceResult	Closest points between the shapes (including radii).
+	 *					normal points from A towards B.
+	 */
+	struct DistanceResult
+	{
+		float		distance;
+		POINT2		pointA,
+					pointB;
+		VECTOR2		normal;
+		int			iterations;
+	};
+
+	// Separation of the two shapes (0 if they overlap)
+	float gjkDistance(ConvexProxy const & a, ConvexProxy const & b, GJKCache & cache, DistanceResult & out);
+
+	// Boolean overlap test; exits as soon as a separating direction is found
+	bool gjkOverlap(ConvexProxy const & a, ConvexProxy const & b, GJKCache & cache);
+
+	/*
+	 * Penetration of overlapping shapes: moving A by -normal * depth (or B by
+	 * +normal * depth) separates them. Uses the GJK result when only the radii
+	 * overlap and EPA on the core polygons otherwise. Returns false if the
+	 * shapes do not overlap.
+	 */
+	bool epaPenetration(ConvexProxy const & a, ConvexProxy const & b, GJKCache & cache,
+						VECTOR2 & normal, float & depth);
+
+} // close namespace 'physics'
+
+#endif
@@ -0,0 +1,232 @@
+/* ********************************************************************************* *
+ * *  File: Raycast.h                                                              * *
+ * *  ---------------                                                              * *
+ * *  COPYRIGHT NOTICE                                                             * *
+ * *  ----------------                                                             * *
+ * *  (C)[2012] - [2015] Deakin University                                         * *
+ * *  All rights reserved.                                                         * *
+ * *  All information contained herein is, and remains the property of Deakin      * *
+ * *  University and the author (Tim Wilkin).                                      * *
+ * *  Dissemination of this information or reproduction of this material is        * *
+ * *  strictly forbidden unless prior written permission is obtained from Deakin   * *
+ * *  University.The right to create derivative works from this material is        * *
+ * *  hereby granted to students enrolled in SIT255, but only for the purposes of  * *
+ * *  assessment while an enrolled student at Deakin University.                   * *
+ * *                                                                               * *
+ * ********************************************************************************* */
+
+#ifndef RAYCAST_H
+#define RAYCAST_H
+
+#include <stdint.h>
+#include <vector>
+#include "math/Geometry.h"
+
+/*
+ * Open namespace: physics
+ */
+namespace physics { // open namespace 'physics'
+
+	/*
+	 * Ray		origin + t * direction, 0 <= t <= max_t
+	 *
+	 * direction is expected to be unit length, so t (and RayHit::distance)
+	 * is a distance in world units.
+	 */
+	struct Ray
+	{
+		POINT2		origin;
+		VECTOR2		direction;
+		float		max_t;
+
+		Ray()
+			: origin(), direction(1, 0), max_t(FLT_MAX)
+		{}
+
+		Ray(POINT2 const & o, VECTOR2 const & d, float t = FLT_MAX)
+			: origin(o), direction(d), max_t(t)
+		{}
+	};
+
+	/*
+	 * RayHit	Result of a ray query. segment is -1 if nothing was hit.
+	 *			normal is the wall normal, flipped where necessary so that it
+	 *			faces back along the ray.
+	 */
+	struct RayHit
+	{
+		float		distance;
+		POINT2		point;
+		VECTOR2		normal;
+		int32_t		segment;
+
+		RayHit()
+			: distance(FLT_MAX), point(), normal(), segment(-1)
+		{}
+
+		bool hit() const { return segment >= 0; }
+	};
+
+	enum class RAY_QUERY
+	{
+		CLOSEST_HIT = 1,	// nearest intersection along the ray
+		ANY_HIT				// stop at the first intersection found (line of sight)
+	};
+
+	/*
+	 * SegmentBVH		Bounding volume hierarchy over a static set of wall Segments
+	 *
+	 * Nodes are stored in a flat array (children of an interior node are
+	 * adjacent) and each leaf references one block of up to four segments
+	 * stored SoA, so that a ray is tested against a whole leaf with one set
+	 * of SSE operations. Rays are traced in packets of four; the slab test
+	 * at each node is evaluated for all four rays at once and the packet
+	 * only descends where at least one active ray overlaps the node.
+	 *
+	 * Segment ids are stable. For terrain that changes at run time, walls can
+	 * be removed (their lane is blanked in place) and inserted (appended to
+	 * overflow blocks tested after the traversal) without touching the tree;
+	 * optimise() rebuilds the tree over the live walls once the overflow
+	 * grows large.
+	 */
+	class SegmentBVH
+	{
+		public:
+
+			static const size_t	LEAF_SIZE = 4;
+			static const size_t	PACKET_SIZE = 4;
+
+			SegmentBVH();
+			explicit SegmentBVH(std::vector<Segment> const & walls);
+
+			// (Re)build the hierarchy over a set of wall segments
+			void build(std::vector<Segment> const & walls);
+
+			size_t				size()	const	{ return walls_.size(); }
+			bool				empty()	const	{ return walls_.empty(); }
+			Segment const &		segment(size_t i) const	{ return walls_[i]; }
+			bool				alive(size_t i) const	{ return alive_[i] != 0; }
+			AABB const &		bounds() const	{ return bounds_; }
+
+			// Incremental edits; ids of other walls are unaffected
+			size_t	insert(Segment const & s);
+			void	remove(size_t id);
+
+			/*
+			 * Give wall id a new segment, reviving it if it was removed. A wall
+			 * in the tree keeps its leaf lane, so the tree bounds are stale
+			 * until refit(); a removed wall goes to the overflow.
+			 */
+			void	replace(size_t id, Segment const & s);
+
+			// Recompute the tree bounds bottom-up over the live walls, keeping the topology
+			void	refit();
+
+			// Walls inserted since the tree was last built
+			size_t	overflow() const	{ return (blocks_.size() - overflow_begin_) * LEAF_SIZE; }
+
+			// Rebuild the tree over the live walls, keeping their ids
+			void	optimise();
+
+			// Single ray; returns true on a hit
+			bool cast(Ray const & ray, RayHit & hit, RAY_QUERY q = RAY_QUERY::CLOSEST_HIT) const;
+
+			// Batched rays, traced four at a time. hits[i] receives the result for rays[i].
+			void cast(Ray const * rays, RayHit * hits, size_t n, RAY_QUERY q = RAY_QUERY::CLOSEST_HIT) const;
+
+			// True if the straight line a->b does not cross any wall
+			bool lineOfSight(POINT2 const & a, POINT2 const & b) const;
+
+			// Batched line of sight; visible[i] = 1 if a[i]->b[i] is unobstructed
+			void lineOfSight(POINT2 const * a, POINT2 const * b, uint8_t * visible, size_t n) const;
+
+			/*
+			 * Call fn(index) for every segment whose bounds overlap the box.
+			 * Used by broad phase queries (swept shapes, local rebuilds).
+			 */
+			template <typename Fn>
+			void query(AABB const & box, Fn fn) const
+			{
+				for (size_t k = overflow_begin_; k < blocks_.size(); ++k)
+					for (size_t i = 0; i < LEAF_SIZE; ++i)
+					{
+						int32_t id = blocks_[k].id[i];
+						if (id >= 0 && AABB(walls_[id]).overlaps(box))
+							fn((size_t)id);
+					}
+
+				if (nodes_.empty())
+					return;
+
+				int32_t stack[MAX_DEPTH];
+				int		top = 0;
+				stack[top++] = 0;
+
+				while (top > 0)
+				{
+					Node const & node = nodes_[stack[--top]];
+					if (box.lo.x > node.hi[0] || box.hi.x < node.lo[0] ||
+						box.lo.y > node.hi[1] || box.hi.y < node.lo[1])
+						continue;
+
+					if (node.count > 0)
+					{
+						Block const & b = blocks_[node.first];
+						for (uint16_t i = 0; i < node.count; ++i)
+						{
+							if (b.id[i] >= 0 && AABB(walls_[b.id[i]]).overlaps(box))
+								fn((size_t)b.id[i]);
+						}
+					}
+					else
+					{
+						stack[top++] = node.first;
+						stack[top++] = node.first + 1;
+					}
+				}
+			}
+
+		private:
+
+			static const int	MAX_DEPTH = 64;
+
+			struct Node
+			{
+				float		lo[2], hi[2];
+				int32_t		first;		// leaf: block index, interior: left child (right = first+1)
+				uint16_t	count;		// number of segments in leaf, 0 for interior nodes
+				uint16_t	axis;		// split axis of an interior node
+			};
+
+			// Four segments stored as p + s * e, 0 <= s <= 1
+			struct Block
+			{
+				float		px[LEAF_SIZE], py[LEAF_SIZE];
+				float		ex[LEAF_SIZE], ey[LEAF_SIZE];
+				float		nx[LEAF_SIZE], ny[LEAF_SIZE];
+				int32_t		id[LEAF_SIZE];
+			};
+
+			std::vector<Segment>	walls_;
+			std::vector<uint8_t>	alive_;
+			std::vector<int32_t>	slot_;			// block * LEAF_SIZE + lane of each wall, -1 if removed
+			std::vector<Node>		nodes_;
+			std::vector<Block>		blocks_;		// tree leaves, then overflow blocks
+			size_t					overflow_begin_;
+			AABB					bounds_;
+
+			static void	setLane(Block & b, size_t lane, Segment const & s, int32_t id);
+			static void	clearLane(Block & b, size_t lane);
+
+			int32_t	place(Segment const & s, size_t id);		// free overflow lane; returns its slot
+
+			void	rebuild();
+			bool	testBlock(Block const & b, size_t block, int k, float const * ox, float const * oy,
+							  float const * dx, float const * dy, float * tmax, int32_t * seg) const;
+			void	buildNode(int32_t index, std::vector<int32_t> & ids, size_t begin, size_t end, int depth);
+			void	castPacket(Ray const * rays, RayHit * hits, size_t n, RAY_QUERY q) const;
+	};
+
+} // close namespace 'physics'
+
+#endif
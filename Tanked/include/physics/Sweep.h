@@ -0,0 +1,182 @@
+/* ********************************************************************************* *
+ * *  File: Sweep.h                                                                * *
+ * *  -------------                                                                * *
+ * *  COPYRIGHT NOTICE                                                             * *
+ * *  ----------------                                                             * *
+ * *  (C)[2012] - [2015] Deakin University                                         * *
+ * *  All rights reserved.                                                         * *
+ * *  All information contained herein is, and remains the property of Deakin      * *
+ * *  University and the author (Tim Wilkin).                                      * *
+ * *  Dissemination of this information or reproduction of this material is        * *
+ * *  strictly forbidden unless prior written permission is obtained from Deakin   * *
+ * *  University.The right to create derivative works from this material is        * *
+ * *  hereby granted to students enrolled in SIT255, but only for the purposes of  * *
+ * *  assessment while an enrolled student at Deakin University.                   * *
+ * *                                                                               * *
+ * ********************************************************************************* */
+
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <stdint.h>
+#include <vector>
+#include "math/Geometry.h"
+#include "physics/Raycast.h"
+
+/*
+ * Open namespace: physics
+ */
+namespace physics { // open namespace 'physics'
+
+	/*
+	 * SweepHit		Result of a swept (continuous) test.
+	 *
+	 *	toi		time of impact as a fraction of the motion, 0 <= toi <= 1
+	 *	normal	contact normal, pointing from the obstacle towards the mover
+	 *	point	contact point at the time of impact
+	 */
+	struct SweepHit
+	{
+		float		toi;
+		VECTOR2		normal;
+		POINT2		point;
+		bool		hit;
+
+		SweepHit()
+			: toi(1.0f), normal(), point(), hit(false)
+		{}
+	};
+
+	/*
+	 * Swept primitive tests. Motions are displacements over the step, so a
+	 * shape at p ends the step at p + motion.
+	 */
+	bool sweepCircleSegment(Circle const & c, VECTOR2 const & motion, Segment const & s, SweepHit & hit);
+
+	bool sweepCircleCircle(Circle const & a, VECTOR2 const & motion_a,
+						   Circle const & b, VECTOR2 const & motion_b,
+						   SweepHit & hit);
+
+	bool sweepAABB(AABB const & a, VECTOR2 const & motion_a,
+				   AABB const & b, VECTOR2 const & motion_b,
+				   SweepHit & hit);
+
+	// Bounds of a box over its whole motion (broad phase)
+	inline AABB sweptBounds(AABB const & box, VECTOR2 const & motion)
+	{
+		AABB swept = box;
+		swept.grow(AABB(box.lo + motion, box.hi + motion));
+		return swept;
+	}
+
+	/*
+	 * Conservative advancement for shapes without a closed form swept test
+	 * (rotating bodies, polygon pairs).
+	 *
+	 *	distance(t, normal, point)	separation of the pair at time t in [0,1],
+	 *								writing the closest feature normal/point
+	 *	bound						upper bound on the rate the separation can
+	 *								decrease over the step (|relative motion|
+	 *								plus any rotational sweep)
+	 *
+	 * Each iteration advances by the largest step that cannot produce contact,
+	 * so the method never tunnels; it stops once within tolerance.
+	 */
+	template <typename DistanceFn>
+	bool conservativeAdvance(DistanceFn distance, float bound, SweepHit & hit,
+							 float tolerance = 1.0e-3f, int max_iterations = 32)
+	{
+		hit = SweepHit();
+		if (bound <= 0.0f)
+			return false;
+
+		float	t = 0.0f;
+		VECTOR2	n;
+		POINT2	p;
+		float	d = distance(t, n, p);
+
+		for (int i = 0; i < max_iterations && d > tolerance; ++i)
+		{
+			t += d / bound;
+			if (t > 1.0f)
+				return false;
+			d = distance(t, n, p);
+		}
+
+		if (d > tolerance)
+			return false;
+
+		hit.toi = t;
+		hit.normal = n;
+		hit.point = p;
+		hit.hit = true;
+		return true;
+	}
+
+	/*
+	 * Batched continuous collision for the movers of a step.
+	 */
+	enum CCD_FLAGS : uint32_t
+	{
+		CCD_NONE	= 0,
+		CCD_ENABLED	= 1 << 0	// sweep this mover against walls and other movers
+	};
+
+	struct Mover
+	{
+		Circle		shape;		// position at the start of the step
+		VECTOR2		motion;		// displacement over the step
+		uint32_t	flags;
+
+		Mover(Circle const & c, VECTOR2 const & m, uint32_t f = CCD_ENABLED)
+			: shape(c), motion(m), flags(f)
+		{}
+	};
+
+	/*
+	 * Impact	Earliest contact of one mover over the step. Exactly one of
+	 *			wall/other is >= 0 when hit.hit is set.
+	 */
+	struct Impact
+	{
+		SweepHit	hit;
+		int32_t		wall;		// index into the wall BVH
+		int32_t		other;		// index of the other mover
+
+		Impact()
+			: hit(), wall(-1), other(-1)
+		{}
+	};
+
+	/*
+	 * ContinuousCollision
+	 *
+	 * Sweeps every CCD-flagged mover against the static walls (candidates
+	 * from the wall BVH using the swept bounds) and against the other movers
+	 * (sort-and-sweep on the swept bounds along x), keeping the earliest
+	 * impact per mover. Movers without the flag still take part in pair
+	 * tests against flagged movers but are never swept against walls.
+	 */
+	class ContinuousCollision
+	{
+		public:
+			explicit ContinuousCollision(SegmentBVH const & walls);
+
+			// impacts is resized to movers.size()
+			void solve(std::vector<Mover> const & movers, std::vector<Impact> & impacts);
+
+		private:
+			struct Interval
+			{
+				float		lo, hi;
+				int32_t		mover;
+			};
+
+			SegmentBVH const &		walls_;
+			std::vector<Interval>	intervals_;		// reused between steps
+			std::vector<AABB>		bounds_;
+	};
+
+} // close namespace 'physics'
+
+#endif
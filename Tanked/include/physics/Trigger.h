@@ -0,0 +1,144 @@
+/* ********************************************************************************* *
+ * *  File: Trigger.h                                                              * *
+ * *  ---------------                                                              * *
+ * *  COPYRIGHT NOTICE                                                             * *
+ * *  ----------------                                                             * *
+ * *  (C)[2012] - [2015] Deakin University                                         * *
+ * *  All rights reserved.                                                         * *
+ * *  All information contained herein is, and remains the property of Deakin      * *
+ * *  University and the author (Tim Wilkin).                                      * *
+ * *  Dissemination of this information or reproduction of this material is        * *
+ * *  strictly forbidden unless prior written permission is obtained from Deakin   * *
+ * *  University.The right to create derivative works from this material is        * *
+ * *  hereby granted to students enrolled in SIT255, but only for the purposes of  * *
+ * *  assessment while an enrolled student at Deakin University.                   * *
+ * *                                                                               * *
+ * ********************************************************************************* */
+
+#ifndef TRIGGER_H
+#define TRIGGER_H
+
+#include <stdint.h>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include "math/Geometry.h"
+
+/*
+ * Open namespace: physics
+ */
+namespace physics { // open namespace 'physics'
+
+	enum class TRIGGER_EVENT : uint8_t
+	{
+		ENTER = 1,
+		STAY,
+		EXIT
+	};
+
+	enum TRIGGER_FLAGS : uint32_t
+	{
+		TRIGGER_NONE		= 0,
+		TRIGGER_REPORT_STAY	= 1 << 0	// deliver STAY events every update (capture zones etc.)
+	};
+
+	struct TriggerEvent
+	{
+		uint32_t		trigger;
+		uint32_t		agent;
+		uint32_t		user;		// user value the trigger was registered with
+		TRIGGER_EVENT	type;
+	};
+
+	/*
+	 * TriggerSystem	Circle/Rect trigger volumes tested against circular agents.
+	 *
+	 * Triggers are static and bucketed in a uniform grid. Each agent keeps a
+	 * sorted list of the triggers it currently overlaps (the pair cache).
+	 * Only agents that moved since the last update are re-tested: their new
+	 * overlap list from the grid is merged against the cached one and the
+	 * differences become ENTER/EXIT events. Agents that did not move cost
+	 * nothing, so an update scales with the number of movers rather than
+	 * triggers x agents.
+	 *
+	 * Events are dispatched in batches, one call per event type per update.
+	 * STAY events are only generated for triggers registered with
+	 * TRIGGER_REPORT_STAY.
+	 */
+	class TriggerSystem
+	{
+		public:
+			typedef std::function<void(TriggerEvent const *, size_t)>	Handler;
+
+			explicit TriggerSystem(float cell_size = 64.0f);
+
+			uint32_t	addTrigger(Circle const & c, uint32_t user = 0, uint32_t flags = TRIGGER_NONE);
+			uint32_t	addTrigger(Rect const & r, uint32_t user = 0, uint32_t flags = TRIGGER_NONE);
+			void		removeTrigger(uint32_t id);
+
+			uint32_t	addAgent(Circle const & shape);
+			void		moveAgent(uint32_t id, POINT2 const & p);
+			void		removeAgent(uint32_t id);
+
+			void		onEnter(Handler const & h)	{ handlers_[0] = h; }
+			void		onStay(Handler const & h)	{ handlers_[1] = h; }
+			void		onExit(Handler const & h)	{ handlers_[2] = h; }
+
+			// Re-test moved agents and dispatch this update's events
+			void		update();
+
+			// Triggers currently overlapped by an agent (sorted)
+			std::vector<uint32_t> const &	overlaps(uint32_t agent) const	{ return agents_[agent].inside; }
+
+			// Agents currently inside a trigger (unordered)
+			std::vector<uint32_t> const &	occupants(uint32_t trigger) const	{ return triggers_[trigger].occupants; }
+
+		private:
+
+			struct Volume
+			{
+				POLYGON_TYPE			shape;		// CIRCLE or RECTANGLE
+				AABB					bounds;
+				POINT2					centre;
+				float					radius;
+				uint32_t				user;
+				uint32_t				flags;
+				bool					alive;
+				std::vector<uint32_t>	occupants;
+			};
+
+			struct Agent
+			{
+				POINT2					position;
+				float					radius;
+				bool					alive;
+				bool					dirty;
+				std::vector<uint32_t>	inside;		// sorted trigger ids
+			};
+
+			float										cell_;
+			std::vector<Volume>							triggers_;
+			std::vector<Agent>							agents_;
+			std::vector<uint32_t>						free_triggers_;
+			std::vector<uint32_t>						removed_triggers_;	// freed once their EXITs are out
+			std::vector<uint32_t>						stay_triggers_;		// live, with TRIGGER_REPORT_STAY
+			std::vector<uint32_t>						free_agents_;
+			std::vector<uint32_t>						dirty_;
+			std::unordered_map<int64_t, std::vector<uint32_t> >	grid_;
+
+			// Per-update scratch, kept to avoid reallocation
+			std::vector<uint32_t>						found_;
+			std::vector<TriggerEvent>					events_[3];
+			Handler										handlers_[3];
+
+			uint32_t	insertTrigger(Volume const & v);
+			int64_t		key(int x, int y) const	{ return ((int64_t)x << 32) ^ (int64_t)(uint32_t)y; }
+			bool		overlapsVolume(Volume const & v, Agent const & a) const;
+			void		markDirty(uint32_t agent);
+			void		retest(uint32_t agent);
+			void		leave(uint32_t trigger, uint32_t agent);
+	};
+
+} // close namespace 'physics'
+
+#endif
@@ -67,6 +67,8 @@ class WinCanvas : public Canvas/*, public Interface*/
 		void WinCanvas::DrawSolidTriangle(Triangle const & t, unsigned long fill_rgb, unsigned long line_rgb, int line_width);
 		void WinCanvas::DrawCircle(Circle const & c, unsigned long line_rgb, int line_width);
 		void WinCanvas::DrawSolidCircle(Circle const & c, unsigned long fill_rgb, unsigned long line_rgb, int line_width);
+		void WinCanvas::DrawConvex(ConvexPolygon const & c, unsigned long line_rgb, int line_width);
+		void WinCanvas::DrawSolidConvex(ConvexPolygon const & c, unsigned long fill_rgb, unsigned long line_rgb, int line_width);
 
 	public:
 		WinCanvas(short x, short y, std::wstring s = L"WinCanvas");
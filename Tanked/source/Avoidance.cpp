@@ -0,0 +1,314 @@
+/* ********************************************************************************* *
+ * *  File: Avoidance.cpp                                                          * *
+ * *  -------------------                                                          * *
+ * *  COPYRIGHT NOTICE                                                             * *
+ * *  ----------------                                                             * *
+ * *  (C)[2012] - [2015] Deakin University                                         * *
+ * *  All rights reserved.                                                         * *
+ * *  All information contained herein is, and remains the property of Deakin      * *
+ * *  University and the author (Tim Wilkin).                                      * *
+ * *  Dissemination of this information or reproduction of this material is        * *
+ * *  strictly forbidden unless prior written permission is obtained from Deakin   * *
+ * *  University.The right to create derivative works from this material is        * *
+ * *  hereby granted to students enrolled in SIT255, but only for the purposes of  * *
+ * *  assessment while an enrolled student at Deakin University.                   * *
+ * *                                                                               * *
+ * ********************************************************************************* */
+
+#include <cmath>
+
+#include "ai/Avoidance.h"
+#include "core/Parallel.h"
+
+using namespace ai;
+
+namespace {
+
+	const float		EPSILON = 1.0e-5f;
+
+	inline float det(float ax, float ay, float bx, float by)
+	{
+		return ax * by - ay * bx;
+	}
+
+} // close anonymous namespace
+
+const size_t Avoidance::MAX_NEIGHBOURS;
+
+Avoidance::Avoidance(float time_horizon, float neighbour_dist, size_t max_neighbours)
+	: horizon_(time_horizon),
+	  neighbour_dist_(neighbour_dist),
+	  max_neighbours_(math::min(max_neighbours, MAX_NEIGHBOURS)),
+	  hash_(neighbour_dist * 0.5f)
+{}
+
+size_t Avoidance::add(POINT2 const & p, float radius, float max_speed)
+{
+	x_.push_back(p.x);
+	y_.push_back(p.y);
+	vx_.push_back(0.0f);
+	vy_.push_back(0.0f);
+	radius_.push_back(radius);
+	max_speed_.push_back(max_speed);
+	pref_x_.push_back(0.0f);
+	pref_y_.push_back(0.0f);
+	new_vx_.push_back(0.0f);
+	new_vy_.push_back(0.0f);
+	return x_.size() - 1;
+}
+
+void Avoidance::clear()
+{
+	x_.clear();			y_.clear();
+	vx_.clear();		vy_.clear();
+	radius_.clear();	max_speed_.clear();
+	pref_x_.clear();	pref_y_.clear();
+	new_vx_.clear();	new_vy_.clear();
+}
+
+void Avoidance::solve(float dt)
+{
+	if (x_.empty())
+		return;
+
+	hash_.build(&x_[0], &y_[0], x_.size());
+	float inv_dt = 1.0f / dt;
+	core::parallel_for(0, x_.size(), 256, [this, inv_dt](size_t first, size_t last)
+	{
+		for (size_t i = first; i < last; ++i)
+			solveAgent(i, inv_dt);
+	});
+}
+
+void Avoidance::integrate(float dt)
+{
+	for (size_t i = 0; i < x_.size(); ++i)
+	{
+		vx_[i] = new_vx_[i];
+		vy_[i] = new_vy_[i];
+		x_[i] += vx_[i] * dt;
+		y_[i] += vy_[i] * dt;
+	}
+}
+
+void Avoidance::solveAgent(size_t i, float inv_dt)
+{
+	int32_t	nb[MAX_NEIGHBOURS];
+	float	d2[MAX_NEIGHBOURS];
+	Line	lines[MAX_NEIGHBOURS];
+
+	size_t count = hash_.nearest(x_[i], y_[i], neighbour_dist_, (int32_t)i, max_neighbours_, nb, d2);
+	float inv_h = 1.0f / horizon_;
+
+	for (size_t k = 0; k < count; ++k)
+	{
+		int32_t j = nb[k];
+		float rpx = x_[j] - x_[i], rpy = y_[j] - y_[i];
+		float rvx = vx_[i] - vx_[j], rvy = vy_[i] - vy_[j];
+		float dist_sq = d2[k];
+		float r = radius_[i] + radius_[j], r_sq = r * r;
+
+		Line & line = lines[k];
+		float ux, uy;
+		if (dist_sq > r_sq)
+		{
+			// Relative velocity from the centre of the cut-off circle
+			float wx = rvx - inv_h * rpx, wy = rvy - inv_h * rpy;
+			float w_sq = wx * wx + wy * wy;
+			float dot = wx * rpx + wy * rpy;
+
+			if (dot < 0.0f && dot * dot > r_sq * w_sq)
+			{
+				// Nearest boundary is the cut-off circle
+				float w = sqrt(w_sq);
+				float nx = wx / w, ny = wy / w;
+				line.dx = ny;
+				line.dy = -nx;
+				ux = (r * inv_h - w) * nx;
+				uy = (r * inv_h - w) * ny;
+			}
+			else
+			{
+				// Nearest boundary is one of the cone's legs
+				float leg = sqrt(dist_sq - r_sq);
+				if (det(rpx, rpy, wx, wy) > 0.0f)
+				{
+					line.dx = (rpx * leg - rpy * r) / dist_sq;
+					line.dy = (rpx * r + rpy * leg) / dist_sq;
+				}
+				else
+				{
+					line.dx = -(rpx * leg + rpy * r) / dist_sq;
+					line.dy = -(-rpx * r + rpy * leg) / dist_sq;
+				}
+				float along = rvx * line.dx + rvy * line.dy;
+				ux = along * line.dx - rvx;
+				uy = along * line.dy - rvy;
+			}
+		}
+		else
+		{
+			// Already overlapping: separate within this time step
+			float wx = rvx - inv_dt * rpx, wy = rvy - inv_dt * rpy;
+			float w = sqrt(wx * wx + wy * wy);
+			float nx = (w > 0.0f) ? wx / w : 1.0f, ny = (w > 0.0f) ? wy / w : 0.0f;
+			line.dx = ny;
+			line.dy = -nx;
+			ux = (r * inv_dt - w) * nx;
+			uy = (r * inv_dt - w) * ny;
+		}
+
+		// Each agent takes half of the change
+		line.px = vx_[i] + 0.5f * ux;
+		line.py = vy_[i] + 0.5f * uy;
+	}
+
+	float rx, ry;
+	size_t failed = program2(lines, count, max_speed_[i], pref_x_[i], pref_y_[i], false, rx, ry);
+	if (failed < count)
+		program3(lines, count, failed, max_speed_[i], rx, ry);
+
+	new_vx_[i] = rx;
+	new_vy_[i] = ry;
+}
+
+/*
+ * Linear programs: optimise over the disc of radius (the speed limit)
+ * intersected with the half-planes left of each line
+ */
+
+// Best point on line n satisfying lines [0, n) within the disc
+bool Avoidance::program1(Line const * lines, size_t n, float radius, float ox, float oy,
+						 bool direction, float & rx, float & ry)
+{
+	Line const & l = lines[n];
+	float dot = l.px * l.dx + l.py * l.dy;
+	float disc = dot * dot + radius * radius - (l.px * l.px + l.py * l.py);
+	if (disc < 0.0f)
+		return false;		// the line misses the speed disc
+
+	float root = sqrt(disc);
+	float t_lo = -dot - root, t_hi = -dot + root;
+
+	for (size_t i = 0; i < n; ++i)
+	{
+		float denom = det(l.dx, l.dy, lines[i].dx, lines[i].dy);
+		float numer = det(lines[i].dx, lines[i].dy, l.px - lines[i].px, l.py - lines[i].py);
+
+		if (fabs(denom) <= EPSILON)
+		{
+			// Parallel: either all of line n is allowed by line i or none of it
+			if (numer < 0.0f)
+				return false;
+			continue;
+		}
+
+		float t = numer / denom;
+		if (denom >= 0.0f)
+			t_hi = math::min(t_hi, t);
+		else
+			t_lo = math::max(t_lo, t);
+		if (t_lo > t_hi)
+			return false;
+	}
+
+	float t;
+	if (direction)
+		t = (ox * l.dx + oy * l.dy > 0.0f) ? t_hi : t_lo;
+	else
+		t = math::clamp(l.dx * (ox - l.px) + l.dy * (oy - l.py), t_lo, t_hi);
+	rx = l.px + t * l.dx;
+	ry = l.py + t * l.dy;
+	return true;
+}
+
+// Returns n on success, else the index of the line that could not be satisfied
+size_t Avoidance::program2(Line const * lines, size_t n, float radius, float ox, float oy,
+						   bool direction, float & rx, float & ry)
+{
+	if (direction)
+	{
+		// (ox, oy) is a unit direction: go as far along it as possible
+		rx = ox * radius;
+		ry = oy * radius;
+	}
+	else if (ox * ox + oy * oy > radius * radius)
+	{
+		float len = sqrt(ox * ox + oy * oy);
+		rx = ox / len * radius;
+		ry = oy / len * radius;
+	}
+	else
+	{
+		rx = ox;
+		ry = oy;
+	}
+
+	for (size_t i = 0; i < n; ++i)
+	{
+		if (det(lines[i].dx, lines[i].dy, lines[i].px - rx, lines[i].py - ry) > 0.0f)
+		{
+			// The current optimum is on the wrong side: the new one lies on line i
+			float sx = rx, sy = ry;
+			if (!program1(lines, i, radius, ox, oy, direction, rx, ry))
+			{
+				rx = sx;
+				ry = sy;
+				return i;
+			}
+		}
+	}
+	return n;
+}
+
+// Infeasible from line begin on: minimise the largest violation instead
+void Avoidance::program3(Line const * lines, size_t n, size_t begin, float radius, float & rx, float & ry)
+{
+	Line	projected[MAX_NEIGHBOURS];
+	float	distance = 0.0f;
+
+	for (size_t i = begin; i < n; ++i)
+	{
+		Line const & li = lines[i];
+		if (det(li.dx, li.dy, li.px - rx, li.py - ry) <= distance)
+			continue;
+
+		// Lines [0, i) recast as bisectors with line i, so equal violation is the boundary
+		size_t m = 0;
+		for (size_t j = 0; j < i; ++j)
+		{
+			Line const & lj = lines[j];
+			Line & p = projected[m];
+			float d = det(li.dx, li.dy, lj.dx, lj.dy);
+
+			if (fabs(d) <= EPSILON)
+			{
+				if (li.dx * lj.dx + li.dy * lj.dy > 0.0f)
+					continue;		// same direction
+				p.px = 0.5f * (li.px + lj.px);
+				p.py = 0.5f * (li.py + lj.py);
+			}
+			else
+			{
+				float t = det(lj.dx, lj.dy, li.px - lj.px, li.py - lj.py) / d;
+				p.px = li.px + t * li.dx;
+				p.py = li.py + t * li.dy;
+			}
+
+			float bx = lj.dx - li.dx, by = lj.dy - li.dy;
+			float len = sqrt(bx * bx + by * by);
+			p.dx = bx / len;
+			p.dy = by / len;
+			++m;
+		}
+
+		float sx = rx, sy = ry;
+		if (program2(projected, m, radius, -li.dy, li.dx, true, rx, ry) < m)
+		{
+			// Only rounding can get here; keep the previous answer
+			rx = sx;
+			ry = sy;
+		}
+		distance = det(li.dx, li.dy, li.px - rx, li.py - ry);
+	}
+}
@@ -0,0 +1,329 @@
+/* ********************************************************************************* *
+ * *  File: BehaviourTree.cpp                                                      * *
+ * *  -----------------------                                                      * *
+ * *  COPYRIGHT NOTICE                                                             * *
+ * *  ----------------                                                             * *
+ * *  (C)[2012] - [2015] Deakin University                                         * *
+ * *  All rights reserved.                                                         * *
+ * *  All information contained herein is, and remains the property of Deakin      * *
+ * *  University and the author (Tim Wilkin).                                      * *
+ * *  Dissemination of this information or reproduction of this material is        * *
+ * *  strictly forbidden unless prior written permission is obtained from Deakin   * *
+ * *  University.The right to create derivative works from this material is        * *
+ * *  hereby granted to students enrolled in SIT255, but only for the purposes of  * *
+ * *  assessment while an enrolled student at Deakin University.                   * *
+ * *                                                                               * *
+ * ********************************************************************************* */
+
+#include <cassert>
+
+#include "ai/BehaviourTree.h"
+#include "core/Parallel.h"
+
+using namespace ai;
+
+const uint32_t BehaviourTree::ALL_EVENTS;
+const uint32_t BehaviourTree::EVENT_TIMER;
+const uint8_t BehaviourTree::NO_SLOT;
+const uint16_t BehaviourState::IDLE;
+
+/*
+ * BehaviourTree construction
+ */
+
+BehaviourTree::BehaviourTree()
+	: seen_(0),
+	  slots_(0)
+{}
+
+void BehaviourTree::add(uint8_t op, uint16_t arg, bool stateful)
+{
+	// One root, at most IDLE nodes and NO_SLOT state columns
+	assert(nodes_.empty() || !open_.empty());
+	assert(nodes_.size() < BehaviourState::IDLE);
+	assert(!stateful || slots_ < NO_SLOT);
+
+	Node n;
+	n.op	 = op;
+	n.slot	 = stateful ? (uint8_t)slots_++ : NO_SLOT;
+	n.skip	 = 0;
+	n.parent = open_.empty() ? 0 : open_.back();
+	n.arg	 = arg;
+
+	// Anything before this node in pre-order can change the path to it
+	watch_.push_back(seen_);
+	nodes_.push_back(n);
+
+	if (op == OP_CONDITION || op == OP_ACTION || op == OP_WAIT)
+	{
+		nodes_.back().skip = (uint16_t)nodes_.size();
+		close();
+	}
+	else
+		open_.push_back((uint16_t)(nodes_.size() - 1));
+}
+
+void BehaviourTree::close()
+{
+	// A finished subtree completes every decorator waiting on it
+	while (!open_.empty())
+	{
+		uint8_t op = nodes_[open_.back()].op;
+		if (op == OP_SEQUENCE || op == OP_SELECTOR)
+			break;
+		nodes_[open_.back()].skip = (uint16_t)nodes_.size();
+		open_.pop_back();
+	}
+}
+
+void BehaviourTree::sequence()	{ add(OP_SEQUENCE, 0, false); }
+void BehaviourTree::selector()	{ add(OP_SELECTOR, 0, false); }
+void BehaviourTree::inverter()	{ add(OP_INVERTER, 0, false); }
+void BehaviourTree::succeeder()	{ add(OP_SUCCEEDER, 0, false); }
+
+void BehaviourTree::end()
+{
+	assert(!open_.empty());
+	assert(nodes_[open_.back()].op == OP_SEQUENCE || nodes_[open_.back()].op == OP_SELECTOR);
+	nodes_[open_.back()].skip = (uint16_t)nodes_.size();
+	open_.pop_back();
+	close();
+}
+
+void BehaviourTree::repeat(uint16_t times)
+{
+	assert(times > 0);
+	add(OP_REPEAT, times, true);
+}
+
+void BehaviourTree::cooldown(uint16_t ticks)
+{
+	add(OP_COOLDOWN, ticks, true);
+	seen_ |= EVENT_TIMER;
+}
+
+void BehaviourTree::condition(Leaf fn, int32_t param, uint32_t events)
+{
+	LeafEntry e = { fn, param };
+	leaves_.push_back(e);
+	add(OP_CONDITION, (uint16_t)(leaves_.size() - 1), false);
+	seen_ |= events;
+}
+
+void BehaviourTree::action(Leaf fn, int32_t param)
+{
+	LeafEntry e = { fn, param };
+	leaves_.push_back(e);
+	add(OP_ACTION, (uint16_t)(leaves_.size() - 1), false);
+}
+
+void BehaviourTree::wait(uint16_t ticks)
+{
+	add(OP_WAIT, ticks, true);
+}
+
+/*
+ * Evaluation
+ */
+
+STATUS BehaviourTree::run(BehaviourState & state, void * context, uint32_t agent) const
+{
+	assert(open_.empty() && !nodes_.empty());
+
+	uint16_t running = state.running_[agent];
+	uint32_t events  = state.events_[agent];
+	uint32_t tick	 = state.tick_;
+	uint32_t wake	 = state.wake_[agent];
+	state.events_[agent] = 0;
+
+	if (wake && (int32_t)(tick - wake) >= 0)
+		events |= EVENT_TIMER;
+
+	// Resume the running leaf unless an event may have changed the way there
+	uint16_t node = 0;
+	if (running != BehaviourState::IDLE && (events & watch_[running]) == 0)
+		node = running;
+	else
+		wake = 0;
+
+	bool	 down = true;
+	STATUS	 status = STATUS_FAILURE;
+
+	for (;;)
+	{
+		Node const & n = nodes_[node];
+
+		if (down)
+		{
+			// Entering a subtree that holds the running leaf continues it
+			bool active = running != BehaviourState::IDLE && node <= running && running < n.skip;
+
+			switch (n.op)
+			{
+				case OP_SEQUENCE:
+				case OP_SELECTOR:
+					if (n.skip == node + 1)
+					{
+						status = (n.op == OP_SEQUENCE) ? STATUS_SUCCESS : STATUS_FAILURE;
+						down = false;
+					}
+					else
+						++node;
+					continue;
+
+				case OP_INVERTER:
+				case OP_SUCCEEDER:
+					++node;
+					continue;
+
+				case OP_REPEAT:
+					if (!active)
+						state.slots_[n.slot][agent] = 0;
+					++node;
+					continue;
+
+				case OP_COOLDOWN:
+				{
+					uint32_t & until = state.slots_[n.slot][agent];
+					if (until && (int32_t)(until - tick) > 0)
+					{
+						// Blocked: look again when the earliest such cooldown ends
+						if (!wake || (int32_t)(until - wake) < 0)
+							wake = until;
+						status = STATUS_FAILURE;
+						down = false;
+					}
+					else
+					{
+						until = 0;		// window over: never compare against it again
+						++node;
+					}
+					continue;
+				}
+
+				case OP_WAIT:
+				{
+					uint32_t & start = state.slots_[n.slot][agent];
+					if (!active)
+						start = tick;
+					status = (tick - start >= n.arg) ? STATUS_SUCCESS : STATUS_RUNNING;
+					break;
+				}
+
+				default:
+				{
+					LeafEntry const & leaf = leaves_[n.arg];
+					status = leaf.fn(context, agent, leaf.param);
+					break;
+				}
+			}
+
+			// A leaf has run
+			if (status == STATUS_RUNNING)
+			{
+				state.running_[agent] = node;
+				state.wake_[agent] = wake;
+				return STATUS_RUNNING;
+			}
+			if (node == running)
+				running = BehaviourState::IDLE;
+			down = false;
+		}
+
+		// status is the result of the subtree at node; hand it to the parent
+		if (node == 0)
+			break;
+
+		uint16_t parent = n.parent;
+		Node const & p = nodes_[parent];
+		switch (p.op)
+		{
+			case OP_SEQUENCE:
+				if (status == STATUS_SUCCESS && n.skip < p.skip)
+				{
+					node = n.skip;
+					down = true;
+					continue;
+				}
+				break;
+
+			case OP_SELECTOR:
+				if (status == STATUS_FAILURE && n.skip < p.skip)
+				{
+					node = n.skip;
+					down = true;
+					continue;
+				}
+				break;
+
+			case OP_INVERTER:
+				status = (status == STATUS_SUCCESS) ? STATUS_FAILURE : STATUS_SUCCESS;
+				break;
+
+			case OP_SUCCEEDER:
+				status = STATUS_SUCCESS;
+				break;
+
+			case OP_REPEAT:
+				if (status == STATUS_SUCCESS && ++state.slots_[p.slot][agent] < p.arg)
+				{
+					node = parent + 1;
+					down = true;
+					continue;
+				}
+				break;
+
+			case OP_COOLDOWN:
+				if (status == STATUS_SUCCESS)
+					state.slots_[p.slot][agent] = (tick + p.arg) ? tick + p.arg : 1;		// 0 means not cooling
+				break;
+		}
+		node = parent;
+	}
+
+	state.running_[agent] = BehaviourState::IDLE;
+	state.wake_[agent] = 0;
+	return status;
+}
+
+void BehaviourTree::tick(BehaviourState & state, void * context, uint32_t first, uint32_t last) const
+{
+	for (uint32_t a = first; a < last; ++a)
+		run(state, context, a);
+}
+
+void BehaviourTree::tick(BehaviourState & state, void * context) const
+{
+	core::parallel_for(0, state.size(), 256, [this, &state, context](size_t first, size_t last)
+	{
+		tick(state, context, (uint32_t)first, (uint32_t)last);
+	});
+}
+
+/*
+ * BehaviourState
+ */
+
+BehaviourState::BehaviourState(BehaviourTree const & tree, size_t agents)
+	: running_(agents, IDLE),
+	  events_(agents, 0),
+	  wake_(agents, 0),
+	  slots_(tree.slots(), std::vector<uint32_t>(agents, 0)),
+	  tick_(0)
+{}
+
+uint32_t BehaviourState::add()
+{
+	running_.push_back(IDLE);
+	events_.push_back(0);
+	wake_.push_back(0);
+	for (size_t s = 0; s < slots_.size(); ++s)
+		slots_[s].push_back(0);
+	return (uint32_t)(running_.size() - 1);
+}
+
+void BehaviourState::post(uint32_t events)
+{
+	for (size_t a = 0; a < events_.size(); ++a)
+		events_[a] |= events;
+}
@@ -0,0 +1,747 @@
+/* ********************************************************************************* *
+ * *  File: Benchmarks.cpp                                                         * *
+ * *  --------------------                                                         * *
+ * *  COPYRIGHT NOTICE                                                             * *
+ * *  ----------------                                                             * *
+ * *  (C)[2012] - [2015] Deakin University                                         * *
+ * *  All rights reserved.                                                         * *
+ * *  All information contained herein is, and remains the property of Deakin      * *
+ * *  University and the author (Tim Wilkin).                                      * *
+ * *  Dissemination of this information or reproduction of this material is        * *
+ * *  strictly forbidden unless prior written permission is obtained from Deakin   * *
+ * *  University.The right to create derivative works from this material is        * *
+ * *  hereby granted to students enrolled in SIT255, but only for the purposes of  * *
+ * *  assessment while an enrolled student at Deakin University.                   * *
+ * *                                                                               * *
+ * ********************************************************************************* */
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <random>
+#include <vector>
+
+#include "ai/Benchmarks.h"
+#include "ai/LodScheduler.h"
+#include "ai/PathService.h"
+#include "ai/Planner.h"
+#include "ai/Script.h"
+#include "ai/Steering.h"
+#include "ai/Utility.h"
+#include "core/DoubleBuffer.h"
+#include "level/DistanceField.h"
+
+using namespace ai;
+using namespace level;
+
+namespace {
+
+	const size_t	QUERIES = 200;
+
+	inline int64_t now_us()
+	{
+		return std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	/*
+	 * A tank's combat tactics: facts and actions for the planner benchmark
+	 */
+	enum TACTICS_FACT
+	{
+		HAS_AMMO = 1 << 0, LOADED = 1 << 1, AT_DEPOT = 1 << 2, SEES_ENEMY = 1 << 3,
+		IN_RANGE = 1 << 4, IN_COVER = 1 << 5, HEALTHY = 1 << 6, HAS_KIT = 1 << 7,
+		AT_WORKSHOP = 1 << 8, FLANKING = 1 << 9, SMOKE = 1 << 10, ENEMY_DEAD = 1 << 11
+	};
+
+	// World-change flags the actions depend on
+	const uint32_t	DEPOTS = 1, WORKSHOPS = 2, TERRAIN = 4;
+
+	/*
+	 * A scripted tank for the script benchmark: drive a while, sit out a
+	 * pause, then fire three shots, each waiting for the shared reload event
+	 */
+	struct Gunner
+	{
+		float		x;
+		uint32_t	shots;
+		uint32_t	resumes;
+	};
+
+	Script gunner_script(ScriptScheduler & s, Gunner & g, ScriptScheduler::EventId reloaded, uint32_t seed)
+	{
+		for (;;)
+		{
+			seed = seed * 1664525u + 1013904223u;
+			for (uint32_t i = 0, n = 10 + (seed >> 24) % 50; i < n; ++i)
+			{
+				g.x += 0.5f;
+				co_await s.yield();
+				++g.resumes;
+			}
+			co_await s.sleep(1.0f + (float)((seed >> 16) & 0xff) / 64.0f);
+			++g.resumes;
+			for (int i = 0; i < 3; ++i)
+			{
+				++g.shots;
+				co_await s.wait(reloaded);
+				++g.resumes;
+			}
+		}
+	}
+
+	void add_tactics(Planner & planner)
+	{
+		typedef Condition C;
+		planner.addAction("drive to depot", 4.0f, C(AT_DEPOT | AT_WORKSHOP, 0), C(AT_DEPOT | IN_COVER | IN_RANGE, AT_DEPOT), DEPOTS);
+		planner.addAction("take ammo", 1.0f, C(AT_DEPOT, AT_DEPOT), C(HAS_AMMO, HAS_AMMO), DEPOTS);
+		planner.addAction("reload", 1.0f, C(HAS_AMMO | LOADED, HAS_AMMO), C(HAS_AMMO | LOADED, LOADED));
+		planner.addAction("scout", 3.0f, C(SEES_ENEMY, 0), C(SEES_ENEMY | AT_DEPOT | AT_WORKSHOP, SEES_ENEMY), TERRAIN);
+		planner.addAction("close in", 2.0f, C(SEES_ENEMY | IN_RANGE, SEES_ENEMY), C(IN_RANGE | IN_COVER | AT_DEPOT | AT_WORKSHOP, IN_RANGE), TERRAIN);
+		planner.addAction("flank", 3.0f, C(SEES_ENEMY | FLANKING, SEES_ENEMY), C(FLANKING | IN_RANGE | IN_COVER | AT_DEPOT | AT_WORKSHOP, FLANKING | IN_RANGE), TERRAIN);
+		planner.addAction("take cover", 2.0f, C(IN_COVER, 0), C(IN_COVER | AT_DEPOT | AT_WORKSHOP, IN_COVER), TERRAIN);
+		planner.addAction("lay smoke", 1.0f, C(HAS_AMMO | SMOKE, HAS_AMMO), C(SMOKE | HAS_AMMO, SMOKE));
+		planner.addAction("fire", 1.0f, C(LOADED | IN_RANGE | HEALTHY, LOADED | IN_RANGE | HEALTHY), C(LOADED | ENEMY_DEAD, ENEMY_DEAD));
+		planner.addAction("fire from cover", 1.5f, C(LOADED | IN_RANGE | IN_COVER, LOADED | IN_RANGE | IN_COVER), C(LOADED | ENEMY_DEAD, ENEMY_DEAD));
+		planner.addAction("fire while flanking", 0.5f, C(LOADED | FLANKING | SMOKE, LOADED | FLANKING | SMOKE), C(LOADED | ENEMY_DEAD | SMOKE, ENEMY_DEAD));
+		planner.addAction("drive to workshop", 5.0f, C(AT_WORKSHOP | AT_DEPOT, 0), C(AT_WORKSHOP | IN_COVER | IN_RANGE, AT_WORKSHOP), WORKSHOPS);
+		planner.addAction("take kit", 1.0f, C(AT_WORKSHOP, AT_WORKSHOP), C(HAS_KIT, HAS_KIT), WORKSHOPS);
+		planner.addAction("repair", 3.0f, C(HAS_KIT | HEALTHY, HAS_KIT), C(HAS_KIT | HEALTHY, HEALTHY));
+		planner.addAction("field repair", 6.0f, C(HEALTHY | IN_COVER, IN_COVER), C(HEALTHY, HEALTHY));
+	}
+
+	// Open the cell rectangle [x0, x1] x [y0, y1] of a unit-cell grid at the origin
+	void carve(OccupancyGrid & grid, int x0, int y0, int x1, int y1)
+	{
+		grid.clearStatic(AABB(POINT2(x0 + 0.25f, y0 + 0.25f), POINT2(x1 + 0.75f, y1 + 0.75f)));
+	}
+
+	/*
+	 * Perfect maze of rooms x rooms, corridors corridor cells wide with one
+	 * cell walls, grown by a randomised depth-first search.
+	 */
+	void make_maze(OccupancyGrid & grid, int rooms, int corridor, uint32_t seed)
+	{
+		int pitch = corridor + 1;
+		float size = (float)(rooms * pitch + 1);
+		grid.reset(AABB(POINT2(0.0f, 0.0f), POINT2(size, size)), 1.0f);
+		grid.stamp(Rect(POINT2(0.0f, 0.0f), POINT2(size, size)));
+
+		static const int DX[4] = { 1, -1, 0, 0 };
+		static const int DY[4] = { 0, 0, 1, -1 };
+
+		std::mt19937 rng(seed);
+		std::vector<bool> visited((size_t)rooms * rooms, false);
+		std::vector<int> stack(1, 0);
+		visited[0] = true;
+		carve(grid, 1, 1, corridor, corridor);
+
+		while (!stack.empty())
+		{
+			int r = stack.back();
+			int x = r % rooms, y = r / rooms;
+
+			int options[4], count = 0;
+			for (int k = 0; k < 4; ++k)
+			{
+				int nx = x + DX[k], ny = y + DY[k];
+				if (nx >= 0 && ny >= 0 && nx < rooms && ny < rooms && !visited[(size_t)ny * rooms + nx])
+					options[count++] = k;
+			}
+			if (count == 0)
+			{
+				stack.pop_back();
+				continue;
+			}
+
+			int k = options[rng() % count];
+			int nx = x + DX[k], ny = y + DY[k];
+			visited[(size_t)ny * rooms + nx] = true;
+			stack.push_back(ny * rooms + nx);
+
+			// The room and the wall between it and its parent
+			int cx = math::min(x, nx) * pitch + 1, cy = math::min(y, ny) * pitch + 1;
+			carve(grid, cx, cy, cx + corridor - 1 + DX[k] * DX[k] * pitch, cy + corridor - 1 + DY[k] * DY[k] * pitch);
+		}
+	}
+
+	// Open ground scattered with round and square obstacles
+	void make_field(OccupancyGrid & grid, int size, int obstacles, uint32_t seed)
+	{
+		float s = (float)size;
+		grid.reset(AABB(POINT2(0.0f, 0.0f), POINT2(s, s)), 1.0f);
+
+		std::mt19937 rng(seed);
+		std::uniform_real_distribution<float> at(0.0f, s), radius(1.0f, 5.0f);
+		for (int i = 0; i < obstacles; ++i)
+		{
+			POINT2 c(at(rng), at(rng));
+			float r = radius(rng);
+			if (i & 1)
+				grid.stamp(Circle(c, r));
+			else
+				grid.stamp(Rect(POINT2(c.x - r, c.y - r), POINT2(c.x + r, c.y + r)));
+		}
+	}
+
+	// Start and goal pairs between random open cells
+	void make_queries(OccupancyGrid const & grid, uint32_t seed, std::vector<POINT2> & out)
+	{
+		std::mt19937 rng(seed);
+		out.clear();
+		while (out.size() < 2 * QUERIES)
+		{
+			int x = (int)(rng() % grid.width()), y = (int)(rng() % grid.height());
+			if (!grid.blocked(x, y))
+				out.push_back(grid.centre(x, y));
+		}
+	}
+
+	float length(std::vector<POINT2> const & path)
+	{
+		float sum = 0.0f;
+		for (size_t i = 1; i < path.size(); ++i)
+			sum += (path[i] - path[i - 1]).length();
+		return sum;
+	}
+
+	void run(char const * level, OccupancyGrid const & grid, std::ostream & out)
+	{
+		static const char * const NAMES[] = { "A*", "JPS", "JPS+", "Theta*", "Lazy Theta*" };
+
+		GridSpace space(grid);
+		int64_t t0 = now_us();
+		space.prepareJumps();
+		int64_t prepare = now_us() - t0;
+
+		std::vector<POINT2> queries, path;
+		make_queries(grid, 7, queries);
+
+		out << std::fixed << std::setprecision(1);
+		out << level << ": " << grid.width() << "x" << grid.height() << " cells, "
+			<< QUERIES << " queries, JPS+ table built in " << prepare / 1000.0 << " ms\n";
+		out << "  " << std::left << std::setw(14) << "search" << std::right
+			<< std::setw(12) << "us/query" << std::setw(12) << "expanded"
+			<< std::setw(12) << "LOS tests" << std::setw(12) << "length" << std::setw(10) << "found" << "\n";
+
+		for (int s = PathService::SEARCH_ASTAR; s <= PathService::SEARCH_LAZY_THETA; ++s)
+		{
+			// One entry of cache and a release per query keeps every query a fresh search
+			PathService service(space, 1);
+			double total_len = 0.0;
+			size_t found = 0;
+
+			t0 = now_us();
+			for (size_t q = 0; q < QUERIES; ++q)
+			{
+				PathService::Ticket t = service.request(queries[2 * q], queries[2 * q + 1], (PathService::SEARCH)s);
+				while (service.pending())
+					service.update(1.0e6f);
+				if (service.path(t, path))
+				{
+					total_len += length(path);
+					++found;
+				}
+				service.release(t);
+			}
+			int64_t elapsed = now_us() - t0;
+
+			PathService::Stats const & st = service.stats();
+			out << "  " << std::left << std::setw(14) << NAMES[s] << std::right
+				<< std::setw(12) << (double)elapsed / QUERIES
+				<< std::setw(12) << (double)st.expansions / QUERIES
+				<< std::setw(12) << (double)st.sight_checks / QUERIES
+				<< std::setw(12) << (found ? total_len / found : 0.0)
+				<< std::setw(10) << found << "\n";
+		}
+		out << "\n";
+		out.unsetf(std::ios::fixed);
+	}
+
+} // close anonymous namespace
+
+void ai::benchmarkPathfinding(std::ostream & out)
+{
+	OccupancyGrid grid;
+
+	make_maze(grid, 100, 3, 1);
+	run("maze", grid, out);
+
+	make_field(grid, 512, 1200, 2);
+	run("open field", grid, out);
+}
+
+void ai::benchmarkSteering(std::ostream & out)
+{
+	static const size_t	CROWDS[] = { 10000, 40000 };
+	const int			TICKS = 60;
+	const float			SIZE = 2000.0f, DT = 1.0f / 30.0f;
+
+	// An arena with a few walls across it
+	std::vector<Segment> walls;
+	POINT2 c[4] = { POINT2(0.0f, 0.0f), POINT2(SIZE, 0.0f), POINT2(SIZE, SIZE), POINT2(0.0f, SIZE) };
+	for (int k = 0; k < 4; ++k)
+	{
+		POINT2 a = c[k], b = c[(k + 1) % 4];
+		walls.push_back(Segment(a, b, VECTOR2(-(b.y - a.y), b.x - a.x)));
+	}
+	for (int k = 1; k < 4; ++k)
+	{
+		POINT2 a(SIZE * 0.25f * k, SIZE * 0.2f), b(SIZE * 0.25f * k, SIZE * 0.6f);
+		walls.push_back(Segment(a, b, VECTOR2(1.0f, 0.0f)));
+		walls.push_back(Segment(b, a, VECTOR2(-1.0f, 0.0f)));
+	}
+	level::DistanceField field;
+	field.bake(walls, AABB(POINT2(0.0f, 0.0f), POINT2(SIZE, SIZE)), 4.0f, 32.0f);
+
+	out << "steering: " << TICKS << " ticks, walls from a " << field.width() << "x" << field.height()
+		<< " distance field\n";
+	out << "  " << std::setw(10) << "agents" << std::setw(12) << "ms/tick" << std::setw(16) << "agents/ms"
+		<< std::setw(12) << "escaped" << "\n";
+
+	for (size_t c = 0; c < sizeof(CROWDS) / sizeof(CROWDS[0]); ++c)
+	{
+		size_t n = CROWDS[c];
+		std::mt19937 rng(11);
+		std::uniform_real_distribution<float> at(20.0f, SIZE - 20.0f);
+
+		// Mostly flocks that wander, some agents seeking goals, some chasing others
+		Steering crowd;
+		crowd.setWalls(&field);
+		for (size_t i = 0; i < n; ++i)
+		{
+			size_t a = crowd.add(POINT2(at(rng), at(rng)), 40.0f, 120.0f);
+			crowd.setWeight(a, STEER_WALLS, 4.0f);
+			crowd.setWeight(a, STEER_SEPARATION, 30.0f);
+			switch (i % 5)
+			{
+				case 0:
+					crowd.setTarget(a, POINT2(at(rng), at(rng)));
+					crowd.setWeight(a, STEER_ARRIVE, 1.0f);
+					break;
+				case 1:
+					crowd.setQuarry(a, (int32_t)(rng() % n));
+					crowd.setWeight(a, (i % 2) ? STEER_PURSUE : STEER_EVADE, 1.0f);
+					break;
+				default:
+					crowd.setWeight(a, STEER_WANDER, 1.0f);
+					crowd.setWeight(a, STEER_ALIGNMENT, 0.5f);
+					crowd.setWeight(a, STEER_COHESION, 0.5f);
+					break;
+			}
+		}
+
+		int64_t t0 = now_us();
+		for (int t = 0; t < TICKS; ++t)
+			crowd.update(DT);
+		double ms = (now_us() - t0) / 1000.0 / TICKS;
+
+		size_t escaped = 0;
+		for (size_t i = 0; i < n; ++i)
+		{
+			POINT2 p = crowd.position(i);
+			if (p.x < 0.0f || p.y < 0.0f || p.x > SIZE || p.y > SIZE)
+				++escaped;
+		}
+
+		out << std::fixed << std::setprecision(2);
+		out << "  " << std::setw(10) << n << std::setw(12) << ms << std::setw(16) << n / ms
+			<< std::setw(12) << escaped << "\n";
+		out.unsetf(std::ios::fixed);
+	}
+	out << "\n";
+}
+
+void ai::benchmarkLod(std::ostream & out)
+{
+	static const size_t	CROWDS[] = { 2000, 20000 };
+	const int			TICKS = 120;
+	const float			DENSITY = 1.0f / 2500.0f;		// agents per square unit
+
+	/*
+	 * A stand-in think(): a few hundred flops standing for a sense/decide
+	 * step, then a new heading. The world grows with the population, and
+	 * two players stay near the middle.
+	 */
+	struct Agent
+	{
+		POINT2	p;
+		VECTOR2	v;
+		float	mind;
+	};
+
+	out << "AI LOD: " << TICKS << " ticks, the world grows with the agents, two viewers\n";
+	out << "  " << std::setw(10) << "agents" << std::setw(14) << "full ms/tick" << std::setw(14) << "lod ms/tick"
+		<< std::setw(14) << "updates/tick" << "\n";
+
+	double full_ms[2], lod_ms[2];
+	for (size_t c = 0; c < sizeof(CROWDS) / sizeof(CROWDS[0]); ++c)
+	{
+		size_t n = CROWDS[c];
+		float size = std::sqrt(n / DENSITY);
+		std::mt19937 rng(5);
+		std::uniform_real_distribution<float> at(0.0f, size);
+
+		std::vector<Agent> agents(n);
+		for (size_t i = 0; i < n; ++i)
+		{
+			agents[i].p	   = POINT2(at(rng), at(rng));
+			agents[i].v	   = VECTOR2(10.0f, 0.0f);
+			agents[i].mind = 0.0f;
+		}
+
+		auto think = [&agents](uint32_t i, float dt)
+		{
+			Agent & a = agents[i];
+			float m = a.mind;
+			for (int k = 0; k < 200; ++k)
+				m = m * 0.999f + std::sin(m + (float)k) * 0.01f;
+			a.mind = m;
+			a.v = VECTOR2(std::cos(m) * 10.0f, std::sin(m) * 10.0f);
+			a.p = POINT2(a.p.x + a.v.x * dt, a.p.y + a.v.y * dt);
+		};
+
+		// Every agent every tick
+		int64_t t0 = now_us();
+		for (int t = 0; t < TICKS; ++t)
+			core::parallel_for(0, n, 64, [&think](size_t first, size_t last)
+			{
+				for (size_t i = first; i < last; ++i)
+					think((uint32_t)i, 1.0f / 60.0f);
+			});
+		double full = (now_us() - t0) / 1000.0 / TICKS;
+
+		// Scheduled by distance to the viewers
+		LodScheduler lod;
+		POINT2 viewers[2] = { POINT2(size * 0.5f, size * 0.5f), POINT2(size * 0.5f + 300.0f, size * 0.5f) };
+		lod.setViewers(viewers, 2);
+		for (size_t i = 0; i < n; ++i)
+			lod.add(agents[i].p);
+
+		size_t updates = 0;
+		t0 = now_us();
+		for (int t = 0; t < TICKS; ++t)
+			updates += lod.tick([&](uint32_t i, float dt)
+			{
+				think(i, dt);
+				lod.setState(i, agents[i].p, agents[i].v);
+			});
+		double scheduled = (now_us() - t0) / 1000.0 / TICKS;
+
+		full_ms[c] = full;
+		lod_ms[c]  = scheduled;
+
+		out << std::fixed << std::setprecision(3);
+		out << "  " << std::setw(10) << n << std::setw(14) << full << std::setw(14) << scheduled
+			<< std::setw(14) << std::setprecision(0) << (double)updates / TICKS << "\n";
+		out.unsetf(std::ios::fixed);
+	}
+
+	out << std::fixed << std::setprecision(1);
+	out << "  10x the agents costs x" << full_ms[1] / full_ms[0] << " every tick, x" << lod_ms[1] / lod_ms[0]
+		<< " scheduled\n\n";
+	out.unsetf(std::ios::fixed);
+}
+
+void ai::benchmarkUtility(std::ostream & out)
+{
+	static const size_t	ACTIONS[] = { 8, 32, 128 };
+	const size_t		AGENTS = 100000, INPUTS = 8, CONSIDERATIONS = 3;
+	const int			ROUNDS = 20;
+
+	std::mt19937 rng(17);
+	std::uniform_real_distribution<float> value(0.0f, 100.0f);
+
+	float ramp[Curve::TABLE_POINTS];
+	for (size_t i = 0; i < Curve::TABLE_POINTS; ++i)
+		ramp[i] = (float)((i * 7) % Curve::TABLE_POINTS) / (Curve::TABLE_POINTS - 1);
+
+	out << "utility: " << AGENTS << " agents, " << CONSIDERATIONS << " considerations per action, all curve shapes\n";
+	out << "  " << std::setw(10) << "actions" << std::setw(12) << "ms/decide" << std::setw(14) << "ns/agent"
+		<< std::setw(16) << "ns/action" << "\n";
+
+	for (size_t c = 0; c < sizeof(ACTIONS) / sizeof(ACTIONS[0]); ++c)
+	{
+		Utility utility(AGENTS);
+		for (size_t i = 0; i < INPUTS; ++i)
+		{
+			Utility::InputId in = utility.addInput();
+			float * v = utility.input(in);
+			for (size_t a = 0; a < AGENTS; ++a)
+				v[a] = value(rng);
+		}
+
+		for (size_t a = 0; a < ACTIONS[c]; ++a)
+		{
+			Utility::ActionId id = utility.addAction(0.5f + value(rng) / 200.0f);
+			for (size_t k = 0; k < CONSIDERATIONS; ++k)
+			{
+				Utility::InputId in = (Utility::InputId)((a + k) % INPUTS);
+				switch ((a + k) % 4)
+				{
+					case 0:		utility.addConsideration(id, in, Curve::linear(0.0f, 100.0f));					break;
+					case 1:		utility.addConsideration(id, in, Curve::logistic(100.0f, 0.0f, 8.0f, 0.4f));	break;
+					case 2:		utility.addConsideration(id, in, Curve::quadratic(0.0f, 100.0f, -1.0f, 0.5f, 1.0f));	break;
+					default:	utility.addConsideration(id, in, Curve::lookup(0.0f, 100.0f, ramp));			break;
+				}
+			}
+		}
+
+		utility.decide(0.1f);
+		int64_t t0 = now_us();
+		for (int r = 0; r < ROUNDS; ++r)
+			utility.decide(0.1f);
+		double ms = (now_us() - t0) / 1000.0 / ROUNDS;
+
+		out << std::fixed << std::setprecision(2);
+		out << "  " << std::setw(10) << ACTIONS[c] << std::setw(12) << ms << std::setw(14) << ms * 1.0e6 / AGENTS
+			<< std::setw(16) << ms * 1.0e6 / AGENTS / ACTIONS[c] << "\n";
+		out.unsetf(std::ios::fixed);
+	}
+	out << "\n";
+}
+
+void ai::benchmarkPlanning(std::ostream & out)
+{
+	static const size_t	AGENTS[] = { 100, 400, 1600 };
+	const int			TICKS = 30;
+	const size_t		BUDGET = 20000;		// node expansions per tick
+
+	// Tanks differ in the facts that start a plan; the rest follow from acting
+	const WorldState	VARYING = HAS_AMMO | LOADED | SEES_ENEMY | IN_RANGE | IN_COVER | HEALTHY | HAS_KIT;
+	const Condition		goal(ENEMY_DEAD | HEALTHY, ENEMY_DEAD | HEALTHY);
+
+	out << "planning: " << TICKS << " ticks, every tank replanning each tick, " << BUDGET << " expansions per tick\n";
+	out << "  " << std::setw(8) << "tanks" << std::setw(8) << "cache" << std::setw(12) << "searches" << std::setw(10)
+		<< "hits" << std::setw(12) << "ms/tick" << std::setw(14) << "us/request" << std::setw(10) << "late" << "\n";
+
+	for (size_t c = 0; c < sizeof(AGENTS) / sizeof(AGENTS[0]); ++c)
+	{
+		for (int cached = 0; cached < 2; ++cached)
+		{
+			Planner planner(cached ? 256 : 1);
+			add_tactics(planner);
+
+			std::mt19937 rng(29);
+			std::vector<Planner::Ticket> tickets(AGENTS[c], 0);
+			std::vector<Planner::ActionId> plan;
+			size_t late = 0;
+
+			int64_t t0 = now_us();
+			for (int t = 0; t < TICKS; ++t)
+			{
+				// The map changes now and then: plans through depots go stale
+				if (t % 10 == 9)
+					planner.invalidate(DEPOTS);
+
+				for (size_t a = 0; a < AGENTS[c]; ++a)
+				{
+					if (tickets[a])
+					{
+						if (planner.status(tickets[a]) == Planner::PLAN_PENDING)
+						{
+							++late;
+							continue;
+						}
+						planner.plan(tickets[a], plan);
+						planner.release(tickets[a]);
+						tickets[a] = 0;
+					}
+
+					WorldState facts = 0;
+					for (WorldState bit = 1; bit <= VARYING; bit <<= 1)
+						if ((VARYING & bit) && (rng() & 1))
+							facts |= bit;
+					tickets[a] = planner.request(facts, goal);
+
+					// Without the cache every request is its own search
+					if (!cached)
+					{
+						planner.update(BUDGET);
+						planner.plan(tickets[a], plan);
+						planner.release(tickets[a]);
+						tickets[a] = 0;
+					}
+				}
+				planner.update(BUDGET);
+			}
+			double ms = (now_us() - t0) / 1000.0 / TICKS;
+
+			Planner::Stats const & st = planner.stats();
+			out << std::fixed << std::setprecision(3);
+			out << "  " << std::setw(8) << AGENTS[c] << std::setw(8) << (cached ? "on" : "off") << std::setw(12) << st.searches
+				<< std::setw(9) << std::setprecision(1) << 100.0 * st.cached / st.requests << "%" << std::setprecision(3)
+				<< std::setw(12) << ms << std::setw(14) << ms * 1000.0 / AGENTS[c] << std::setw(10) << late << "\n";
+			out.unsetf(std::ios::fixed);
+		}
+	}
+	out << "\n";
+}
+
+void ai::benchmarkScripts(std::ostream & out)
+{
+	static const size_t	AGENTS[] = { 1000, 10000, 100000 };
+	const int			TICKS = 600;
+	const int			RELOAD = 30;		// ticks between reload signals
+
+	out << "scripts: " << TICKS << " ticks at 60 Hz, scripted tanks driving, pausing and firing\n";
+	out << "  " << std::setw(8) << "tanks" << std::setw(12) << "ms/tick" << std::setw(14) << "ns/tank" << std::setw(16)
+		<< "resumes/tick" << std::setw(16) << "ns/resume" << "\n";
+
+	for (size_t c = 0; c < sizeof(AGENTS) / sizeof(AGENTS[0]); ++c)
+	{
+		ScriptScheduler scheduler(1.0f / 60.0f);
+		ScriptScheduler::EventId reloaded = scheduler.event();
+		std::vector<Gunner> gunners(AGENTS[c]);
+		for (size_t a = 0; a < AGENTS[c]; ++a)
+		{
+			gunners[a].x = 0.0f;
+			gunners[a].shots = 0;
+			gunners[a].resumes = 0;
+			scheduler.start(gunner_script(scheduler, gunners[a], reloaded, (uint32_t)a * 2654435761u), (uint32_t)a);
+		}
+		scheduler.update(1.0f / 60.0f);
+
+		double before = 0.0;
+		for (size_t a = 0; a < AGENTS[c]; ++a)
+			before += gunners[a].resumes;
+
+		int64_t t0 = now_us();
+		for (int t = 0; t < TICKS; ++t)
+		{
+			if (t % RELOAD == 0)
+				scheduler.signal(reloaded);
+			scheduler.update(1.0f / 60.0f);
+		}
+		double ms = (now_us() - t0) / 1000.0 / TICKS;
+
+		double after = 0.0;
+		for (size_t a = 0; a < AGENTS[c]; ++a)
+			after += gunners[a].resumes;
+		double resumes = (after - before) / TICKS;
+
+		out << std::fixed << std::setprecision(3);
+		out << "  " << std::setw(8) << AGENTS[c] << std::setw(12) << ms << std::setw(14) << ms * 1.0e6 / AGENTS[c]
+			<< std::setw(16) << std::setprecision(0) << resumes << std::setw(16) << std::setprecision(1)
+			<< ms * 1.0e6 / math::max(resumes, 1.0) << "\n";
+		out.unsetf(std::ios::fixed);
+	}
+	out << "\n";
+}
+
+void ai::benchmarkDeterministicTicks(std::ostream & out)
+{
+	static const unsigned	THREADS[] = { 1, 2, 4, 8 };
+	static const size_t		AGENTS = 50000;
+	static const int		TICKS = 120;
+	static const float		DT = 1.0f / 60.0f;
+	static const float		ARENA = 1000.0f;
+	static const float		RANGE = 200.0f;
+
+	/*
+	 * Tanks duelling in an arena. Each drives at its target and, in range,
+	 * hits it for damage falling off with distance. About eight tanks share
+	 * a target, so the damage one takes is a float sum that changes in the
+	 * last bits with the order it is added in.
+	 */
+	struct Duellist
+	{
+		float		x, y;
+		float		vx, vy;
+		float		health;
+		uint32_t	target;
+	};
+
+	std::vector<Duellist> start(AGENTS);
+	std::mt19937 rng(41);
+	std::uniform_real_distribution<float> at(0.0f, ARENA);
+	for (size_t i = 0; i < AGENTS; ++i)
+	{
+		Duellist d = { at(rng), at(rng), 0.0f, 0.0f, 100.0f, (uint32_t)(rng() % (AGENTS / 8)) };
+		start[i] = d;
+	}
+
+	out << "deterministic ticks: " << AGENTS << " tanks, " << TICKS
+		<< " ticks of double-buffered state with damage reductions\n";
+	out << "  " << std::setw(8) << "threads" << std::setw(12) << "ms/tick" << std::setw(12) << "hits/tick"
+		<< std::setw(12) << "state" << "\n";
+
+	std::vector<Duellist> reference;
+	for (size_t c = 0; c < sizeof(THREADS) / sizeof(THREADS[0]); ++c)
+	{
+		core::JobSystem jobs(THREADS[c]);
+		core::DoubleBuffer<Duellist> state;
+		core::Reduction<float> hits;
+		for (size_t i = 0; i < AGENTS; ++i)
+			state.push_back(start[i]);
+
+		size_t landed = 0;
+		int64_t t0 = now_us();
+		for (int t = 0; t < TICKS; ++t)
+		{
+			// Drive: every tank reads only last tick's state
+			state.update(jobs, [t](size_t i, std::vector<Duellist> const & prev, Duellist & next)
+			{
+				Duellist const & me = prev[i];
+				Duellist const & foe = prev[me.target];
+				float dx = foe.x - me.x, dy = foe.y - me.y;
+				float len = std::sqrt(dx * dx + dy * dy) + 1.0e-3f;
+
+				next = me;
+				next.vx = me.vx * 0.9f + dx / len * 6.0f;
+				next.vy = me.vy * 0.9f + dy / len * 6.0f;
+				next.x = me.x + next.vx * DT;
+				next.y = me.y + next.vy * DT;
+
+				uint32_t h = (uint32_t)i * 2654435761u + (uint32_t)t * 40503u;
+				if (me.health <= 0.0f)
+				{
+					next.x = (float)(h % 1000u);
+					next.y = (float)((h >> 11) % 1000u);
+					next.health = 100.0f;
+				}
+				if ((i + t) % 97 == 0)
+					next.target = (h >> 7) % (uint32_t)(prev.size() / 8);
+			}, 256);
+
+			// Fire: hits land on other tanks, so they go through the reduction
+			std::vector<Duellist> const & prev = state.previous();
+			core::parallel_for(jobs, 0, prev.size(), 256, [&prev, &hits](size_t first, size_t last)
+			{
+				core::Reduction<float>::Writer shots(hits);
+				for (size_t i = first; i < last; ++i)
+				{
+					Duellist const & me = prev[i];
+					Duellist const & foe = prev[me.target];
+					float dx = foe.x - me.x, dy = foe.y - me.y;
+					float d2 = dx * dx + dy * dy;
+					if (me.health > 0.0f && me.target != i && d2 < RANGE * RANGE)
+						shots.emit((uint32_t)i, me.target, 4.0f / (1.0f + 0.01f * d2) + 0.1f);
+				}
+			});
+
+			landed += hits.size();
+			hits.reduce([&state](uint32_t target, float damage)
+			{
+				state.next(target).health -= damage;
+			});
+			state.swap();
+		}
+		double ms = (now_us() - t0) / 1000.0 / TICKS;
+
+		// The one-thread run is the reference every other run must match byte for byte
+		char const * verdict = "reference";
+		if (reference.empty())
+			reference = state.previous();
+		else
+			verdict = (std::memcmp(reference.data(), state.previous().data(), AGENTS * sizeof(Duellist)) == 0)
+				? "identical" : "DIFFERS";
+
+		out << std::fixed << std::setprecision(3);
+		out << "  " << std::setw(8) << THREADS[c] << std::setw(12) << ms << std::setw(12) << std::setprecision(0)
+			<< (double)landed / TICKS << std::setw(12) << verdict << "\n";
+		out.unsetf(std::ios::fixed);
+	}
+	out << "\n";
+}
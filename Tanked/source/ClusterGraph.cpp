@@ -0,0 +1,506 @@
+/* ********************************************************************************* *
+ * *  File: ClusterGraph.cpp                                                       * *
+ * *  ----------------------                                                       * *
+ * *  COPYRIGHT NOTICE                                                             * *
+ * *  ----------------                                                             * *
+ * *  (C)[2012] - [2015] Deakin University                                         * *
+ * *  All rights reserved.                                                         * *
+ * *  All information contained herein is, and remains the property of Deakin      * *
+ * *  University and the author (Tim Wilkin).                                      * *
+ * *  Dissemination of this information or reproduction of this material is        * *
+ * *  strictly forbidden unless prior written permission is obtained from Deakin   * *
+ * *  University.The right to create derivative works from this material is        * *
+ * *  hereby granted to students enrolled in SIT255, but only for the purposes of  * *
+ * *  assessment while an enrolled student at Deakin University.                   * *
+ * *                                                                               * *
+ * ********************************************************************************* */
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+#include "ai/ClusterGraph.h"
+
+using namespace ai;
+using namespace level;
+
+namespace {
+
+	const float		SQRT_2 = 1.41421356f;
+
+	// Free runs at least this long get an entrance at each end
+	const int		LONG_RUN = 6;
+
+	// Advance a visit stamp, clearing the stamp arrays when it wraps
+	void next_stamp(std::vector<uint32_t> & a, std::vector<uint32_t> & b, uint32_t & stamp)
+	{
+		if (++stamp == 0)
+		{
+			std::fill(a.begin(), a.end(), 0u);
+			std::fill(b.begin(), b.end(), 0u);
+			stamp = 1;
+		}
+	}
+
+	inline float octile(int dx, int dy, float cell)
+	{
+		dx = abs(dx);
+		dy = abs(dy);
+		return (math::max(dx, dy) + (SQRT_2 - 1.0f) * math::min(dx, dy)) * cell;
+	}
+
+} // close anonymous namespace
+
+ClusterGraph::ClusterGraph()
+	: grid_(0),
+	  size_(16),
+	  cw_(0),
+	  ch_(0),
+	  max_nodes_(0),
+	  version_(0),
+	  stamp_(0),
+	  local_stamp_(0)
+{}
+
+size_t ClusterGraph::nodes() const
+{
+	size_t n = 0;
+	for (size_t i = 0; i < clusters_.size(); ++i)
+		n += clusters_[i].cells.size();
+	return n;
+}
+
+int ClusterGraph::clusterOf(int32_t cell) const
+{
+	int w = grid_->width();
+	return ((cell / w) / size_) * cw_ + (cell % w) / size_;
+}
+
+int32_t ClusterGraph::cellAt(POINT2 const & p) const
+{
+	int x = grid_->toCellX(p.x), y = grid_->toCellY(p.y);
+	if (x < 0 || y < 0 || x >= grid_->width() || y >= grid_->height())
+		return -1;
+
+	int fx, fy;
+	if (!grid_->nearestFree(x, y, 2, fx, fy))
+		return -1;
+	return fy * grid_->width() + fx;
+}
+
+/*
+ * Construction and maintenance
+ */
+
+void ClusterGraph::build(OccupancyGrid const & grid, int cluster)
+{
+	grid_ = &grid;
+	size_ = math::max(cluster, 2);
+	cw_ = (grid.width() + size_ - 1) / size_;
+	ch_ = (grid.height() + size_ - 1) / size_;
+	max_nodes_ = 4 * size_;
+
+	clusters_.assign((size_t)cw_ * ch_, Cluster());
+	for (int cy = 0; cy < ch_; ++cy)
+		for (int cx = 0; cx < cw_; ++cx)
+		{
+			Cluster & c = clusters_[cy * cw_ + cx];
+			c.x0 = cx * size_;
+			c.y0 = cy * size_;
+			c.x1 = math::min(c.x0 + size_, grid.width()) - 1;
+			c.y1 = math::min(c.y0 + size_, grid.height()) - 1;
+		}
+
+	size_t ids = clusters_.size() * max_nodes_ + 2;
+	g_.assign(ids, 0.0f);
+	parent_.assign(ids, -1);
+	seen_.assign(ids, 0);
+	closed_.assign(ids, 0);
+	stamp_ = 0;
+
+	size_t cells = (size_t)size_ * size_;
+	local_g_.assign(cells, 0.0f);
+	local_parent_.assign(cells, -1);
+	local_seen_.assign(cells, 0);
+	local_closed_.assign(cells, 0);
+	local_stamp_ = 0;
+
+	for (int cy = 0; cy < ch_; ++cy)
+		for (int cx = 0; cx < cw_; ++cx)
+			entrances(cx, cy);
+	for (size_t c = 0; c < clusters_.size(); ++c)
+		connect((int)c);
+
+	++version_;
+}
+
+void ClusterGraph::update(AABB const & region)
+{
+	if (!grid_ || clusters_.empty() || region.empty())
+		return;
+
+	int x0 = math::clamp(grid_->toCellX(region.lo.x) - 1, 0, grid_->width() - 1) / size_;
+	int y0 = math::clamp(grid_->toCellY(region.lo.y) - 1, 0, grid_->height() - 1) / size_;
+	int x1 = math::clamp(grid_->toCellX(region.hi.x) + 1, 0, grid_->width() - 1) / size_;
+	int y1 = math::clamp(grid_->toCellY(region.hi.y) + 1, 0, grid_->height() - 1) / size_;
+
+	// Borders of the touched clusters (the west/south ones are owned by the neighbour)
+	for (int cy = math::max(y0 - 1, 0); cy <= y1; ++cy)
+		for (int cx = math::max(x0 - 1, 0); cx <= x1; ++cx)
+			entrances(cx, cy);
+
+	// Every cluster on either side of those borders
+	for (int cy = math::max(y0 - 1, 0); cy <= math::min(y1 + 1, ch_ - 1); ++cy)
+		for (int cx = math::max(x0 - 1, 0); cx <= math::min(x1 + 1, cw_ - 1); ++cx)
+			connect(cy * cw_ + cx);
+
+	++version_;
+}
+
+void ClusterGraph::terrainChanged(Terrain const & /*terrain*/, AABB const & region)
+{
+	update(region);
+}
+
+void ClusterGraph::entrances(int cx, int cy)
+{
+	Cluster & c = clusters_[cy * cw_ + cx];
+	int w = grid_->width();
+	c.east.clear();
+	c.north.clear();
+
+	// side 0: border to the east neighbour, side 1: to the north neighbour
+	for (int side = 0; side < 2; ++side)
+	{
+		if ((side == 0 && cx + 1 >= cw_) || (side == 1 && cy + 1 >= ch_))
+			continue;
+
+		std::vector<Transition> & out = side ? c.north : c.east;
+		int first = side ? c.x0 : c.y0;
+		int last  = side ? c.x1 : c.y1;
+		int run = -1;
+
+		for (int i = first; i <= last + 1; ++i)
+		{
+			bool open = false;
+			if (i <= last)
+				open = side ? (!grid_->blocked(i, c.y1) && !grid_->blocked(i, c.y1 + 1))
+							: (!grid_->blocked(c.x1, i) && !grid_->blocked(c.x1 + 1, i));
+
+			if (open && run < 0)
+				run = i;
+			if (open || run < 0)
+				continue;
+
+			// Run [run, i - 1] ended
+			int ends[2] = { (run + i - 1) / 2, -1 };
+			if (i - run >= LONG_RUN)
+			{
+				ends[0] = run;
+				ends[1] = i - 1;
+			}
+			for (int k = 0; k < 2 && ends[k] >= 0; ++k)
+			{
+				Transition t;
+				t.a = side ? (c.y1 * w + ends[k]) : (ends[k] * w + c.x1);
+				t.b = side ? (t.a + w) : (t.a + 1);
+				out.push_back(t);
+			}
+			run = -1;
+		}
+	}
+}
+
+void ClusterGraph::connect(int ci)
+{
+	Cluster & c = clusters_[ci];
+	int cx = ci % cw_, cy = ci / cw_;
+
+	c.cells.clear();
+	for (size_t i = 0; i < c.east.size(); ++i)
+		c.cells.push_back(c.east[i].a);
+	for (size_t i = 0; i < c.north.size(); ++i)
+		c.cells.push_back(c.north[i].a);
+	if (cx > 0)
+	{
+		std::vector<Transition> const & e = clusters_[ci - 1].east;
+		for (size_t i = 0; i < e.size(); ++i)
+			c.cells.push_back(e[i].b);
+	}
+	if (cy > 0)
+	{
+		std::vector<Transition> const & n = clusters_[ci - cw_].north;
+		for (size_t i = 0; i < n.size(); ++i)
+			c.cells.push_back(n[i].b);
+	}
+	std::sort(c.cells.begin(), c.cells.end());
+	c.cells.erase(std::unique(c.cells.begin(), c.cells.end()), c.cells.end());
+
+	size_t n = c.cells.size();
+	c.cost.assign(n * n, FLT_MAX);
+	for (size_t i = 0; i < n; ++i)
+	{
+		search(c, c.cells[i], -1);
+		for (size_t j = 0; j < n; ++j)
+			c.cost[i * n + j] = localCost(c, c.cells[j]);
+	}
+}
+
+/*
+ * In-cluster search: Dijkstra from 'from' over the free cells of c, or A*
+ * stopping at 'to' when one is given
+ */
+
+void ClusterGraph::search(Cluster const & c, int32_t from, int32_t to)
+{
+	static const int DX[8] = { 1, -1, 0, 0, 1, -1, 1, -1 };
+	static const int DY[8] = { 0, 0, 1, -1, 1, 1, -1, -1 };
+
+	next_stamp(local_seen_, local_closed_, local_stamp_);
+
+	int		w = grid_->width();
+	int		lw = c.x1 - c.x0 + 1;
+	float	cell = grid_->cell();
+	int		tx = (to >= 0) ? to % w : 0, ty = (to >= 0) ? to / w : 0;
+
+	int l = (from / w - c.y0) * lw + (from % w - c.x0);
+	local_g_[l] = 0.0f;
+	local_parent_[l] = -1;
+	local_seen_[l] = local_stamp_;
+	local_open_.clear();
+	local_open_.push_back(OpenNode(0.0f, l));
+
+	while (!local_open_.empty())
+	{
+		std::pop_heap(local_open_.begin(), local_open_.end(), std::greater<OpenNode>());
+		int32_t n = local_open_.back().second;
+		local_open_.pop_back();
+		if (local_closed_[n] == local_stamp_)
+			continue;
+		local_closed_[n] = local_stamp_;
+
+		int x = c.x0 + n % lw, y = c.y0 + n / lw;
+		if (to >= 0 && x == tx && y == ty)
+			return;
+
+		bool open[4];
+		for (int k = 0; k < 8; ++k)
+		{
+			int nx = x + DX[k], ny = y + DY[k];
+			bool ok = nx >= c.x0 && nx <= c.x1 && ny >= c.y0 && ny <= c.y1 && !grid_->blocked(nx, ny);
+			if (k < 4)
+				open[k] = ok;
+			else
+				ok = ok && open[(DX[k] > 0) ? 0 : 1] && open[(DY[k] > 0) ? 2 : 3];
+			if (!ok)
+				continue;
+
+			int32_t m = (ny - c.y0) * lw + (nx - c.x0);
+			if (local_closed_[m] == local_stamp_)
+				continue;
+			float g = local_g_[n] + ((k < 4) ? cell : cell * SQRT_2);
+			if (local_seen_[m] != local_stamp_ || g < local_g_[m])
+			{
+				local_seen_[m] = local_stamp_;
+				local_g_[m] = g;
+				local_parent_[m] = n;
+				float h = (to >= 0) ? octile(tx - nx, ty - ny, cell) : 0.0f;
+				local_open_.push_back(OpenNode(g + h, m));
+				std::push_heap(local_open_.begin(), local_open_.end(), std::greater<OpenNode>());
+			}
+		}
+	}
+}
+
+float ClusterGraph::localCost(Cluster const & c, int32_t cell) const
+{
+	int w = grid_->width();
+	int l = (cell / w - c.y0) * (c.x1 - c.x0 + 1) + (cell % w - c.x0);
+	return (local_closed_[l] == local_stamp_) ? local_g_[l] : FLT_MAX;
+}
+
+/*
+ * Abstract graph
+ */
+
+void ClusterGraph::links(int ci, int local, std::vector<std::pair<int32_t, float>> & out) const
+{
+	Cluster const & c = clusters_[ci];
+	size_t n = c.cells.size();
+	int32_t cell = c.cells[local];
+	int w = grid_->width();
+	int x = cell % w, y = cell / w;
+	int cx = ci % cw_, cy = ci / cw_;
+
+	out.clear();
+	for (size_t j = 0; j < n; ++j)
+		if ((int)j != local && c.cost[local * n + j] < FLT_MAX)
+			out.push_back(std::make_pair((int32_t)(ci * max_nodes_ + j), c.cost[local * n + j]));
+
+	// Across the entrances this cell is an end of
+	for (int side = 0; side < 4; ++side)
+	{
+		int		other;
+		bool	low;		// is this cell the 'a' end?
+		std::vector<Transition> const * t;
+		if (side == 0)		{ if (x != c.x1 || cx + 1 >= cw_) continue; other = ci + 1;	  t = &c.east;						low = true; }
+		else if (side == 1)	{ if (x != c.x0 || cx == 0) continue;		other = ci - 1;	  t = &clusters_[ci - 1].east;		low = false; }
+		else if (side == 2)	{ if (y != c.y1 || cy + 1 >= ch_) continue; other = ci + cw_; t = &c.north;						low = true; }
+		else				{ if (y != c.y0 || cy == 0) continue;		other = ci - cw_; t = &clusters_[ci - cw_].north;	low = false; }
+
+		for (size_t i = 0; i < t->size(); ++i)
+		{
+			Transition const & tr = (*t)[i];
+			if ((low ? tr.a : tr.b) != cell)
+				continue;
+			std::vector<int32_t> const & oc = clusters_[other].cells;
+			int32_t target = low ? tr.b : tr.a;
+			size_t j = std::lower_bound(oc.begin(), oc.end(), target) - oc.begin();
+			out.push_back(std::make_pair((int32_t)(other * max_nodes_ + j), grid_->cell()));
+		}
+	}
+}
+
+bool ClusterGraph::findPath(POINT2 const & start, POINT2 const & goal, std::vector<int32_t> & cells, float * cost)
+{
+	cells.clear();
+	if (!grid_ || clusters_.empty())
+		return false;
+
+	int32_t s = cellAt(start), g = cellAt(goal);
+	if (s < 0 || g < 0)
+		return false;
+
+	int			w = grid_->width();
+	float		cell = grid_->cell();
+	int			cs = clusterOf(s), cg = clusterOf(g);
+	Cluster const & S = clusters_[cs];
+	Cluster const & G = clusters_[cg];
+
+	// Connect both ends to the nodes of their clusters
+	search(G, g, -1);
+	goal_links_.clear();
+	for (size_t j = 0; j < G.cells.size(); ++j)
+	{
+		float c = localCost(G, G.cells[j]);
+		if (c < FLT_MAX)
+			goal_links_.push_back(std::make_pair((int32_t)(cg * max_nodes_ + j), c));
+	}
+
+	search(S, s, -1);
+	start_links_.clear();
+	for (size_t j = 0; j < S.cells.size(); ++j)
+	{
+		float c = localCost(S, S.cells[j]);
+		if (c < FLT_MAX)
+			start_links_.push_back(std::make_pair((int32_t)(cs * max_nodes_ + j), c));
+	}
+
+	int32_t const START = (int32_t)clusters_.size() * max_nodes_;
+	int32_t const GOAL = START + 1;
+	float direct = (cs == cg) ? localCost(S, g) : FLT_MAX;
+	if (direct < FLT_MAX)
+		start_links_.push_back(std::make_pair(GOAL, direct));
+
+	next_stamp(seen_, closed_, stamp_);
+	open_.clear();
+	g_[START] = 0.0f;
+	parent_[START] = -1;
+	seen_[START] = stamp_;
+	open_.push_back(OpenNode(octile(g % w - s % w, g / w - s / w, cell), START));
+
+	bool found = false;
+	while (!open_.empty())
+	{
+		std::pop_heap(open_.begin(), open_.end(), std::greater<OpenNode>());
+		int32_t n = open_.back().second;
+		open_.pop_back();
+		if (closed_[n] == stamp_)
+			continue;
+		closed_[n] = stamp_;
+
+		if (n == GOAL)
+		{
+			found = true;
+			break;
+		}
+
+		std::vector<std::pair<int32_t, float>> const * out = &start_links_;
+		if (n != START)
+		{
+			int ci = n / max_nodes_;
+			links(ci, n % max_nodes_, links_);
+			if (ci == cg)
+				for (size_t i = 0; i < goal_links_.size(); ++i)
+					if (goal_links_[i].first == n)
+						links_.push_back(std::make_pair(GOAL, goal_links_[i].second));
+			out = &links_;
+		}
+
+		for (size_t i = 0; i < out->size(); ++i)
+		{
+			int32_t m = (*out)[i].first;
+			if (closed_[m] == stamp_)
+				continue;
+			float gm = g_[n] + (*out)[i].second;
+			if (seen_[m] != stamp_ || gm < g_[m])
+			{
+				seen_[m] = stamp_;
+				g_[m] = gm;
+				parent_[m] = n;
+
+				int32_t mc = (m == GOAL) ? g : clusters_[m / max_nodes_].cells[m % max_nodes_];
+				open_.push_back(OpenNode(gm + octile(g % w - mc % w, g / w - mc / w, cell), m));
+				std::push_heap(open_.begin(), open_.end(), std::greater<OpenNode>());
+			}
+		}
+	}
+
+	if (!found)
+		return false;
+	if (cost)
+		*cost = g_[GOAL];
+
+	for (int32_t n = GOAL; n >= 0; n = parent_[n])
+	{
+		int32_t c = (n == GOAL) ? g : (n == START) ? s : clusters_[n / max_nodes_].cells[n % max_nodes_];
+		if (cells.empty() || cells.back() != c)
+			cells.push_back(c);
+	}
+	std::reverse(cells.begin(), cells.end());
+	if (cells.size() == 1)
+		cells.push_back(g);		// start == goal: a single empty leg
+	return true;
+}
+
+bool ClusterGraph::refine(std::vector<int32_t> const & path, size_t leg, std::vector<int32_t> & cells)
+{
+	if (leg + 1 >= path.size())
+		return false;
+
+	int32_t a = path[leg], b = path[leg + 1];
+	if (a == b)
+		return true;
+
+	int ca = clusterOf(a);
+	if (ca != clusterOf(b))
+	{
+		cells.push_back(b);		// an entrance: one step across the border
+		return true;
+	}
+
+	Cluster const & c = clusters_[ca];
+	search(c, a, b);
+	if (localCost(c, b) == FLT_MAX)
+		return false;
+
+	// Walk the parents back from b, then reverse that stretch in place
+	int		w = grid_->width();
+	int		lw = c.x1 - c.x0 + 1;
+	size_t	first = cells.size();
+	int32_t	l = (b / w - c.y0) * lw + (b % w - c.x0);
+	for (; local_parent_[l] >= 0; l = local_parent_[l])
+		cells.push_back((c.y0 + l / lw) * w + c.x0 + l % lw);
+	std::reverse(cells.begin() + first, cells.end());
+	return true;
+}
@@ -0,0 +1,578 @@
+/* ********************************************************************************* *
+ * *  File: ConfigSpace.cpp                                                        * *
+ * *  ---------------------                                                        * *
+ * *  COPYRIGHT NOTICE                                                             * *
+ * *  ----------------                                                             * *
+ * *  (C)[2012] - [2015] Deakin University                                         * *
+ * *  All rights reserved.                                                         * *
+ * *  All information contained herein is, and remains the property of Deakin      * *
+ * *  University and the author (Tim Wilkin).                                      * *
+ * *  Dissemination of this information or reproduction of this material is        * *
+ * *  strictly forbidden unless prior written permission is obtained from Deakin   * *
+ * *  University.The right to create derivative works from this material is        * *
+ * *  hereby granted to students enrolled in SIT255, but only for the purposes of  * *
+ * *  assessment while an enrolled student at Deakin University.                   * *
+ * *                                                                               * *
+ * ********************************************************************************* */
+
+#include <algorithm>
+#include <cmath>
+
+#include "level/ConfigSpace.h"
+
+using namespace level;
+using namespace physics;
+
+namespace {
+
+	inline int clampi(int v, int lo, int hi)
+	{
+		return (v < lo) ? lo : ((v > hi) ? hi : v);
+	}
+
+	inline float distance_sqr(POINT2 const & p, Segment const & s)
+	{
+		float ex = s.end().x - s.start().x, ey = s.end().y - s.start().y;
+		float px = p.x - s.start().x, py = p.y - s.start().y;
+		float ee = ex * ex + ey * ey;
+		float u = (ee > 0.0f) ? math::clamp((px * ex + py * ey) / ee, 0.0f, 1.0f) : 0.0f;
+		px -= ex * u;
+		py -= ey * u;
+		return px * px + py * py;
+	}
+
+	// One side of a wall's capsule (the one the wall normal faces, or the other), facing away from the wall
+	Segment offset_side(Segment const & s, float radius, bool front)
+	{
+		float ex = s.end().x - s.start().x, ey = s.end().y - s.start().y;
+		float len = sqrt(ex * ex + ey * ey);
+
+		VECTOR2 n = s.normal();
+		if (len > 0.0f)
+		{
+			n = VECTOR2(-ey / len, ex / len);
+			if (inner_product(n, s.normal()) < 0.0f)
+				n = -n;
+		}
+		if (!front)
+			n = -n;
+		float ox = n.x * radius, oy = n.y * radius;
+		return Segment(POINT2(s.start().x + ox, s.start().y + oy), POINT2(s.end().x + ox, s.end().y + oy), n);
+	}
+
+	// Entry distance of a ray into a circle; 0 if the origin is inside
+	inline bool ray_circle(POINT2 const & o, VECTOR2 const & d, Circle const & c, float & t)
+	{
+		float mx = o.x - c.origin().x, my = o.y - c.origin().y;
+		float b = mx * d.x + my * d.y;
+		float cc = mx * mx + my * my - c.radius() * c.radius();
+		if (cc <= 0.0f)
+		{
+			t = 0.0f;
+			return true;
+		}
+		if (b > 0.0f)
+			return false;
+		float disc = b * b - cc;
+		if (disc < 0.0f)
+			return false;
+		t = -b - sqrt(disc);
+		return true;
+	}
+
+} // close anonymous namespace
+
+InflatedWalls::InflatedWalls()
+	: radius_(0.0f),
+	  grid_cell_(1.0f),
+	  gw_(0),
+	  gh_(0)
+{}
+
+InflatedWalls::InflatedWalls(std::vector<Segment> const & walls, float radius)
+	: radius_(0.0f),
+	  grid_cell_(1.0f),
+	  gw_(0),
+	  gh_(0)
+{
+	build(walls, radius);
+}
+
+void InflatedWalls::build(std::vector<Segment> const & walls, float radius)
+{
+	radius_ = radius;
+	walls_ = walls;
+
+	// Two offset sides per wall, normals facing away from the wall
+	std::vector<Segment> sides;
+	sides.reserve(2 * walls.size());
+	std::vector<std::pair<POINT2, int32_t>> ends;
+	ends.reserve(2 * walls.size());
+
+	for (size_t i = 0; i < walls.size(); ++i)
+	{
+		Segment const & s = walls[i];
+		sides.push_back(offset_side(s, radius, true));
+		sides.push_back(offset_side(s, radius, false));
+
+		ends.push_back(std::make_pair(s.start(), (int32_t)i));
+		ends.push_back(std::make_pair(s.end(), (int32_t)i));
+	}
+	sides_.build(sides);
+	free_walls_.clear();
+
+	// One cap per distinct end point; joined walls share theirs
+	std::sort(ends.begin(), ends.end(), [](std::pair<POINT2, int32_t> const & a, std::pair<POINT2, int32_t> const & b)
+	{
+		return (a.first.x < b.first.x) || (a.first.x == b.first.x && a.first.y < b.first.y);
+	});
+
+	caps_.clear();
+	cap_wall_.clear();
+	cap_ends_.clear();
+	free_caps_.clear();
+	AABB bounds;
+	for (size_t i = 0; i < ends.size(); ++i)
+	{
+		if (i > 0 && ends[i].first.x == ends[i - 1].first.x && ends[i].first.y == ends[i - 1].first.y)
+		{
+			++cap_ends_.back();
+			continue;
+		}
+		caps_.push_back(Circle(ends[i].first, radius));
+		cap_wall_.push_back(ends[i].second);
+		cap_ends_.push_back(1);
+		bounds.grow(ends[i].first);
+	}
+
+	grid_.clear();
+	gw_ = gh_ = 0;
+	if (caps_.empty())
+		return;
+
+	// Grid cells of a few caps each, never smaller than a cap
+	grid_area_ = bounds.inflate(radius);
+	VECTOR2 ext = grid_area_.extent();
+	grid_cell_ = math::max(2.0f * radius, (float)sqrt(math::max(ext.x * ext.y, 1.0f) / caps_.size()) * 2.0f);
+	grid_cell_ = math::max(grid_cell_, 1.0f);
+	gw_ = math::max(1, (int)ceil(ext.x / grid_cell_));
+	gh_ = math::max(1, (int)ceil(ext.y / grid_cell_));
+
+	// Register each cap in every cell its bounds overlap
+	grid_.assign((size_t)gw_ * gh_, std::vector<int32_t>());
+	for (size_t c = 0; c < caps_.size(); ++c)
+		link((int32_t)c, true);
+}
+
+void InflatedWalls::update(std::vector<Segment> const & near, AABB const & region)
+{
+	/*
+	 * The walls replaced are those whose bounds overlap region, which is what
+	 * near holds after the change: both sides of such a wall overlap region
+	 * grown by the radius. New walls take over the replaced ids, so most
+	 * sides are rewritten in their leaf lanes and only the bounds move.
+	 */
+	std::vector<int32_t> old;
+	sides_.query(region.inflate(radius_), [&](size_t id)
+	{
+		if ((id & 1) == 0 && AABB(walls_[id / 2]).overlaps(region))
+			old.push_back((int32_t)(id / 2));
+	});
+
+	// A cap outside the grid cannot be registered: start again from every wall
+	bool fits = !grid_.empty();
+	AABB inner(POINT2(grid_area_.lo.x + radius_, grid_area_.lo.y + radius_),
+			   POINT2(grid_area_.hi.x - radius_, grid_area_.hi.y - radius_));
+	for (size_t k = 0; k < near.size() && fits; ++k)
+		fits = inner.contains(near[k].start()) && inner.contains(near[k].end());
+	if (!fits)
+	{
+		std::vector<uint8_t> replaced(walls_.size(), 0);
+		for (size_t k = 0; k < old.size(); ++k)
+			replaced[old[k]] = 1;
+		std::vector<Segment> all(near);
+		for (size_t i = 0; i < walls_.size(); ++i)
+			if (sides_.alive(2 * i) && !replaced[i])
+				all.push_back(walls_[i]);
+		build(all, radius_);
+		return;
+	}
+
+	std::vector<int32_t> orphans;
+	for (size_t k = 0; k < old.size(); ++k)
+	{
+		release(walls_[old[k]].start(), old[k], orphans);
+		release(walls_[old[k]].end(), old[k], orphans);
+	}
+
+	for (size_t k = 0; k < near.size(); ++k)
+	{
+		int32_t i;
+		if (k < old.size())
+			i = old[k];
+		else if (!free_walls_.empty())
+		{
+			i = free_walls_.back();
+			free_walls_.pop_back();
+		}
+		else
+		{
+			i = (int32_t)walls_.size();
+			walls_.push_back(near[k]);
+			sides_.insert(near[k]);
+			sides_.insert(near[k]);
+		}
+
+		walls_[i] = near[k];
+		sides_.replace(2 * i, offset_side(near[k], radius_, true));
+		sides_.replace(2 * i + 1, offset_side(near[k], radius_, false));
+		claim(near[k].start(), i);
+		claim(near[k].end(), i);
+	}
+
+	for (size_t k = near.size(); k < old.size(); ++k)
+	{
+		sides_.remove(2 * old[k]);
+		sides_.remove(2 * old[k] + 1);
+		free_walls_.push_back(old[k]);
+	}
+
+	// Caps whose wall went but which other walls still end at
+	for (size_t k = 0; k < orphans.size(); ++k)
+	{
+		int32_t c = orphans[k];
+		if (cap_wall_[c] >= 0 || cap_ends_[c] == 0)
+			continue;
+		POINT2 const & p = caps_[c].origin();
+		sides_.query(AABB(p, p).inflate(radius_), [&](size_t id)
+		{
+			Segment const & w = walls_[id / 2];
+			if (cap_wall_[c] < 0 && (w.start() == p || w.end() == p))
+				cap_wall_[c] = (int32_t)(id / 2);
+		});
+	}
+
+	// Same rule as the terrain: rebuild once the unsorted overflow costs more than it saves
+	if (sides_.overflow() > math::max((size_t)256, sides_.size() / 8))
+		sides_.optimise();
+	else
+		sides_.refit();
+}
+
+void InflatedWalls::link(int32_t c, bool on)
+{
+	AABB b(caps_[c]);
+	int x0 = clampi((int)floor((b.lo.x - grid_area_.lo.x) / grid_cell_), 0, gw_ - 1);
+	int x1 = clampi((int)floor((b.hi.x - grid_area_.lo.x) / grid_cell_), 0, gw_ - 1);
+	int y0 = clampi((int)floor((b.lo.y - grid_area_.lo.y) / grid_cell_), 0, gh_ - 1);
+	int y1 = clampi((int)floor((b.hi.y - grid_area_.lo.y) / grid_cell_), 0, gh_ - 1);
+	for (int y = y0; y <= y1; ++y)
+		for (int x = x0; x <= x1; ++x)
+		{
+			std::vector<int32_t> & cell = grid_[(size_t)y * gw_ + x];
+			if (on)
+				cell.push_back(c);
+			else
+				cell.erase(std::find(cell.begin(), cell.end(), c));
+		}
+}
+
+int32_t InflatedWalls::findCap(POINT2 const & p) const
+{
+	int x = clampi((int)floor((p.x - grid_area_.lo.x) / grid_cell_), 0, gw_ - 1);
+	int y = clampi((int)floor((p.y - grid_area_.lo.y) / grid_cell_), 0, gh_ - 1);
+	std::vector<int32_t> const & cell = grid_[(size_t)y * gw_ + x];
+	for (size_t i = 0; i < cell.size(); ++i)
+		if (caps_[cell[i]].origin() == p)
+			return cell[i];
+	return -1;
+}
+
+void InflatedWalls::claim(POINT2 const & p, int32_t wall)
+{
+	int32_t c = findCap(p);
+	if (c < 0)
+	{
+		if (!free_caps_.empty())
+		{
+			c = free_caps_.back();
+			free_caps_.pop_back();
+			caps_[c] = Circle(p, radius_);
+		}
+		else
+		{
+			c = (int32_t)caps_.size();
+			caps_.push_back(Circle(p, radius_));
+			cap_wall_.push_back(-1);
+			cap_ends_.push_back(0);
+		}
+		link(c, true);
+	}
+	if (cap_wall_[c] < 0)
+		cap_wall_[c] = wall;
+	++cap_ends_[c];
+}
+
+void InflatedWalls::release(POINT2 const & p, int32_t wall, std::vector<int32_t> & orphans)
+{
+	int32_t c = findCap(p);
+	if (c < 0)
+		return;
+	if (--cap_ends_[c] == 0)
+	{
+		// Free slots stay in caps() with no radius
+		link(c, false);
+		caps_[c] = Circle(p, 0.0f);
+		cap_wall_[c] = -1;
+		free_caps_.push_back(c);
+	}
+	else if (cap_wall_[c] == wall)
+	{
+		cap_wall_[c] = -1;
+		orphans.push_back(c);
+	}
+}
+
+int32_t InflatedWalls::overlap(POINT2 const & p) const
+{
+	float	r2 = radius_ * radius_;
+	int32_t	wall = -1;
+
+	// Inside the straight part of a capsule: one of its sides is within radius
+	sides_.query(AABB(p, p).inflate(radius_), [&](size_t id)
+	{
+		if (wall < 0 && distance_sqr(p, walls_[id / 2]) < r2)
+			wall = (int32_t)(id / 2);
+	});
+	if (wall >= 0 || caps_.empty())
+		return wall;
+
+	int x = (int)floor((p.x - grid_area_.lo.x) / grid_cell_);
+	int y = (int)floor((p.y - grid_area_.lo.y) / grid_cell_);
+	if (x < 0 || y < 0 || x >= gw_ || y >= gh_)
+		return -1;
+
+	std::vector<int32_t> const & cell = grid_[(size_t)y * gw_ + x];
+	for (size_t i = 0; i < cell.size(); ++i)
+	{
+		Circle const & c = caps_[cell[i]];
+		float dx = p.x - c.origin().x, dy = p.y - c.origin().y;
+		if (dx * dx + dy * dy < r2)
+			return cap_wall_[cell[i]];
+	}
+	return -1;
+}
+
+bool InflatedWalls::blocked(POINT2 const & p) const
+{
+	return overlap(p) >= 0;
+}
+
+bool InflatedWalls::castCaps(POINT2 const & o, VECTOR2 const & d, float max_t, float & t, int32_t & cap) const
+{
+	if (caps_.empty())
+		return false;
+
+	// Clip the ray to the grid
+	float t0 = 0.0f, t1 = max_t;
+	float lo[2] = { grid_area_.lo.x, grid_area_.lo.y }, hi[2] = { grid_area_.hi.x, grid_area_.hi.y };
+	float org[2] = { o.x, o.y }, dir[2] = { d.x, d.y };
+	for (int a = 0; a < 2; ++a)
+	{
+		if (dir[a] == 0.0f)
+		{
+			if (org[a] < lo[a] || org[a] > hi[a])
+				return false;
+			continue;
+		}
+		float ta = (lo[a] - org[a]) / dir[a], tb = (hi[a] - org[a]) / dir[a];
+		if (ta > tb)
+			std::swap(ta, tb);
+		t0 = math::max(t0, ta);
+		t1 = math::min(t1, tb);
+	}
+	if (t0 > t1)
+		return false;
+
+	// Walk the cells along the ray (Amanatides & Woo)
+	float sx = o.x + d.x * t0, sy = o.y + d.y * t0;
+	int x = clampi((int)floor((sx - grid_area_.lo.x) / grid_cell_), 0, gw_ - 1);
+	int y = clampi((int)floor((sy - grid_area_.lo.y) / grid_cell_), 0, gh_ - 1);
+	int step_x = (d.x > 0.0f) ? 1 : -1, step_y = (d.y > 0.0f) ? 1 : -1;
+
+	float next_x = (d.x != 0.0f) ? (grid_area_.lo.x + (x + (step_x > 0 ? 1 : 0)) * grid_cell_ - o.x) / d.x : FLT_MAX;
+	float next_y = (d.y != 0.0f) ? (grid_area_.lo.y + (y + (step_y > 0 ? 1 : 0)) * grid_cell_ - o.y) / d.y : FLT_MAX;
+	float delta_x = (d.x != 0.0f) ? grid_cell_ / fabs(d.x) : FLT_MAX;
+	float delta_y = (d.y != 0.0f) ? grid_cell_ / fabs(d.y) : FLT_MAX;
+
+	float	best = t1;
+	bool	found = false;
+	for (;;)
+	{
+		std::vector<int32_t> const & cell = grid_[(size_t)y * gw_ + x];
+		for (size_t i = 0; i < cell.size(); ++i)
+		{
+			float tc;
+			if (ray_circle(o, d, caps_[cell[i]], tc) && tc <= best)
+			{
+				best = tc;
+				cap = cell[i];
+				found = true;
+			}
+		}
+
+		// A hit before the far side of this cell cannot be beaten further on
+		float exit = math::min(next_x, next_y);
+		if ((found && best <= exit) || exit > t1)
+			break;
+
+		if (next_x < next_y)
+		{
+			x += step_x;
+			next_x += delta_x;
+		}
+		else
+		{
+			y += step_y;
+			next_y += delta_y;
+		}
+		if (x < 0 || y < 0 || x >= gw_ || y >= gh_)
+			break;
+	}
+
+	t = best;
+	return found;
+}
+
+bool InflatedWalls::cast(Ray const & ray, RayHit & hit) const
+{
+	hit = RayHit();
+
+	int32_t inside = overlap(ray.origin);
+	if (inside >= 0)
+	{
+		hit.distance = 0.0f;
+		hit.point = ray.origin;
+		hit.normal = -ray.direction;
+		hit.segment = inside;
+		return true;
+	}
+
+	RayHit side;
+	sides_.cast(ray, side);
+
+	float	t;
+	int32_t	cap;
+	if (castCaps(ray.origin, ray.direction, side.hit() ? side.distance : ray.max_t, t, cap) &&
+		(!side.hit() || t < side.distance))
+	{
+		Circle const & c = caps_[cap];
+		hit.distance = t;
+		hit.point = POINT2(ray.origin.x + ray.direction.x * t, ray.origin.y + ray.direction.y * t);
+		hit.normal = normalise(VECTOR2(hit.point.x - c.origin().x, hit.point.y - c.origin().y));
+		hit.segment = cap_wall_[cap];
+		return true;
+	}
+
+	if (!side.hit())
+		return false;
+
+	hit = side;
+	hit.segment = side.segment / 2;
+	return true;
+}
+
+bool InflatedWalls::lineOfSight(POINT2 const & a, POINT2 const & b) const
+{
+	uint8_t visible;
+	lineOfSight(&a, &b, &visible, 1);
+	return visible != 0;
+}
+
+void InflatedWalls::lineOfSight(POINT2 const * a, POINT2 const * b, uint8_t * visible, size_t n) const
+{
+	// Crossing a side is tested for four pairs at a time; caps and starts inside only for the survivors
+	sides_.lineOfSight(a, b, visible, n);
+
+	for (size_t i = 0; i < n; ++i)
+	{
+		if (!visible[i])
+			continue;
+
+		if (overlap(a[i]) >= 0)
+		{
+			visible[i] = 0;
+			continue;
+		}
+
+		float dx = b[i].x - a[i].x, dy = b[i].y - a[i].y;
+		float len = sqrt(dx * dx + dy * dy);
+		if (len <= 0.0f)
+			continue;
+
+		float	t;
+		int32_t	cap;
+		if (castCaps(a[i], VECTOR2(dx / len, dy / len), len, t, cap))
+			visible[i] = 0;
+	}
+}
+
+InflationCache::InflationCache(float quantum)
+	: quantum_(quantum),
+	  version_(0),
+	  terrain_(0),
+	  stale_(false)
+{}
+
+void InflationCache::reset(std::vector<Segment> const & walls)
+{
+	walls_ = walls;
+	++version_;
+	terrain_ = 0;
+	stale_ = false;
+}
+
+float InflationCache::classRadius(float radius) const
+{
+	return math::max(1.0f, (float)ceil(radius / quantum_)) * quantum_;
+}
+
+InflatedWalls const & InflationCache::get(float radius)
+{
+	int key = (int)(classRadius(radius) / quantum_ + 0.5f);
+	Class & c = classes_[key];
+
+	// A class built before the changes patches just the changed region
+	if (c.walls && c.version == version_ && !c.changed.empty())
+	{
+		terrain_->wallsNear(c.changed, near_);
+		c.walls->update(near_, c.changed);
+		c.changed = AABB();
+		return *c.walls;
+	}
+
+	if (!c.walls || c.version != version_)
+	{
+		// A new class (or one from before reset()) inflates every wall
+		if (stale_ && terrain_)
+		{
+			terrain_->wallsNear(terrain_->walls().bounds(), walls_);
+			stale_ = false;
+		}
+		if (!c.walls)
+			c.walls.reset(new InflatedWalls(walls_, key * quantum_));
+		else
+			c.walls->build(walls_, key * quantum_);
+		c.version = version_;
+		c.changed = AABB();
+	}
+	return *c.walls;
+}
+
+void InflationCache::terrainChanged(Terrain const & terrain, AABB const & region)
+{
+	terrain_ = &terrain;
+	stale_ = true;
+	for (std::map<int, Class>::iterator i = classes_.begin(); i != classes_.end(); ++i)
+		i->second.changed.grow(region);
+}
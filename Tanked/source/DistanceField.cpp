@@ -0,0 +1,490 @@
+/* ********************************************************************************* *
+ * *  File: DistanceField.cpp                                                      * *
+ * *  -----------------------                                                      * *
+ * *  COPYRIGHT NOTICE                                                             * *
+ * *  ----------------                                                             * *
+ * *  (C)[2012] - [2015] Deakin University                                         * *
+ * *  All rights reserved.                                                         * *
+ * *  All information contained herein is, and remains the property of Deakin      * *
+ * *  University and the author (Tim Wilkin).                                      * *
+ * *  Dissemination of this information or reproduction of this material is        * *
+ * *  strictly forbidden unless prior written permission is obtained from Deakin   * *
+ * *  University.The right to create derivative works from this material is        * *
+ * *  hereby granted to students enrolled in SIT255, but only for the purposes of  * *
+ * *  assessment while an enrolled student at Deakin University.                   * *
+ * *                                                                               * *
+ * ********************************************************************************* */
+
+#include <algorithm>
+#include <cmath>
+#include <emmintrin.h>
+
+#include "level/DistanceField.h"
+#include "core/Parallel.h"
+
+using namespace level;
+
+namespace {
+
+	const float	EDT_INF = 1.0e20f;
+
+	/*
+	 * 1D squared distance transform of f (Felzenszwalb & Huttenlocher) with
+	 * the index of the minimising sample written to arg. v and z are scratch
+	 * of n and n+1 elements.
+	 */
+	void edt_1d(float const * f, int n, float * d, int * arg, int * v, float * z)
+	{
+		int k = 0;
+		v[0] = 0;
+		z[0] = -EDT_INF;
+		z[1] = EDT_INF;
+
+		for (int q = 1; q < n; ++q)
+		{
+			float s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2.0f * (q - v[k]));
+			while (s <= z[k])
+			{
+				--k;
+				s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2.0f * (q - v[k]));
+			}
+			++k;
+			v[k] = q;
+			z[k] = s;
+			z[k + 1] = EDT_INF;
+		}
+
+		k = 0;
+		for (int q = 0; q < n; ++q)
+		{
+			while (z[k + 1] < q)
+				++k;
+			float dq = (float)(q - v[k]);
+			d[q] = dq * dq + f[v[k]];
+			arg[q] = v[k];
+		}
+	}
+
+	inline int clampi(int v, int lo, int hi)
+	{
+		return (v < lo) ? lo : ((v > hi) ? hi : v);
+	}
+
+} // close anonymous namespace
+
+
+DistanceField::DistanceField()
+	: cell_(1.0f), band_(0.0f), w_(0), h_(0)
+{}
+
+float DistanceField::signedDistance(POINT2 const & p, Segment const & s, VECTOR2 const * pn) const
+{
+	VECTOR2 e = s.end() - s.start();
+	float	ee = inner_product(e, e);
+	float	u = (ee > 0.0f) ? math::clamp(inner_product(VECTOR2(p - s.start()), e) / ee, 0.0f, 1.0f) : 0.0f;
+	POINT2	c = s.start() + e * u;
+	VECTOR2 d = p - c;
+	float	dist = d.length();
+
+	VECTOR2 const & n = (u <= 0.0f) ? pn[0] : ((u >= 1.0f) ? pn[1] : s.normal());
+	return (inner_product(d, n) >= 0.0f) ? dist : -dist;
+}
+
+void DistanceField::pseudoNormals(std::vector<Segment const *> const & walls, std::vector<VECTOR2> & pn) const
+{
+	// End points within tolerance of each other are treated as shared
+	float const tol = 1e-3f * cell_;
+	size_t const n = walls.size();
+
+	std::vector<size_t> order(2 * n);
+	pn.resize(2 * n);
+	for (size_t i = 0; i < 2 * n; ++i)
+	{
+		order[i] = i;
+		pn[i] = walls[i / 2]->normal();
+	}
+
+	auto point = [&](size_t k) -> POINT2 const &
+	{
+		return (k & 1) ? walls[k / 2]->end() : walls[k / 2]->start();
+	};
+	std::sort(order.begin(), order.end(), [&](size_t a, size_t b)
+	{
+		return point(a).x < point(b).x;
+	});
+
+	// Sweep in x; the sum of the normals meeting at a point orients its wedge
+	for (size_t i = 0; i < order.size(); ++i)
+	{
+		POINT2 const & a = point(order[i]);
+		for (size_t j = i + 1; j < order.size() && point(order[j]).x - a.x <= tol; ++j)
+		{
+			POINT2 const & b = point(order[j]);
+			if (fabs(b.y - a.y) > tol || order[i] / 2 == order[j] / 2)
+				continue;
+			pn[order[i]] = pn[order[i]] + walls[order[j] / 2]->normal();
+			pn[order[j]] = pn[order[j]] + walls[order[i] / 2]->normal();
+		}
+	}
+}
+
+void DistanceField::bake(std::vector<Segment> const & walls, AABB const & area, float cell, float band)
+{
+	area_ = area;
+	cell_ = cell;
+	band_ = band;
+	w_ = math::max(1, (int)ceil((area.hi.x - area.lo.x) / cell));
+	h_ = math::max(1, (int)ceil((area.hi.y - area.lo.y) / cell));
+
+	size_t cells = (size_t)w_ * h_;
+	field_.assign(cells, band_);
+
+	/*
+	 * Rasterise: every cell a wall passes through becomes a seed. Each seed
+	 * lists all walls crossing it (compressed rows: seed_first / seed_walls)
+	 * so that dense outlines keep every candidate for the exact pass.
+	 */
+	std::vector<int32_t>	seed_last(cells, -1);
+	std::vector<uint32_t>	seed_first(cells + 1, 0);
+	std::vector<int32_t>	seed_walls;
+	std::vector<uint32_t>	cursor;
+
+	auto rasterise = [&](bool fill)
+	{
+		std::fill(seed_last.begin(), seed_last.end(), -1);
+		for (size_t i = 0; i < walls.size(); ++i)
+		{
+			Segment const & s = walls[i];
+			int steps = math::max(1, (int)ceil(s.length() / (0.5f * cell_)));
+			for (int k = 0; k <= steps; ++k)
+			{
+				POINT2 p = s.start() + VECTOR2(s.end() - s.start()) * ((float)k / steps);
+				int x = (int)floor((p.x - area_.lo.x) / cell_);
+				int y = (int)floor((p.y - area_.lo.y) / cell_);
+
+				// Walls lying on the boundary of the area seed the edge cells
+				if (x < -1 || x > w_ || y < -1 || y > h_)
+					continue;
+				size_t c = (size_t)clampi(y, 0, h_ - 1) * w_ + clampi(x, 0, w_ - 1);
+				if (seed_last[c] == (int32_t)i)
+					continue;
+				seed_last[c] = (int32_t)i;
+				if (fill)
+					seed_walls[cursor[c]++] = (int32_t)i;
+				else
+					++seed_first[c + 1];
+			}
+		}
+	};
+
+	rasterise(false);
+	for (size_t c = 0; c < cells; ++c)
+		seed_first[c + 1] += seed_first[c];
+	seed_walls.resize(seed_first[cells]);
+	cursor.assign(seed_first.begin(), seed_first.end() - 1);
+	rasterise(true);
+
+	// Column pass: squared distance to the nearest seed in the same column
+	std::vector<float>	col(cells);
+	std::vector<int>	col_arg(cells);
+	int w = w_, h = h_;
+
+	core::parallel_for(0, (size_t)w, 16, [&](size_t x0, size_t x1)
+	{
+		std::vector<float>	f(h), d(h), z(h + 1);
+		std::vector<int>	arg(h), v(h);
+		for (size_t x = x0; x < x1; ++x)
+		{
+			for (int y = 0; y < h; ++y)
+				f[y] = (seed_first[(size_t)y * w + x + 1] > seed_first[(size_t)y * w + x]) ? 0.0f : EDT_INF;
+			edt_1d(f.data(), h, d.data(), arg.data(), v.data(), z.data());
+			for (int y = 0; y < h; ++y)
+			{
+				col[(size_t)y * w + x] = d[y];
+				col_arg[(size_t)y * w + x] = arg[y];
+			}
+		}
+	});
+
+	// Row pass: combine columns and recover the nearest seed cell
+	std::vector<int32_t> owner(cells, -1);
+
+	core::parallel_for(0, (size_t)h, 16, [&](size_t y0, size_t y1)
+	{
+		std::vector<float>	d(w), z(w + 1);
+		std::vector<int>	arg(w), v(w);
+		for (size_t y = y0; y < y1; ++y)
+		{
+			float const * f = &col[y * w];
+			edt_1d(f, w, d.data(), arg.data(), v.data(), z.data());
+			for (int x = 0; x < w; ++x)
+			{
+				if (d[x] >= 0.5f * EDT_INF)
+					continue;	// no walls at all
+
+				int sx = arg[x];
+				int sy = col_arg[y * w + sx];
+				owner[y * w + x] = sy * w + sx;
+			}
+		}
+	});
+
+	std::vector<Segment const *> all(walls.size());
+	for (size_t i = 0; i < walls.size(); ++i)
+		all[i] = &walls[i];
+
+	std::vector<VECTOR2> pn;
+	pseudoNormals(all, pn);
+
+	/*
+	 * Exact pass: the nearest seed is only nearest to within a cell, so take
+	 * the closest of the walls crossing the nearest seeds of the 3x3 block.
+	 */
+	core::parallel_for(0, (size_t)h, 16, [&](size_t y0, size_t y1)
+	{
+		for (int y = (int)y0; y < (int)y1; ++y)
+			for (int x = 0; x < w; ++x)
+			{
+				POINT2	p = centre(x, y);
+				float	best = FLT_MAX;
+				int32_t	tried[9];
+				int		ntried = 0;
+
+				for (int dy = -1; dy <= 1; ++dy)
+					for (int dx = -1; dx <= 1; ++dx)
+					{
+						int nx = x + dx, ny = y + dy;
+						if (nx < 0 || nx >= w || ny < 0 || ny >= h)
+							continue;
+
+						int32_t c = owner[(size_t)ny * w + nx];
+						bool seen = (c < 0);
+						for (int k = 0; k < ntried && !seen; ++k)
+							seen = (tried[k] == c);
+						if (seen)
+							continue;
+
+						tried[ntried++] = c;
+						for (uint32_t k = seed_first[c]; k < seed_first[c + 1]; ++k)
+						{
+							int32_t s = seed_walls[k];
+							float sd = signedDistance(p, walls[s], &pn[2 * s]);
+							if (fabs(sd) < fabs(best))
+								best = sd;
+						}
+					}
+
+				field_[(size_t)y * w + x] = (best == FLT_MAX) ? band_ : math::clamp(best, -band_, band_);
+			}
+	});
+}
+
+void DistanceField::update(std::vector<Segment> const & walls, AABB const & region)
+{
+	if (field_.empty())
+		return;
+
+	// Only cells within band of the change can hold a different clamped value
+	AABB window = region.inflate(band_ + cell_);
+	int x0 = clampi((int)floor((window.lo.x - area_.lo.x) / cell_), 0, w_ - 1);
+	int x1 = clampi((int)floor((window.hi.x - area_.lo.x) / cell_), 0, w_ - 1);
+	int y0 = clampi((int)floor((window.lo.y - area_.lo.y) / cell_), 0, h_ - 1);
+	int y1 = clampi((int)floor((window.hi.y - area_.lo.y) / cell_), 0, h_ - 1);
+
+	// Walls that can be within band of any cell in the window
+	AABB reach = AABB(centre(x0, y0), centre(x1, y1)).inflate(band_);
+	std::vector<Segment const *> near;
+	for (size_t i = 0; i < walls.size(); ++i)
+		if (AABB(walls[i]).overlaps(reach))
+			near.push_back(&walls[i]);
+
+	std::vector<VECTOR2> pn;
+	pseudoNormals(near, pn);
+
+	int ww = x1 - x0 + 1;
+	std::vector<uint8_t> far((size_t)ww * (y1 - y0 + 1), 0);
+
+	core::parallel_for((size_t)y0, (size_t)y1 + 1, 8, [&](size_t r0, size_t r1)
+	{
+		for (size_t y = r0; y < r1; ++y)
+			for (int x = x0; x <= x1; ++x)
+			{
+				POINT2	p = centre(x, (int)y);
+				float	best = FLT_MAX;
+				for (size_t i = 0; i < near.size(); ++i)
+				{
+					float sd = signedDistance(p, *near[i], &pn[2 * i]);
+					if (fabs(sd) < fabs(best))
+						best = sd;
+				}
+
+				// Past band a nearer wall outside reach may decide the sign; flooded below
+				bool found = fabs(best) < band_;
+				field_[y * w_ + x] = found ? best : band_;
+				far[(y - y0) * ww + (x - x0)] = found ? 0 : 1;
+			}
+	});
+
+	/*
+	 * Cells beyond band of every wall cannot take their sign from a wall.
+	 * The sign only changes across a wall, so flood it in from the nearest
+	 * known cells (inside the window or just outside it).
+	 */
+	static const int dx[4] = { 1, -1, 0, 0 }, dy[4] = { 0, 0, 1, -1 };
+	std::vector<int> open;
+	for (int y = y0; y <= y1; ++y)
+		for (int x = x0; x <= x1; ++x)
+		{
+			if (!far[(y - y0) * ww + (x - x0)])
+				continue;
+			for (int k = 0; k < 4; ++k)
+			{
+				int nx = x + dx[k], ny = y + dy[k];
+				if (nx < 0 || ny < 0 || nx >= w_ || ny >= h_)
+					continue;
+				bool inside = nx >= x0 && nx <= x1 && ny >= y0 && ny <= y1;
+				if (inside && far[(ny - y0) * ww + (nx - x0)])
+					continue;
+
+				field_[(size_t)y * w_ + x] = field_[(size_t)ny * w_ + nx] < 0.0f ? -band_ : band_;
+				far[(y - y0) * ww + (x - x0)] = 0;
+				open.push_back(y * w_ + x);
+				break;
+			}
+		}
+
+	while (!open.empty())
+	{
+		int c = open.back();
+		open.pop_back();
+		int x = c % w_, y = c / w_;
+		for (int k = 0; k < 4; ++k)
+		{
+			int nx = x + dx[k], ny = y + dy[k];
+			if (nx < x0 || ny < y0 || nx > x1 || ny > y1 || !far[(ny - y0) * ww + (nx - x0)])
+				continue;
+			field_[(size_t)ny * w_ + nx] = field_[c];
+			far[(ny - y0) * ww + (nx - x0)] = 0;
+			open.push_back(ny * w_ + nx);
+		}
+	}
+}
+
+float DistanceField::distance(POINT2 const & p) const
+{
+	VECTOR2 g;
+	return sample(p, g);
+}
+
+float DistanceField::sample(POINT2 const & p, VECTOR2 & gradient) const
+{
+	if (field_.empty())
+	{
+		gradient = VECTOR2(0.0f, 0.0f);
+		return FLT_MAX;
+	}
+
+	float fx = math::clamp((p.x - area_.lo.x) / cell_ - 0.5f, 0.0f, (float)(w_ - 1));
+	float fy = math::clamp((p.y - area_.lo.y) / cell_ - 0.5f, 0.0f, (float)(h_ - 1));
+	int x0 = math::min((int)fx, math::max(w_ - 2, 0)), y0 = math::min((int)fy, math::max(h_ - 2, 0));
+	int x1 = math::min(x0 + 1, w_ - 1), y1 = math::min(y0 + 1, h_ - 1);
+	float tx = fx - x0, ty = fy - y0;
+
+	float d00 = at(x0, y0), d10 = at(x1, y0);
+	float d01 = at(x0, y1), d11 = at(x1, y1);
+
+	float top = d00 + (d10 - d00) * tx;
+	float bot = d01 + (d11 - d01) * tx;
+
+	gradient = VECTOR2(((d10 - d00) * (1.0f - ty) + (d11 - d01) * ty) / cell_,
+					   (bot - top) / cell_);
+	return top + (bot - top) * ty;
+}
+
+void DistanceField::sample(float const * x, float const * y, size_t n, float * d, float * gx, float * gy) const
+{
+	if (field_.empty())
+	{
+		for (size_t i = 0; i < n; ++i)
+		{
+			d[i] = FLT_MAX;
+			if (gx) gx[i] = 0.0f;
+			if (gy) gy[i] = 0.0f;
+		}
+		return;
+	}
+
+	__m128 const lo_x  = _mm_set1_ps(area_.lo.x), lo_y = _mm_set1_ps(area_.lo.y);
+	__m128 const inv   = _mm_set1_ps(1.0f / cell_);
+	__m128 const half  = _mm_set1_ps(0.5f), zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+	__m128 const max_x = _mm_set1_ps((float)(w_ - 1)), max_y = _mm_set1_ps((float)(h_ - 1));
+	__m128i const lim_x = _mm_set1_epi32(math::max(w_ - 2, 0)), lim_y = _mm_set1_epi32(math::max(h_ - 2, 0));
+
+	float	px[4], py[4];
+	int32_t	ix[4], iy[4];
+	float	c00[4], c10[4], c01[4], c11[4];
+
+	for (size_t i = 0; i < n; i += 4)
+	{
+		size_t m = math::min<size_t>(4, n - i);
+		for (size_t k = 0; k < 4; ++k)
+		{
+			px[k] = x[i + (k < m ? k : 0)];
+			py[k] = y[i + (k < m ? k : 0)];
+		}
+
+		// Continuous grid coordinates, clamped so truncation acts as floor
+		__m128 fx = _mm_min_ps(_mm_max_ps(_mm_sub_ps(_mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(px), lo_x), inv), half), zero), max_x);
+		__m128 fy = _mm_min_ps(_mm_max_ps(_mm_sub_ps(_mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(py), lo_y), inv), half), zero), max_y);
+
+		__m128i vx = _mm_cvttps_epi32(fx), vy = _mm_cvttps_epi32(fy);
+		// min(v, lim) via compare/select (SSE2 has no 32-bit integer min)
+		__m128i gt = _mm_cmpgt_epi32(vx, lim_x);
+		vx = _mm_or_si128(_mm_and_si128(gt, lim_x), _mm_andnot_si128(gt, vx));
+		gt = _mm_cmpgt_epi32(vy, lim_y);
+		vy = _mm_or_si128(_mm_and_si128(gt, lim_y), _mm_andnot_si128(gt, vy));
+
+		__m128 tx = _mm_sub_ps(fx, _mm_cvtepi32_ps(vx));
+		__m128 ty = _mm_sub_ps(fy, _mm_cvtepi32_ps(vy));
+
+		// Gather the four corners of each lane (no gather instruction in SSE2)
+		_mm_storeu_si128((__m128i *)ix, vx);
+		_mm_storeu_si128((__m128i *)iy, vy);
+		for (int k = 0; k < 4; ++k)
+		{
+			int x1 = math::min(ix[k] + 1, w_ - 1), y1 = math::min(iy[k] + 1, h_ - 1);
+			c00[k] = at(ix[k], iy[k]);
+			c10[k] = at(x1, iy[k]);
+			c01[k] = at(ix[k], y1);
+			c11[k] = at(x1, y1);
+		}
+
+		__m128 d00 = _mm_loadu_ps(c00), d10 = _mm_loadu_ps(c10);
+		__m128 d01 = _mm_loadu_ps(c01), d11 = _mm_loadu_ps(c11);
+
+		__m128 dx0 = _mm_sub_ps(d10, d00), dx1 = _mm_sub_ps(d11, d01);
+		__m128 top = _mm_add_ps(d00, _mm_mul_ps(dx0, tx));
+		__m128 bot = _mm_add_ps(d01, _mm_mul_ps(dx1, tx));
+		__m128 res = _mm_add_ps(top, _mm_mul_ps(_mm_sub_ps(bot, top), ty));
+
+		float out[4];
+		_mm_storeu_ps(out, res);
+		for (size_t k = 0; k < m; ++k)
+			d[i + k] = out[k];
+
+		if (gx)
+		{
+			__m128 g = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(dx0, _mm_sub_ps(one, ty)), _mm_mul_ps(dx1, ty)), inv);
+			_mm_storeu_ps(out, g);
+			for (size_t k = 0; k < m; ++k)
+				gx[i + k] = out[k];
+		}
+		if (gy)
+		{
+			__m128 g = _mm_mul_ps(_mm_sub_ps(bot, top), inv);
+			_mm_storeu_ps(out, g);
+			for (size_t k = 0; k < m; ++k)
+				gy[i + k] = out[k];
+		}
+	}
+}
@@ -0,0 +1,283 @@
+/* ********************************************************************************* *
+ * *  File: ECS.cpp                                                                * *
+ * *  -------------                                                                * *
+ * *  COPYRIGHT NOTICE                                                             * *
+ * *  ----------------                                                             * *
+ * *  (C)[2012] - [2015] Deakin University                                         * *
+ * *  All rights reserved.                                                         * *
+ * *  All information contained herein is, and remains the property of Deakin      * *
+ * *  University and the author (Tim Wilkin).                                      * *
+ * *  Dissemination of this information or reproduction of this material is        * *
+ * *  strictly forbidden unless prior written permission is obtained from Deakin   * *
+ * *  University.The right to create derivative works from this material is        * *
+ * *  hereby granted to students enrolled in SIT255, but only for the purposes of  * *
+ * *  assessment while an enrolled student at Deakin University.                   * *
+ * *                                                                               * *
+ * ********************************************************************************* */
+
+#include <mutex>
+
+#include "core/ECS.h"
+
+using namespace core;
+
+namespace {
+
+	std::vector<ComponentInfo> reserved()
+	{
+		std::vector<ComponentInfo> v;
+		v.reserve(MAX_COMPONENTS);
+		return v;
+	}
+
+	// Reserved up front so that readers never see the vector reallocate
+	std::vector<ComponentInfo> & registry()
+	{
+		static std::vector<ComponentInfo> types = reserved();
+		return types;
+	}
+
+	std::mutex & registry_lock()
+	{
+		static std::mutex m;
+		return m;
+	}
+
+	inline size_t align_up(size_t v, size_t a)
+	{
+		return (v + a - 1) & ~(a - 1);
+	}
+
+} // close anonymous namespace
+
+ComponentId core::register_component(ComponentInfo const & info)
+{
+	std::lock_guard<std::mutex> lock(registry_lock());
+	std::vector<ComponentInfo> & types = registry();
+	assert(types.size() < MAX_COMPONENTS && "Too many component types");
+	assert(info.align <= 16 && "Component alignment beyond 16 bytes is not supported");
+	types.push_back(info);
+	return (ComponentId)(types.size() - 1);
+}
+
+ComponentInfo const & core::component_info(ComponentId id)
+{
+	return registry()[id];
+}
+
+/*
+ * Archetype
+ */
+
+const size_t Archetype::CHUNK_BYTES;
+
+Archetype::Archetype(ComponentMask mask)
+	: mask_(mask),
+	  capacity_(0),
+	  size_(0)
+{
+	size_t row = sizeof(Entity), slack = 0;
+	for (ComponentId id = 0; id < MAX_COMPONENTS; ++id)
+	{
+		offset_[id] = 0;
+		stride_[id] = 0;
+		if (!has(id))
+			continue;
+		types_.push_back(id);
+		row += component_info(id).size;
+		slack += component_info(id).align - 1;
+	}
+
+	// Entity handles first, then each component array aligned for its type
+	size_t bytes = sizeof(((Chunk *)0)->data);
+	capacity_ = (bytes - slack) / row;
+	size_t at = capacity_ * sizeof(Entity);
+	for (size_t t = 0; t < types_.size(); ++t)
+	{
+		ComponentInfo const & c = component_info(types_[t]);
+		at = align_up(at, c.align);
+		offset_[types_[t]] = at;
+		stride_[types_[t]] = c.size;
+		at += capacity_ * c.size;
+	}
+	assert(capacity_ > 0 && at <= bytes && "Components too large for one chunk");
+}
+
+Archetype::~Archetype()
+{
+	while (size_ > 0)
+		erase(0, 0, true);
+}
+
+std::pair<uint32_t, uint32_t> Archetype::push(Entity e)
+{
+	if (chunks_.empty() || chunks_.back()->count == capacity_)
+	{
+		chunks_.push_back(std::unique_ptr<Chunk>(new Chunk));
+		chunks_.back()->count = 0;
+	}
+
+	uint32_t c = (uint32_t)chunks_.size() - 1;
+	uint32_t r = chunks_[c]->count++;
+	entities(c)[r] = e;
+	++size_;
+	return std::make_pair(c, r);
+}
+
+Entity Archetype::erase(uint32_t chunk, uint32_t row, bool destroy)
+{
+	uint32_t last_c = (uint32_t)chunks_.size() - 1;
+	uint32_t last_r = chunks_[last_c]->count - 1;
+
+	if (destroy)
+		for (size_t t = 0; t < types_.size(); ++t)
+			component_info(types_[t]).destroy(at(chunk, row, types_[t]));
+
+	Entity moved;
+	if (chunk != last_c || row != last_r)
+	{
+		for (size_t t = 0; t < types_.size(); ++t)
+			component_info(types_[t]).move(at(chunk, row, types_[t]), at(last_c, last_r, types_[t]));
+		moved = entities(last_c)[last_r];
+		entities(chunk)[row] = moved;
+	}
+
+	--size_;
+	if (--chunks_[last_c]->count == 0)
+		chunks_.pop_back();
+	return moved;
+}
+
+/*
+ * World
+ */
+
+World::World()
+	: alive_(0)
+{}
+
+Archetype * World::archetype(ComponentMask mask)
+{
+	std::unordered_map<ComponentMask, Archetype *>::const_iterator it = by_mask_.find(mask);
+	if (it != by_mask_.end())
+		return it->second;
+
+	archetypes_.push_back(std::unique_ptr<Archetype>(new Archetype(mask)));
+	by_mask_[mask] = archetypes_.back().get();
+	return archetypes_.back().get();
+}
+
+std::vector<Archetype *> const & World::query(ComponentMask mask)
+{
+	// Only archetypes created since the last call need testing
+	Query & q = queries_[mask];
+	for (; q.seen < archetypes_.size(); ++q.seen)
+		if ((archetypes_[q.seen]->mask() & mask) == mask)
+			q.matches.push_back(archetypes_[q.seen].get());
+	return q.matches;
+}
+
+Entity World::allocate()
+{
+	uint32_t index;
+	if (!free_.empty())
+	{
+		index = free_.back();
+		free_.pop_back();
+	}
+	else
+	{
+		index = (uint32_t)records_.size();
+		Record r = { 0, 0, 0, 1 };
+		records_.push_back(r);
+	}
+	++alive_;
+	return Entity(index, records_[index].generation);
+}
+
+void World::place(Entity e, Archetype * a)
+{
+	std::pair<uint32_t, uint32_t> at = a->push(e);
+	Record & r = records_[e.index];
+	r.archetype = a;
+	r.chunk = at.first;
+	r.row = at.second;
+}
+
+bool World::alive(Entity e) const
+{
+	return e.generation != 0 && e.index < records_.size() &&
+		   records_[e.index].generation == e.generation && records_[e.index].archetype != 0;
+}
+
+void World::destroy(Entity e)
+{
+	if (!alive(e))
+		return;
+
+	Record & r = records_[e.index];
+	Entity moved = r.archetype->erase(r.chunk, r.row, true);
+	if (moved.generation != 0)
+	{
+		records_[moved.index].chunk = r.chunk;
+		records_[moved.index].row = r.row;
+	}
+
+	r.archetype = 0;
+	if (++r.generation == 0)
+		r.generation = 1;
+	free_.push_back(e.index);
+	--alive_;
+}
+
+void World::destroy(Entity const * e, size_t n)
+{
+	for (size_t i = 0; i < n; ++i)
+		destroy(e[i]);
+}
+
+void World::move(Entity e, ComponentMask mask)
+{
+	Record r = records_[e.index];
+	Archetype * from = r.archetype;
+	Archetype * to = archetype(mask);
+
+	std::pair<uint32_t, uint32_t> at = to->push(e);
+	std::vector<ComponentId> const & types = to->types();
+	for (size_t t = 0; t < types.size(); ++t)
+	{
+		void * dst = to->at(at.first, at.second, types[t]);
+		if (from->has(types[t]))
+			component_info(types[t]).move(dst, from->at(r.chunk, r.row, types[t]));
+		else
+			component_info(types[t]).construct(dst);
+	}
+	for (size_t t = 0; t < from->types().size(); ++t)
+		if (!to->has(from->types()[t]))
+			component_info(from->types()[t]).destroy(from->at(r.chunk, r.row, from->types()[t]));
+
+	// Every column of the old row is now moved out or destroyed
+	Entity moved = from->erase(r.chunk, r.row, false);
+	if (moved.generation != 0)
+	{
+		records_[moved.index].chunk = r.chunk;
+		records_[moved.index].row = r.row;
+	}
+
+	Record & now = records_[e.index];
+	now.archetype = to;
+	now.chunk = at.first;
+	now.row = at.second;
+}
+
+/*
+ * CommandBuffer
+ */
+
+void CommandBuffer::apply(World & w)
+{
+	created_.clear();
+	for (size_t i = 0; i < commands_.size(); ++i)
+		commands_[i](w, created_);
+	commands_.clear();
+}
@@ -0,0 +1,339 @@
+/* ********************************************************************************* *
+ * *  File: FlowField.cpp                                                          * *
+ * *  -------------------                                                          * *
+ * *  COPYRIGHT NOTICE                                                             * *
+ * *  ----------------                                                             * *
+ * *  (C)[2012] - [2015] Deakin University                                         * *
+ * *  All rights reserved.                                                         * *
+ * *  All information contained herein is, and remains the property of Deakin      * *
+ * *  University and the author (Tim Wilkin).                                      * *
+ * *  Dissemination of this information or reproduction of this material is        * *
+ * *  strictly forbidden unless prior written permission is obtained from Deakin   * *
+ * *  University.The right to create derivative works from this material is        * *
+ * *  hereby granted to students enrolled in SIT255, but only for the purposes of  * *
+ * *  assessment while an enrolled student at Deakin University.                   * *
+ * *                                                                               * *
+ * ********************************************************************************* */
+
+#include <algorithm>
+#include <cmath>
+
+#include "ai/FlowField.h"
+#include "core/Parallel.h"
+
+using namespace ai;
+using namespace level;
+
+namespace {
+
+	// Sweep passes per tile before handing the rest to the neighbours
+	const int	MAX_PASSES = 8;
+
+} // close anonymous namespace
+
+FlowField::FlowField()
+	: grid_(0),
+	  tile_(16),
+	  tw_(0),
+	  th_(0),
+	  goal_cell_(-1),
+	  solved_(0)
+{}
+
+void FlowField::reset(OccupancyGrid const & grid, int tile)
+{
+	grid_ = &grid;
+	tile_ = math::max(tile, 2);
+	tw_ = (grid.width() + tile_ - 1) / tile_;
+	th_ = (grid.height() + tile_ - 1) / tile_;
+	goal_cell_ = -1;
+
+	size_t cells = (size_t)grid.width() * grid.height();
+	cost_.assign(cells, FLT_MAX);
+	dir_x_.assign(cells, 0.0f);
+	dir_y_.assign(cells, 0.0f);
+	active_.assign((size_t)tw_ * th_, 0);
+	touched_.assign((size_t)tw_ * th_, 0);
+}
+
+int32_t FlowField::cellAt(POINT2 const & p) const
+{
+	int x = grid_->toCellX(p.x), y = grid_->toCellY(p.y);
+	if (x < 0 || y < 0 || x >= grid_->width() || y >= grid_->height())
+		return -1;
+	return y * grid_->width() + x;
+}
+
+void FlowField::setGoal(POINT2 const & goal)
+{
+	if (!grid_)
+		return;
+
+	goal_ = goal;
+	int w = grid_->width();
+	int gx = math::clamp(grid_->toCellX(goal.x), 0, w - 1);
+	int gy = math::clamp(grid_->toCellY(goal.y), 0, grid_->height() - 1);
+	goal_cell_ = gy * w + gx;
+
+	std::fill(cost_.begin(), cost_.end(), FLT_MAX);
+	std::fill(touched_.begin(), touched_.end(), (uint8_t)1);
+	cost_[goal_cell_] = 0.0f;
+	active_[(gy / tile_) * tw_ + gx / tile_] = 1;
+
+	solved_ = 0;
+	solve();
+	directions();
+}
+
+void FlowField::update(AABB const & region)
+{
+	if (!grid_ || goal_cell_ < 0 || region.empty())
+		return;
+
+	int w = grid_->width(), h = grid_->height();
+	int x0 = math::clamp(grid_->toCellX(region.lo.x) - 1, 0, w - 1);
+	int y0 = math::clamp(grid_->toCellY(region.lo.y) - 1, 0, h - 1);
+	int x1 = math::clamp(grid_->toCellX(region.hi.x) + 1, 0, w - 1);
+	int y1 = math::clamp(grid_->toCellY(region.hi.y) + 1, 0, h - 1);
+
+	// The changed cells, and everything downstream that took its value from them
+	raise_.clear();
+	for (int y = y0; y <= y1; ++y)
+		for (int x = x0; x <= x1; ++x)
+		{
+			int32_t i = y * w + x;
+			if (i != goal_cell_)
+			{
+				raise_.push_back(std::make_pair(i, cost_[i]));
+				cost_[i] = FLT_MAX;
+			}
+		}
+
+	for (size_t k = 0; k < raise_.size(); ++k)
+	{
+		int32_t	c = raise_[k].first;
+		float	old = raise_[k].second;
+		int		x = c % w, y = c / w;
+		touched_[(y / tile_) * tw_ + x / tile_] = 1;
+		if (old == FLT_MAX)
+			continue;
+
+		// n depends on c if c is upwind of it and the lower of n's two neighbours on that axis
+		for (int e = 0; e < 4; ++e)
+		{
+			int nx = x + ((e == 0) ? 1 : (e == 1) ? -1 : 0);
+			int ny = y + ((e == 2) ? 1 : (e == 3) ? -1 : 0);
+			if (nx < 0 || ny < 0 || nx >= w || ny >= h)
+				continue;
+			int32_t n = ny * w + nx;
+			if (n == goal_cell_ || cost_[n] == FLT_MAX || cost_[n] <= old)
+				continue;
+
+			int ox = 2 * nx - x, oy = 2 * ny - y;
+			float other = (ox >= 0 && oy >= 0 && ox < w && oy < h) ? cost_[oy * w + ox] : FLT_MAX;
+			if (old <= other)
+			{
+				raise_.push_back(std::make_pair(n, cost_[n]));
+				cost_[n] = FLT_MAX;
+			}
+		}
+	}
+
+	// Re-solve the reset tiles from the values around them
+	for (size_t t = 0; t < touched_.size(); ++t)
+		active_[t] = touched_[t];
+
+	solved_ = 0;
+	solve();
+	directions();
+}
+
+void FlowField::terrainChanged(Terrain const & /*terrain*/, AABB const & region)
+{
+	update(region);
+}
+
+/*
+ * Wavefront
+ */
+
+void FlowField::solve()
+{
+	for (;;)
+	{
+		bool any = false;
+		for (int colour = 0; colour < 2; ++colour)
+		{
+			batch_.clear();
+			for (int ty = 0; ty < th_; ++ty)
+				for (int tx = 0; tx < tw_; ++tx)
+				{
+					int t = ty * tw_ + tx;
+					if (active_[t] && ((tx + ty) & 1) == colour)
+					{
+						batch_.push_back(t);
+						active_[t] = 0;
+					}
+				}
+			if (batch_.empty())
+				continue;
+
+			any = true;
+			spread_.assign(batch_.size(), 0);
+			core::parallel_for(0, batch_.size(), 2, [&](size_t first, size_t last)
+			{
+				for (size_t i = first; i < last; ++i)
+					spread_[i] = sweep(batch_[i]) ? 1 : 0;
+			});
+			solved_ += batch_.size();
+
+			for (size_t i = 0; i < batch_.size(); ++i)
+			{
+				if (!spread_[i])
+					continue;
+				int tx = batch_[i] % tw_, ty = batch_[i] / tw_;
+				if (tx > 0)			active_[batch_[i] - 1] = 1;
+				if (tx + 1 < tw_)	active_[batch_[i] + 1] = 1;
+				if (ty > 0)			active_[batch_[i] - tw_] = 1;
+				if (ty + 1 < th_)	active_[batch_[i] + tw_] = 1;
+			}
+		}
+		if (!any)
+			break;
+	}
+}
+
+bool FlowField::sweep(int t)
+{
+	int		w = grid_->width(), h = grid_->height();
+	int		x0 = (t % tw_) * tile_, y0 = (t / tw_) * tile_;
+	int		x1 = math::min(x0 + tile_, w) - 1, y1 = math::min(y0 + tile_, h) - 1;
+	float	step = grid_->cell();
+	float	step2 = 2.0f * step * step;
+	bool	border = false;
+
+	for (int pass = 0; pass < MAX_PASSES; ++pass)
+	{
+		bool changed = false;
+
+		// The four sweep orderings of the fast sweeping method
+		for (int order = 0; order < 4; ++order)
+		{
+			int sx = (order & 1) ? -1 : 1, sy = (order & 2) ? -1 : 1;
+			for (int y = (sy > 0) ? y0 : y1; y >= y0 && y <= y1; y += sy)
+				for (int x = (sx > 0) ? x0 : x1; x >= x0 && x <= x1; x += sx)
+				{
+					int32_t i = y * w + x;
+					if (i == goal_cell_ || grid_->blocked(x, y))
+						continue;
+
+					float a = math::min((x > 0) ? cost_[i - 1] : FLT_MAX, (x + 1 < w) ? cost_[i + 1] : FLT_MAX);
+					float b = math::min((y > 0) ? cost_[i - w] : FLT_MAX, (y + 1 < h) ? cost_[i + w] : FLT_MAX);
+					if (a == FLT_MAX && b == FLT_MAX)
+						continue;
+
+					float d = a - b;
+					float u = (fabs(d) >= step) ? math::min(a, b) + step : 0.5f * (a + b + (float)sqrt(step2 - d * d));
+					if (u < cost_[i] - 1e-4f * step)
+					{
+						cost_[i] = u;
+						changed = true;
+						border = border || x == x0 || x == x1 || y == y0 || y == y1;
+					}
+				}
+		}
+		if (!changed)
+			break;
+		if (pass + 1 == MAX_PASSES)
+			active_[t] = 1;		// not settled yet: come back next round
+	}
+
+	touched_[t] = 1;
+	return border;
+}
+
+/*
+ * Directions: down the steeper upwind difference on each axis
+ */
+
+void FlowField::directions()
+{
+	batch_.clear();
+	for (int ty = 0; ty < th_; ++ty)
+		for (int tx = 0; tx < tw_; ++tx)
+		{
+			// Border cells read the neighbouring tiles
+			bool near = false;
+			for (int y = math::max(ty - 1, 0); y <= math::min(ty + 1, th_ - 1) && !near; ++y)
+				for (int x = math::max(tx - 1, 0); x <= math::min(tx + 1, tw_ - 1) && !near; ++x)
+					near = touched_[y * tw_ + x] != 0;
+			if (near)
+				batch_.push_back(ty * tw_ + tx);
+		}
+
+	int w = grid_->width(), h = grid_->height();
+	core::parallel_for(0, batch_.size(), 4, [&](size_t first, size_t last)
+	{
+		for (size_t k = first; k < last; ++k)
+		{
+			int t = batch_[k];
+			int x0 = (t % tw_) * tile_, y0 = (t / tw_) * tile_;
+			int x1 = math::min(x0 + tile_, w), y1 = math::min(y0 + tile_, h);
+			for (int y = y0; y < y1; ++y)
+				for (int x = x0; x < x1; ++x)
+				{
+					int32_t i = y * w + x;
+					float u = cost_[i];
+					float gx = 0.0f, gy = 0.0f;
+					if (u < FLT_MAX && i != goal_cell_ && !grid_->blocked(x, y))
+					{
+						float l = (x > 0) ? cost_[i - 1] : FLT_MAX, r = (x + 1 < w) ? cost_[i + 1] : FLT_MAX;
+						float d = (y > 0) ? cost_[i - w] : FLT_MAX, p = (y + 1 < h) ? cost_[i + w] : FLT_MAX;
+						if (math::min(l, r) < u)
+							gx = (l < r) ? l - u : u - r;
+						if (math::min(d, p) < u)
+							gy = (d < p) ? d - u : u - p;
+
+						float len = (float)sqrt(gx * gx + gy * gy);
+						if (len > 0.0f)
+						{
+							gx /= len;
+							gy /= len;
+						}
+					}
+					dir_x_[i] = gx;
+					dir_y_[i] = gy;
+				}
+		}
+	});
+
+	std::fill(touched_.begin(), touched_.end(), (uint8_t)0);
+}
+
+/*
+ * Sampling
+ */
+
+VECTOR2 FlowField::direction(POINT2 const & p) const
+{
+	int32_t i = grid_ ? cellAt(p) : -1;
+	if (i < 0)
+		return VECTOR2(0.0f, 0.0f);
+	return VECTOR2(dir_x_[i], dir_y_[i]);
+}
+
+void FlowField::direction(float const * x, float const * y, size_t n, float * dx, float * dy) const
+{
+	for (size_t k = 0; k < n; ++k)
+	{
+		int32_t i = grid_ ? cellAt(POINT2(x[k], y[k])) : -1;
+		dx[k] = (i >= 0) ? dir_x_[i] : 0.0f;
+		dy[k] = (i >= 0) ? dir_y_[i] : 0.0f;
+	}
+}
+
+float FlowField::cost(POINT2 const & p) const
+{
+	int32_t i = grid_ ? cellAt(p) : -1;
+	return (i >= 0) ? cost_[i] : FLT_MAX;
+}
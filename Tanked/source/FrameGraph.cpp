@@ -0,0 +1,221 @@
+/* ********************************************************************************* *
+ * *  File: FrameGraph.cpp                                                         * *
+ * *  --------------------                                                         * *
+ * *  COPYRIGHT NOTICE                                                             * *
+ * *  ----------------                                                             * *
+ * *  (C)[2012] - [2015] Deakin University                                         * *
+ * *  All rights reserved.                                                         * *
+ * *  All information contained herein is, and remains the property of Deakin      * *
+ * *  University and the author (Tim Wilkin).                                      * *
+ * *  Dissemination of this information or reproduction of this material is        * *
+ * *  strictly forbidden unless prior written permission is obtained from Deakin   * *
+ * *  University.The right to create derivative works from this material is        * *
+ * *  hereby granted to students enrolled in SIT255, but only for the purposes of  * *
+ * *  assessment while an enrolled student at Deakin University.                   * *
+ * *                                                                               * *
+ * ********************************************************************************* */
+
+#include <cassert>
+
+#include "core/FrameGraph.h"
+
+using namespace core;
+
+namespace {
+
+	const uint64_t	NO_FRAME = ~(uint64_t)0;
+
+} // close anonymous namespace
+
+FrameGraph::FrameGraph(JobSystem & jobs)
+	: jobs_(jobs),
+	  compiled_(false),
+	  next_(0)
+{
+	slots_[0].number = NO_FRAME;
+	slots_[1].number = NO_FRAME;
+}
+
+FrameGraph::~FrameGraph()
+{
+	finish();
+}
+
+ResourceId FrameGraph::resource(char const * name, bool buffered)
+{
+	assert(!compiled_);
+	resources_.push_back(name);
+	buffered_.push_back(buffered);
+	return (ResourceId)(resources_.size() - 1);
+}
+
+StageId FrameGraph::stage(char const * name, StageFn fn)
+{
+	assert(!compiled_);
+	Stage s;
+	s.name = name;
+	s.fn   = fn;
+	s.deps = 0;
+	stages_.push_back(s);
+	return (StageId)(stages_.size() - 1);
+}
+
+void FrameGraph::reads(StageId s, ResourceId r, VERSION v)
+{
+	assert(!compiled_ && s < stages_.size() && r < resources_.size());
+	Access a = { r, v, false };
+	stages_[s].access.push_back(a);
+}
+
+void FrameGraph::writes(StageId s, ResourceId r, VERSION v)
+{
+	assert(!compiled_ && s < stages_.size() && r < resources_.size());
+	Access a = { r, v, true };
+	stages_[s].access.push_back(a);
+}
+
+bool FrameGraph::conflict(Access const & a, uint64_t fa, Access const & b, uint64_t fb) const
+{
+	if (a.resource != b.resource || (!a.write && !b.write))
+		return false;
+	if (!buffered_[a.resource])
+		return true;
+
+	// Same copy?
+	uint64_t ca = fa - (a.version == VERSION_PREVIOUS ? 1 : 0),
+			 cb = fb - (b.version == VERSION_PREVIOUS ? 1 : 0);
+	return ((ca ^ cb) & 1) == 0;
+}
+
+bool FrameGraph::conflict(StageId a, uint64_t fa, StageId b, uint64_t fb) const
+{
+	std::vector<Access> const & x = stages_[a].access;
+	std::vector<Access> const & y = stages_[b].access;
+	for (size_t i = 0; i < x.size(); ++i)
+		for (size_t j = 0; j < y.size(); ++j)
+			if (conflict(x[i], fa, y[j], fb))
+				return true;
+	return false;
+}
+
+void FrameGraph::compile()
+{
+	// Frames 2 and 3 stand in for any even and odd frame; conflicts only
+	// depend on parity
+	for (StageId b = 0; b < stages_.size(); ++b)
+	{
+		for (StageId a = 0; a < b; ++a)
+			if (conflict(a, 2, b, 2))
+			{
+				stages_[a].next.push_back(b);
+				++stages_[b].deps;
+			}
+
+		for (unsigned p = 0; p < 2; ++p)
+			for (StageId a = 0; a < stages_.size(); ++a)
+				if (a == b || conflict(a, 3 + p, b, 4 + p))		// a in frame n, b in frame n + 1 of parity p
+					stages_[a].after[p].push_back(b);
+	}
+
+	for (unsigned i = 0; i < 2; ++i)
+	{
+		slots_[i].pending.resize(stages_.size());
+		slots_[i].done.resize(stages_.size());
+	}
+	compiled_ = true;
+}
+
+void FrameGraph::submit()
+{
+	if (!compiled_)
+		compile();
+
+	uint64_t n = next_++;
+	unsigned i = (unsigned)(n & 1);
+	Slot & slot = slots_[i];
+	Slot & prev = slots_[i ^ 1];
+
+	// Frame n - 2 used this slot
+	jobs_.wait(slot.finished);
+	jobs_.hold(slot.finished, (int)stages_.size());
+
+	std::vector<Job> ready;
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		slot.number = n;
+		for (StageId s = 0; s < stages_.size(); ++s)
+		{
+			slot.pending[s] = stages_[s].deps;
+			slot.done[s] = false;
+		}
+
+		if (n > 0 && prev.number == n - 1)
+			for (StageId a = 0; a < stages_.size(); ++a)
+				if (!prev.done[a])
+				{
+					std::vector<StageId> const & after = stages_[a].after[i];
+					for (size_t k = 0; k < after.size(); ++k)
+						++slot.pending[after[k]];
+				}
+
+		for (StageId s = 0; s < stages_.size(); ++s)
+			if (slot.pending[s] == 0)
+			{
+				Job job = { &FrameGraph::run, this, i, s, 0 };
+				ready.push_back(job);
+			}
+	}
+
+	for (size_t k = 0; k < ready.size(); ++k)
+		jobs_.submit(ready[k]);
+}
+
+void FrameGraph::finish()
+{
+	jobs_.wait(slots_[0].finished);
+	jobs_.wait(slots_[1].finished);
+}
+
+void FrameGraph::run(Job const & job)
+{
+	((FrameGraph *)job.data)->execute((unsigned)job.first, (StageId)job.last);
+}
+
+void FrameGraph::execute(unsigned i, StageId s)
+{
+	Slot & slot = slots_[i];
+	Slot & next = slots_[i ^ 1];
+
+	Frame frame = { slot.number };
+	stages_[s].fn(frame);
+
+	std::vector<Job> ready;
+	{
+		std::lock_guard<std::mutex> lock(lock_);
+		slot.done[s] = true;
+
+		std::vector<StageId> const & later = stages_[s].next;
+		for (size_t k = 0; k < later.size(); ++k)
+			if (--slot.pending[later[k]] == 0)
+			{
+				Job job = { &FrameGraph::run, this, i, later[k], 0 };
+				ready.push_back(job);
+			}
+
+		// The next frame may already be waiting on this stage
+		if (next.number == frame.number + 1)
+		{
+			std::vector<StageId> const & after = stages_[s].after[i ^ 1];
+			for (size_t k = 0; k < after.size(); ++k)
+				if (--next.pending[after[k]] == 0)
+				{
+					Job job = { &FrameGraph::run, this, i ^ 1, after[k], 0 };
+					ready.push_back(job);
+				}
+		}
+	}
+
+	for (size_t k = 0; k < ready.size(); ++k)
+		jobs_.submit(ready[k]);
+	jobs_.signal(slot.finished);
+}
@@ -0,0 +1,474 @@
+/* ********************************************************************************* *
+ * *  File: GJK.cpp                                                                * *
+ * *  -------------                                                                * *
+ * *  COPYRIGHT NOTICE                                                             * *
+ * *  ----------------                                                             * *
+ * *  (C)[2012] - [2015] Deakin University                                         * *
+ * *  All rights reserved.                                                         * *
+ * *  All information contained herein is, and remains the property of Deakin      * *
+ * *  University and the author (Tim Wilkin).                                      * *
+ * *  Dissemination of this information or reproduction of this material is        * *
+ * *  strictly forbidden unless prior written permission is obtained from Deakin   * *
+ * *  University.The right to create derivative works from this material is        * *
+ * *  hereby granted to students enrolled in SIT255, but only for the purposes of  * *
+ * *  assessment while an enrolled student at Deakin University.                   * *
+ * *                                                                               * *
+ * ********************************************************************************* */
+
+#include "physics/GJK.h"
+
+/*
+ *		GJK works on the Minkowski difference A - B. A simplex vertex keeps the
+ *		indices of the source vertices in A and B so that the simplex can be
+ *		cached between frames and witness points recovered afterwards. EPA
+ *		expands the final GJK triangle into a polygon held in fixed arrays, so
+ *		neither query allocates.
+ */
+
+using namespace physics;
+
+namespace {
+
+	const int	GJK_MAX_ITERATIONS = 32;
+	const int	EPA_MAX_VERTICES = 64;
+	const float	EPA_TOLERANCE = 1.0e-4f;
+
+	struct SimplexVertex
+	{
+		POINT2		a, b;		// support points of A and B
+		VECTOR2		w;			// a - b
+		float		u;			// barycentric weight of the closest point
+		uint8_t		ia, ib;
+	};
+
+	struct Simplex
+	{
+		SimplexVertex	v[3];
+		int				count;
+
+		void set(int k, ConvexProxy const & A, ConvexProxy const & B, size_t ia, size_t ib)
+		{
+			v[k].ia = (uint8_t)ia;
+			v[k].ib = (uint8_t)ib;
+			v[k].a = A.vertex(ia);
+			v[k].b = B.vertex(ib);
+			v[k].w = v[k].a - v[k].b;
+			v[k].u = 1.0f;
+		}
+
+		/*
+		 * Reduce to the sub-simplex nearest the origin and set the weights;
+		 * returns the closest point. count == 3 after solving means the
+		 * origin is inside the triangle.
+		 */
+		VECTOR2 solve()
+		{
+			if (count == 1)
+			{
+				v[0].u = 1.0f;
+				return v[0].w;
+			}
+
+			if (count == 2)
+			{
+				VECTOR2 e = v[1].w - v[0].w;
+				float	t0 = -inner_product(v[0].w, e);
+				float	ee = inner_product(e, e);
+
+				if (t0 <= 0.0f || ee <= 0.0f)
+				{
+					count = 1;
+					v[0].u = 1.0f;
+					return v[0].w;
+				}
+				if (t0 >= ee)
+				{
+					v[0] = v[1];
+					count = 1;
+					v[0].u = 1.0f;
+					return v[0].w;
+				}
+
+				v[1].u = t0 / ee;
+				v[0].u = 1.0f - v[1].u;
+				return VECTOR2(v[0].w * v[0].u + v[1].w * v[1].u);
+			}
+
+			// Triangle: Voronoi regions of vertices, edges and the interior
+			VECTOR2 const & A = v[0].w;
+			VECTOR2 const & B = v[1].w;
+			VECTOR2 const & C = v[2].w;
+
+			VECTOR2 ab = B - A, ac = C - A, bc = C - B;
+			float d1 = -inner_product(ab, A), d2 = -inner_product(ac, A);
+			if (d1 <= 0.0f && d2 <= 0.0f)			{ keep(0);		return solve(); }
+
+			float d3 = -inner_product(ab, B), d4 = -inner_product(ac, B);
+			if (d3 >= 0.0f && d4 <= d3)				{ keep(1);		return solve(); }
+
+			float d5 = -inner_product(ab, C), d6 = -inner_product(ac, C);
+			if (d6 >= 0.0f && d5 <= d6)				{ keep(2);		return solve(); }
+
+			float vc = d1 * d4 - d3 * d2;
+			if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)	{ keep(0, 1);	return solve(); }
+
+			float vb = d5 * d2 - d1 * d6;
+			if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)	{ keep(0, 2);	return solve(); }
+
+			float va = d3 * d6 - d5 * d4;
+			if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f)	{ keep(1, 2);	return solve(); }
+
+			float denom = 1.0f / (va + vb + vc);
+			v[0].u = va * denom;
+			v[1].u = vb * denom;
+			v[2].u = vc * denom;
+			(void)bc;
+			return VECTOR2(0.0f, 0.0f);
+		}
+
+		void keep(int i)
+		{
+			v[0] = v[i];
+			count = 1;
+		}
+
+		void keep(int i, int j)
+		{
+			SimplexVertex a = v[i], b = v[j];
+			v[0] = a;
+			v[1] = b;
+			count = 2;
+		}
+
+		void witness(POINT2 & pa, POINT2 & pb) const
+		{
+			float ax = 0.0f, ay = 0.0f, bx = 0.0f, by = 0.0f;
+			for (int i = 0; i < count; ++i)
+			{
+				ax += v[i].a.x * v[i].u;	ay += v[i].a.y * v[i].u;
+				bx += v[i].b.x * v[i].u;	by += v[i].b.y * v[i].u;
+			}
+			pa = POINT2(ax, ay);
+			pb = POINT2(bx, by);
+		}
+
+		bool contains(size_t ia, size_t ib) const
+		{
+			for (int i = 0; i < count; ++i)
+				if (v[i].ia == ia && v[i].ib == ib)
+					return true;
+			return false;
+		}
+
+		void toCache(GJKCache & c) const
+		{
+			c.count = (uint8_t)count;
+			for (int i = 0; i < count; ++i)
+			{
+				c.indexA[i] = v[i].ia;
+				c.indexB[i] = v[i].ib;
+			}
+		}
+	};
+
+	void warm_start(Simplex & s, GJKCache const & cache, ConvexProxy const & A, ConvexProxy const & B)
+	{
+		s.count = 0;
+		for (int i = 0; i < cache.count; ++i)
+		{
+			if (cache.indexA[i] < A.count && cache.indexB[i] < B.count)
+				s.set(s.count++, A, B, cache.indexA[i], cache.indexB[i]);
+		}
+		if (s.count == 0)
+		{
+			s.set(0, A, B, 0, 0);
+			s.count = 1;
+		}
+	}
+
+	/*
+	 * Core GJK loop. With early_out set, returns as soon as the cores are
+	 * proven to be further apart than the combined radii.
+	 */
+	bool run_gjk(ConvexProxy const & A, ConvexProxy const & B, GJKCache & cache,
+				 Simplex & s, VECTOR2 & closest, int & iterations, bool early_out)
+	{
+		warm_start(s, cache, A, B);
+
+		float	radii = A.radius + B.radius;
+		int		hintA = s.v[0].ia, hintB = s.v[0].ib;
+
+		for (iterations = 0; iterations < GJK_MAX_ITERATIONS; ++iterations)
+		{
+			closest = s.solve();
+			if (s.count == 3)
+				break;
+
+			float dist_sq = inner_product(closest, closest);
+			if (dist_sq < 1.0e-12f)
+				break;
+
+			// Support of A - B in the direction of the origin
+			VECTOR2 d = -closest;
+			size_t	ia = A.support(d, hintA);
+			size_t	ib = B.support(-d, hintB);
+			hintA = (int)ia;
+			hintB = (int)ib;
+
+			VECTOR2 w = A.vertex(ia) - B.vertex(ib);
+
+			if (early_out)
+			{
+				// |closest| >= separation >= projection of w onto -closest
+				float sep = -inner_product(w, closest) / sqrt(dist_sq);
+				if (sep > radii)
+				{
+					s.toCache(cache);
+					return false;
+				}
+			}
+
+			// No progress: the current simplex already contains the support point
+			if (s.contains(ia, ib) || inner_product(w, d) - inner_product(closest, d) <= 1.0e-6f * dist_sq)
+				break;
+
+			s.set(s.count++, A, B, ia, ib);
+		}
+
+		s.toCache(cache);
+		return true;
+	}
+
+	inline VECTOR2 unit(VECTOR2 const & v, VECTOR2 const & fallback)
+	{
+		float len = v.length();
+		return (len > 1.0e-9f) ? VECTOR2(v / len) : fallback;
+	}
+
+} // close anonymous namespace
+
+
+ConvexProxy::ConvexProxy(Polytype const & p)
+	: count(0),
+	  radius(0.0f)
+{
+	switch (p.type())
+	{
+		case POLYGON_TYPE::CIRCLE:
+		{
+			Circle const & c = static_cast<Circle const &>(p);
+			v[0] = c.origin();
+			count = 1;
+			radius = c.radius();
+			break;
+		}
+		case POLYGON_TYPE::RECTANGLE:
+		{
+			Rect const & r = static_cast<Rect const &>(p);
+			v[0] = r.start();
+			v[1] = POINT2(r.end().x, r.start().y);
+			v[2] = r.end();
+			v[3] = POINT2(r.start().x, r.end().y);
+			count = 4;
+			break;
+		}
+		case POLYGON_TYPE::TRIANGLE:
+		{
+			Triangle const & t = static_cast<Triangle const &>(p);
+			for (size_t i = 0; i < 3; ++i)
+				v[i] = t.vertex(i);
+			count = 3;
+			break;
+		}
+		case POLYGON_TYPE::CONVEX:
+		{
+			ConvexPolygon const & c = static_cast<ConvexPolygon const &>(p);
+			count = c.size();
+			for (size_t i = 0; i < count; ++i)
+				v[i] = c.vertex(i);
+			break;
+		}
+	}
+}
+
+size_t ConvexProxy::support(VECTOR2 const & d, size_t hint) const
+{
+	if (count == 0)
+		return 0;
+
+	if (count <= 4)
+	{
+		size_t	best = 0;
+		float	dmax = inner_product(VECTOR2(v[0].x, v[0].y), d);
+		for (size_t i = 1; i < count; ++i)
+		{
+			float di = inner_product(VECTOR2(v[i].x, v[i].y), d);
+			if (di > dmax)
+			{
+				dmax = di;
+				best = i;
+			}
+		}
+		return best;
+	}
+
+	// Hill climb from the cached vertex (see ConvexPolygon::support)
+	size_t	i = hint % count;
+	float	best = inner_product(VECTOR2(v[i].x, v[i].y), d);
+	for (;;)
+	{
+		size_t	next = (i + 1) % count, prev = (i + count - 1) % count;
+		float	dn = inner_product(VECTOR2(v[next].x, v[next].y), d);
+		float	dp = inner_product(VECTOR2(v[prev].x, v[prev].y), d);
+
+		if (dn > best && dn >= dp)
+		{
+			i = next;
+			best = dn;
+		}
+		else if (dp > best)
+		{
+			i = prev;
+			best = dp;
+		}
+		else
+			return i;
+	}
+}
+
+
+float physics::gjkDistance(ConvexProxy const & a, ConvexProxy const & b, GJKCache & cache, DistanceResult & out)
+{
+	if (a.count == 0 || b.count == 0)
+	{
+		out.pointA = out.pointB = POINT2();
+		out.normal = VECTOR2(1, 0);
+		out.iterations = 0;
+		out.distance = FLT_MAX;
+		return out.distance;
+	}
+
+	Simplex s;
+	VECTOR2 closest;
+	run_gjk(a, b, cache, s, closest, out.iterations, false);
+
+	s.witness(out.pointA, out.pointB);
+	VECTOR2 ab = out.pointB - out.pointA;
+	float	core = (s.count == 3) ? 0.0f : ab.length();
+
+	out.normal = unit(ab, VECTOR2(1, 0));
+
+	// Shrink the witness points onto the rounded surfaces
+	float radii = a.radius + b.radius;
+	if (core > radii)
+	{
+		out.pointA += VECTOR2(out.normal * a.radius);
+		out.pointB -= VECTOR2(out.normal * b.radius);
+		out.distance = core - radii;
+	}
+	else
+	{
+		POINT2 mid = out.pointA + VECTOR2(ab * 0.5f);
+		out.pointA = out.pointB = mid;
+		out.distance = 0.0f;
+	}
+	return out.distance;
+}
+
+bool physics::gjkOverlap(ConvexProxy const & a, ConvexProxy const & b, GJKCache & cache)
+{
+	if (a.count == 0 || b.count == 0)
+		return false;
+
+	Simplex s;
+	VECTOR2 closest;
+	int		iterations;
+
+	if (!run_gjk(a, b, cache, s, closest, iterations, true))
+		return false;
+
+	float radii = a.radius + b.radius;
+	return s.count == 3 || inner_product(closest, closest) <= radii * radii;
+}
+
+bool physics::epaPenetration(ConvexProxy const & a, ConvexProxy const & b, GJKCache & cache,
+							 VECTOR2 & normal, float & depth)
+{
+	if (a.count == 0 || b.count == 0)
+		return false;
+
+	Simplex s;
+	VECTOR2 closest;
+	int		iterations;
+	run_gjk(a, b, cache, s, closest, iterations, false);
+
+	float radii = a.radius + b.radius;
+
+	if (s.count < 3)
+	{
+		// Cores are separate (or touching): only the radii can overlap
+		float core = closest.length();
+		if (core > radii)
+			return false;
+
+		if (core > 1.0e-6f)
+		{
+			normal = VECTOR2(-closest / core);		// closest is a - b, normal points A to B
+			depth = radii - core;
+			return true;
+		}
+
+		// Touching cores: grow the simplex to a triangle so EPA has a polygon
+		VECTOR2 dirs[3] = { VECTOR2(1, 0), VECTOR2(-0.5f, 0.8660254f), VECTOR2(-0.5f, -0.8660254f) };
+		s.count = 0;
+		for (int i = 0; i < 3; ++i)
+			s.set(s.count++, a, b, a.support(dirs[i]), b.support(-dirs[i]));
+	}
+
+	// EPA over the Minkowski difference, starting from the GJK triangle
+	VECTOR2 poly[EPA_MAX_VERTICES];
+	int		n = 3;
+	for (int i = 0; i < 3; ++i)
+		poly[i] = s.v[i].w;
+
+	// Outward edge normals depend on the winding of the triangle
+	float	winding = (perp_product(VECTOR2(poly[1] - poly[0]), VECTOR2(poly[2] - poly[0])) >= 0.0f) ? 1.0f : -1.0f;
+	VECTOR2 best_n(1, 0);
+	float	best_d = 0.0f;
+
+	for (int iter = 0; iter < EPA_MAX_VERTICES; ++iter)
+	{
+		// Edge of the polytope closest to the origin
+		int		edge = 0;
+		best_d = FLT_MAX;
+		for (int i = 0; i < n; ++i)
+		{
+			VECTOR2 e = poly[(i + 1) % n] - poly[i];
+			VECTOR2 en = unit(VECTOR2(e.y * winding, -e.x * winding), VECTOR2(1, 0));
+			float	d = inner_product(en, poly[i]);
+			if (d < best_d)
+			{
+				best_d = d;
+				best_n = en;
+				edge = i;
+			}
+		}
+
+		VECTOR2 w = a.vertex(a.support(best_n)) - b.vertex(b.support(-best_n));
+		float	d = inner_product(w, best_n);
+
+		if (d - best_d < EPA_TOLERANCE || n == EPA_MAX_VERTICES)
+			break;
+
+		// Insert the support point after the closest edge
+		for (int i = n; i > edge + 1; --i)
+			poly[i] = poly[i - 1];
+		poly[edge + 1] = w;
+		++n;
+	}
+
+	// The closest face of A - B: translating A by -best_n * depth separates the cores
+	normal = best_n;
+	depth = best_d + radii;
+	return true;
+}
@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <vector>
 
 #include "math/linear.h"
 #include "math/Geometry.h"
@@ -8,3 +10,125 @@ using math::affine::POINT2;
 using math::linear::MATRIX2;
 using math::linear::VECTOR2;
 using math::linear::SCALAR;
+
+
+
+/*
+ *		ConvexPolygon
+ */
+
+const size_t ConvexPolygon::MAX_VERTICES;
+
+ConvexPolygon::ConvexPolygon(POINT2 const * pts, size_t count)
+	: Polytype(POLYGON_TYPE::CONVEX),
+	  n(0)
+{
+	if (count == 0)
+		return;
+
+	// Andrew's monotone chain; strict turns only so collinear points are dropped
+	std::vector<POINT2> p(pts, pts + count);
+	std::sort(p.begin(), p.end(), [](POINT2 const & a, POINT2 const & b)
+	{
+		return (a.x < b.x) || (a.x == b.x && a.y < b.y);
+	});
+
+	std::vector<POINT2> h(2 * p.size() + 1);
+	size_t k = 0;
+	for (size_t i = 0; i < p.size(); ++i)
+	{
+		while (k >= 2 && perp_product(h[k - 1] - h[k - 2], p[i] - h[k - 2]) <= 0.0f)
+			--k;
+		h[k++] = p[i];
+	}
+	for (size_t i = p.size() - 1, t = k + 1; i-- > 0; )
+	{
+		while (k >= t && perp_product(h[k - 1] - h[k - 2], p[i] - h[k - 2]) <= 0.0f)
+			--k;
+		h[k++] = p[i];
+	}
+	if (k > 1)
+		--k;	// last point repeats the first
+
+	// Too many vertices: drop the one whose removal loses the least area
+	// (the flattest corner) until they fit. The result stays convex and
+	// inside the true hull, rather than being cut off at an arbitrary vertex
+	h.resize(k);
+	while (h.size() > MAX_VERTICES)
+	{
+		size_t	best = 0;
+		float	least = FLT_MAX;
+		for (size_t i = 0; i < h.size(); ++i)
+		{
+			POINT2 const & a = h[(i + h.size() - 1) % h.size()];
+			POINT2 const & c = h[(i + 1) % h.size()];
+			float lost = perp_product(h[i] - a, c - a);
+			if (lost < least)
+			{
+				least = lost;
+				best = i;
+			}
+		}
+		h.erase(h.begin() + best);
+	}
+
+	n = h.size();
+	for (size_t i = 0; i < n; ++i)
+		v[i] = h[i];
+}
+
+POINT2 ConvexPolygon::centre() const
+{
+	float x = 0.0f, y = 0.0f;
+	for (size_t i = 0; i < n; ++i)
+	{
+		x += v[i].x;
+		y += v[i].y;
+	}
+	return (n > 0) ? POINT2(x / n, y / n) : POINT2();
+}
+
+float ConvexPolygon::area() const
+{
+	float a = 0.0f;
+	for (size_t i = 0; i < n; ++i)
+		a += v[i].x * v[(i + 1) % n].y - v[(i + 1) % n].x * v[i].y;
+	return 0.5f * fabs(a);
+}
+
+void ConvexPolygon::translate(VECTOR2 const & d)
+{
+	for (size_t i = 0; i < n; ++i)
+		v[i] += d;
+}
+
+size_t ConvexPolygon::support(VECTOR2 const & d, size_t hint) const
+{
+	if (n == 0)
+		return 0;
+
+	size_t	i = hint % n;
+	float	best = inner_product(VECTOR2(v[i].x, v[i].y), d);
+
+	// Step towards whichever neighbour improves; on a convex polygon the
+	// projection is unimodal around the boundary so this finds the maximum
+	for (;;)
+	{
+		size_t	next = (i + 1) % n, prev = (i + n - 1) % n;
+		float	dn = inner_product(VECTOR2(v[next].x, v[next].y), d);
+		float	dp = inner_product(VECTOR2(v[prev].x, v[prev].y), d);
+
+		if (dn > best && dn >= dp)
+		{
+			i = next;
+			best = dn;
+		}
+		else if (dp > best)
+		{
+			i = prev;
+			best = dp;
+		}
+		else
+			return i;
+	}
+}
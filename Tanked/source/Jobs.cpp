@@ -0,0 +1,406 @@
+/* ********************************************************************************* *
+ * *  File: Jobs.cpp                                                               * *
+ * *  --------------                                                               * *
+ * *  COPYRIGHT NOTICE                                                             * *
+ * *  ----------------                                                             * *
+ * *  (C)[2012] - [2015] Deakin University                                         * *
+ * *  All rights reserved.                                                         * *
+ * *  All information contained herein is, and remains the property of Deakin      * *
+ * *  University and the author (Tim Wilkin).                                      * *
+ * *  Dissemination of this information or reproduction of this material is        * *
+ * *  strictly forbidden unless prior written permission is obtained from Deakin   * *
+ * *  University.The right to create derivative works from this material is        * *
+ * *  hereby granted to students enrolled in SIT255, but only for the purposes of  * *
+ * *  assessment while an enrolled student at Deakin University.                   * *
+ * *                                                                               * *
+ * ********************************************************************************* */
+
+#include <algorithm>
+
+#include "core/Jobs.h"
+
+using namespace core;
+
+namespace {
+
+	const unsigned	SPINS = 64;		// failed takes before a worker sleeps
+
+	// Which scheduler (and which of its workers) this thread belongs to
+	thread_local JobSystem const *	tls_system = 0;
+	thread_local int				tls_index = -1;
+	thread_local uint32_t			tls_seed = 0x9e3779b9u;
+
+	inline uint32_t xorshift(uint32_t & s)
+	{
+		s ^= s << 13;
+		s ^= s >> 17;
+		s ^= s << 5;
+		return s;
+	}
+
+} // close anonymous namespace
+
+/*
+ * WorkQueue
+ */
+
+const size_t WorkQueue::CAPACITY;
+
+WorkQueue::WorkQueue()
+	: top_(0),
+	  bottom_(0)
+{
+	for (size_t i = 0; i < CAPACITY; ++i)
+		items_[i].store(0, std::memory_order_relaxed);
+}
+
+bool WorkQueue::push(Job * job)
+{
+	int64_t b = bottom_.load(std::memory_order_relaxed);
+	int64_t t = top_.load(std::memory_order_acquire);
+	if (b - t >= (int64_t)CAPACITY)
+		return false;
+
+	items_[b & (CAPACITY - 1)].store(job, std::memory_order_relaxed);
+	bottom_.store(b + 1, std::memory_order_release);
+	return true;
+}
+
+Job * WorkQueue::pop()
+{
+	int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+	bottom_.store(b, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t t = top_.load(std::memory_order_relaxed);
+
+	if (t > b)
+	{
+		// empty
+		bottom_.store(b + 1, std::memory_order_relaxed);
+		return 0;
+	}
+
+	Job * job = items_[b & (CAPACITY - 1)].load(std::memory_order_relaxed);
+	if (t == b)
+	{
+		// last item: race any thief for it
+		if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			job = 0;
+		bottom_.store(b + 1, std::memory_order_relaxed);
+	}
+	return job;
+}
+
+Job * WorkQueue::steal()
+{
+	int64_t t = top_.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	int64_t b = bottom_.load(std::memory_order_acquire);
+	if (t >= b)
+		return 0;
+
+	Job * job = items_[t & (CAPACITY - 1)].load(std::memory_order_relaxed);
+	if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+		return 0;
+	return job;
+}
+
+bool WorkQueue::empty() const
+{
+	return bottom_.load(std::memory_order_relaxed) <= top_.load(std::memory_order_relaxed);
+}
+
+/*
+ * JobSystem
+ */
+
+const size_t JobSystem::POOL;
+
+JobSystem & JobSystem::instance()
+{
+	static JobSystem system;
+	return system;
+}
+
+JobSystem::JobSystem(unsigned threads)
+	: shared_size_(0),
+	  epoch_(0),
+	  sleepers_(0),
+	  quit_(false),
+	  stopped_(false)
+{
+	threads = (std::max)(threads, 1u);
+	for (unsigned i = 0; i < threads; ++i)
+	{
+		std::unique_ptr<Worker> w(new Worker);
+		w->pool.reset(new Slot[POOL]);
+		for (size_t s = 0; s < POOL; ++s)
+			w->pool[s].busy.store(false, std::memory_order_relaxed);
+		w->next = 0;
+		w->seed = 0x9e3779b9u * (i + 1);
+		workers_.push_back(std::move(w));
+	}
+
+	tls_system = this;
+	tls_index  = 0;
+
+	for (unsigned i = 1; i < threads; ++i)
+		workers_[i]->thread = std::thread(&JobSystem::loop, this, i);
+}
+
+JobSystem::~JobSystem()
+{
+	shutdown();
+	if (tls_system == this)
+	{
+		tls_system = 0;
+		tls_index  = -1;
+	}
+}
+
+void JobSystem::shutdown()
+{
+	if (stopped_.load(std::memory_order_acquire))
+		return;
+
+	quit_.store(true, std::memory_order_release);
+	{
+		std::lock_guard<std::mutex> lock(sleep_lock_);
+		wake_.notify_all();
+	}
+
+	// Workers leave only once they find nothing left to take
+	for (size_t i = 1; i < workers_.size(); ++i)
+		if (workers_[i]->thread.joinable())
+			workers_[i]->thread.join();
+
+	// Whatever remains was queued by this thread
+	int s = self();
+	Job job;
+	while (take(s, job))
+		execute(job);
+
+	stopped_.store(true, std::memory_order_release);
+}
+
+int JobSystem::self() const
+{
+	return (tls_system == this) ? tls_index : -1;
+}
+
+void JobSystem::submit(Job const & job, Counter * after)
+{
+	if (job.counter)
+		job.counter->value_.fetch_add(1, std::memory_order_relaxed);
+
+	if (after)
+	{
+		// The final release of a counter happens under its lock, so the
+		// job is either parked before it or sees the counter done
+		std::unique_lock<std::mutex> lock(after->lock_);
+		if (after->value_.load(std::memory_order_acquire) > 0)
+		{
+			after->waiting_.push_back(job);
+			return;
+		}
+	}
+
+	enqueue(job);
+}
+
+void JobSystem::wait(Counter & c)
+{
+	int s = self();
+	unsigned idle = 0;
+
+	while (c.value_.load(std::memory_order_acquire) > 0)
+	{
+		Job job;
+		if (take(s, job))
+		{
+			execute(job);
+			idle = 0;
+		}
+		else if (++idle > SPINS)
+			std::this_thread::yield();
+	}
+
+	// The last release may still hold the lock; c must outlive it
+	std::lock_guard<std::mutex> sync(c.lock_);
+}
+
+void JobSystem::hold(Counter & c, int n)
+{
+	c.value_.fetch_add(n, std::memory_order_relaxed);
+}
+
+void JobSystem::signal(Counter & c)
+{
+	release(&c);
+}
+
+void JobSystem::enqueue(Job const & job)
+{
+	int s = self();
+	if (stopped_.load(std::memory_order_acquire))
+	{
+		execute(job);
+		return;
+	}
+
+	if (s < 0)
+	{
+		{
+			std::lock_guard<std::mutex> lock(shared_lock_);
+			shared_.push_back(job);
+		}
+		shared_size_.fetch_add(1, std::memory_order_release);
+		notify();
+		return;
+	}
+
+	// Pool slots are reused in ring order; help out until the oldest is free
+	Worker & w = *workers_[s];
+	Slot & slot = w.pool[w.next++ & (POOL - 1)];
+	while (slot.busy.load(std::memory_order_acquire))
+	{
+		Job other;
+		if (take(s, other))
+			execute(other);
+		else
+			std::this_thread::yield();
+	}
+
+	slot.job = job;
+	slot.busy.store(true, std::memory_order_relaxed);
+	if (!w.queue.push(&slot.job))
+	{
+		slot.busy.store(false, std::memory_order_relaxed);
+		execute(job);
+		return;
+	}
+	notify();
+}
+
+bool JobSystem::take(int s, Job & job)
+{
+	Job * found = 0;
+
+	if (s >= 0)
+		found = workers_[s]->queue.pop();
+
+	if (!found && shared_size_.load(std::memory_order_acquire) > 0)
+	{
+		std::lock_guard<std::mutex> lock(shared_lock_);
+		if (!shared_.empty())
+		{
+			job = shared_.front();
+			shared_.pop_front();
+			shared_size_.fetch_sub(1, std::memory_order_relaxed);
+			return true;
+		}
+	}
+
+	if (!found)
+	{
+		size_t n = workers_.size();
+		size_t start = xorshift(s >= 0 ? workers_[s]->seed : tls_seed) % n;
+		for (size_t i = 0; i < n && !found; ++i)
+		{
+			size_t v = (start + i) % n;
+			if ((int)v != s)
+				found = workers_[v]->queue.steal();
+		}
+	}
+
+	if (!found)
+		return false;
+
+	// Copy the job out and hand its slot back to the owner
+	Slot * slot = reinterpret_cast<Slot *>(found);
+	job = slot->job;
+	slot->busy.store(false, std::memory_order_release);
+	return true;
+}
+
+void JobSystem::execute(Job const & job)
+{
+	job.fn(job);
+	if (job.counter)
+		release(job.counter);
+}
+
+void JobSystem::release(Counter * c)
+{
+	// Only the decrement to zero needs the lock
+	int v = c->value_.load(std::memory_order_relaxed);
+	while (v > 1)
+		if (c->value_.compare_exchange_weak(v, v - 1, std::memory_order_acq_rel, std::memory_order_relaxed))
+			return;
+
+	std::vector<Job> ready;
+	{
+		std::lock_guard<std::mutex> lock(c->lock_);
+		if (c->value_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			ready.swap(c->waiting_);
+	}
+
+	for (size_t i = 0; i < ready.size(); ++i)
+		enqueue(ready[i]);
+}
+
+void JobSystem::notify()
+{
+	epoch_.fetch_add(1, std::memory_order_seq_cst);
+	if (sleepers_.load(std::memory_order_seq_cst) > 0)
+	{
+		std::lock_guard<std::mutex> lock(sleep_lock_);
+		wake_.notify_one();
+	}
+}
+
+void JobSystem::loop(unsigned index)
+{
+	tls_system = this;
+	tls_index  = (int)index;
+
+	unsigned idle = 0;
+	for (;;)
+	{
+		Job job;
+		if (take((int)index, job))
+		{
+			execute(job);
+			idle = 0;
+			continue;
+		}
+
+		if (quit_.load(std::memory_order_acquire))
+			break;
+
+		if (++idle < SPINS)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		// Sleep until something is submitted. The epoch is read before the
+		// last look, so a submit in between is never missed.
+		uint32_t e = epoch_.load(std::memory_order_seq_cst);
+		sleepers_.fetch_add(1, std::memory_order_seq_cst);
+		bool found = take((int)index, job);
+		if (!found)
+		{
+			std::unique_lock<std::mutex> lock(sleep_lock_);
+			wake_.wait(lock, [this, e]()
+			{
+				return epoch_.load(std::memory_order_seq_cst) != e || quit_.load(std::memory_order_acquire);
+			});
+		}
+		sleepers_.fetch_sub(1, std::memory_order_seq_cst);
+
+		if (found)
+			execute(job);
+		idle = 0;
+	}
+}
@@ -0,0 +1,172 @@
+/* ********************************************************************************* *
+ * *  File: LodScheduler.cpp                                                       * *
+ * *  ----------------------                                                       * *
+ * *  COPYRIGHT NOTICE                                                             * *
+ * *  ----------------                                                             * *
+ * *  (C)[2012] - [2015] Deakin University                                         * *
+ * *  All rights reserved.                                                         * *
+ * *  All information contained herein is, and remains the property of Deakin      * *
+ * *  University and the author (Tim Wilkin).                                      * *
+ * *  Dissemination of this information or reproduction of this material is        * *
+ * *  strictly forbidden unless prior written permission is obtained from Deakin   * *
+ * *  University.The right to create derivative works from this material is        * *
+ * *  hereby granted to students enrolled in SIT255, but only for the purposes of  * *
+ * *  assessment while an enrolled student at Deakin University.                   * *
+ * *                                                                               * *
+ * ********************************************************************************* */
+
+#include <cassert>
+#include <cmath>
+
+#include "ai/LodScheduler.h"
+
+using namespace ai;
+
+namespace {
+
+	const uint8_t	UNASSIGNED = 0xff;
+	const float		HYSTERESIS = 1.1f;		// slower tiers start this much further out
+
+	struct Staler
+	{
+		LodScheduler::Tier const *	tiers;
+		uint8_t const *				tier;
+		uint64_t const *			last;
+		uint64_t					now;
+
+		// Fraction of its period an agent has waited; ties by index
+		bool operator()(uint32_t a, uint32_t b) const
+		{
+			float sa = (float)(now - last[a]) / tiers[tier[a]].period,
+				  sb = (float)(now - last[b]) / tiers[tier[b]].period;
+			return sa > sb || (sa == sb && a < b);
+		}
+	};
+
+} // close anonymous namespace
+
+const size_t LodScheduler::MAX_TIERS;
+const size_t LodScheduler::BATCH;
+
+LodScheduler::LodScheduler(float tick_seconds)
+	: tier_count_(0),
+	  tick_seconds_(tick_seconds),
+	  budget_ms_(0.0),
+	  tick_(0)
+{
+	// Full rate near the viewers, then a quarter, a sixteenth, ~1 Hz at 60 Hz
+	Tier tiers[] = { { 400.0f, 1 }, { 1000.0f, 4 }, { 2500.0f, 16 }, { 0.0f, 64 } };
+	setTiers(tiers, sizeof(tiers) / sizeof(tiers[0]));
+}
+
+void LodScheduler::setTiers(Tier const * tiers, size_t n)
+{
+	assert(n > 0 && n <= MAX_TIERS);
+	tier_count_ = n;
+	for (size_t k = 0; k < n; ++k)
+	{
+		tiers_[k] = tiers[k];
+		tiers_[k].period = (std::max)(tiers[k].period, 1u);
+		cursor_[k] = 0;
+	}
+
+	// Re-deal everyone on the next tick
+	std::fill(tier_.begin(), tier_.end(), UNASSIGNED);
+}
+
+void LodScheduler::setViewers(POINT2 const * viewers, size_t n)
+{
+	viewers_.assign(viewers, viewers + n);
+}
+
+uint32_t LodScheduler::add(POINT2 const & position, float importance)
+{
+	x_.push_back(position.x);
+	y_.push_back(position.y);
+	vx_.push_back(0.0f);
+	vy_.push_back(0.0f);
+	stamp_.push_back(tick_);
+	last_.push_back(tick_);
+	importance_.push_back((std::max)(importance, 1.0e-3f));
+	tier_.push_back(UNASSIGNED);
+	bucket_.push_back(0);
+	queued_.push_back(0);
+	return (uint32_t)(x_.size() - 1);
+}
+
+void LodScheduler::setState(uint32_t agent, POINT2 const & position, VECTOR2 const & velocity)
+{
+	x_[agent]	  = position.x;
+	y_[agent]	  = position.y;
+	vx_[agent]	  = velocity.x;
+	vy_[agent]	  = velocity.y;
+	stamp_[agent] = tick_;
+}
+
+POINT2 LodScheduler::position(uint32_t agent) const
+{
+	float t = (float)(tick_ - stamp_[agent]) * tick_seconds_;
+	return POINT2(x_[agent] + vx_[agent] * t, y_[agent] + vy_[agent] * t);
+}
+
+void LodScheduler::classify()
+{
+	next_tier_.resize(x_.size());
+
+	core::parallel_for(0, x_.size(), 1024, [this](size_t first, size_t last)
+	{
+		for (size_t i = first; i < last; ++i)
+		{
+			float t = (float)(tick_ - stamp_[i]) * tick_seconds_;
+			float px = x_[i] + vx_[i] * t,
+				  py = y_[i] + vy_[i] * t;
+
+			// No viewers: everyone is near
+			float d2 = viewers_.empty() ? 0.0f : FLT_MAX;
+			for (size_t v = 0; v < viewers_.size(); ++v)
+			{
+				float dx = px - viewers_[v].x,
+					  dy = py - viewers_[v].y;
+				d2 = (std::min)(d2, dx * dx + dy * dy);
+			}
+			float reach = std::sqrt(d2) / importance_[i];
+
+			uint8_t current = tier_[i];
+			size_t k = 0;
+			for (; k + 1 < tier_count_; ++k)
+				if (reach <= tiers_[k].distance * ((current != UNASSIGNED && k >= (size_t)current) ? HYSTERESIS : 1.0f))
+					break;
+			next_tier_[i] = (uint8_t)k;
+		}
+	});
+}
+
+void LodScheduler::collect()
+{
+	// Carried agents stay flagged until the scan is done so they are not added twice
+	due_.swap(carried_);
+	carried_.clear();
+
+	for (uint32_t i = 0; i < x_.size(); ++i)
+	{
+		uint8_t t = next_tier_[i];
+		if (t != tier_[i])
+		{
+			// Deal into the new tier's buckets round-robin
+			tier_[i]   = t;
+			bucket_[i] = cursor_[t]++ % tiers_[t].period;
+		}
+
+		if (tick_ % tiers_[t].period == bucket_[i] && !queued_[i])
+			due_.push_back(i);
+	}
+
+	for (size_t k = 0; k < due_.size(); ++k)
+		queued_[due_[k]] = 0;
+
+	if (!due_.empty())
+	{
+		Staler order = { tiers_, &tier_[0], &last_[0], tick_ };
+		std::sort(due_.begin(), due_.end(), order);
+	}
+}
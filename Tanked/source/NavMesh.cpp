@@ -0,0 +1,1170 @@
+/* ********************************************************************************* *
+ * *  File: NavMesh.cpp                                                            * *
+ * *  -----------------                                                            * *
+ * *  COPYRIGHT NOTICE                                                             * *
+ * *  ----------------                                                             * *
+ * *  (C)[2012] - [2015] Deakin University                                         * *
+ * *  All rights reserved.                                                         * *
+ * *  All information contained herein is, and remains the property of Deakin      * *
+ * *  University and the author (Tim Wilkin).                                      * *
+ * *  Dissemination of this information or reproduction of this material is        * *
+ * *  strictly forbidden unless prior written permission is obtained from Deakin   * *
+ * *  University.The right to create derivative works from this material is        * *
+ * *  hereby granted to students enrolled in SIT255, but only for the purposes of  * *
+ * *  assessment while an enrolled student at Deakin University.                   * *
+ * *                                                                               * *
+ * ********************************************************************************* */
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+
+#include "ai/NavMesh.h"
+
+using namespace ai;
+
+namespace {
+
+	// Points closer than this (world units) are merged
+	const double	MERGE_DISTANCE = 1e-4;
+
+	// Points closer than this to a line are on it
+	const double	EDGE_DISTANCE = 1e-6;
+
+	struct DPoint
+	{
+		double	x, y;
+
+		DPoint()
+			: x(0.0), y(0.0)
+		{}
+
+		DPoint(double _x, double _y)
+			: x(_x), y(_y)
+		{}
+	};
+
+	inline double orient(DPoint const & a, DPoint const & b, DPoint const & c)
+	{
+		return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+	}
+
+	inline double length(DPoint const & a, DPoint const & b)
+	{
+		return sqrt((b.x - a.x) * (b.x - a.x) + (b.y - a.y) * (b.y - a.y));
+	}
+
+	/*
+	 * True if d lies inside the circumcircle of the counter clockwise
+	 * triangle abc, by more than the rounding error of the determinant.
+	 * The tolerance keeps co-circular points from flipping back and forth.
+	 */
+	bool in_circle(DPoint const & a, DPoint const & b, DPoint const & c, DPoint const & d)
+	{
+		double adx = a.x - d.x, ady = a.y - d.y;
+		double bdx = b.x - d.x, bdy = b.y - d.y;
+		double cdx = c.x - d.x, cdy = c.y - d.y;
+		double ad = adx * adx + ady * ady;
+		double bd = bdx * bdx + bdy * bdy;
+		double cd = cdx * cdx + cdy * cdy;
+
+		double det = adx * (bdy * cd - bd * cdy) - ady * (bdx * cd - bd * cdx) + ad * (bdx * cdy - bdy * cdx);
+		double mag = fabs(adx) * (fabs(bdy) * cd + bd * fabs(cdy)) +
+					 fabs(ady) * (fabs(bdx) * cd + bd * fabs(cdx)) +
+					 ad * (fabs(bdx) * fabs(cdy) + fabs(bdy) * fabs(cdx));
+		return det > 1e-10 * mag;
+	}
+
+	// Segments ab and pq cross at a point interior to both
+	inline bool crosses(DPoint const & a, DPoint const & b, DPoint const & p, DPoint const & q)
+	{
+		double o1 = orient(a, b, p), o2 = orient(a, b, q);
+		double o3 = orient(p, q, a), o4 = orient(p, q, b);
+		return ((o1 > 0.0 && o2 < 0.0) || (o1 < 0.0 && o2 > 0.0)) &&
+			   ((o3 > 0.0 && o4 < 0.0) || (o3 < 0.0 && o4 > 0.0));
+	}
+
+	/*
+	 * Triangulator	Constrained Delaunay triangulation of one rectangle.
+	 *
+	 * Points are inserted by splitting the containing triangle (or edge) and
+	 * restoring the Delaunay property with Lawson flips. Constraints are
+	 * inserted by flipping away the edges they cross (Sloan) and then
+	 * re-legalising the new edges; vertices on a constraint and crossings
+	 * with earlier constraints split it first. Tiles are small, so edges and
+	 * containing triangles are found by scanning.
+	 */
+	class Triangulator
+	{
+		public:
+			struct Tri
+			{
+				int		v[3];
+				int		adj[3];
+				bool	fixed[3];
+				bool	alive;
+			};
+
+			std::vector<DPoint>	pts;
+			std::vector<Tri>	tris;
+
+			void	init(double x0, double y0, double x1, double y1);
+			int		insertPoint(DPoint const & p);
+			void	insertSegment(int a, int b, int depth = 0);
+
+		private:
+			struct Border
+			{
+				int		p, q, ext;
+				bool	fixed;
+			};
+
+			typedef std::pair<int, int>	Edge;
+
+			int		find(int u, int v, int & e) const;
+			void	fix(int a, int b);
+			void	relink(int ext, int u, int v, int t);
+			void	set(int t, int a, int b, int c, int n0, int n1, int n2, bool f0, bool f1, bool f2);
+			void	fan(int n, std::vector<Border> const & border, bool closed, std::vector<int> const & reuse,
+						std::vector<Edge> & check);
+			void	flip(int t, int e);
+			void	legalise(std::vector<Edge> & check);
+	};
+
+	void Triangulator::init(double x0, double y0, double x1, double y1)
+	{
+		pts.clear();
+		pts.push_back(DPoint(x0, y0));
+		pts.push_back(DPoint(x1, y0));
+		pts.push_back(DPoint(x1, y1));
+		pts.push_back(DPoint(x0, y1));
+
+		tris.assign(2, Tri());
+		set(0, 0, 1, 2, -1, -1, 1, false, false, false);
+		set(1, 0, 2, 3, 0, -1, -1, false, false, false);
+	}
+
+	void Triangulator::set(int t, int a, int b, int c, int n0, int n1, int n2, bool f0, bool f1, bool f2)
+	{
+		Tri & r = tris[t];
+		r.v[0] = a;		r.v[1] = b;		r.v[2] = c;
+		r.adj[0] = n0;	r.adj[1] = n1;	r.adj[2] = n2;
+		r.fixed[0] = f0; r.fixed[1] = f1; r.fixed[2] = f2;
+		r.alive = true;
+	}
+
+	int Triangulator::find(int u, int v, int & e) const
+	{
+		for (size_t t = 0; t < tris.size(); ++t)
+		{
+			if (!tris[t].alive)
+				continue;
+			for (int i = 0; i < 3; ++i)
+				if (tris[t].v[i] == u && tris[t].v[(i + 1) % 3] == v)
+				{
+					e = i;
+					return (int)t;
+				}
+		}
+		return -1;
+	}
+
+	void Triangulator::relink(int ext, int u, int v, int t)
+	{
+		// ext holds the edge u->v reversed
+		if (ext < 0)
+			return;
+		for (int i = 0; i < 3; ++i)
+			if (tris[ext].v[i] == v && tris[ext].v[(i + 1) % 3] == u)
+				tris[ext].adj[i] = t;
+	}
+
+	void Triangulator::fan(int n, std::vector<Border> const & border, bool closed, std::vector<int> const & reuse,
+						   std::vector<Edge> & check)
+	{
+		size_t k = border.size();
+		std::vector<int> ids(k);
+		for (size_t j = 0; j < k; ++j)
+		{
+			if (j < reuse.size())
+				ids[j] = reuse[j];
+			else
+			{
+				ids[j] = (int)tris.size();
+				tris.push_back(Tri());
+			}
+		}
+
+		for (size_t j = 0; j < k; ++j)
+		{
+			int next = (j + 1 < k) ? ids[j + 1] : (closed ? ids[0] : -1);
+			int prev = (j > 0) ? ids[j - 1] : (closed ? ids[k - 1] : -1);
+			set(ids[j], border[j].p, border[j].q, n, border[j].ext, next, prev, border[j].fixed, false, false);
+			relink(border[j].ext, border[j].p, border[j].q, ids[j]);
+			check.push_back(Edge(border[j].p, border[j].q));
+		}
+	}
+
+	int Triangulator::insertPoint(DPoint const & p)
+	{
+		for (size_t i = 0; i < pts.size(); ++i)
+			if (length(pts[i], p) < MERGE_DISTANCE)
+				return (int)i;
+
+		// Containing triangle: the one whose nearest edge line is least behind p
+		int		t = -1;
+		double	best = -1e300;
+		for (size_t i = 0; i < tris.size(); ++i)
+		{
+			if (!tris[i].alive)
+				continue;
+			double m = 1e300;
+			for (int k = 0; k < 3; ++k)
+			{
+				DPoint const & a = pts[tris[i].v[k]];
+				DPoint const & b = pts[tris[i].v[(k + 1) % 3]];
+				m = math::min(m, orient(a, b, p) / length(a, b));
+			}
+			if (m > best)
+			{
+				best = m;
+				t = (int)i;
+			}
+		}
+
+		int edge = -1;
+		double nearest = EDGE_DISTANCE;
+		for (int k = 0; k < 3; ++k)
+		{
+			DPoint const & a = pts[tris[t].v[k]];
+			DPoint const & b = pts[tris[t].v[(k + 1) % 3]];
+			double d = fabs(orient(a, b, p)) / length(a, b);
+			if (d < nearest)
+			{
+				nearest = d;
+				edge = k;
+			}
+		}
+
+		int n = (int)pts.size();
+		pts.push_back(p);
+
+		Tri const			r = tris[t];
+		std::vector<Border>	border;
+		std::vector<int>	reuse(1, t);
+		std::vector<Edge>	check;
+		tris[t].alive = false;
+
+		if (edge < 0)
+		{
+			for (int k = 0; k < 3; ++k)
+			{
+				Border b = { r.v[k], r.v[(k + 1) % 3], r.adj[k], r.fixed[k] };
+				border.push_back(b);
+			}
+			fan(n, border, true, reuse, check);
+		}
+		else
+		{
+			// Split the edge a->b and the triangle beyond it, if any
+			int a = r.v[edge], b = r.v[(edge + 1) % 3], c = r.v[(edge + 2) % 3];
+			int o = r.adj[edge];
+
+			Border bc = { b, c, r.adj[(edge + 1) % 3], r.fixed[(edge + 1) % 3] };
+			Border ca = { c, a, r.adj[(edge + 2) % 3], r.fixed[(edge + 2) % 3] };
+			border.push_back(bc);
+			border.push_back(ca);
+
+			if (o >= 0)
+			{
+				int j = 0;
+				while (!(tris[o].v[j] == b && tris[o].v[(j + 1) % 3] == a))
+					++j;
+				Tri const s = tris[o];
+				int d = s.v[(j + 2) % 3];
+				Border ad = { a, d, s.adj[(j + 1) % 3], s.fixed[(j + 1) % 3] };
+				Border db = { d, b, s.adj[(j + 2) % 3], s.fixed[(j + 2) % 3] };
+				border.push_back(ad);
+				border.push_back(db);
+				tris[o].alive = false;
+				reuse.push_back(o);
+			}
+			fan(n, border, o >= 0, reuse, check);
+
+			// The two halves of a constrained edge stay constrained
+			if (r.fixed[edge])
+			{
+				fix(a, n);
+				fix(n, b);
+			}
+		}
+
+		legalise(check);
+		return n;
+	}
+
+	void Triangulator::flip(int t, int e)
+	{
+		Tri const r = tris[t];
+		int o = r.adj[e];
+		int a = r.v[e], b = r.v[(e + 1) % 3], c = r.v[(e + 2) % 3];
+
+		int j = 0;
+		while (!(tris[o].v[j] == b && tris[o].v[(j + 1) % 3] == a))
+			++j;
+		Tri const s = tris[o];
+		int d = s.v[(j + 2) % 3];
+
+		int		n_bc = r.adj[(e + 1) % 3], n_ca = r.adj[(e + 2) % 3];
+		bool	f_bc = r.fixed[(e + 1) % 3], f_ca = r.fixed[(e + 2) % 3];
+		int		n_ad = s.adj[(j + 1) % 3], n_db = s.adj[(j + 2) % 3];
+		bool	f_ad = s.fixed[(j + 1) % 3], f_db = s.fixed[(j + 2) % 3];
+
+		// abc + bad  ->  adc + dbc
+		set(t, a, d, c, n_ad, o, n_ca, f_ad, false, f_ca);
+		set(o, d, b, c, n_db, n_bc, t, f_db, f_bc, false);
+
+		relink(n_ad, a, d, t);
+		relink(n_ca, c, a, t);
+		relink(n_db, d, b, o);
+		relink(n_bc, b, c, o);
+	}
+
+	void Triangulator::legalise(std::vector<Edge> & check)
+	{
+		size_t guard = 64 * (check.size() + tris.size());
+		while (!check.empty() && guard-- > 0)
+		{
+			Edge ed = check.back();
+			check.pop_back();
+
+			int e;
+			int t = find(ed.first, ed.second, e);
+			if (t < 0 || tris[t].fixed[e] || tris[t].adj[e] < 0)
+				continue;
+
+			int o = tris[t].adj[e];
+			int a = tris[t].v[e], b = tris[t].v[(e + 1) % 3], c = tris[t].v[(e + 2) % 3];
+			int d = -1;
+			for (int j = 0; j < 3; ++j)
+				if (tris[o].v[j] != a && tris[o].v[j] != b)
+					d = tris[o].v[j];
+
+			if (!in_circle(pts[a], pts[b], pts[c], pts[d]))
+				continue;
+
+			flip(t, e);
+			check.push_back(Edge(a, d));
+			check.push_back(Edge(d, b));
+			check.push_back(Edge(b, c));
+			check.push_back(Edge(c, a));
+		}
+	}
+
+	void Triangulator::insertSegment(int a, int b, int depth)
+	{
+		if (a == b || depth > 32)
+			return;
+
+		DPoint const A = pts[a], B = pts[b];
+		double len = length(A, B);
+
+		// Vertices on the segment split it
+		std::vector<std::pair<double, int>> on;
+		for (size_t i = 0; i < pts.size(); ++i)
+		{
+			if ((int)i == a || (int)i == b)
+				continue;
+			if (fabs(orient(A, B, pts[i])) / len >= EDGE_DISTANCE)
+				continue;
+			double t = ((pts[i].x - A.x) * (B.x - A.x) + (pts[i].y - A.y) * (B.y - A.y)) / (len * len);
+			if (t > 0.0 && t < 1.0)
+				on.push_back(std::make_pair(t, (int)i));
+		}
+		if (!on.empty())
+		{
+			std::sort(on.begin(), on.end());
+			int from = a;
+			for (size_t i = 0; i < on.size(); ++i)
+			{
+				insertSegment(from, on[i].second, depth + 1);
+				from = on[i].second;
+			}
+			insertSegment(from, b, depth + 1);
+			return;
+		}
+
+		// Crossing an earlier constraint: split both at the crossing
+		for (size_t t = 0; t < tris.size(); ++t)
+		{
+			if (!tris[t].alive)
+				continue;
+			for (int e = 0; e < 3; ++e)
+			{
+				int u = tris[t].v[e], w = tris[t].v[(e + 1) % 3];
+				if (!tris[t].fixed[e] || u == a || u == b || w == a || w == b || !crosses(A, B, pts[u], pts[w]))
+					continue;
+
+				DPoint const & P = pts[u];
+				DPoint const & Q = pts[w];
+				double s = orient(P, Q, A) / (orient(P, Q, A) - orient(P, Q, B));
+				int m = insertPoint(DPoint(A.x + (B.x - A.x) * s, A.y + (B.y - A.y) * s));
+				if (m == a || m == b)
+					continue;
+				insertSegment(a, m, depth + 1);
+				insertSegment(m, b, depth + 1);
+				return;
+			}
+		}
+
+		int e;
+		std::vector<Edge> created;
+		if (find(a, b, e) < 0)
+		{
+			// Flip away every edge crossing ab (Sloan)
+			std::deque<Edge> cross;
+			for (size_t i = 0; i < tris.size(); ++i)
+			{
+				if (!tris[i].alive)
+					continue;
+				for (int k = 0; k < 3; ++k)
+				{
+					int u = tris[i].v[k], w = tris[i].v[(k + 1) % 3];
+					if (u < w && tris[i].adj[k] >= 0 && crosses(A, B, pts[u], pts[w]))
+						cross.push_back(Edge(u, w));
+				}
+			}
+
+			size_t guard = 64 * cross.size() + 256;
+			while (!cross.empty() && guard-- > 0)
+			{
+				Edge ed = cross.front();
+				cross.pop_front();
+
+				int k;
+				int r = find(ed.first, ed.second, k);
+				if (r < 0 || tris[r].adj[k] < 0)
+					continue;
+
+				int o = tris[r].adj[k];
+				int u = tris[r].v[k], w = tris[r].v[(k + 1) % 3], c = tris[r].v[(k + 2) % 3];
+				int d = -1;
+				for (int j = 0; j < 3; ++j)
+					if (tris[o].v[j] != u && tris[o].v[j] != w)
+						d = tris[o].v[j];
+
+				// Only a strictly convex quad can be flipped
+				double o1 = orient(pts[c], pts[d], pts[u]), o2 = orient(pts[c], pts[d], pts[w]);
+				if (!((o1 > 0.0 && o2 < 0.0) || (o1 < 0.0 && o2 > 0.0)))
+				{
+					cross.push_back(ed);
+					continue;
+				}
+
+				flip(r, k);
+				if (c != a && c != b && d != a && d != b && crosses(A, B, pts[c], pts[d]))
+					cross.push_back(Edge(c, d));
+				else
+					created.push_back(Edge(c, d));
+			}
+		}
+
+		fix(a, b);
+		legalise(created);
+	}
+
+	void Triangulator::fix(int a, int b)
+	{
+		// Both sides, so that neither can be flipped
+		int e;
+		int t = find(a, b, e);
+		if (t >= 0)
+			tris[t].fixed[e] = true;
+		t = find(b, a, e);
+		if (t >= 0)
+			tris[t].fixed[e] = true;
+	}
+
+	/*
+	 * Clip the wall to the closed rectangle. A clipped end lies exactly on
+	 * the rectangle side it was clipped against, and is computed only from
+	 * the wall and that side, so neighbouring tiles agree on it bit for bit.
+	 */
+	bool clip_wall(Segment const & s, AABB const & r, POINT2 & p, POINT2 & q)
+	{
+		float ax = s.start().x, ay = s.start().y;
+		float dx = s.end().x - ax, dy = s.end().y - ay;
+		float t0 = 0.0f, t1 = 1.0f;
+		int plane0 = -1, plane1 = -1;
+
+		float const	bound[4] = { r.lo.x, r.hi.x, r.lo.y, r.hi.y };
+		float const	pk[4] = { -dx, dx, -dy, dy };
+		float const	qk[4] = { ax - r.lo.x, r.hi.x - ax, ay - r.lo.y, r.hi.y - ay };
+
+		for (int k = 0; k < 4; ++k)
+		{
+			if (pk[k] == 0.0f)
+			{
+				if (qk[k] < 0.0f)
+					return false;
+				continue;
+			}
+			float t = (k < 2) ? (bound[k] - ax) / dx : (bound[k] - ay) / dy;
+			if (pk[k] < 0.0f)
+			{
+				if (t > t0)
+				{
+					t0 = t;
+					plane0 = k;
+				}
+			}
+			else if (t < t1)
+			{
+				t1 = t;
+				plane1 = k;
+			}
+		}
+		if (t0 > t1)
+			return false;
+
+		p = (plane0 < 0) ? s.start()
+						 : (plane0 < 2 ? POINT2(bound[plane0], ay + dy * t0) : POINT2(ax + dx * t0, bound[plane0]));
+		q = (plane1 < 0) ? s.end()
+						 : (plane1 < 2 ? POINT2(bound[plane1], ay + dy * t1) : POINT2(ax + dx * t1, bound[plane1]));
+		return true;
+	}
+
+	inline double orientf(POINT2 const & a, POINT2 const & b, POINT2 const & c)
+	{
+		return ((double)b.x - a.x) * ((double)c.y - a.y) - ((double)b.y - a.y) * ((double)c.x - a.x);
+	}
+
+	inline float distance_sqr(POINT2 const & p, POINT2 const & a, POINT2 const & b)
+	{
+		float ex = b.x - a.x, ey = b.y - a.y;
+		float px = p.x - a.x, py = p.y - a.y;
+		float ee = ex * ex + ey * ey;
+		float u = (ee > 0.0f) ? math::clamp((px * ex + py * ey) / ee, 0.0f, 1.0f) : 0.0f;
+		px -= ex * u;
+		py -= ey * u;
+		return px * px + py * py;
+	}
+
+} // close anonymous namespace
+
+const int NavMesh::GRID_PER_TILE;
+
+NavMesh::NavMesh()
+	: tile_(1.0f),
+	  tw_(0),
+	  th_(0),
+	  grid_cell_(1.0f),
+	  gw_(0),
+	  gh_(0),
+	  version_(0)
+{}
+
+AABB NavMesh::tileRect(int tx, int ty) const
+{
+	// Shared sides come from the same expression, so neighbours agree exactly
+	float x0 = area_.lo.x + tx * tile_, y0 = area_.lo.y + ty * tile_;
+	float x1 = (tx + 1 == tw_) ? area_.hi.x : area_.lo.x + (tx + 1) * tile_;
+	float y1 = (ty + 1 == th_) ? area_.hi.y : area_.lo.y + (ty + 1) * tile_;
+	return AABB(POINT2(x0, y0), POINT2(x1, y1));
+}
+
+void NavMesh::tileRange(AABB const & region, int & x0, int & y0, int & x1, int & y1) const
+{
+	// Closed tiles: a region ending on a tile side also touches the tile beyond it
+	x0 = math::clamp((int)ceil((region.lo.x - area_.lo.x) / tile_) - 1, 0, tw_ - 1);
+	y0 = math::clamp((int)ceil((region.lo.y - area_.lo.y) / tile_) - 1, 0, th_ - 1);
+	x1 = math::clamp((int)floor((region.hi.x - area_.lo.x) / tile_), 0, tw_ - 1);
+	y1 = math::clamp((int)floor((region.hi.y - area_.lo.y) / tile_), 0, th_ - 1);
+}
+
+AABB NavMesh::tileBounds(AABB const & region) const
+{
+	if (tiles_.empty() || region.empty())
+		return AABB();
+
+	int x0, y0, x1, y1;
+	tileRange(region, x0, y0, x1, y1);
+
+	AABB b = tileRect(x0, y0);
+	b.grow(tileRect(x1, y1));
+	return b;
+}
+
+void NavMesh::build(std::vector<Segment> const & walls, AABB const & area, float tile)
+{
+	area_ = area;
+	tile_ = tile;
+	tw_ = math::max(1, (int)ceil((area.hi.x - area.lo.x) / tile));
+	th_ = math::max(1, (int)ceil((area.hi.y - area.lo.y) / tile));
+
+	verts_.clear();
+	tris_.clear();
+	free_tris_.clear();
+	free_verts_.clear();
+	tiles_.assign((size_t)tw_ * th_, Tile());
+
+	grid_cell_ = tile_ / GRID_PER_TILE;
+	gw_ = tw_ * GRID_PER_TILE;
+	gh_ = th_ * GRID_PER_TILE;
+	grid_.assign((size_t)gw_ * gh_, -1);
+
+	for (int ty = 0; ty < th_; ++ty)
+		for (int tx = 0; tx < tw_; ++tx)
+			buildTile(tx, ty, walls);
+	for (int ty = 0; ty < th_; ++ty)
+		for (int tx = 0; tx < tw_; ++tx)
+			stitch(tx, ty);
+
+	classify();
+	++version_;
+}
+
+void NavMesh::update(std::vector<Segment> const & walls, AABB const & region)
+{
+	if (tiles_.empty() || region.empty())
+		return;
+
+	int x0, y0, x1, y1;
+	tileRange(region, x0, y0, x1, y1);
+
+	// Regions reaching into the rebuilt tiles are forgotten; the triangles
+	// just outside that bordered them are where their remains are found
+	std::vector<uint8_t>	cut(regions_.size(), 0);
+	std::vector<int32_t>	border, seeds;
+	for (int ty = y0; ty <= y1; ++ty)
+		for (int tx = x0; tx <= x1; ++tx)
+		{
+			Tile const & tile = tiles_[ty * tw_ + tx];
+			for (size_t i = 0; i < tile.tris.size(); ++i)
+			{
+				Tri const & t = tris_[tile.tris[i]];
+				cut[region_[tile.tris[i]]] = 1;
+				for (int e = 0; e < 3; ++e)
+				{
+					if (t.adj[e] < 0)
+						continue;
+					int nx = tris_[t.adj[e]].tile % tw_, ny = tris_[t.adj[e]].tile / tw_;
+					if (nx < x0 || nx > x1 || ny < y0 || ny > y1)
+						border.push_back(t.adj[e]);
+				}
+			}
+		}
+
+	for (int ty = y0; ty <= y1; ++ty)
+		for (int tx = x0; tx <= x1; ++tx)
+			clearTile(tx, ty);
+	for (int ty = y0; ty <= y1; ++ty)
+		for (int tx = x0; tx <= x1; ++tx)
+			buildTile(tx, ty, walls);
+	for (int ty = y0; ty <= y1; ++ty)
+		for (int tx = x0; tx <= x1; ++tx)
+			stitch(tx, ty);
+
+	region_.resize(tris_.size(), -1);
+	for (int ty = y0; ty <= y1; ++ty)
+		for (int tx = x0; tx <= x1; ++tx)
+		{
+			Tile const & tile = tiles_[ty * tw_ + tx];
+			for (size_t i = 0; i < tile.tris.size(); ++i)
+			{
+				region_[tile.tris[i]] = -1;
+				seeds.push_back(tile.tris[i]);
+			}
+		}
+
+	// Unlabel what is left of the cut regions outside; it may have been split
+	// off by a new wall or joined to something else by a removed one
+	size_t first = seeds.size();
+	for (size_t i = 0; i < border.size(); ++i)
+	{
+		int32_t b = border[i];
+		if (region_[b] >= 0 && cut[region_[b]])
+		{
+			region_[b] = -1;
+			seeds.push_back(b);
+		}
+	}
+	for (size_t i = first; i < seeds.size(); ++i)
+	{
+		Tri const & t = tris_[seeds[i]];
+		for (int e = 0; e < 3; ++e)
+		{
+			int32_t n = t.adj[e];
+			if (!(t.edge[e] & EDGE_WALL) && n >= 0 && region_[n] >= 0 && cut[region_[n]])
+			{
+				region_[n] = -1;
+				seeds.push_back(n);
+			}
+		}
+	}
+	for (size_t r = 0; r < cut.size(); ++r)
+		if (cut[r])
+			freeRegion((int32_t)r);
+
+	// Walkability is a property of whole regions, which may reach far outside
+	reclassify(seeds);
+	++version_;
+}
+
+void NavMesh::terrainChanged(level::Terrain const & terrain, AABB const & region)
+{
+	std::vector<Segment> walls;
+	terrain.wallsNear(tileBounds(region), walls);
+	update(walls, region);
+}
+
+void NavMesh::clearTile(int tx, int ty)
+{
+	int		id = ty * tw_ + tx;
+	Tile &	tile = tiles_[id];
+
+	for (size_t i = 0; i < tile.tris.size(); ++i)
+	{
+		int32_t t = tile.tris[i];
+		for (int e = 0; e < 3; ++e)
+		{
+			int32_t n = tris_[t].adj[e];
+			if (n < 0 || tris_[n].tile == id)
+				continue;
+			for (int k = 0; k < 3; ++k)
+				if (tris_[n].adj[k] == t)
+					tris_[n].adj[k] = -1;
+		}
+		tris_[t].flags = 0;
+		region_[t] = -1;
+		free_tris_.push_back(t);
+	}
+	free_verts_.insert(free_verts_.end(), tile.verts.begin(), tile.verts.end());
+	tile.tris.clear();
+	tile.verts.clear();
+}
+
+void NavMesh::buildTile(int tx, int ty, std::vector<Segment> const & walls)
+{
+	int		id = ty * tw_ + tx;
+	AABB	rect = tileRect(tx, ty);
+
+	Triangulator tr;
+	tr.init(rect.lo.x, rect.lo.y, rect.hi.x, rect.hi.y);
+
+	// Walls clipped to the tile; end points first, then the constraints
+	std::vector<POINT2>		cp, cq;
+	std::vector<size_t>		source;
+	for (size_t i = 0; i < walls.size(); ++i)
+	{
+		POINT2 p, q;
+		if (!AABB(walls[i]).overlaps(rect) || !clip_wall(walls[i], rect, p, q))
+			continue;
+		cp.push_back(p);
+		cq.push_back(q);
+		source.push_back(i);
+	}
+
+	std::vector<int> ia(cp.size()), ib(cp.size());
+	for (size_t i = 0; i < cp.size(); ++i)
+	{
+		ia[i] = tr.insertPoint(DPoint(cp[i].x, cp[i].y));
+		ib[i] = tr.insertPoint(DPoint(cq[i].x, cq[i].y));
+	}
+	for (size_t i = 0; i < cp.size(); ++i)
+		tr.insertSegment(ia[i], ib[i]);
+
+	// Copy out into the shared arrays
+	Tile & tile = tiles_[id];
+	std::vector<int32_t> vmap(tr.pts.size()), tmap(tr.tris.size(), -1);
+	for (size_t i = 0; i < tr.pts.size(); ++i)
+	{
+		int32_t v;
+		if (!free_verts_.empty())
+		{
+			v = free_verts_.back();
+			free_verts_.pop_back();
+		}
+		else
+		{
+			v = (int32_t)verts_.size();
+			verts_.push_back(POINT2());
+		}
+		verts_[v] = POINT2((float)tr.pts[i].x, (float)tr.pts[i].y);
+		vmap[i] = v;
+		tile.verts.push_back(v);
+	}
+	for (size_t i = 0; i < tr.tris.size(); ++i)
+	{
+		if (!tr.tris[i].alive)
+			continue;
+		int32_t t;
+		if (!free_tris_.empty())
+		{
+			t = free_tris_.back();
+			free_tris_.pop_back();
+		}
+		else
+		{
+			t = (int32_t)tris_.size();
+			tris_.push_back(Tri());
+		}
+		tmap[i] = t;
+		tile.tris.push_back(t);
+	}
+
+	for (size_t i = 0; i < tr.tris.size(); ++i)
+	{
+		if (tmap[i] < 0)
+			continue;
+
+		Triangulator::Tri const & s = tr.tris[i];
+		Tri & t = tris_[tmap[i]];
+		t.tile = id;
+		t.flags = TRI_ALIVE;
+		for (int e = 0; e < 3; ++e)
+		{
+			t.v[e] = vmap[s.v[e]];
+			t.adj[e] = (s.adj[e] >= 0) ? tmap[s.adj[e]] : -1;
+			t.edge[e] = (s.adj[e] < 0) ? EDGE_TILE : 0;
+		}
+
+		POINT2 c = centroid(tmap[i]);
+		for (int e = 0; e < 3; ++e)
+		{
+			if (!s.fixed[e])
+				continue;
+
+			// The wall this edge lies on decides which side is its front
+			POINT2 const & a = verts_[t.v[e]];
+			POINT2 const & b = verts_[t.v[(e + 1) % 3]];
+			POINT2 mid((a.x + b.x) * 0.5f, (a.y + b.y) * 0.5f);
+			size_t best = 0;
+			float best_d = FLT_MAX;
+			for (size_t k = 0; k < cp.size(); ++k)
+			{
+				float d = distance_sqr(mid, cp[k], cq[k]);
+				if (d < best_d)
+				{
+					best_d = d;
+					best = k;
+				}
+			}
+
+			t.edge[e] |= EDGE_WALL;
+			if (!cp.empty())
+			{
+				VECTOR2 const & n = walls[source[best]].normal();
+				if ((c.x - mid.x) * n.x + (c.y - mid.y) * n.y > 0.0f)
+					t.edge[e] |= EDGE_FRONT;
+			}
+		}
+	}
+
+	// Point location starts for the grid cells of this tile
+	for (int gy = ty * GRID_PER_TILE; gy < (ty + 1) * GRID_PER_TILE; ++gy)
+		for (int gx = tx * GRID_PER_TILE; gx < (tx + 1) * GRID_PER_TILE; ++gx)
+		{
+			POINT2 p(area_.lo.x + (gx + 0.5f) * grid_cell_, area_.lo.y + (gy + 0.5f) * grid_cell_);
+			int32_t	found = tile.tris.empty() ? -1 : tile.tris[0];
+			double	best = -1e300;
+			for (size_t i = 0; i < tile.tris.size(); ++i)
+			{
+				Tri const & t = tris_[tile.tris[i]];
+				double m = math::min(orientf(verts_[t.v[0]], verts_[t.v[1]], p),
+							math::min(orientf(verts_[t.v[1]], verts_[t.v[2]], p), orientf(verts_[t.v[2]], verts_[t.v[0]], p)));
+				if (m > best)
+				{
+					best = m;
+					found = tile.tris[i];
+				}
+			}
+			grid_[(size_t)gy * gw_ + gx] = found;
+		}
+}
+
+void NavMesh::stitch(int tx, int ty)
+{
+	int		id = ty * tw_ + tx;
+	Tile &	tile = tiles_[id];
+	AABB	rect = tileRect(tx, ty);
+
+	for (size_t i = 0; i < tile.tris.size(); ++i)
+	{
+		int32_t t = tile.tris[i];
+		for (int e = 0; e < 3; ++e)
+		{
+			if (!(tris_[t].edge[e] & EDGE_TILE) || tris_[t].adj[e] >= 0)
+				continue;
+
+			POINT2 const & a = verts_[tris_[t].v[e]];
+			POINT2 const & b = verts_[tris_[t].v[(e + 1) % 3]];
+
+			// Neighbouring tile across the side this edge lies on
+			int nx = tx, ny = ty;
+			if (a.x == rect.lo.x && b.x == rect.lo.x)		--nx;
+			else if (a.x == rect.hi.x && b.x == rect.hi.x)	++nx;
+			else if (a.y == rect.lo.y && b.y == rect.lo.y)	--ny;
+			else if (a.y == rect.hi.y && b.y == rect.hi.y)	++ny;
+			if ((nx == tx && ny == ty) || nx < 0 || ny < 0 || nx >= tw_ || ny >= th_)
+				continue;
+
+			Tile const & other = tiles_[ny * tw_ + nx];
+			for (size_t j = 0; j < other.tris.size(); ++j)
+			{
+				int32_t u = other.tris[j];
+				for (int k = 0; k < 3; ++k)
+				{
+					if (!(tris_[u].edge[k] & EDGE_TILE))
+						continue;
+					POINT2 const & c = verts_[tris_[u].v[k]];
+					POINT2 const & d = verts_[tris_[u].v[(k + 1) % 3]];
+					if (c.x == b.x && c.y == b.y && d.x == a.x && d.y == a.y)
+					{
+						tris_[t].adj[e] = u;
+						tris_[u].adj[k] = t;
+					}
+				}
+			}
+		}
+	}
+}
+
+void NavMesh::classify()
+{
+	// Label regions connected across non-wall edges
+	region_.assign(tris_.size(), -1);
+	regions_.clear();
+	free_regions_.clear();
+
+	std::vector<int32_t> painted;
+	for (size_t s = 0; s < tris_.size(); ++s)
+	{
+		if (!(tris_[s].flags & TRI_ALIVE) || region_[s] >= 0)
+			continue;
+		painted.clear();
+		flood((int32_t)s, newRegion(), painted, 0);
+	}
+
+	for (size_t s = 0; s < tris_.size(); ++s)
+		if (tris_[s].flags & TRI_ALIVE)
+			setWalkable((int32_t)s);
+}
+
+void NavMesh::reclassify(std::vector<int32_t> const & seeds)
+{
+	std::vector<int32_t> painted, met;
+	for (size_t i = 0; i < seeds.size(); ++i)
+	{
+		int32_t s = seeds[i];
+		if (region_[s] >= 0)
+			continue;
+
+		int32_t r = newRegion();
+		painted.clear();
+		met.clear();
+		flood(s, r, painted, &met);
+
+		// Join the labelled regions the flood ran into, relabelling the smaller
+		// side. At most one of them keeps its triangles, and its old flags
+		bool kept = false, kept_walkable = false;
+		for (size_t k = 0; k < met.size(); ++k)
+		{
+			int32_t m = region_[met[k]];
+			if (m == r)
+				continue;
+
+			Region & a = regions_[r];
+			Region & b = regions_[m];
+			if (b.size > a.size)
+			{
+				kept = true;
+				kept_walkable = (tris_[met[k]].flags & TRI_WALKABLE) != 0;
+				b.size += a.size;
+				b.front |= a.front;
+				b.walled |= a.walled;
+				relabel(s, r, m, painted);
+				freeRegion(r);
+				r = m;
+			}
+			else
+			{
+				a.size += b.size;
+				a.front |= b.front;
+				a.walled |= b.walled;
+				relabel(met[k], m, r, painted);
+				freeRegion(m);
+			}
+		}
+
+		// A kept region whose walkability flipped is repainted whole
+		Region const & g = regions_[r];
+		if (kept && (g.front || !g.walled) != kept_walkable)
+		{
+			int32_t n = newRegion();
+			regions_[n] = regions_[r];
+			relabel(s, r, n, painted);
+			freeRegion(r);
+		}
+
+		for (size_t k = 0; k < painted.size(); ++k)
+			setWalkable(painted[k]);
+	}
+}
+
+int32_t NavMesh::newRegion()
+{
+	int32_t r;
+	if (!free_regions_.empty())
+	{
+		r = free_regions_.back();
+		free_regions_.pop_back();
+	}
+	else
+	{
+		r = (int32_t)regions_.size();
+		regions_.push_back(Region());
+	}
+	regions_[r].size = 0;
+	regions_[r].front = 0;
+	regions_[r].walled = 0;
+	return r;
+}
+
+void NavMesh::freeRegion(int32_t r)
+{
+	regions_[r].size = 0;
+	free_regions_.push_back(r);
+}
+
+void NavMesh::flood(int32_t seed, int32_t r, std::vector<int32_t> & out, std::vector<int32_t> * met)
+{
+	// Paint the unlabelled triangles reachable from seed, noting labelled ones met
+	size_t i = out.size();
+	region_[seed] = r;
+	out.push_back(seed);
+
+	Region & g = regions_[r];
+	for (; i < out.size(); ++i)
+	{
+		Tri const & t = tris_[out[i]];
+		++g.size;
+		for (int e = 0; e < 3; ++e)
+		{
+			if (t.edge[e] & EDGE_WALL)
+			{
+				g.walled = 1;
+				if (t.edge[e] & EDGE_FRONT)
+					g.front = 1;
+				continue;
+			}
+
+			int32_t n = t.adj[e];
+			if (n < 0)
+				continue;
+			if (region_[n] < 0)
+			{
+				region_[n] = r;
+				out.push_back(n);
+			}
+			else if (met && region_[n] != r)
+				met->push_back(n);
+		}
+	}
+}
+
+void NavMesh::relabel(int32_t seed, int32_t from, int32_t to, std::vector<int32_t> & out)
+{
+	size_t i = out.size();
+	region_[seed] = to;
+	out.push_back(seed);
+
+	for (; i < out.size(); ++i)
+	{
+		Tri const & t = tris_[out[i]];
+		for (int e = 0; e < 3; ++e)
+		{
+			int32_t n = t.adj[e];
+			if (!(t.edge[e] & EDGE_WALL) && n >= 0 && region_[n] == from)
+			{
+				region_[n] = to;
+				out.push_back(n);
+			}
+		}
+	}
+}
+
+void NavMesh::setWalkable(int32_t t)
+{
+	Region const & g = regions_[region_[t]];
+	if (g.front || !g.walled)
+		tris_[t].flags |= TRI_WALKABLE;
+	else
+		tris_[t].flags &= ~TRI_WALKABLE;
+}
+
+int32_t NavMesh::walk(int32_t t, POINT2 const & p) const
+{
+	int32_t from = -1;
+	for (int steps = 0; steps < 1024 && t >= 0; ++steps)
+	{
+		Tri const & tri = tris_[t];
+		int exit = -1;
+		for (int e = 0; e < 3 && exit < 0; ++e)
+			if (tri.adj[e] != from && orientf(verts_[tri.v[e]], verts_[tri.v[(e + 1) % 3]], p) < 0.0)
+				exit = e;
+
+		if (exit < 0)
+			return t;
+		if (tri.adj[exit] < 0)
+			return t;	// on the map edge within rounding
+		from = t;
+		t = tri.adj[exit];
+	}
+	return -1;
+}
+
+int32_t NavMesh::locate(POINT2 const & p) const
+{
+	if (tiles_.empty() || !area_.contains(p))
+		return -1;
+
+	int gx = math::clamp((int)floor((p.x - area_.lo.x) / grid_cell_), 0, gw_ - 1);
+	int gy = math::clamp((int)floor((p.y - area_.lo.y) / grid_cell_), 0, gh_ - 1);
+	int32_t t = walk(grid_[(size_t)gy * gw_ + gx], p);
+	if (t >= 0)
+		return t;
+
+	// The walk gave up (degenerate slivers); scan the tile
+	int tx = math::clamp((int)floor((p.x - area_.lo.x) / tile_), 0, tw_ - 1);
+	int ty = math::clamp((int)floor((p.y - area_.lo.y) / tile_), 0, th_ - 1);
+	Tile const &	tile = tiles_[ty * tw_ + tx];
+	double			best = -1e300;
+	for (size_t i = 0; i < tile.tris.size(); ++i)
+	{
+		Tri const & r = tris_[tile.tris[i]];
+		double m = math::min(orientf(verts_[r.v[0]], verts_[r.v[1]], p),
+				   math::min(orientf(verts_[r.v[1]], verts_[r.v[2]], p), orientf(verts_[r.v[2]], verts_[r.v[0]], p)));
+		if (m > best)
+		{
+			best = m;
+			t = tile.tris[i];
+		}
+	}
+	return t;
+}
+
+POINT2 NavMesh::centroid(size_t i) const
+{
+	Tri const & t = tris_[i];
+	POINT2 const & a = verts_[t.v[0]];
+	POINT2 const & b = verts_[t.v[1]];
+	POINT2 const & c = verts_[t.v[2]];
+	return POINT2((a.x + b.x + c.x) / 3.0f, (a.y + b.y + c.y) / 3.0f);
+}
+
+Triangle NavMesh::triangle(size_t i) const
+{
+	Tri const & t = tris_[i];
+	return Triangle(verts_[t.v[0]], verts_[t.v[1]], verts_[t.v[2]]);
+}
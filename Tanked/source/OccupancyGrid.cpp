@@ -0,0 +1,547 @@
+/* ********************************************************************************* *
+ * *  File: OccupancyGrid.cpp                                                      * *
+ * *  -----------------------                                                      * *
+ * *  COPYRIGHT NOTICE                                                             * *
+ * *  ----------------                                                             * *
+ * *  (C)[2012] - [2015] Deakin University                                         * *
+ * *  All rights reserved.                                                         * *
+ * *  All information contained herein is, and remains the property of Deakin      * *
+ * *  University and the author (Tim Wilkin).                                      * *
+ * *  Dissemination of this information or reproduction of this material is        * *
+ * *  strictly forbidden unless prior written permission is obtained from Deakin   * *
+ * *  University.The right to create derivative works from this material is        * *
+ * *  hereby granted to students enrolled in SIT255, but only for the purposes of  * *
+ * *  assessment while an enrolled student at Deakin University.                   * *
+ * *                                                                               * *
+ * ********************************************************************************* */
+
+#include <cmath>
+#include <cstring>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "level/OccupancyGrid.h"
+
+using namespace level;
+
+namespace {
+
+	inline bool get_bit(std::vector<uint64_t> const & v, int words, int x, int y)
+	{
+		return ((v[(size_t)y * words + (x >> 6)] >> (x & 63)) & 1) != 0;
+	}
+
+	inline void put_bit(std::vector<uint64_t> & v, int words, int x, int y, bool on)
+	{
+		uint64_t & w = v[(size_t)y * words + (x >> 6)];
+		uint64_t   m = (uint64_t)1 << (x & 63);
+		w = on ? (w | m) : (w & ~m);
+	}
+
+	// Bits [lo, hi] of a word (0 <= lo <= hi <= 63)
+	inline uint64_t span_mask(int lo, int hi)
+	{
+		uint64_t upper = (hi == 63) ? ~(uint64_t)0 : (((uint64_t)1 << (hi + 1)) - 1);
+		return upper & ~(((uint64_t)1 << lo) - 1);
+	}
+
+	// Index of the lowest set bit of a non-zero word
+	inline int lowest_bit(uint64_t w)
+	{
+#ifdef _MSC_VER
+		unsigned long i;
+		if (_BitScanForward(&i, (unsigned long)(w & 0xffffffffu)))
+			return (int)i;
+		_BitScanForward(&i, (unsigned long)(w >> 32));
+		return (int)i + 32;
+#else
+		return __builtin_ctzll(w);
+#endif
+	}
+
+	// Index of the highest set bit of a non-zero word
+	inline int highest_bit(uint64_t w)
+	{
+#ifdef _MSC_VER
+		unsigned long i;
+		if (_BitScanReverse(&i, (unsigned long)(w >> 32)))
+			return (int)i + 32;
+		_BitScanReverse(&i, (unsigned long)(w & 0xffffffffu));
+		return (int)i;
+#else
+		return 63 - __builtin_clzll(w);
+#endif
+	}
+
+	// Lowest / highest clear bit in [x0, x1] of a row, or -1
+	int first_clear(uint64_t const * r, int x0, int x1)
+	{
+		for (int wi = x0 >> 6; x0 <= x1 && wi <= (x1 >> 6); ++wi)
+		{
+			uint64_t m = ~r[wi] & span_mask((wi == (x0 >> 6)) ? (x0 & 63) : 0, (wi == (x1 >> 6)) ? (x1 & 63) : 63);
+			if (m)
+				return (wi << 6) + lowest_bit(m);
+		}
+		return -1;
+	}
+
+	int last_clear(uint64_t const * r, int x0, int x1)
+	{
+		for (int wi = x1 >> 6; x0 <= x1 && wi >= (x0 >> 6); --wi)
+		{
+			uint64_t m = ~r[wi] & span_mask((wi == (x0 >> 6)) ? (x0 & 63) : 0, (wi == (x1 >> 6)) ? (x1 & 63) : 63);
+			if (m)
+				return (wi << 6) + highest_bit(m);
+		}
+		return -1;
+	}
+
+} // close anonymous namespace
+
+
+OccupancyGrid::OccupancyGrid()
+	: cell_(1.0f), w_(0), h_(0), words_(0), version_(0), dynamic_version_(0)
+{}
+
+OccupancyGrid::OccupancyGrid(AABB const & area, float cell)
+	: version_(0), dynamic_version_(0)
+{
+	reset(area, cell);
+}
+
+void OccupancyGrid::reset(AABB const & area, float cell)
+{
+	area_ = area;
+	cell_ = cell;
+	w_ = math::max(1, (int)ceil((area.hi.x - area.lo.x) / cell));
+	h_ = math::max(1, (int)ceil((area.hi.y - area.lo.y) / cell));
+	words_ = (w_ + 63) / 64;
+	++version_;
+
+	static_.assign((size_t)words_ * h_, 0);
+	bits_.assign((size_t)words_ * h_, 0);
+	dynamic_.assign((size_t)w_ * h_, 0);
+
+	pyramid_.clear();
+	int lw = w_, lh = h_;
+	while (lw > 1 || lh > 1)
+	{
+		Level l;
+		l.w = (lw + 1) / 2;
+		l.h = (lh + 1) / 2;
+		l.words = (l.w + 63) / 64;
+		l.any.assign((size_t)l.words * l.h, 0);
+		l.all.assign((size_t)l.words * l.h, 0);
+		pyramid_.push_back(l);
+		lw = l.w;
+		lh = l.h;
+	}
+}
+
+/*
+ * Stamping
+ */
+
+void OccupancyGrid::stampSpan(int y, int x0, int x1, STAMP_MODE mode)
+{
+	if (y < 0 || y >= h_)
+		return;
+	x0 = math::max(x0, 0);
+	x1 = math::min(x1, w_ - 1);
+	if (x0 > x1)
+		return;
+
+	if (mode == STAMP_STATIC || mode == STAMP_CLEAR)
+		++version_;
+
+	if (mode == STAMP_STATIC)
+	{
+		// Whole words at a time
+		uint64_t * s = &static_[(size_t)y * words_];
+		uint64_t * b = &bits_[(size_t)y * words_];
+		for (int wi = x0 >> 6; wi <= (x1 >> 6); ++wi)
+		{
+			uint64_t m = span_mask((wi == (x0 >> 6)) ? (x0 & 63) : 0, (wi == (x1 >> 6)) ? (x1 & 63) : 63);
+			s[wi] |= m;
+			b[wi] |= m;
+		}
+		return;
+	}
+
+	if (mode == STAMP_CLEAR)
+	{
+		uint64_t * s = &static_[(size_t)y * words_];
+		for (int wi = x0 >> 6; wi <= (x1 >> 6); ++wi)
+			s[wi] &= ~span_mask((wi == (x0 >> 6)) ? (x0 & 63) : 0, (wi == (x1 >> 6)) ? (x1 & 63) : 63);
+
+		// Dynamic obstacles over the cleared cells stay blocked
+		for (int x = x0; x <= x1; ++x)
+			put_bit(bits_, words_, x, y, get_bit(static_, words_, x, y) || dynamic_[(size_t)y * w_ + x] > 0);
+		return;
+	}
+
+	for (int x = x0; x <= x1; ++x)
+	{
+		uint8_t & c = dynamic_[(size_t)y * w_ + x];
+		if (mode == STAMP_ADD)
+		{
+			if (c < 255)
+				++c;
+			if (!get_bit(bits_, words_, x, y))
+				++dynamic_version_;
+			put_bit(bits_, words_, x, y, true);
+		}
+		else if (c > 0 && --c == 0)
+		{
+			if (!get_bit(static_, words_, x, y))
+				++dynamic_version_;
+			put_bit(bits_, words_, x, y, get_bit(static_, words_, x, y));
+		}
+	}
+}
+
+void OccupancyGrid::stampRect(Rect const & r, STAMP_MODE mode)
+{
+	AABB b(r);
+	int x0 = toCellX(b.lo.x), x1 = toCellX(b.hi.x);
+	int y0 = toCellY(b.lo.y), y1 = toCellY(b.hi.y);
+	for (int y = y0; y <= y1; ++y)
+		stampSpan(y, x0, x1, mode);
+	refresh(x0, y0, x1, y1);
+}
+
+void OccupancyGrid::stampCircle(Circle const & c, STAMP_MODE mode)
+{
+	// Cells whose centre lies inside the circle, plus the cell holding the centre
+	float	r = c.radius();
+	int		y0 = toCellY(c.origin().y - r), y1 = toCellY(c.origin().y + r);
+	for (int y = y0; y <= y1; ++y)
+	{
+		float dy = area_.lo.y + (y + 0.5f) * cell_ - c.origin().y;
+		float half = (dy * dy <= r * r) ? sqrt(r * r - dy * dy) : -1.0f;
+		if (half < 0.0f)
+			continue;
+		stampSpan(y, toCellX(c.origin().x - half), toCellX(c.origin().x + half), mode);
+	}
+	stampSpan(toCellY(c.origin().y), toCellX(c.origin().x), toCellX(c.origin().x), mode);
+	refresh(toCellX(c.origin().x - r), y0, toCellX(c.origin().x + r), y1);
+}
+
+void OccupancyGrid::stamp(Rect const & r)		{ stampRect(r, STAMP_STATIC); }
+void OccupancyGrid::stamp(Circle const & c)		{ stampCircle(c, STAMP_STATIC); }
+void OccupancyGrid::stampDynamic(Circle const & c)		{ stampCircle(c, STAMP_ADD); }
+void OccupancyGrid::unstampDynamic(Circle const & c)	{ stampCircle(c, STAMP_REMOVE); }
+void OccupancyGrid::stampDynamic(Rect const & r)		{ stampRect(r, STAMP_ADD); }
+void OccupancyGrid::unstampDynamic(Rect const & r)		{ stampRect(r, STAMP_REMOVE); }
+
+void OccupancyGrid::stamp(Segment const & s)
+{
+	// Grid traversal (Amanatides & Woo) so that every cell the wall crosses is marked
+	float fx = (s.start().x - area_.lo.x) / cell_, fy = (s.start().y - area_.lo.y) / cell_;
+	float tx = (s.end().x - area_.lo.x) / cell_,   ty = (s.end().y - area_.lo.y) / cell_;
+	int x = (int)floor(fx), y = (int)floor(fy);
+	int ex = (int)floor(tx), ey = (int)floor(ty);
+	float dx = tx - fx, dy = ty - fy;
+	int sx = (dx > 0) ? 1 : -1, sy = (dy > 0) ? 1 : -1;
+	float tdx = (dx != 0.0f) ? fabs(1.0f / dx) : FLT_MAX;
+	float tdy = (dy != 0.0f) ? fabs(1.0f / dy) : FLT_MAX;
+	float nx = (dx != 0.0f) ? ((sx > 0 ? (x + 1 - fx) : (fx - x)) * tdx) : FLT_MAX;
+	float ny = (dy != 0.0f) ? ((sy > 0 ? (y + 1 - fy) : (fy - y)) * tdy) : FLT_MAX;
+
+	int guard = abs(ex - x) + abs(ey - y) + 2;
+	for (;;)
+	{
+		stampSpan(y, x, x, STAMP_STATIC);
+		if ((x == ex && y == ey) || --guard < 0)
+			break;
+		if (nx < ny)
+		{
+			x += sx;
+			nx += tdx;
+		}
+		else
+		{
+			y += sy;
+			ny += tdy;
+		}
+	}
+
+	AABB b(s);
+	refresh(toCellX(b.lo.x), toCellY(b.lo.y), toCellX(b.hi.x), toCellY(b.hi.y));
+}
+
+void OccupancyGrid::stamp(ConvexPolygon const & p)
+{
+	if (p.size() == 0)
+		return;
+
+	// Scan-convert cell centre rows, then trace the edges so thin slivers are kept
+	AABB b(p);
+	int y0 = toCellY(b.lo.y), y1 = toCellY(b.hi.y);
+	for (int y = y0; y <= y1; ++y)
+	{
+		float cy = area_.lo.y + (y + 0.5f) * cell_;
+		float lo = FLT_MAX, hi = -FLT_MAX;
+		for (size_t i = 0; i < p.size(); ++i)
+		{
+			POINT2 const & a = p.vertex(i);
+			POINT2 const & c = p.vertex(i + 1);
+			if ((a.y <= cy && c.y >= cy) || (c.y <= cy && a.y >= cy))
+			{
+				float x = (c.y != a.y) ? a.x + (cy - a.y) * (c.x - a.x) / (c.y - a.y) : a.x;
+				lo = math::min(lo, math::min(x, (c.y != a.y) ? x : c.x));
+				hi = math::max(hi, math::max(x, (c.y != a.y) ? x : c.x));
+			}
+		}
+		if (lo <= hi)
+			stampSpan(y, toCellX(lo), toCellX(hi), STAMP_STATIC);
+	}
+
+	for (size_t i = 0; i < p.size(); ++i)
+		stamp(Segment(p.vertex(i), p.vertex(i + 1), VECTOR2(0, 1)));
+
+	refresh(toCellX(b.lo.x), y0, toCellX(b.hi.x), y1);
+}
+
+void OccupancyGrid::stamp(std::vector<Segment> const & walls)
+{
+	for (size_t i = 0; i < walls.size(); ++i)
+		stamp(walls[i]);
+}
+
+/*
+ * Pyramid maintenance: recompute the blocks covering a changed cell rectangle
+ */
+
+void OccupancyGrid::clearStatic(AABB const & box)
+{
+	int x0 = toCellX(box.lo.x), x1 = toCellX(box.hi.x);
+	int y0 = toCellY(box.lo.y), y1 = toCellY(box.hi.y);
+	for (int y = y0; y <= y1; ++y)
+		stampSpan(y, x0, x1, STAMP_CLEAR);
+	refresh(x0, y0, x1, y1);
+}
+
+void OccupancyGrid::refresh(int x0, int y0, int x1, int y1)
+{
+	x0 = math::max(x0, 0);	y0 = math::max(y0, 0);
+	x1 = math::min(x1, w_ - 1);	y1 = math::min(y1, h_ - 1);
+	if (x0 > x1 || y0 > y1)
+		return;
+
+	for (size_t l = 0; l < pyramid_.size(); ++l)
+	{
+		Level & L = pyramid_[l];
+		x0 >>= 1;	y0 >>= 1;
+		x1 >>= 1;	y1 >>= 1;
+
+		for (int by = y0; by <= y1; ++by)
+			for (int bx = x0; bx <= x1; ++bx)
+			{
+				bool any = false, all = true;
+				for (int k = 0; k < 4; ++k)
+				{
+					int cx = 2 * bx + (k & 1), cy = 2 * by + (k >> 1);
+					bool a, m;
+					if (l == 0)
+					{
+						if (cx >= w_ || cy >= h_)
+							continue;		// outside the map counts as neither
+						a = m = get_bit(bits_, words_, cx, cy);
+					}
+					else
+					{
+						Level const & C = pyramid_[l - 1];
+						if (cx >= C.w || cy >= C.h)
+							continue;
+						a = get_bit(C.any, C.words, cx, cy);
+						m = get_bit(C.all, C.words, cx, cy);
+					}
+					any = any || a;
+					all = all && m;
+				}
+				put_bit(L.any, L.words, bx, by, any);
+				put_bit(L.all, L.words, bx, by, all);
+			}
+	}
+}
+
+/*
+ * Queries
+ */
+
+bool OccupancyGrid::blocked(int x, int y) const
+{
+	if (x < 0 || y < 0 || x >= w_ || y >= h_)
+		return true;	// outside the level is solid
+	return get_bit(bits_, words_, x, y);
+}
+
+bool OccupancyGrid::blocked(POINT2 const & p) const
+{
+	return blocked(toCellX(p.x), toCellY(p.y));
+}
+
+bool OccupancyGrid::rowRange(uint64_t const * row, int x0, int x1, bool any) const
+{
+	// any: is some bit in [x0,x1] set?  !any: are all bits in [x0,x1] set?
+	for (int wi = x0 >> 6; wi <= (x1 >> 6); ++wi)
+	{
+		uint64_t m = span_mask((wi == (x0 >> 6)) ? (x0 & 63) : 0, (wi == (x1 >> 6)) ? (x1 & 63) : 63);
+		if (any && (row[wi] & m))
+			return true;
+		if (!any && (row[wi] & m) != m)
+			return false;
+	}
+	return !any;
+}
+
+bool OccupancyGrid::occupied(int x0, int y0, int x1, int y1) const
+{
+	if (x0 < 0 || y0 < 0 || x1 >= w_ || y1 >= h_)
+		return true;
+	if (x0 > x1 || y0 > y1)
+		return false;
+
+	// Hierarchical rejection: the coarsest level at which the rectangle
+	// spans at most a few blocks per axis
+	int span = math::max(x1 - x0, y1 - y0) + 1;
+	int l = -1;
+	while (l + 1 < (int)pyramid_.size() && (2 << (l + 1)) * 2 <= span)
+		++l;
+
+	if (l >= 0)
+	{
+		Level const & L = pyramid_[l];
+		int		s = 2 << l;
+		bool	any = false;
+		for (int by = y0 / s; by <= y1 / s && !any; ++by)
+			for (int bx = x0 / s; bx <= x1 / s && !any; ++bx)
+				any = get_bit(L.any, L.words, bx, by);
+		if (!any)
+			return false;
+
+		// A fully blocked block lying wholly inside the rectangle settles it
+		for (int by = (y0 + s - 1) / s; (by + 1) * s - 1 <= y1; ++by)
+			for (int bx = (x0 + s - 1) / s; (bx + 1) * s - 1 <= x1; ++bx)
+				if (get_bit(L.all, L.words, bx, by))
+					return true;
+	}
+
+	for (int y = y0; y <= y1; ++y)
+		if (rowRange(row(y), x0, x1, true))
+			return true;
+	return false;
+}
+
+bool OccupancyGrid::occupied(AABB const & box) const
+{
+	return occupied(toCellX(box.lo.x), toCellY(box.lo.y), toCellX(box.hi.x), toCellY(box.hi.y));
+}
+
+bool OccupancyGrid::firstFree(int x0, int y0, int x1, int y1, int & fx, int & fy) const
+{
+	x0 = math::max(x0, 0);	y0 = math::max(y0, 0);
+	x1 = math::min(x1, w_ - 1);	y1 = math::min(y1, h_ - 1);
+
+	// 8x8 solid blocks (pyramid level 2) let whole row bands be skipped
+	Level const * band = (pyramid_.size() > 2) ? &pyramid_[2] : 0;
+
+	for (int y = y0; y <= y1; ++y)
+	{
+		if (band && (y & 7) == 0 && y + 7 <= y1)
+		{
+			bool solid = true;
+			for (int bx = x0 >> 3; bx <= (x1 >> 3) && solid; ++bx)
+				solid = get_bit(band->all, band->words, bx, y >> 3);
+			if (solid)
+			{
+				y += 7;
+				continue;
+			}
+		}
+
+		uint64_t const * r = row(y);
+		for (int wi = x0 >> 6; wi <= (x1 >> 6); ++wi)
+		{
+			uint64_t m = span_mask((wi == (x0 >> 6)) ? (x0 & 63) : 0, (wi == (x1 >> 6)) ? (x1 & 63) : 63);
+			uint64_t free_bits = ~r[wi] & m;
+			if (free_bits)
+			{
+				fx = (wi << 6) + lowest_bit(free_bits);
+				fy = y;
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+bool OccupancyGrid::nearestFree(int cx, int cy, int max_radius, int & fx, int & fy) const
+{
+	if (!blocked(cx, cy))
+	{
+		fx = cx;
+		fy = cy;
+		return true;
+	}
+
+	/*
+	 * Every cell of ring r is at least r from the centre, so once a free cell
+	 * at squared distance best is known only rings with r * r < best can
+	 * hold a nearer one. Along each side of a ring the distance grows away
+	 * from the centre's projection, so each side is searched outwards from
+	 * there and stops at its first free cell.
+	 */
+	int best = -1;
+	auto consider = [&](int x, int y)
+	{
+		int d = (x - cx) * (x - cx) + (y - cy) * (y - cy);
+		if (best < 0 || d < best)
+		{
+			best = d;
+			fx = x;
+			fy = y;
+		}
+	};
+
+	for (int r = 1; r <= max_radius && (best < 0 || r * r < best); ++r)
+	{
+		// Top and bottom rows, a word at a time either side of cx
+		int x0 = math::max(cx - r, 0), x1 = math::min(cx + r, w_ - 1);
+		int px = math::min(math::max(cx, x0), x1);
+		for (int y = cy - r; y <= cy + r && x0 <= x1; y += 2 * r)
+		{
+			if (y < 0 || y >= h_)
+				continue;
+			int x = first_clear(row(y), px, x1);
+			if (x >= 0)
+				consider(x, y);
+			x = last_clear(row(y), x0, px - 1);
+			if (x >= 0)
+				consider(x, y);
+		}
+
+		// Left and right columns without the corners, outwards from cy
+		for (int x = cx - r; x <= cx + r; x += 2 * r)
+		{
+			if (x < 0 || x >= w_)
+				continue;
+			for (int t = 0; t < r; ++t)
+			{
+				if (!blocked(x, cy + t))
+				{
+					consider(x, cy + t);
+					break;
+				}
+				if (t > 0 && !blocked(x, cy - t))
+				{
+					consider(x, cy - t);
+					break;
+				}
+			}
+		}
+	}
+	return best >= 0;
+}
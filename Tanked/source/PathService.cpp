@@ -0,0 +1,448 @@
+/* ********************************************************************************* *
+ * *  File: PathService.cpp                                                        * *
+ * *  ---------------------                                                        * *
+ * *  COPYRIGHT NOTICE                                                             * *
+ * *  ----------------                                                             * *
+ * *  (C)[2012] - [2015] Deakin University                                         * *
+ * *  All rights reserved.                                                         * *
+ * *  All information contained herein is, and remains the property of Deakin      * *
+ * *  University and the author (Tim Wilkin).                                      * *
+ * *  Dissemination of this information or reproduction of this material is        * *
+ * *  strictly forbidden unless prior written permission is obtained from Deakin   * *
+ * *  University.The right to create derivative works from this material is        * *
+ * *  hereby granted to students enrolled in SIT255, but only for the purposes of  * *
+ * *  assessment while an enrolled student at Deakin University.                   * *
+ * *                                                                               * *
+ * ********************************************************************************* */
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+
+#include "ai/PathService.h"
+
+using namespace ai;
+
+namespace {
+
+	const uint32_t	SLOT_BITS = 20;
+	const uint32_t	SLOT_MASK = (1u << SLOT_BITS) - 1;
+
+	// Expansions between clock reads
+	const uint32_t	CLOCK_INTERVAL = 32;
+
+	// Cache key: search in the top bits, then start and goal node
+	const uint32_t	NODE_BITS = 30;
+
+	inline int64_t now_us()
+	{
+		return std::chrono::duration_cast<std::chrono::microseconds>(
+			std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+} // close anonymous namespace
+
+PathService::PathService(SearchSpace const & space, size_t cache_size)
+	: space_(space),
+	  cache_size_(math::max(cache_size, (size_t)1)),
+	  head_(-1),
+	  tail_(-1),
+	  active_(-1),
+	  active_version_(0),
+	  stamp_(0)
+{
+	resetStats();
+}
+
+void PathService::resetStats()
+{
+	stats_.requests = 0;
+	stats_.cached = 0;
+	stats_.suffixes = 0;
+	stats_.searches = 0;
+	stats_.expansions = 0;
+	stats_.sight_checks = 0;
+}
+
+/*
+ * Tickets: slot + 1 in the low bits, slot generation above
+ */
+
+PathService::Request const * PathService::find(Ticket t) const
+{
+	uint32_t slot = (t & SLOT_MASK) - 1;
+	if (t == 0 || slot >= requests_.size())
+		return 0;
+	Request const & r = requests_[slot];
+	if (!r.live || (r.generation & (0xffffffffu >> SLOT_BITS)) != (t >> SLOT_BITS))
+		return 0;
+	return &r;
+}
+
+PathService::Ticket PathService::request(POINT2 const & start, POINT2 const & goal, SEARCH search)
+{
+	++stats_.requests;
+
+	uint32_t slot;
+	if (!free_requests_.empty())
+	{
+		slot = free_requests_.back();
+		free_requests_.pop_back();
+	}
+	else
+	{
+		slot = (uint32_t)requests_.size();
+		requests_.push_back(Request());
+		requests_.back().generation = 0;
+	}
+
+	Request & r = requests_[slot];
+	r.start = start;
+	r.goal = goal;
+	r.entry = -1;
+	r.live = true;
+	++r.generation;
+
+	int32_t s = space_.nodeAt(start), g = space_.nodeAt(goal);
+	if (s >= 0 && g >= 0)
+	{
+		uint64_t key = ((uint64_t)search << (2 * NODE_BITS)) | ((uint64_t)(uint32_t)s << NODE_BITS) | (uint32_t)g;
+		std::unordered_map<uint64_t, int32_t>::const_iterator it = index_.find(key);
+
+		int32_t e;
+		if (it != index_.end() &&
+			(entries_[it->second].state == ENTRY_PENDING || entries_[it->second].version == space_.version()))
+		{
+			e = it->second;
+			++stats_.cached;
+		}
+		else
+		{
+			e = allocate(key, s, g, search);
+			if (suffix(e))
+				++stats_.suffixes;
+			else
+				queue_.push_back(e);
+		}
+
+		++entries_[e].pins;
+		touch(e);
+		r.entry = e;
+	}
+
+	return ((r.generation & (0xffffffffu >> SLOT_BITS)) << SLOT_BITS) | (slot + 1);
+}
+
+PathService::STATUS PathService::status(Ticket t) const
+{
+	Request const * r = find(t);
+	if (!r)
+		return PATH_INVALID;
+	if (r->entry < 0)
+		return PATH_FAILED;
+
+	switch (entries_[r->entry].state)
+	{
+		case ENTRY_PENDING:	return PATH_PENDING;
+		case ENTRY_FOUND:	return PATH_FOUND;
+		default:			return PATH_FAILED;
+	}
+}
+
+bool PathService::path(Ticket t, std::vector<POINT2> & out) const
+{
+	if (status(t) != PATH_FOUND)
+		return false;
+	Request const * r = find(t);
+	space_.waypoints(entries_[r->entry].path, r->start, r->goal, out);
+	return true;
+}
+
+bool PathService::nodes(Ticket t, std::vector<int32_t> & out) const
+{
+	if (status(t) != PATH_FOUND)
+		return false;
+	out = entries_[find(t)->entry].path;
+	return true;
+}
+
+void PathService::release(Ticket t)
+{
+	if (!find(t))
+		return;
+
+	uint32_t slot = (t & SLOT_MASK) - 1;
+	Request & r = requests_[slot];
+	if (r.entry >= 0)
+		--entries_[r.entry].pins;
+	r.live = false;
+	free_requests_.push_back(slot);
+}
+
+/*
+ * Cache entries: an intrusive LRU list over a slot array
+ */
+
+void PathService::unlink(int32_t e)
+{
+	Entry & en = entries_[e];
+	if (en.prev >= 0)
+		entries_[en.prev].next = en.next;
+	else
+		head_ = en.next;
+	if (en.next >= 0)
+		entries_[en.next].prev = en.prev;
+	else
+		tail_ = en.prev;
+	en.prev = en.next = -1;
+}
+
+void PathService::touch(int32_t e)
+{
+	if (head_ == e)
+		return;
+	unlink(e);
+	Entry & en = entries_[e];
+	en.next = head_;
+	if (head_ >= 0)
+		entries_[head_].prev = e;
+	head_ = e;
+	if (tail_ < 0)
+		tail_ = e;
+}
+
+int32_t PathService::allocate(uint64_t key, int32_t start, int32_t goal, SEARCH search)
+{
+	int32_t e = -1;
+
+	if (entries_.size() - free_entries_.size() >= cache_size_)
+	{
+		// Evict the least recently used entry nobody is waiting on
+		for (int32_t c = tail_; c >= 0 && e < 0; c = entries_[c].prev)
+			if (entries_[c].pins == 0 && entries_[c].state != ENTRY_PENDING)
+				e = c;
+		if (e >= 0)
+		{
+			unlink(e);
+			std::unordered_map<uint64_t, int32_t>::iterator it = index_.find(entries_[e].key);
+			if (it != index_.end() && it->second == e)
+				index_.erase(it);
+		}
+	}
+	if (e < 0 && !free_entries_.empty())
+	{
+		e = free_entries_.back();
+		free_entries_.pop_back();
+	}
+	if (e < 0)
+	{
+		e = (int32_t)entries_.size();
+		entries_.push_back(Entry());
+	}
+
+	Entry & en = entries_[e];
+	en.key = key;
+	en.start = start;
+	en.goal = goal;
+	en.version = space_.version();
+	en.state = ENTRY_PENDING;
+	en.search = (uint8_t)search;
+	en.pins = 0;
+	en.prev = en.next = -1;
+	en.path.clear();
+
+	index_[key] = e;		// replaces a stale entry, which lives on for its tickets
+	touch(e);
+	return e;
+}
+
+bool PathService::suffix(int32_t e)
+{
+	Entry & en = entries_[e];
+	for (int32_t c = head_; c >= 0; c = entries_[c].next)
+	{
+		Entry const & other = entries_[c];
+		if (c == e || other.state != ENTRY_FOUND || other.goal != en.goal || other.version != en.version ||
+			other.search != en.search)
+			continue;
+
+		std::vector<int32_t>::const_iterator it = std::find(other.path.begin(), other.path.end(), en.start);
+		if (it == other.path.end())
+			continue;
+
+		en.path.assign(it, other.path.end());
+		en.state = ENTRY_FOUND;
+		return true;
+	}
+	return false;
+}
+
+/*
+ * Searching
+ */
+
+void PathService::update(float budget_us)
+{
+	int64_t deadline = now_us() + (int64_t)budget_us;
+
+	while (!queue_.empty())
+	{
+		int32_t e = queue_.front();
+
+		if (entries_[e].pins == 0)
+		{
+			// Every requester gave up; don't search for nobody
+			queue_.pop_front();
+			unlink(e);
+			std::unordered_map<uint64_t, int32_t>::iterator it = index_.find(entries_[e].key);
+			if (it != index_.end() && it->second == e)
+				index_.erase(it);
+			entries_[e].state = ENTRY_FREE;
+			free_entries_.push_back(e);
+			if (active_ == e)
+				active_ = -1;
+			continue;
+		}
+
+		// A graph change under a suspended search restarts it
+		if (active_ != e || active_version_ != space_.version())
+			begin(e);
+
+		if (!search(e, deadline))
+			return;
+
+		queue_.pop_front();
+		active_ = -1;
+		++stats_.searches;
+	}
+}
+
+void PathService::begin(int32_t e)
+{
+	size_t n = space_.nodes();
+	if (g_.size() < n)
+	{
+		g_.resize(n);
+		parent_.resize(n);
+		seen_.resize(n, 0);
+		closed_.resize(n, 0);
+	}
+	if (++stamp_ == 0)
+	{
+		std::fill(seen_.begin(), seen_.end(), 0u);
+		std::fill(closed_.begin(), closed_.end(), 0u);
+		stamp_ = 1;
+	}
+
+	Entry & en = entries_[e];
+	en.version = space_.version();
+	active_ = e;
+	active_version_ = en.version;
+
+	open_.clear();
+	g_[en.start] = 0.0f;
+	parent_[en.start] = -1;
+	seen_[en.start] = stamp_;
+	open_.push_back(OpenNode(estimate(en, en.start), en.start));
+}
+
+float PathService::estimate(Entry const & en, int32_t n) const
+{
+	// Any-angle paths can beat the grid's octile distance, so they need the straight line
+	if (en.search == SEARCH_THETA || en.search == SEARCH_LAZY_THETA)
+		return space_.distance(n, en.goal);
+	return space_.heuristic(n, en.goal);
+}
+
+bool PathService::search(int32_t e, int64_t deadline_us)
+{
+	Entry &		en = entries_[e];
+	int32_t		nb[SearchSpace::MAX_NEIGHBOURS];
+	float		cost[SearchSpace::MAX_NEIGHBOURS];
+	uint32_t	count = 0;
+
+	bool jump = en.search == SEARCH_JPS || en.search == SEARCH_JPS_PLUS;
+	bool theta = en.search == SEARCH_THETA || en.search == SEARCH_LAZY_THETA;
+	bool lazy = en.search == SEARCH_LAZY_THETA;
+
+	while (!open_.empty())
+	{
+		if (++count % CLOCK_INTERVAL == 0 && now_us() >= deadline_us)
+			return false;
+
+		std::pop_heap(open_.begin(), open_.end(), std::greater<OpenNode>());
+		int32_t n = open_.back().second;
+		open_.pop_back();
+
+		if (closed_[n] == stamp_)
+			continue;		// stale heap entry
+		closed_[n] = stamp_;
+		++stats_.expansions;
+
+		// Lazy Theta*: the parent was assumed visible; if it isn't, fall
+		// back to the best expanded neighbour (the one that relaxed n is one)
+		if (lazy && parent_[n] >= 0)
+		{
+			++stats_.sight_checks;
+			if (!space_.lineOfSight(parent_[n], n))
+			{
+				size_t k = space_.neighbours(n, nb, cost);
+				g_[n] = FLT_MAX;
+				for (size_t i = 0; i < k; ++i)
+					if (closed_[nb[i]] == stamp_ && g_[nb[i]] + cost[i] < g_[n])
+					{
+						g_[n] = g_[nb[i]] + cost[i];
+						parent_[n] = nb[i];
+					}
+			}
+		}
+
+		if (n == en.goal)
+		{
+			en.path.clear();
+			for (int32_t m = n; m >= 0; m = parent_[m])
+				en.path.push_back(m);
+			std::reverse(en.path.begin(), en.path.end());
+			en.state = ENTRY_FOUND;
+			return true;
+		}
+
+		size_t k = jump
+			? space_.successors(n, parent_[n], en.goal, en.search == SEARCH_JPS_PLUS, nb, cost)
+			: space_.neighbours(n, nb, cost);
+		for (size_t i = 0; i < k; ++i)
+		{
+			int32_t m = nb[i];
+			if (closed_[m] == stamp_)
+				continue;
+
+			float g = g_[n] + cost[i];
+			int32_t from = n;
+			int32_t p = parent_[n];
+			if (theta && p >= 0)
+			{
+				// Cut the corner at n when p sees m (lazy: assume it does)
+				if (!lazy)
+					++stats_.sight_checks;
+				if (lazy || space_.lineOfSight(p, m))
+				{
+					g = g_[p] + space_.distance(p, m);
+					from = p;
+				}
+			}
+
+			if (seen_[m] != stamp_ || g < g_[m])
+			{
+				seen_[m] = stamp_;
+				g_[m] = g;
+				parent_[m] = from;
+				open_.push_back(OpenNode(g + estimate(en, m), m));
+				std::push_heap(open_.begin(), open_.end(), std::greater<OpenNode>());
+			}
+		}
+	}
+
+	en.path.clear();
+	en.state = ENTRY_FAILED;
+	return true;
+}
@@ -0,0 +1,524 @@
+/* ********************************************************************************* *
+ * *  File: Planner.cpp                                                            * *
+ * *  -----------------                                                            * *
+ * *  COPYRIGHT NOTICE                                                             * *
+ * *  ----------------                                                             * *
+ * *  (C)[2012] - [2015] Deakin University                                         * *
+ * *  All rights reserved.                                                         * *
+ * *  All information contained herein is, and remains the property of Deakin      * *
+ * *  University and the author (Tim Wilkin).                                      * *
+ * *  Dissemination of this information or reproduction of this material is        * *
+ * *  strictly forbidden unless prior written permission is obtained from Deakin   * *
+ * *  University.The right to create derivative works from this material is        * *
+ * *  hereby granted to students enrolled in SIT255, but only for the purposes of  * *
+ * *  assessment while an enrolled student at Deakin University.                   * *
+ * *                                                                               * *
+ * ********************************************************************************* */
+
+#include <assert.h>
+#include <float.h>
+#include <algorithm>
+#include <functional>
+
+#include "ai/Planner.h"
+
+using namespace ai;
+
+namespace {
+
+	const uint32_t	SLOT_BITS = 20;
+	const uint32_t	SLOT_MASK = (1u << SLOT_BITS) - 1;
+
+	const Planner::ActionId	NO_ACTION = 0xffff;
+
+	inline uint32_t popcount(uint64_t v)
+	{
+		uint32_t n = 0;
+		for (; v; v &= v - 1)
+			++n;
+		return n;
+	}
+
+	inline uint64_t mix(uint64_t v)
+	{
+		v ^= v >> 33;
+		v *= 0xff51afd7ed558ccdull;
+		v ^= v >> 33;
+		v *= 0xc4ceb9fe1a85ec53ull;
+		return v ^ (v >> 33);
+	}
+
+} // close anonymous namespace
+
+size_t Planner::KeyHash::operator()(Key const & k) const
+{
+	return (size_t)mix(k.start ^ mix(k.mask ^ mix(k.value)));
+}
+
+Planner::Planner(size_t cache_size, size_t max_nodes)
+	: per_fact_(0.0f),
+	  version_(0),
+	  cache_size_(std::max(cache_size, (size_t)1)),
+	  max_nodes_(std::max(max_nodes, (size_t)1)),
+	  head_(-1),
+	  tail_(-1),
+	  active_(-1),
+	  stamp_(0),
+	  active_version_(0),
+	  depends_(0)
+{
+	// Visited table at most half full
+	size_t capacity = 16;
+	while (capacity < 2 * max_nodes_)
+		capacity *= 2;
+	visit_state_.resize(capacity);
+	visit_node_.resize(capacity);
+	visit_stamp_.resize(capacity, 0);
+	nodes_.reserve(max_nodes_);
+
+	resetStats();
+}
+
+void Planner::resetStats()
+{
+	stats_.requests = 0;
+	stats_.cached = 0;
+	stats_.searches = 0;
+	stats_.expansions = 0;
+}
+
+/*
+ * Actions
+ */
+
+Planner::ActionId Planner::addAction(char const * name, float cost, Condition const & pre, Condition const & effect,
+	uint32_t flags, Leaf perform, int32_t param)
+{
+	assert(actions_.size() < NO_ACTION && cost > 0.0f);
+
+	Action a;
+	a.name = name;
+	a.cost = cost;
+	a.pre = pre;
+	a.effect = effect;
+	a.flags = flags;
+	a.perform = perform;
+	a.param = param;
+	a.enabled = true;
+	actions_.push_back(a);
+
+	++version_;
+	rescale();
+	return (ActionId)(actions_.size() - 1);
+}
+
+void Planner::setCost(ActionId a, float cost)
+{
+	assert(a < actions_.size() && cost > 0.0f);
+	if (actions_[a].cost == cost)
+		return;
+	actions_[a].cost = cost;
+	rescale();
+
+	if (actions_[a].flags)
+		invalidate(actions_[a].flags);
+	else
+		++version_;
+}
+
+void Planner::setEnabled(ActionId a, bool enabled)
+{
+	assert(a < actions_.size());
+	if (actions_[a].enabled == enabled)
+		return;
+	actions_[a].enabled = enabled;
+
+	if (actions_[a].flags)
+		invalidate(actions_[a].flags);
+	else
+		++version_;
+}
+
+void Planner::rescale()
+{
+	// Cheapest cost per fact an action sets; disabled actions count too,
+	// which only makes the estimate lower
+	per_fact_ = FLT_MAX;
+	for (size_t i = 0; i < actions_.size(); ++i)
+	{
+		uint32_t bits = popcount(actions_[i].effect.mask);
+		if (bits)
+			per_fact_ = std::min(per_fact_, actions_[i].cost / (float)bits);
+	}
+	if (per_fact_ == FLT_MAX)
+		per_fact_ = 0.0f;
+}
+
+ai::STATUS Planner::perform(ActionId a, void * context, uint32_t agent) const
+{
+	Action const & act = actions_[a];
+	if (!act.perform)
+		return STATUS_SUCCESS;
+	return act.perform(context, agent, act.param);
+}
+
+/*
+ * Tickets: slot + 1 in the low bits, slot generation above
+ */
+
+Planner::Request const * Planner::find(Ticket t) const
+{
+	uint32_t slot = (t & SLOT_MASK) - 1;
+	if (t == 0 || slot >= requests_.size())
+		return 0;
+	Request const & r = requests_[slot];
+	if (!r.live || (r.generation & (0xffffffffu >> SLOT_BITS)) != (t >> SLOT_BITS))
+		return 0;
+	return &r;
+}
+
+Planner::Ticket Planner::request(WorldState start, Condition const & goal)
+{
+	++stats_.requests;
+
+	uint32_t slot;
+	if (!free_requests_.empty())
+	{
+		slot = free_requests_.back();
+		free_requests_.pop_back();
+	}
+	else
+	{
+		slot = (uint32_t)requests_.size();
+		requests_.push_back(Request());
+		requests_.back().generation = 0;
+	}
+
+	Request & r = requests_[slot];
+	r.live = true;
+	++r.generation;
+
+	Key key = { start, goal.mask, goal.value };
+	std::unordered_map<Key, int32_t, KeyHash>::const_iterator it = index_.find(key);
+
+	int32_t e;
+	if (it != index_.end() &&
+		(entries_[it->second].state == ENTRY_PENDING || entries_[it->second].version == version_))
+	{
+		e = it->second;
+		++stats_.cached;
+	}
+	else
+	{
+		e = allocate(key);
+		queue_.push_back(e);
+	}
+
+	++entries_[e].pins;
+	touch(e);
+	r.entry = e;
+
+	return ((r.generation & (0xffffffffu >> SLOT_BITS)) << SLOT_BITS) | (slot + 1);
+}
+
+Planner::STATUS Planner::status(Ticket t) const
+{
+	Request const * r = find(t);
+	if (!r)
+		return PLAN_INVALID;
+
+	switch (entries_[r->entry].state)
+	{
+		case ENTRY_PENDING:	return PLAN_PENDING;
+		case ENTRY_FOUND:	return PLAN_FOUND;
+		default:			return PLAN_FAILED;
+	}
+}
+
+bool Planner::plan(Ticket t, std::vector<ActionId> & out) const
+{
+	if (status(t) != PLAN_FOUND)
+		return false;
+	out = entries_[find(t)->entry].plan;
+	return true;
+}
+
+void Planner::release(Ticket t)
+{
+	if (!find(t))
+		return;
+
+	uint32_t slot = (t & SLOT_MASK) - 1;
+	Request & r = requests_[slot];
+	--entries_[r.entry].pins;
+	r.live = false;
+	free_requests_.push_back(slot);
+}
+
+/*
+ * Cache entries: an intrusive LRU list over a slot array, as PathService
+ */
+
+void Planner::unlink(int32_t e)
+{
+	Entry & en = entries_[e];
+	if (en.prev >= 0)
+		entries_[en.prev].next = en.next;
+	else
+		head_ = en.next;
+	if (en.next >= 0)
+		entries_[en.next].prev = en.prev;
+	else
+		tail_ = en.prev;
+	en.prev = en.next = -1;
+}
+
+void Planner::touch(int32_t e)
+{
+	if (head_ == e)
+		return;
+	unlink(e);
+	Entry & en = entries_[e];
+	en.next = head_;
+	if (head_ >= 0)
+		entries_[head_].prev = e;
+	head_ = e;
+	if (tail_ < 0)
+		tail_ = e;
+}
+
+void Planner::forget(int32_t e)
+{
+	std::unordered_map<Key, int32_t, KeyHash>::iterator it = index_.find(entries_[e].key);
+	if (it != index_.end() && it->second == e)
+		index_.erase(it);
+}
+
+int32_t Planner::allocate(Key const & key)
+{
+	int32_t e = -1;
+
+	if (entries_.size() - free_entries_.size() >= cache_size_)
+	{
+		// Evict the least recently used entry nobody is waiting on
+		for (int32_t c = tail_; c >= 0 && e < 0; c = entries_[c].prev)
+			if (entries_[c].pins == 0 && entries_[c].state != ENTRY_PENDING)
+				e = c;
+		if (e >= 0)
+		{
+			unlink(e);
+			forget(e);
+		}
+	}
+	if (e < 0 && !free_entries_.empty())
+	{
+		e = free_entries_.back();
+		free_entries_.pop_back();
+	}
+	if (e < 0)
+	{
+		e = (int32_t)entries_.size();
+		entries_.push_back(Entry());
+	}
+
+	Entry & en = entries_[e];
+	en.key = key;
+	en.version = version_;
+	en.depends = 0;
+	en.state = ENTRY_PENDING;
+	en.pins = 0;
+	en.prev = en.next = -1;
+	en.plan.clear();
+
+	index_[key] = e;		// replaces a stale entry, which lives on for its tickets
+	touch(e);
+	return e;
+}
+
+void Planner::invalidate(uint32_t flags)
+{
+	// A suspended search that has already used a changed action starts over
+	if (active_ >= 0 && (depends_ & flags))
+		active_ = -1;
+
+	for (int32_t e = head_, next; e >= 0; e = next)
+	{
+		Entry & en = entries_[e];
+		next = en.next;
+		if (en.state == ENTRY_PENDING || !(en.depends & flags))
+			continue;
+
+		// Entries with tickets live on for them, but are never shared again
+		forget(e);
+		if (en.pins == 0)
+		{
+			unlink(e);
+			en.state = ENTRY_FREE;
+			free_entries_.push_back(e);
+		}
+	}
+}
+
+/*
+ * Searching
+ */
+
+void Planner::update(size_t budget)
+{
+	while (!queue_.empty())
+	{
+		int32_t e = queue_.front();
+
+		if (entries_[e].pins == 0)
+		{
+			// Every requester gave up; don't search for nobody
+			queue_.pop_front();
+			unlink(e);
+			forget(e);
+			entries_[e].state = ENTRY_FREE;
+			free_entries_.push_back(e);
+			if (active_ == e)
+				active_ = -1;
+			continue;
+		}
+
+		// Adding or changing actions under a suspended search restarts it
+		if (active_ != e || active_version_ != version_)
+			begin(e);
+
+		if (!search(e, budget))
+			return;
+
+		queue_.pop_front();
+		active_ = -1;
+		++stats_.searches;
+	}
+}
+
+float Planner::estimate(WorldState s, Condition const & goal) const
+{
+	return (float)popcount((s & goal.mask) ^ goal.value) * per_fact_;
+}
+
+// Slot of s in the visited table, claimed with node -1 if s is new
+size_t Planner::visit(WorldState s)
+{
+	size_t mask = visit_state_.size() - 1;
+	for (size_t i = (size_t)mix(s) & mask;; i = (i + 1) & mask)
+	{
+		if (visit_stamp_[i] != stamp_)
+		{
+			visit_stamp_[i] = stamp_;
+			visit_state_[i] = s;
+			visit_node_[i] = -1;
+			return i;
+		}
+		if (visit_state_[i] == s)
+			return i;
+	}
+}
+
+void Planner::begin(int32_t e)
+{
+	if (++stamp_ == 0)
+	{
+		std::fill(visit_stamp_.begin(), visit_stamp_.end(), 0u);
+		stamp_ = 1;
+	}
+
+	Entry & en = entries_[e];
+	en.version = version_;
+	active_ = e;
+	active_version_ = version_;
+	depends_ = 0;
+
+	Node start = { en.key.start, 0.0f, -1, NO_ACTION, false };
+	nodes_.clear();
+	nodes_.push_back(start);
+	visit_node_[visit(en.key.start)] = 0;
+
+	Condition goal(en.key.mask, en.key.value);
+	open_.clear();
+	open_.push_back(OpenNode(estimate(en.key.start, goal), 0));
+}
+
+bool Planner::search(int32_t e, size_t & budget)
+{
+	Entry &		en = entries_[e];
+	Condition	goal(en.key.mask, en.key.value);
+
+	while (!open_.empty())
+	{
+		if (budget == 0)
+			return false;
+
+		std::pop_heap(open_.begin(), open_.end(), std::greater<OpenNode>());
+		int32_t n = open_.back().second;
+		open_.pop_back();
+
+		if (nodes_[n].closed)
+			continue;		// stale heap entry
+		nodes_[n].closed = true;
+		--budget;
+		++stats_.expansions;
+
+		WorldState s = nodes_[n].state;
+		if (goal.holds(s))
+		{
+			for (int32_t c = n; nodes_[c].parent >= 0; c = nodes_[c].parent)
+				en.plan.push_back(nodes_[c].action);
+			std::reverse(en.plan.begin(), en.plan.end());
+			en.state = ENTRY_FOUND;
+			en.depends = depends_;
+			return true;
+		}
+
+		for (size_t a = 0; a < actions_.size(); ++a)
+		{
+			Action const & act = actions_[a];
+			if (!act.pre.holds(s))
+				continue;
+
+			// Disabled actions count: enabling one could change the plan
+			depends_ |= act.flags;
+			if (!act.enabled)
+				continue;
+
+			WorldState t = act.effect.apply(s);
+			if (t == s)
+				continue;
+
+			float g = nodes_[n].g + act.cost;
+			size_t slot = visit(t);
+			int32_t m = visit_node_[slot];
+			if (m < 0)
+			{
+				if (nodes_.size() >= max_nodes_)
+				{
+					// Pool full: the search can only finish with what it has.
+					// The slot was claimed last, so nothing probes past it yet
+					visit_stamp_[slot] = stamp_ - 1;
+					continue;
+				}
+				m = visit_node_[slot] = (int32_t)nodes_.size();
+				Node node = { t, g, n, (ActionId)a, false };
+				nodes_.push_back(node);
+			}
+			else if (nodes_[m].closed || g >= nodes_[m].g)
+				continue;		// the estimate is consistent, so closed nodes are final
+			else
+			{
+				nodes_[m].g = g;
+				nodes_[m].parent = n;
+				nodes_[m].action = (ActionId)a;
+			}
+
+			open_.push_back(OpenNode(g + estimate(t, goal), m));
+			std::push_heap(open_.begin(), open_.end(), std::greater<OpenNode>());
+		}
+	}
+
+	en.state = ENTRY_FAILED;
+	en.depends = depends_;
+	return true;
+}
@@ -0,0 +1,465 @@
+/* ********************************************************************************* *
+ * *  File: Raycast.cpp                                                            * *
+ * *  -----------------                                                            * *
+ * *  COPYRIGHT NOTICE                                                             * *
+ * *  ----------------                                                             * *
+ * *  (C)[2012] - [2015] Deakin University                                         * *
+ * *  All rights reserved.                                                         * *
+ * *  All information contained herein is, and remains the property of Deakin      * *
+ * *  University and the author (Tim Wilkin).                                      * *
+ * *  Dissemination of this information or reproduction of this material is        * *
+ * *  strictly forbidden unless prior written permission is obtained from Deakin   * *
+ * *  University.The right to create derivative works from this material is        * *
+ * *  hereby granted to students enrolled in SIT255, but only for the purposes of  * *
+ * *  assessment while an enrolled student at Deakin University.                   * *
+ * *                                                                               * *
+ * ********************************************************************************* */
+
+#include <algorithm>
+#include <emmintrin.h>
+
+#include "physics/Raycast.h"
+
+/*
+ *		Rays are traced through the hierarchy in packets of four. Each SSE
+ *		lane holds one ray during traversal (slab tests against node bounds);
+ *		at a leaf the roles swap and each lane holds one segment of the leaf
+ *		block, so a single ray is tested against the whole block at once.
+ */
+
+using namespace physics;
+
+namespace {
+
+	// Replace zero direction components so the slab test never computes 0 * inf
+	inline float safe_inverse(float d)
+	{
+		return 1.0f / ((fabs(d) > 1.0e-12f) ? d : ((d < 0.0f) ? -1.0e-12f : 1.0e-12f));
+	}
+
+	inline int lowest_bit(int mask)
+	{
+		int i = 0;
+		while (!(mask & (1 << i)))
+			++i;
+		return i;
+	}
+
+} // close anonymous namespace
+
+
+const size_t SegmentBVH::LEAF_SIZE;
+const size_t SegmentBVH::PACKET_SIZE;
+const int SegmentBVH::MAX_DEPTH;
+
+SegmentBVH::SegmentBVH()
+	: overflow_begin_(0)
+{}
+
+SegmentBVH::SegmentBVH(std::vector<Segment> const & walls)
+	: overflow_begin_(0)
+{
+	build(walls);
+}
+
+void SegmentBVH::build(std::vector<Segment> const & walls)
+{
+	walls_ = walls;
+	alive_.assign(walls_.size(), 1);
+	rebuild();
+}
+
+void SegmentBVH::optimise()
+{
+	rebuild();
+}
+
+void SegmentBVH::rebuild()
+{
+	nodes_.clear();
+	blocks_.clear();
+	slot_.assign(walls_.size(), -1);
+	bounds_ = AABB();
+
+	std::vector<int32_t> ids;
+	ids.reserve(walls_.size());
+	for (size_t i = 0; i < walls_.size(); ++i)
+	{
+		if (!alive_[i])
+			continue;
+		ids.push_back((int32_t)i);
+		bounds_.grow(AABB(walls_[i]));
+	}
+
+	if (!ids.empty())
+	{
+		// A binary tree with leaves of >= 1 segment has at most 2n-1 nodes
+		nodes_.reserve(2 * ids.size());
+		blocks_.reserve(ids.size());
+
+		nodes_.push_back(Node());
+		buildNode(0, ids, 0, ids.size(), 0);
+	}
+	overflow_begin_ = blocks_.size();
+}
+
+void SegmentBVH::setLane(Block & b, size_t lane, Segment const & s, int32_t id)
+{
+	b.px[lane] = s.start().x;
+	b.py[lane] = s.start().y;
+	b.ex[lane] = s.end().x - s.start().x;
+	b.ey[lane] = s.end().y - s.start().y;
+	b.nx[lane] = s.normal().x;
+	b.ny[lane] = s.normal().y;
+	b.id[lane] = id;
+}
+
+void SegmentBVH::clearLane(Block & b, size_t lane)
+{
+	// A degenerate segment (e = 0) is always rejected by the intersection test
+	b.px[lane] = b.py[lane] = b.ex[lane] = b.ey[lane] = b.nx[lane] = b.ny[lane] = 0.0f;
+	b.id[lane] = -1;
+}
+
+size_t SegmentBVH::insert(Segment const & s)
+{
+	size_t id = walls_.size();
+	walls_.push_back(s);
+	alive_.push_back(1);
+	bounds_.grow(AABB(s));
+	slot_.push_back(place(s, id));
+	return id;
+}
+
+int32_t SegmentBVH::place(Segment const & s, size_t id)
+{
+	// Fill the last overflow block before starting a new one
+	size_t lane = LEAF_SIZE;
+	if (blocks_.size() > overflow_begin_)
+	{
+		Block const & last = blocks_.back();
+		for (size_t k = 0; k < LEAF_SIZE && lane == LEAF_SIZE; ++k)
+			if (last.id[k] < 0)
+				lane = k;
+	}
+	if (lane == LEAF_SIZE)
+	{
+		Block b;
+		for (size_t k = 0; k < LEAF_SIZE; ++k)
+			clearLane(b, k);
+		blocks_.push_back(b);
+		lane = 0;
+	}
+
+	setLane(blocks_.back(), lane, s, (int32_t)id);
+	return (int32_t)((blocks_.size() - 1) * LEAF_SIZE + lane);
+}
+
+void SegmentBVH::remove(size_t id)
+{
+	if (id >= walls_.size() || !alive_[id])
+		return;
+
+	alive_[id] = 0;
+	if (slot_[id] >= 0)
+		clearLane(blocks_[slot_[id] / LEAF_SIZE], slot_[id] % LEAF_SIZE);
+	slot_[id] = -1;
+}
+
+void SegmentBVH::replace(size_t id, Segment const & s)
+{
+	walls_[id] = s;
+	alive_[id] = 1;
+	bounds_.grow(AABB(s));
+	if (slot_[id] >= 0)
+		setLane(blocks_[slot_[id] / LEAF_SIZE], slot_[id] % LEAF_SIZE, s, (int32_t)id);
+	else
+		slot_[id] = place(s, id);
+}
+
+void SegmentBVH::refit()
+{
+	// Children are always stored after their parent, so a reverse sweep meets them first.
+	// A leaf left with no live lanes gets an empty (inverted) box and drops out of its parent.
+	for (size_t k = nodes_.size(); k-- > 0; )
+	{
+		Node & node = nodes_[k];
+		AABB box;
+		if (node.count > 0)
+		{
+			Block const & b = blocks_[node.first];
+			for (uint16_t i = 0; i < node.count; ++i)
+				if (b.id[i] >= 0)
+					box.grow(AABB(walls_[b.id[i]]));
+		}
+		else
+		{
+			for (int32_t c = node.first; c <= node.first + 1; ++c)
+				box.grow(AABB(POINT2(nodes_[c].lo[0], nodes_[c].lo[1]), POINT2(nodes_[c].hi[0], nodes_[c].hi[1])));
+		}
+		node.lo[0] = box.lo.x;	node.lo[1] = box.lo.y;
+		node.hi[0] = box.hi.x;	node.hi[1] = box.hi.y;
+	}
+
+	bounds_ = nodes_.empty() ? AABB() : AABB(POINT2(nodes_[0].lo[0], nodes_[0].lo[1]), POINT2(nodes_[0].hi[0], nodes_[0].hi[1]));
+	for (size_t k = overflow_begin_; k < blocks_.size(); ++k)
+		for (size_t i = 0; i < LEAF_SIZE; ++i)
+			if (blocks_[k].id[i] >= 0)
+				bounds_.grow(AABB(walls_[blocks_[k].id[i]]));
+}
+
+void SegmentBVH::buildNode(int32_t index, std::vector<int32_t> & ids, size_t begin, size_t end, int depth)
+{
+	AABB box, centres;
+	for (size_t i = begin; i < end; ++i)
+	{
+		AABB b(walls_[ids[i]]);
+		box.grow(b);
+		centres.grow(b.centre());
+	}
+
+	Node node;
+	node.lo[0] = box.lo.x;	node.lo[1] = box.lo.y;
+	node.hi[0] = box.hi.x;	node.hi[1] = box.hi.y;
+	node.axis = 0;
+
+	size_t n = end - begin;
+	if (n <= LEAF_SIZE || depth >= MAX_DEPTH - 2)
+	{
+		// Leaf: pack the segments SoA, padding unused lanes with degenerate
+		// segments (e = 0) which the intersection test always rejects
+		Block b;
+		for (size_t k = 0; k < LEAF_SIZE; ++k)
+			clearLane(b, k);
+		n = math::min(n, LEAF_SIZE);
+		for (size_t k = 0; k < n; ++k)
+		{
+			setLane(b, k, walls_[ids[begin + k]], ids[begin + k]);
+			slot_[ids[begin + k]] = (int32_t)(blocks_.size() * LEAF_SIZE + k);
+		}
+		node.first = (int32_t)blocks_.size();
+		node.count = (uint16_t)n;
+		blocks_.push_back(b);
+		nodes_[index] = node;
+		return;
+	}
+
+	// Interior: median split of the segment centres along the longest axis
+	VECTOR2 ext = centres.extent();
+	int axis = (ext.y > ext.x) ? 1 : 0;
+	size_t mid = begin + n / 2;
+
+	std::nth_element(ids.begin() + begin, ids.begin() + mid, ids.begin() + end,
+		[this, axis](int32_t a, int32_t b)
+		{
+			return AABB(walls_[a]).centre()[axis] < AABB(walls_[b]).centre()[axis];
+		});
+
+	node.first = (int32_t)nodes_.size();
+	node.count = 0;
+	node.axis = (uint16_t)axis;
+	nodes_[index] = node;
+
+	nodes_.push_back(Node());
+	nodes_.push_back(Node());
+	buildNode(node.first, ids, begin, mid, depth + 1);
+	buildNode(node.first + 1, ids, mid, end, depth + 1);
+}
+
+bool SegmentBVH::cast(Ray const & ray, RayHit & hit, RAY_QUERY q) const
+{
+	castPacket(&ray, &hit, 1, q);
+	return hit.hit();
+}
+
+void SegmentBVH::cast(Ray const * rays, RayHit * hits, size_t n, RAY_QUERY q) const
+{
+	for (size_t i = 0; i < n; i += PACKET_SIZE)
+		castPacket(rays + i, hits + i, math::min(PACKET_SIZE, n - i), q);
+}
+
+bool SegmentBVH::lineOfSight(POINT2 const & a, POINT2 const & b) const
+{
+	uint8_t visible;
+	lineOfSight(&a, &b, &visible, 1);
+	return visible != 0;
+}
+
+void SegmentBVH::lineOfSight(POINT2 const * a, POINT2 const * b, uint8_t * visible, size_t n) const
+{
+	Ray		rays[PACKET_SIZE];
+	RayHit	hits[PACKET_SIZE];
+
+	for (size_t i = 0; i < n; i += PACKET_SIZE)
+	{
+		size_t m = math::min(PACKET_SIZE, n - i);
+		for (size_t k = 0; k < m; ++k)
+		{
+			VECTOR2 d = b[i + k] - a[i + k];
+			float	len = d.length();
+			rays[k] = Ray(a[i + k], (len > 0.0f) ? VECTOR2(d / len) : VECTOR2(1, 0), len);
+			hits[k] = RayHit();
+		}
+		castPacket(rays, hits, m, RAY_QUERY::ANY_HIT);
+		for (size_t k = 0; k < m; ++k)
+			visible[i + k] = hits[k].hit() ? 0 : 1;
+	}
+}
+
+bool SegmentBVH::testBlock(Block const & b, size_t block, int k, float const * ox, float const * oy,
+						   float const * dx, float const * dy, float * tmax, int32_t * seg) const
+{
+	__m128 const zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+	__m128 px = _mm_loadu_ps(b.px), py = _mm_loadu_ps(b.py);
+	__m128 ex = _mm_loadu_ps(b.ex), ey = _mm_loadu_ps(b.ey);
+
+	__m128 rdx = _mm_set1_ps(dx[k]), rdy = _mm_set1_ps(dy[k]);
+	__m128 wx = _mm_sub_ps(px, _mm_set1_ps(ox[k]));
+	__m128 wy = _mm_sub_ps(py, _mm_set1_ps(oy[k]));
+
+	// o + t d = p + s e  =>  t = (w x e) / (d x e), s = (w x d) / (d x e)
+	__m128 denom = _mm_sub_ps(_mm_mul_ps(rdx, ey), _mm_mul_ps(rdy, ex));
+	__m128 inv	 = _mm_div_ps(one, denom);
+	__m128 t = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(wx, ey), _mm_mul_ps(wy, ex)), inv);
+	__m128 s = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(wx, rdy), _mm_mul_ps(wy, rdx)), inv);
+
+	__m128 ok = _mm_cmpneq_ps(denom, zero);
+	ok = _mm_and_ps(ok, _mm_cmpge_ps(t, zero));
+	ok = _mm_and_ps(ok, _mm_cmple_ps(t, _mm_set1_ps(tmax[k])));
+	ok = _mm_and_ps(ok, _mm_cmpge_ps(s, zero));
+	ok = _mm_and_ps(ok, _mm_cmple_ps(s, one));
+
+	int hitmask = _mm_movemask_ps(ok);
+	if (!hitmask)
+		return false;
+
+	float tv[LEAF_SIZE];
+	_mm_storeu_ps(tv, t);
+	for (size_t j = 0; j < LEAF_SIZE; ++j)
+	{
+		if ((hitmask & (1 << j)) && tv[j] <= tmax[k])
+		{
+			tmax[k] = tv[j];
+			seg[k] = (int32_t)(block * LEAF_SIZE + j);
+		}
+	}
+	return true;
+}
+
+void SegmentBVH::castPacket(Ray const * rays, RayHit * hits, size_t n, RAY_QUERY q) const
+{
+	for (size_t k = 0; k < n; ++k)
+		hits[k] = RayHit();
+
+	if (n == 0 || (nodes_.empty() && blocks_.empty()))
+		return;
+
+	// Per-lane ray data; unused lanes are inactive from the start
+	float ox[PACKET_SIZE], oy[PACKET_SIZE], dx[PACKET_SIZE], dy[PACKET_SIZE];
+	float ix[PACKET_SIZE], iy[PACKET_SIZE], tmax[PACKET_SIZE];
+	int32_t seg[PACKET_SIZE];
+	int	active = 0;
+
+	for (size_t k = 0; k < PACKET_SIZE; ++k)
+	{
+		Ray const & r = rays[k < n ? k : 0];
+		ox[k] = r.origin.x;		oy[k] = r.origin.y;
+		dx[k] = r.direction.x;	dy[k] = r.direction.y;
+		ix[k] = safe_inverse(dx[k]);
+		iy[k] = safe_inverse(dy[k]);
+		tmax[k] = r.max_t;
+		seg[k] = -1;
+		if (k < n)
+			active |= (1 << k);
+	}
+
+	__m128 const vox = _mm_loadu_ps(ox), voy = _mm_loadu_ps(oy);
+	__m128 const vix = _mm_loadu_ps(ix), viy = _mm_loadu_ps(iy);
+	__m128 const zero = _mm_setzero_ps();
+
+	int32_t stack[MAX_DEPTH];
+	int		top = 0;
+	if (!nodes_.empty())
+		stack[top++] = 0;
+
+	while (top > 0 && active)
+	{
+		Node const & node = nodes_[stack[--top]];
+
+		// Slab test of all four rays against the node bounds
+		__m128 vtmax = _mm_loadu_ps(tmax);
+		__m128 t0x = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.lo[0]), vox), vix);
+		__m128 t1x = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.hi[0]), vox), vix);
+		__m128 t0y = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.lo[1]), voy), viy);
+		__m128 t1y = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.hi[1]), voy), viy);
+		__m128 tnear = _mm_max_ps(_mm_max_ps(_mm_min_ps(t0x, t1x), _mm_min_ps(t0y, t1y)), zero);
+		__m128 tfar  = _mm_min_ps(_mm_min_ps(_mm_max_ps(t0x, t1x), _mm_max_ps(t0y, t1y)), vtmax);
+
+		int mask = _mm_movemask_ps(_mm_cmple_ps(tnear, tfar)) & active;
+		if (!mask)
+			continue;
+
+		if (node.count == 0)
+		{
+			// Visit the nearer child first (pushed last) using the first live ray
+			int lead = lowest_bit(mask);
+			float d = node.axis ? dy[lead] : dx[lead];
+			if (d < 0.0f)
+			{
+				stack[top++] = node.first;
+				stack[top++] = node.first + 1;
+			}
+			else
+			{
+				stack[top++] = node.first + 1;
+				stack[top++] = node.first;
+			}
+			continue;
+		}
+
+		// Leaf: test each overlapping ray against the four segments of the block
+		while (mask)
+		{
+			int k = lowest_bit(mask);
+			mask &= ~(1 << k);
+
+			if (testBlock(blocks_[node.first], node.first, k, ox, oy, dx, dy, tmax, seg) &&
+				q == RAY_QUERY::ANY_HIT)
+				active &= ~(1 << k);
+		}
+	}
+
+	// Walls inserted since the last build are not in the tree
+	for (size_t b = overflow_begin_; b < blocks_.size() && active; ++b)
+	{
+		int mask = active;
+		while (mask)
+		{
+			int k = lowest_bit(mask);
+			mask &= ~(1 << k);
+
+			if (testBlock(blocks_[b], b, k, ox, oy, dx, dy, tmax, seg) &&
+				q == RAY_QUERY::ANY_HIT)
+				active &= ~(1 << k);
+		}
+	}
+
+	// Resolve hit records from the winning block lane
+	for (size_t k = 0; k < n; ++k)
+	{
+		if (seg[k] < 0)
+			continue;
+
+		Block const & b = blocks_[seg[k] / LEAF_SIZE];
+		size_t j = seg[k] % LEAF_SIZE;
+
+		VECTOR2 normal(b.nx[j], b.ny[j]);
+		if (normal.x * dx[k] + normal.y * dy[k] > 0.0f)
+			normal = -normal;
+
+		hits[k].distance = tmax[k];
+		hits[k].point	 = POINT2(ox[k] + dx[k] * tmax[k], oy[k] + dy[k] * tmax[k]);
+		hits[k].normal	 = normal;
+		hits[k].segment	 = b.id[j];
+	}
+}
@@ -0,0 +1,477 @@
+/* ********************************************************************************* *
+ * *  File: Script.cpp                                                             * *
+ * *  ----------------                                                             * *
+ * *  COPYRIGHT NOTICE                                                             * *
+ * *  ----------------                                                             * *
+ * *  (C)[2012] - [2015] Deakin University                                         * *
+ * *  All rights reserved.                                                         * *
+ * *  All information contained herein is, and remains the property of Deakin      * *
+ * *  University and the author (Tim Wilkin).                                      * *
+ * *  Dissemination of this information or reproduction of this material is        * *
+ * *  strictly forbidden unless prior written permission is obtained from Deakin   * *
+ * *  University.The right to create derivative works from this material is        * *
+ * *  hereby granted to students enrolled in SIT255, but only for the purposes of  * *
+ * *  assessment while an enrolled student at Deakin University.                   * *
+ * *                                                                               * *
+ * ********************************************************************************* */
+
+#include <assert.h>
+#include <math.h>
+#include <new>
+
+#include "ai/Script.h"
+
+using namespace ai;
+
+namespace {
+
+	const uint32_t	SLOT_BITS = 20;
+	const uint32_t	SLOT_MASK = (1u << SLOT_BITS) - 1;
+
+	/*
+	 * Frame pool: power of two classes from 64 bytes to 4 KB, each a free
+	 * list threaded through its free frames, refilled a 64 KB block at a time
+	 */
+	const size_t	MIN_SHIFT = 6;
+	const size_t	CLASSES = 7;
+	const size_t	BLOCK_SIZE = 64 * 1024;
+
+	struct FramePool
+	{
+		void *				free[CLASSES];
+		std::vector<char *>	blocks;
+
+		FramePool()
+		{
+			for (size_t c = 0; c < CLASSES; ++c)
+				free[c] = 0;
+		}
+
+		~FramePool()
+		{
+			for (size_t i = 0; i < blocks.size(); ++i)
+				::operator delete(blocks[i]);
+		}
+
+		static size_t class_of(size_t size)
+		{
+			size_t c = 0;
+			while (((size_t)1 << (c + MIN_SHIFT)) < size)
+				++c;
+			return c;
+		}
+
+		void refill(size_t c)
+		{
+			size_t size = (size_t)1 << (c + MIN_SHIFT);
+			char * block = (char *)::operator new(BLOCK_SIZE);
+			blocks.push_back(block);
+			for (size_t i = BLOCK_SIZE / size; i-- > 0;)
+			{
+				void * frame = block + i * size;
+				*(void **)frame = free[c];
+				free[c] = frame;
+			}
+		}
+	};
+
+	// One per thread: schedulers on different job threads never share a free list
+	FramePool & frame_pool()
+	{
+		static thread_local FramePool pool;
+		return pool;
+	}
+
+	// Lists: ready, being resumed, the two wheels, then overflow
+	const int32_t	LIST_READY = 0;
+	const int32_t	LIST_RESUMING = 1;
+	const int32_t	LIST_WHEEL0 = 2;
+	const int32_t	LIST_WHEEL1 = LIST_WHEEL0 + (int32_t)ScriptScheduler::WHEEL_SIZE;
+	const int32_t	LIST_OVERFLOW = LIST_WHEEL1 + (int32_t)ScriptScheduler::WHEEL_SIZE;
+	const int32_t	LIST_EVENTS = LIST_OVERFLOW + 1;
+
+	// Whole ticks in seconds, forgiving float error (2s of 1/60s ticks is 120, not 121)
+	inline uint32_t to_ticks(float seconds, float tick)
+	{
+		float n = ceilf(seconds / tick - 1.0e-3f);
+		return n > 1.0f ? (uint32_t)n : 1;
+	}
+
+} // close anonymous namespace
+
+const uint32_t	ScriptScheduler::WHEEL_BITS;
+const uint32_t	ScriptScheduler::WHEEL_SIZE;
+
+void * ai::allocate_frame(size_t size)
+{
+	size_t c = FramePool::class_of(size);
+	if (c >= CLASSES)
+		return ::operator new(size);
+
+	FramePool & pool = frame_pool();
+	if (!pool.free[c])
+		pool.refill(c);
+	void * frame = pool.free[c];
+	pool.free[c] = *(void **)frame;
+	return frame;
+}
+
+void ai::free_frame(void * p, size_t size)
+{
+	size_t c = FramePool::class_of(size);
+	if (c >= CLASSES)
+	{
+		::operator delete(p);
+		return;
+	}
+
+	FramePool & pool = frame_pool();
+	*(void **)p = pool.free[c];
+	pool.free[c] = p;
+}
+
+/*
+ * Script
+ */
+
+std::coroutine_handle<> Script::promise_type::Final::await_suspend(Handle h) noexcept
+{
+	if (h.promise().caller)
+		return h.promise().caller;
+	return std::noop_coroutine();
+}
+
+Script & Script::operator=(Script && s)
+{
+	if (this != &s)
+	{
+		if (handle_)
+			handle_.destroy();
+		handle_ = s.handle_;
+		s.handle_ = Handle();
+	}
+	return *this;
+}
+
+/*
+ * ScriptScheduler
+ */
+
+ScriptScheduler::ScriptScheduler(float tick)
+	: tick_(tick),
+	  elapsed_(0.0f),
+	  now_(0),
+	  live_(0),
+	  running_(-1)
+{
+	assert(tick > 0.0f);
+	List empty = { -1, -1 };
+	lists_.resize(LIST_EVENTS, empty);
+}
+
+ScriptScheduler::~ScriptScheduler()
+{
+	for (size_t r = 0; r < records_.size(); ++r)
+		if (records_[r].root)
+			records_[r].root.destroy();
+}
+
+/*
+ * Ids: slot + 1 in the low bits, slot generation above
+ */
+
+ScriptScheduler::Record const * ScriptScheduler::find(Id id) const
+{
+	uint32_t slot = (id & SLOT_MASK) - 1;
+	if (id == 0 || slot >= records_.size())
+		return 0;
+	Record const & r = records_[slot];
+	if (!r.root || (r.generation & (0xffffffffu >> SLOT_BITS)) != (id >> SLOT_BITS))
+		return 0;
+	return &r;
+}
+
+bool ScriptScheduler::running(Id id) const
+{
+	return find(id) != 0;
+}
+
+ScriptScheduler::Id ScriptScheduler::start(Script && script, uint32_t agent)
+{
+	assert(script.handle_ && !script.handle_.done());
+
+	uint32_t slot;
+	if (!free_records_.empty())
+	{
+		slot = free_records_.back();
+		free_records_.pop_back();
+	}
+	else
+	{
+		slot = (uint32_t)records_.size();
+		records_.push_back(Record());
+		records_.back().generation = 0;
+	}
+
+	Record & r = records_[slot];
+	r.root = script.handle_;
+	r.resume = script.handle_;
+	r.agent = agent;
+	++r.generation;
+	r.list = -1;
+	r.prev = r.next = -1;
+	r.test = 0;
+	r.context = 0;
+	script.handle_ = Script::Handle();
+
+	Script::promise_type & p = r.root.promise();
+	p.scheduler = this;
+	p.record = (int32_t)slot;
+
+	++live_;
+	link((int32_t)slot, LIST_READY);
+	return ((r.generation & (0xffffffffu >> SLOT_BITS)) << SLOT_BITS) | (slot + 1);
+}
+
+void ScriptScheduler::kill(Id id)
+{
+	if (!find(id))
+		return;
+
+	int32_t r = (int32_t)((id & SLOT_MASK) - 1);
+	assert(r != running_);		// a script ends itself by returning
+
+	unlink(r);
+	records_[r].root.destroy();
+	records_[r].root = Script::Handle();
+	free_records_.push_back((uint32_t)r);
+	--live_;
+}
+
+/*
+ * Intrusive lists over the records, first in first out
+ */
+
+void ScriptScheduler::link(int32_t r, int32_t list)
+{
+	Record & rec = records_[r];
+	List & l = lists_[list];
+	rec.list = list;
+	rec.prev = l.tail;
+	rec.next = -1;
+	if (l.tail >= 0)
+		records_[l.tail].next = r;
+	else
+		l.head = r;
+	l.tail = r;
+}
+
+void ScriptScheduler::unlink(int32_t r)
+{
+	Record & rec = records_[r];
+	if (rec.list < 0)
+		return;
+	List & l = lists_[rec.list];
+	if (rec.prev >= 0)
+		records_[rec.prev].next = rec.next;
+	else
+		l.head = rec.next;
+	if (rec.next >= 0)
+		records_[rec.next].prev = rec.prev;
+	else
+		l.tail = rec.prev;
+	rec.list = rec.prev = rec.next = -1;
+}
+
+/*
+ * Timer wheel
+ */
+
+void ScriptScheduler::schedule(int32_t r, uint32_t due)
+{
+	records_[r].due = due;
+	uint32_t delta = due - now_;
+	if (delta < WHEEL_SIZE)
+		link(r, LIST_WHEEL0 + (int32_t)(due & (WHEEL_SIZE - 1)));
+	else if (delta < WHEEL_SIZE * WHEEL_SIZE)
+		link(r, LIST_WHEEL1 + (int32_t)((due >> WHEEL_BITS) & (WHEEL_SIZE - 1)));
+	else
+		link(r, LIST_OVERFLOW);
+}
+
+void ScriptScheduler::advance()
+{
+	++now_;
+
+	// Spread the second wheel slot now starting, and every 65536 ticks the overflow, over the first wheel
+	if ((now_ & (WHEEL_SIZE - 1)) == 0)
+	{
+		int32_t lists[2] = { LIST_WHEEL1 + (int32_t)((now_ >> WHEEL_BITS) & (WHEEL_SIZE - 1)), LIST_OVERFLOW };
+		int32_t count = (now_ & (WHEEL_SIZE * WHEEL_SIZE - 1)) == 0 ? 2 : 1;
+		for (int32_t i = 0; i < count; ++i)
+		{
+			int32_t r = lists_[lists[i]].head;
+			lists_[lists[i]].head = lists_[lists[i]].tail = -1;
+			while (r >= 0)
+			{
+				int32_t next = records_[r].next;
+				records_[r].list = records_[r].prev = records_[r].next = -1;
+				schedule(r, records_[r].due);
+				r = next;
+			}
+		}
+	}
+
+	// Fire this tick's slot: polls that fail go round again
+	int32_t slot = LIST_WHEEL0 + (int32_t)(now_ & (WHEEL_SIZE - 1));
+	int32_t r = lists_[slot].head;
+	lists_[slot].head = lists_[slot].tail = -1;
+	while (r >= 0)
+	{
+		Record & rec = records_[r];
+		int32_t next = rec.next;
+		rec.list = rec.prev = rec.next = -1;
+		if (rec.test && !rec.test(rec.context, rec.agent))
+			schedule(r, now_ + rec.period);
+		else
+			link(r, LIST_READY);
+		r = next;
+	}
+}
+
+/*
+ * Events
+ */
+
+ScriptScheduler::EventId ScriptScheduler::event()
+{
+	List empty = { -1, -1 };
+	lists_.push_back(empty);
+	return (EventId)(lists_.size() - 1 - LIST_EVENTS);
+}
+
+void ScriptScheduler::signal(EventId e)
+{
+	int32_t list = LIST_EVENTS + (int32_t)e;
+	assert(list < (int32_t)lists_.size());
+
+	for (int32_t r = lists_[list].head, next; r >= 0; r = next)
+	{
+		Record & rec = records_[r];
+		next = rec.next;
+		if (rec.test && !rec.test(rec.context, rec.agent))
+			continue;
+		unlink(r);
+		link(r, LIST_READY);
+	}
+}
+
+/*
+ * Awaitables
+ */
+
+ScriptScheduler::Awaiter ScriptScheduler::ticks(uint32_t n)
+{
+	Awaiter a = { this, WAIT_TIMER, n > 0 ? n : 1, 0, 0 };
+	return a;
+}
+
+ScriptScheduler::Awaiter ScriptScheduler::sleep(float seconds)
+{
+	return ticks(to_ticks(seconds, tick_));
+}
+
+ScriptScheduler::Awaiter ScriptScheduler::wait(EventId e)
+{
+	Awaiter a = { this, WAIT_EVENT, e, 0, 0 };
+	return a;
+}
+
+ScriptScheduler::Awaiter ScriptScheduler::until(EventId e, Test test, void * context)
+{
+	Awaiter a = { this, WAIT_EVENT, e, test, context };
+	return a;
+}
+
+ScriptScheduler::Awaiter ScriptScheduler::until(Test test, void * context, float period)
+{
+	Awaiter a = { this, WAIT_POLL, to_ticks(period, tick_), test, context };
+	return a;
+}
+
+bool ScriptScheduler::suspend(int32_t r, std::coroutine_handle<> h, Awaiter const & a)
+{
+	assert(a.scheduler == this && r == running_);
+
+	Record & rec = records_[r];
+	rec.test = a.test;
+	rec.context = a.context;
+
+	// A condition that already holds doesn't wait
+	if (a.test && a.test(a.context, rec.agent))
+		return false;
+
+	rec.resume = h;
+	switch (a.kind)
+	{
+		case WAIT_TIMER:
+			schedule(r, now_ + a.arg);
+			break;
+		case WAIT_POLL:
+			rec.period = a.arg;
+			schedule(r, now_ + a.arg);
+			break;
+		default:
+			assert(LIST_EVENTS + (int32_t)a.arg < (int32_t)lists_.size());
+			link(r, LIST_EVENTS + (int32_t)a.arg);
+			break;
+	}
+	return true;
+}
+
+/*
+ * Running
+ */
+
+void ScriptScheduler::run(int32_t r)
+{
+	running_ = r;
+	records_[r].resume.resume();
+	running_ = -1;
+
+	// records_ may have grown under the script
+	Record & rec = records_[r];
+	if (rec.root.done())
+	{
+		rec.root.destroy();
+		rec.root = Script::Handle();
+		free_records_.push_back((uint32_t)r);
+		--live_;
+	}
+	else
+		assert(rec.list >= 0);		// suspended on something other than this scheduler's awaitables
+}
+
+void ScriptScheduler::update(float dt)
+{
+	elapsed_ += dt;
+	while (elapsed_ >= tick_)
+	{
+		elapsed_ -= tick_;
+		advance();
+	}
+
+	// Only scripts ready now: those readied while running wait for the next update.
+	// They stay linked until resumed, so a script can kill one still queued
+	for (int32_t r = lists_[LIST_READY].head; r >= 0; r = records_[r].next)
+		records_[r].list = LIST_RESUMING;
+	lists_[LIST_RESUMING] = lists_[LIST_READY];
+	lists_[LIST_READY].head = lists_[LIST_READY].tail = -1;
+
+	while (lists_[LIST_RESUMING].head >= 0)
+	{
+		int32_t r = lists_[LIST_RESUMING].head;
+		unlink(r);
+		run(r);
+	}
+}
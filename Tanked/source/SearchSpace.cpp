@@ -0,0 +1,593 @@
+/* ********************************************************************************* *
+ * *  File: SearchSpace.cpp                                                        * *
+ * *  ---------------------                                                        * *
+ * *  COPYRIGHT NOTICE                                                             * *
+ * *  ----------------                                                             * *
+ * *  (C)[2012] - [2015] Deakin University                                         * *
+ * *  All rights reserved.                                                         * *
+ * *  All information contained herein is, and remains the property of Deakin      * *
+ * *  University and the author (Tim Wilkin).                                      * *
+ * *  Dissemination of this information or reproduction of this material is        * *
+ * *  strictly forbidden unless prior written permission is obtained from Deakin   * *
+ * *  University.The right to create derivative works from this material is        * *
+ * *  hereby granted to students enrolled in SIT255, but only for the purposes of  * *
+ * *  assessment while an enrolled student at Deakin University.                   * *
+ * *                                                                               * *
+ * ********************************************************************************* */
+
+#include <cmath>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "ai/SearchSpace.h"
+
+using namespace ai;
+using namespace level;
+
+namespace {
+
+	const float		SQRT_2 = 1.41421356f;
+
+	inline float distance(POINT2 const & a, POINT2 const & b)
+	{
+		float dx = b.x - a.x, dy = b.y - a.y;
+		return sqrt(dx * dx + dy * dy);
+	}
+
+	// Twice the signed area of abc, positive when counter clockwise
+	inline float orient(POINT2 const & a, POINT2 const & b, POINT2 const & c)
+	{
+		return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+	}
+
+	inline bool same(POINT2 const & a, POINT2 const & b)
+	{
+		return a.x == b.x && a.y == b.y;
+	}
+
+	// Jump directions, straight first: E W N S NE NW SE SW
+	const int		JX[8] = { 1, -1, 0, 0, 1, -1, 1, -1 };
+	const int		JY[8] = { 0, 0, 1, -1, 1, 1, -1, -1 };
+
+	inline int direction(int dx, int dy)
+	{
+		if (dy == 0)
+			return (dx > 0) ? 0 : 1;
+		if (dx == 0)
+			return (dy > 0) ? 2 : 3;
+		return 4 + ((dx > 0) ? 0 : 1) + ((dy > 0) ? 0 : 2);
+	}
+
+	// Entry for a cell whose neighbour along the ray has entry next
+	inline int16_t step_past(int16_t next)
+	{
+		return (int16_t)((next > 0) ? next + 1 : next - 1);
+	}
+
+	inline int sign(int v)
+	{
+		return (v > 0) - (v < 0);
+	}
+
+	// Index of the lowest / highest set bit of a non-zero word
+	inline int lowest_bit(uint64_t w)
+	{
+#ifdef _MSC_VER
+		unsigned long i;
+		if (_BitScanForward(&i, (unsigned long)(w & 0xffffffffu)))
+			return (int)i;
+		_BitScanForward(&i, (unsigned long)(w >> 32));
+		return (int)i + 32;
+#else
+		return __builtin_ctzll(w);
+#endif
+	}
+
+	inline int highest_bit(uint64_t w)
+	{
+#ifdef _MSC_VER
+		unsigned long i;
+		if (_BitScanReverse(&i, (unsigned long)(w >> 32)))
+			return (int)i + 32;
+		_BitScanReverse(&i, (unsigned long)(w & 0xffffffffu));
+		return (int)i;
+#else
+		return 63 - __builtin_clzll(w);
+#endif
+	}
+
+} // close anonymous namespace
+
+const size_t SearchSpace::MAX_NEIGHBOURS;
+
+void SearchSpace::waypoints(std::vector<int32_t> const & path, POINT2 const & start, POINT2 const & goal,
+							std::vector<POINT2> & out) const
+{
+	out.clear();
+	out.push_back(start);
+	for (size_t i = 1; i + 1 < path.size(); ++i)
+		out.push_back(position(path[i]));
+	out.push_back(goal);
+}
+
+size_t SearchSpace::successors(int32_t n, int32_t /*parent*/, int32_t /*goal*/, bool /*precomputed*/,
+								int32_t * out, float * cost) const
+{
+	return neighbours(n, out, cost);
+}
+
+float SearchSpace::distance(int32_t a, int32_t b) const
+{
+	return ::distance(position(a), position(b));
+}
+
+/*
+ * GridSpace
+ */
+
+size_t GridSpace::nodes() const
+{
+	return (size_t)grid_.width() * grid_.height();
+}
+
+int32_t GridSpace::nodeAt(POINT2 const & p) const
+{
+	int x = grid_.toCellX(p.x), y = grid_.toCellY(p.y);
+	if (x < 0 || y < 0 || x >= grid_.width() || y >= grid_.height())
+		return -1;
+
+	// An agent hugging a wall may have its centre in a blocked cell
+	int fx, fy;
+	if (!grid_.nearestFree(x, y, 2, fx, fy))
+		return -1;
+	return fy * grid_.width() + fx;
+}
+
+POINT2 GridSpace::position(int32_t n) const
+{
+	return grid_.centre(n % grid_.width(), n / grid_.width());
+}
+
+size_t GridSpace::neighbours(int32_t n, int32_t * out, float * cost) const
+{
+	static const int DX[8] = { 1, -1, 0, 0, 1, -1, 1, -1 };
+	static const int DY[8] = { 0, 0, 1, -1, 1, 1, -1, -1 };
+
+	int w = grid_.width();
+	int x = n % w, y = n / w;
+	bool open[4];
+	size_t count = 0;
+
+	for (int k = 0; k < 4; ++k)
+	{
+		open[k] = !grid_.blocked(x + DX[k], y + DY[k]);
+		if (open[k])
+		{
+			out[count] = n + DY[k] * w + DX[k];
+			cost[count++] = grid_.cell();
+		}
+	}
+
+	// Diagonals need both orthogonal cells beside them open
+	for (int k = 4; k < 8; ++k)
+	{
+		if (!open[(DX[k] > 0) ? 0 : 1] || !open[(DY[k] > 0) ? 2 : 3] || grid_.blocked(x + DX[k], y + DY[k]))
+			continue;
+		out[count] = n + DY[k] * w + DX[k];
+		cost[count++] = grid_.cell() * SQRT_2;
+	}
+	return count;
+}
+
+float GridSpace::heuristic(int32_t a, int32_t b) const
+{
+	int w = grid_.width();
+	int dx = abs(a % w - b % w), dy = abs(a / w - b / w);
+	return (math::max(dx, dy) + (SQRT_2 - 1.0f) * math::min(dx, dy)) * grid_.cell();
+}
+
+void GridSpace::waypoints(std::vector<int32_t> const & path, POINT2 const & start, POINT2 const & goal,
+						  std::vector<POINT2> & out) const
+{
+	out.clear();
+	out.push_back(start);
+	for (size_t i = 1; i + 1 < path.size(); ++i)
+		if (path[i] - path[i - 1] != path[i + 1] - path[i])
+			out.push_back(position(path[i]));
+	out.push_back(goal);
+}
+
+/*
+ * Jump point search. A jump returns the first jump point along its ray (or
+ * the goal), or -1 when it runs into a wall. With corner cutting forbidden a
+ * straight move is forced to stop beside the end of a wall: a cell to the
+ * side that is open where the cell behind it was blocked.
+ */
+
+int32_t GridSpace::jumpRow(int x, int y, int dx, int32_t goal) const
+{
+	int w = grid_.width(), h = grid_.height(), words = grid_.words();
+	if (x < 0 || x >= w || y < 0 || y >= h)
+		return -1;
+
+	uint64_t const * r = grid_.row(y);
+	uint64_t const * up = (y + 1 < h) ? grid_.row(y + 1) : 0;
+	uint64_t const * dn = (y > 0) ? grid_.row(y - 1) : 0;
+	int gx = (goal / w == y && (goal % w - x) * dx >= 0) ? goal % w : -1;
+
+	// Padding past the last column reads as wall, as do missing rows
+	int last = words - 1;
+	uint64_t pad = (w & 63) ? ~(((uint64_t)1 << (w & 63)) - 1) : 0;
+
+	for (int i = x >> 6; i >= 0 && i < words; i += dx)
+	{
+		uint64_t edge = (i == last) ? pad : 0;
+		uint64_t b = r[i] | edge;
+		uint64_t u = up ? (up[i] | edge) : ~(uint64_t)0;
+		uint64_t d = dn ? (dn[i] | edge) : ~(uint64_t)0;
+
+		// Forced where the side cell is open and the one behind it is not
+		uint64_t stop;
+		if (dx > 0)
+		{
+			uint64_t cu = (i > 0 && up) ? (up[i - 1] >> 63) : 1;
+			uint64_t cd = (i > 0 && dn) ? (dn[i - 1] >> 63) : 1;
+			stop = b | (~u & ((u << 1) | cu)) | (~d & ((d << 1) | cd));
+			if (i == (x >> 6))
+				stop &= ~(((uint64_t)1 << (x & 63)) - 1);
+		}
+		else
+		{
+			uint64_t cu = (i < last && up) ? (up[i + 1] << 63) : ((uint64_t)1 << 63);
+			uint64_t cd = (i < last && dn) ? (dn[i + 1] << 63) : ((uint64_t)1 << 63);
+			stop = b | (~u & ((u >> 1) | cu)) | (~d & ((d >> 1) | cd));
+			if (i == (x >> 6) && (x & 63) != 63)
+				stop &= ((uint64_t)1 << ((x & 63) + 1)) - 1;
+		}
+		if (gx >= 0 && (gx >> 6) == i)
+			stop |= (uint64_t)1 << (gx & 63);
+		if (!stop)
+			continue;
+
+		int bit = (dx > 0) ? lowest_bit(stop) : highest_bit(stop);
+		int px = (i << 6) + bit;
+		if (px != gx && ((b >> bit) & 1))
+			return -1;
+		return y * w + px;
+	}
+	return -1;
+}
+
+int32_t GridSpace::jumpColumn(int x, int y, int dy, int32_t goal) const
+{
+	int w = grid_.width();
+	for (;; y += dy)
+	{
+		if (!open(x, y))
+			return -1;
+		int32_t n = y * w + x;
+		if (n == goal)
+			return n;
+		if ((open(x - 1, y) && !open(x - 1, y - dy)) || (open(x + 1, y) && !open(x + 1, y - dy)))
+			return n;
+	}
+}
+
+int32_t GridSpace::jumpDiagonal(int x, int y, int dx, int dy, int32_t goal) const
+{
+	int w = grid_.width();
+	for (;; x += dx, y += dy)
+	{
+		if (!open(x, y))
+			return -1;
+		int32_t n = y * w + x;
+		if (n == goal)
+			return n;
+
+		// A diagonal cell is a jump point when either straight ray from it finds one
+		if (jumpRow(x + dx, y, dx, goal) >= 0 || jumpColumn(x, y + dy, dy, goal) >= 0)
+			return n;
+		if (!open(x + dx, y) || !open(x, y + dy))
+			return -1;
+	}
+}
+
+int32_t GridSpace::jumpTable(int x, int y, int d, int32_t goal) const
+{
+	int w = grid_.width();
+	int dist = jumps_[((size_t)y * w + x) * 8 + d];
+	int reach = (dist > 0) ? dist : -dist;
+	int gx = goal % w - x, gy = goal / w - y;
+
+	// The goal (or the diagonal cell level with it) may lie short of the jump point
+	if (d < 4)
+	{
+		int along = (JX[d] != 0) ? gx * JX[d] : gy * JY[d];
+		int across = (JX[d] != 0) ? gy : gx;
+		if (across == 0 && along > 0 && along <= reach)
+			return goal;
+	}
+	else if (sign(gx) == JX[d] && sign(gy) == JY[d])
+	{
+		int m = math::min(abs(gx), abs(gy));
+		if (m <= reach)
+			return (y + JY[d] * m) * w + x + JX[d] * m;
+	}
+	return (dist > 0) ? (y + JY[d] * dist) * w + x + JX[d] * dist : -1;
+}
+
+size_t GridSpace::successors(int32_t n, int32_t parent, int32_t goal, bool precomputed,
+							 int32_t * out, float * cost) const
+{
+	int w = grid_.width();
+	int x = n % w, y = n / w;
+	bool table = precomputed && jumpsReady();
+
+	// Directions worth following from n, pruned by the direction it was entered
+	int dirs[8];
+	size_t count = 0;
+	if (parent < 0)
+	{
+		for (int d = 0; d < 8; ++d)
+			if (open(x + JX[d], y) && open(x, y + JY[d]))
+				dirs[count++] = d;
+	}
+	else
+	{
+		int dx = sign(x - parent % w), dy = sign(y - parent / w);
+		if (dx != 0 && dy != 0)
+		{
+			bool ox = open(x + dx, y), oy = open(x, y + dy);
+			if (oy)
+				dirs[count++] = direction(0, dy);
+			if (ox)
+				dirs[count++] = direction(dx, 0);
+			if (ox && oy)
+				dirs[count++] = direction(dx, dy);
+		}
+		else if (dx != 0)
+		{
+			bool ahead = open(x + dx, y), up = open(x, y + 1), down = open(x, y - 1);
+			if (ahead)
+			{
+				dirs[count++] = direction(dx, 0);
+				if (up)
+					dirs[count++] = direction(dx, 1);
+				if (down)
+					dirs[count++] = direction(dx, -1);
+			}
+			if (up)
+				dirs[count++] = direction(0, 1);
+			if (down)
+				dirs[count++] = direction(0, -1);
+		}
+		else
+		{
+			bool ahead = open(x, y + dy), right = open(x + 1, y), left = open(x - 1, y);
+			if (ahead)
+			{
+				dirs[count++] = direction(0, dy);
+				if (right)
+					dirs[count++] = direction(1, dy);
+				if (left)
+					dirs[count++] = direction(-1, dy);
+			}
+			if (right)
+				dirs[count++] = direction(1, 0);
+			if (left)
+				dirs[count++] = direction(-1, 0);
+		}
+	}
+
+	size_t found = 0;
+	for (size_t i = 0; i < count; ++i)
+	{
+		int d = dirs[i];
+		int32_t j;
+		if (table)
+			j = jumpTable(x, y, d, goal);
+		else if (d < 2)
+			j = jumpRow(x + JX[d], y, JX[d], goal);
+		else if (d < 4)
+			j = jumpColumn(x, y + JY[d], JY[d], goal);
+		else
+			j = jumpDiagonal(x + JX[d], y + JY[d], JX[d], JY[d], goal);
+		if (j < 0)
+			continue;
+
+		out[found] = j;
+		cost[found] = heuristic(n, j);
+		++found;
+	}
+	return found;
+}
+
+void GridSpace::prepareJumps()
+{
+	int w = grid_.width(), h = grid_.height();
+	jumps_.assign((size_t)w * h * 8, 0);
+
+	auto jump = [this, w](int x, int y, int d) -> int16_t & { return jumps_[((size_t)y * w + x) * 8 + d]; };
+
+	// Straight runs: a cell entered and found forced is one step away
+	for (int y = 0; y < h; ++y)
+	{
+		for (int x = w - 1; x >= 0; --x)
+			if (open(x + 1, y))
+				jump(x, y, 0) = ((open(x + 1, y - 1) && !open(x, y - 1)) || (open(x + 1, y + 1) && !open(x, y + 1)))
+					? 1 : step_past(jump(x + 1, y, 0));
+		for (int x = 0; x < w; ++x)
+			if (open(x - 1, y))
+				jump(x, y, 1) = ((open(x - 1, y - 1) && !open(x, y - 1)) || (open(x - 1, y + 1) && !open(x, y + 1)))
+					? 1 : step_past(jump(x - 1, y, 1));
+	}
+	for (int x = 0; x < w; ++x)
+	{
+		for (int y = h - 1; y >= 0; --y)
+			if (open(x, y + 1))
+				jump(x, y, 2) = ((open(x - 1, y + 1) && !open(x - 1, y)) || (open(x + 1, y + 1) && !open(x + 1, y)))
+					? 1 : step_past(jump(x, y + 1, 2));
+		for (int y = 0; y < h; ++y)
+			if (open(x, y - 1))
+				jump(x, y, 3) = ((open(x - 1, y - 1) && !open(x - 1, y)) || (open(x + 1, y - 1) && !open(x + 1, y)))
+					? 1 : step_past(jump(x, y - 1, 3));
+	}
+
+	// Diagonals, each sweep ordered so the next cell along is already done
+	for (int d = 4; d < 8; ++d)
+	{
+		int dx = JX[d], dy = JY[d];
+		int sx = (dx > 0) ? 1 : 0, sy = (dy > 0) ? 1 : 0;
+		int hx = (dx > 0) ? 0 : 1, hy = (dy > 0) ? 2 : 3;
+		for (int j = 0; j < h; ++j)
+		{
+			int y = sy ? h - 1 - j : j;
+			for (int i = 0; i < w; ++i)
+			{
+				int x = sx ? w - 1 - i : i;
+				if (!open(x + dx, y) || !open(x, y + dy) || !open(x + dx, y + dy))
+					continue;
+				jump(x, y, d) = (jump(x + dx, y + dy, hx) > 0 || jump(x + dx, y + dy, hy) > 0)
+					? 1 : step_past(jump(x + dx, y + dy, d));
+			}
+		}
+	}
+
+	jump_version_ = grid_.version();
+	jump_dynamic_ = grid_.dynamicVersion();
+}
+
+bool GridSpace::lineOfSight(int32_t a, int32_t b) const
+{
+	int w = grid_.width();
+	int x = a % w, y = a / w, bx = b % w, by = b / w;
+
+	// The pyramid clears most open-ground queries in a few word tests
+	if (!grid_.occupied(math::min(x, bx), math::min(y, by), math::max(x, bx), math::max(y, by)))
+		return true;
+
+	// Walk the cells the segment between the centres passes through; where
+	// it crosses a cell corner exactly both cells beside the corner must be open
+	int sx = sign(bx - x), sy = sign(by - y);
+	int64_t nx = abs(bx - x), ny = abs(by - y);
+	for (int64_t ix = 0, iy = 0; ix < nx || iy < ny; )
+	{
+		int64_t tx = (1 + 2 * ix) * ny, ty = (1 + 2 * iy) * nx;
+		if (tx == ty)
+		{
+			if (!open(x + sx, y) || !open(x, y + sy))
+				return false;
+			x += sx;	++ix;
+			y += sy;	++iy;
+		}
+		else if (tx < ty)
+		{
+			x += sx;	++ix;
+		}
+		else
+		{
+			y += sy;	++iy;
+		}
+		if (!open(x, y))
+			return false;
+	}
+	return true;
+}
+
+/*
+ * NavMeshSpace
+ */
+
+int32_t NavMeshSpace::nodeAt(POINT2 const & p) const
+{
+	int32_t t = mesh_.locate(p);
+	return (t >= 0 && mesh_.walkable(t)) ? t : -1;
+}
+
+size_t NavMeshSpace::neighbours(int32_t n, int32_t * out, float * cost) const
+{
+	size_t count = 0;
+	POINT2 c = mesh_.centroid(n);
+	for (int e = 0; e < 3; ++e)
+	{
+		if (!mesh_.crossable(n, e))
+			continue;
+		out[count] = mesh_.tri(n).adj[e];
+		cost[count] = ::distance(c, mesh_.centroid(out[count]));
+		++count;
+	}
+	return count;
+}
+
+float NavMeshSpace::heuristic(int32_t a, int32_t b) const
+{
+	return ::distance(mesh_.centroid(a), mesh_.centroid(b));
+}
+
+void NavMeshSpace::waypoints(std::vector<int32_t> const & path, POINT2 const & start, POINT2 const & goal,
+							 std::vector<POINT2> & out) const
+{
+	out.clear();
+	out.push_back(start);
+
+	// Portal i is the edge from path[i-1] into path[i], as seen walking through it
+	size_t n = path.size() + 1;
+	std::vector<POINT2> left(n, start), right(n, start);
+	for (size_t i = 1; i < path.size(); ++i)
+	{
+		NavMesh::Tri const & t = mesh_.tri(path[i - 1]);
+		for (int e = 0; e < 3; ++e)
+			if (t.adj[e] == path[i])
+			{
+				left[i] = mesh_.vertex(t.v[(e + 1) % 3]);
+				right[i] = mesh_.vertex(t.v[e]);
+			}
+	}
+	left[n - 1] = right[n - 1] = goal;
+
+	POINT2 apex = start, l = start, r = start;
+	size_t apex_i = 0, l_i = 0, r_i = 0;
+	for (size_t i = 1; i < n; ++i)
+	{
+		// Narrow the right side of the funnel
+		if (orient(apex, r, right[i]) >= 0.0f)
+		{
+			if (same(apex, r) || orient(apex, l, right[i]) < 0.0f)
+			{
+				r = right[i];
+				r_i = i;
+			}
+			else
+			{
+				// Crossed over the left side: its end is a corner of the path
+				out.push_back(l);
+				apex = r = l;
+				apex_i = r_i = l_i;
+				i = apex_i;
+				continue;
+			}
+		}
+
+		// Narrow the left side
+		if (orient(apex, l, left[i]) <= 0.0f)
+		{
+			if (same(apex, l) || orient(apex, r, left[i]) > 0.0f)
+			{
+				l = left[i];
+				l_i = i;
+			}
+			else
+			{
+				out.push_back(r);
+				apex = l = r;
+				apex_i = l_i = r_i;
+				i = apex_i;
+				continue;
+			}
+		}
+	}
+
+	if (!same(out.back(), goal))
+		out.push_back(goal);
+}
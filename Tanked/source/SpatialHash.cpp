@@ -0,0 +1,96 @@
+/* ********************************************************************************* *
+ * *  File: SpatialHash.cpp                                                        * *
+ * *  ---------------------                                                        * *
+ * *  COPYRIGHT NOTICE                                                             * *
+ * *  ----------------                                                             * *
+ * *  (C)[2012] - [2015] Deakin University                                         * *
+ * *  All rights reserved.                                                         * *
+ * *  All information contained herein is, and remains the property of Deakin      * *
+ * *  University and the author (Tim Wilkin).                                      * *
+ * *  Dissemination of this information or reproduction of this material is        * *
+ * *  strictly forbidden unless prior written permission is obtained from Deakin   * *
+ * *  University.The right to create derivative works from this material is        * *
+ * *  hereby granted to students enrolled in SIT255, but only for the purposes of  * *
+ * *  assessment while an enrolled student at Deakin University.                   * *
+ * *                                                                               * *
+ * ********************************************************************************* */
+
+#include <cmath>
+
+#include "ai/SpatialHash.h"
+
+using namespace ai;
+
+SpatialHash::SpatialHash(float cell)
+	: cell_(cell),
+	  inv_cell_(1.0f / cell),
+	  x_(0),
+	  y_(0),
+	  mask_(0)
+{}
+
+void SpatialHash::build(float const * x, float const * y, size_t n)
+{
+	x_ = x;
+	y_ = y;
+
+	uint32_t buckets = 1;
+	while (buckets < n)
+		buckets <<= 1;
+	mask_ = buckets - 1;
+
+	// Counting sort by bucket
+	first_.assign((size_t)buckets + 1, 0);
+	bucket_.resize(n);
+	for (size_t i = 0; i < n; ++i)
+	{
+		bucket_[i] = hash(cellOf(x[i]), cellOf(y[i]));
+		++first_[bucket_[i] + 1];
+	}
+	for (uint32_t b = 0; b < buckets; ++b)
+		first_[b + 1] += first_[b];
+
+	items_.resize(n);
+	for (size_t i = 0; i < n; ++i)
+		items_[first_[bucket_[i]]++] = (int32_t)i;
+
+	// The scatter advanced each start to the next bucket's; shift back
+	for (uint32_t b = buckets; b > 0; --b)
+		first_[b] = first_[b - 1];
+	first_[0] = 0;
+}
+
+size_t SpatialHash::nearest(float px, float py, float radius, int32_t self, size_t max,
+							int32_t * out, float * dist_sqr) const
+{
+	if (max == 0)
+		return 0;
+
+	// Insertion into a short sorted list; max is a small neighbour budget
+	size_t count = 0;
+	query(px, py, radius, [&](int32_t i)
+	{
+		if (i == self)
+			return;
+		float dx = x_[i] - px, dy = y_[i] - py;
+		float q = dx * dx + dy * dy;
+
+		size_t k = count;
+		if (k == max)
+		{
+			if (q > dist_sqr[k - 1] || (q == dist_sqr[k - 1] && i > out[k - 1]))
+				return;
+			--k;
+		}
+		else
+			++count;
+		for (; k > 0 && (q < dist_sqr[k - 1] || (q == dist_sqr[k - 1] && i < out[k - 1])); --k)
+		{
+			out[k] = out[k - 1];
+			dist_sqr[k] = dist_sqr[k - 1];
+		}
+		out[k] = i;
+		dist_sqr[k] = q;
+	});
+	return count;
+}
@@ -0,0 +1,351 @@
+/* ********************************************************************************* *
+ * *  File: Steering.cpp                                                           * *
+ * *  ------------------                                                           * *
+ * *  COPYRIGHT NOTICE                                                             * *
+ * *  ----------------                                                             * *
+ * *  (C)[2012] - [2015] Deakin University                                         * *
+ * *  All rights reserved.                                                         * *
+ * *  All information contained herein is, and remains the property of Deakin      * *
+ * *  University and the author (Tim Wilkin).                                      * *
+ * *  Dissemination of this information or reproduction of this material is        * *
+ * *  strictly forbidden unless prior written permission is obtained from Deakin   * *
+ * *  University.The right to create derivative works from this material is        * *
+ * *  hereby granted to students enrolled in SIT255, but only for the purposes of  * *
+ * *  assessment while an enrolled student at Deakin University.                   * *
+ * *                                                                               * *
+ * ********************************************************************************* */
+
+#include <cmath>
+#include <emmintrin.h>
+
+#include "ai/Steering.h"
+#include "core/Parallel.h"
+
+using namespace ai;
+
+namespace {
+
+	// Four lanes of floats; the helpers below keep the kernels readable
+	typedef __m128	F4;
+
+	inline F4 add4(F4 a, F4 b)	{ return _mm_add_ps(a, b); }
+	inline F4 sub4(F4 a, F4 b)	{ return _mm_sub_ps(a, b); }
+	inline F4 mul4(F4 a, F4 b)	{ return _mm_mul_ps(a, b); }
+	inline F4 splat(float v)	{ return _mm_set1_ps(v); }
+
+	inline F4 load(std::vector<float> const & v, size_t i)		{ return _mm_loadu_ps(&v[i]); }
+	inline void store(std::vector<float> & v, size_t i, F4 a)	{ _mm_storeu_ps(&v[i], a); }
+
+	inline F4 length(F4 x, F4 y)
+	{
+		return _mm_sqrt_ps(add4(mul4(x, x), mul4(y, y)));
+	}
+
+	// Rescale (x, y) to length len; zero vectors stay zero
+	inline void scale_to(F4 & x, F4 & y, F4 len)
+	{
+		F4 const tiny = splat(1.0e-6f);
+		F4 l = length(x, y);
+		F4 s = _mm_and_ps(_mm_cmpgt_ps(l, tiny), _mm_div_ps(len, _mm_max_ps(l, tiny)));
+		x = mul4(x, s);
+		y = mul4(y, s);
+	}
+
+	inline void truncate(F4 & x, F4 & y, F4 max)
+	{
+		F4 const tiny = splat(1.0e-6f);
+		F4 s = _mm_min_ps(splat(1.0f), _mm_div_ps(max, _mm_max_ps(length(x, y), tiny)));
+		x = mul4(x, s);
+		y = mul4(y, s);
+	}
+
+	// Force turning velocity v toward (dx, dy) at speed
+	inline void steer(F4 dx, F4 dy, F4 speed, F4 vx, F4 vy, F4 & fx, F4 & fy)
+	{
+		scale_to(dx, dy, speed);
+		fx = sub4(dx, vx);
+		fy = sub4(dy, vy);
+	}
+
+	// fx += w * gx (and y)
+	inline void blend(F4 & fx, F4 & fy, F4 w, F4 gx, F4 gy)
+	{
+		fx = add4(fx, mul4(w, gx));
+		fy = add4(fy, mul4(w, gy));
+	}
+
+	// xorshift32 per lane, returned in [-1, 1]
+	inline F4 jitter(__m128i & seed)
+	{
+		seed = _mm_xor_si128(seed, _mm_slli_epi32(seed, 13));
+		seed = _mm_xor_si128(seed, _mm_srli_epi32(seed, 17));
+		seed = _mm_xor_si128(seed, _mm_slli_epi32(seed, 5));
+		F4 u = _mm_cvtepi32_ps(_mm_srli_epi32(seed, 8));
+		return sub4(mul4(u, splat(2.0f / 16777216.0f)), splat(1.0f));
+	}
+
+} // close anonymous namespace
+
+const size_t Steering::MAX_NEIGHBOURS;
+
+Steering::Params::Params()
+	: slowing_radius(20.0f),
+	  wander_radius(4.0f),
+	  wander_distance(8.0f),
+	  wander_jitter(40.0f),
+	  wall_range(12.0f),
+	  neighbour_radius(16.0f),
+	  max_neighbours(8)
+{}
+
+Steering::Steering(Params const & params)
+	: params_(params),
+	  count_(0),
+	  walls_(0),
+	  hash_(params.neighbour_radius)
+{
+	params_.max_neighbours = math::min(params_.max_neighbours, MAX_NEIGHBOURS);
+}
+
+void Steering::resize(size_t n)
+{
+	size_t old = x_.size();
+	size_t padded = (n + 3) & ~(size_t)3;
+
+	std::vector<float> * arrays[] = { &x_, &y_, &vx_, &vy_, &max_speed_, &max_force_,
+									  &target_x_, &target_y_, &wander_x_, &wander_y_, &fx_, &fy_ };
+	for (size_t k = 0; k < sizeof(arrays) / sizeof(arrays[0]); ++k)
+		arrays[k]->resize(padded, 0.0f);
+	for (int b = 0; b < STEER_BEHAVIOURS; ++b)
+		weight_[b].resize(padded, 0.0f);
+	quarry_.resize(padded, -1);
+	seed_.resize(padded);
+
+	for (size_t i = old; i < padded; ++i)
+	{
+		wander_x_[i] = params_.wander_radius;
+		seed_[i] = (uint32_t)(i + 1) * 2654435761u;
+	}
+	count_ = n;
+}
+
+size_t Steering::add(POINT2 const & p, float max_speed, float max_force)
+{
+	size_t i = count_;
+	resize(count_ + 1);
+	x_[i] = p.x;
+	y_[i] = p.y;
+	max_speed_[i] = max_speed;
+	max_force_[i] = max_force;
+	target_x_[i] = p.x;
+	target_y_[i] = p.y;
+	return i;
+}
+
+void Steering::clear()
+{
+	resize(0);
+}
+
+bool Steering::any(BEHAVIOUR k, size_t b) const
+{
+	return _mm_movemask_ps(_mm_cmpneq_ps(load(weight_[k], 4 * b), _mm_setzero_ps())) != 0;
+}
+
+void Steering::update(float dt)
+{
+	computeForces(dt);
+	integrate(dt);
+}
+
+void Steering::computeForces(float dt)
+{
+	if (count_ == 0)
+		return;
+
+	// Neighbour lists, only for agents that flock
+	size_t k = params_.max_neighbours;
+	neighbours_.assign(count_ * k, -1);
+	hash_.build(&x_[0], &y_[0], count_);
+	core::parallel_for(0, count_, 256, [this, k](size_t first, size_t last)
+	{
+		float d2[MAX_NEIGHBOURS];
+		for (size_t i = first; i < last; ++i)
+			if (weight_[STEER_SEPARATION][i] != 0.0f || weight_[STEER_ALIGNMENT][i] != 0.0f ||
+				weight_[STEER_COHESION][i] != 0.0f)
+				hash_.nearest(x_[i], y_[i], params_.neighbour_radius, (int32_t)i, k, &neighbours_[i * k], d2);
+	});
+
+	core::parallel_for(0, x_.size() / 4, 64, [this, dt](size_t first, size_t last)
+	{
+		for (size_t b = first; b < last; ++b)
+			block(b, dt);
+	});
+}
+
+void Steering::block(size_t b, float dt)
+{
+	size_t i = 4 * b;
+	F4 const zero = _mm_setzero_ps();
+
+	F4 px = load(x_, i), py = load(y_, i);
+	F4 vx = load(vx_, i), vy = load(vy_, i);
+	F4 speed = load(max_speed_, i);
+	F4 tx = load(target_x_, i), ty = load(target_y_, i);
+	F4 fx = zero, fy = zero;
+	F4 gx, gy;
+
+	if (any(STEER_SEEK, b))
+	{
+		steer(sub4(tx, px), sub4(ty, py), speed, vx, vy, gx, gy);
+		blend(fx, fy, load(weight_[STEER_SEEK], i), gx, gy);
+	}
+
+	if (any(STEER_FLEE, b))
+	{
+		steer(sub4(px, tx), sub4(py, ty), speed, vx, vy, gx, gy);
+		blend(fx, fy, load(weight_[STEER_FLEE], i), gx, gy);
+	}
+
+	if (any(STEER_ARRIVE, b))
+	{
+		F4 dx = sub4(tx, px), dy = sub4(ty, py);
+		F4 slow = _mm_min_ps(speed, mul4(length(dx, dy), mul4(speed, splat(1.0f / params_.slowing_radius))));
+		steer(dx, dy, slow, vx, vy, gx, gy);
+		blend(fx, fy, load(weight_[STEER_ARRIVE], i), gx, gy);
+	}
+
+	if (any(STEER_PURSUE, b) || any(STEER_EVADE, b))
+	{
+		// Gather the quarries; lanes without one get a zero weight
+		float qx[4], qy[4], qvx[4], qvy[4], has[4];
+		for (int l = 0; l < 4; ++l)
+		{
+			int32_t q = quarry_[i + l];
+			has[l] = (q >= 0) ? 1.0f : 0.0f;
+			qx[l] = (q >= 0) ? x_[q] : x_[i + l];
+			qy[l] = (q >= 0) ? y_[q] : y_[i + l];
+			qvx[l] = (q >= 0) ? vx_[q] : 0.0f;
+			qvy[l] = (q >= 0) ? vy_[q] : 0.0f;
+		}
+		F4 q_x = _mm_loadu_ps(qx), q_y = _mm_loadu_ps(qy);
+		F4 q_vx = _mm_loadu_ps(qvx), q_vy = _mm_loadu_ps(qvy);
+		F4 mask = _mm_loadu_ps(has);
+
+		// Lead the quarry by the time it would take to close the distance
+		F4 ahead = _mm_div_ps(length(sub4(q_x, px), sub4(q_y, py)),
+							  _mm_max_ps(add4(speed, length(q_vx, q_vy)), splat(1.0e-6f)));
+		F4 aim_x = add4(q_x, mul4(q_vx, ahead)), aim_y = add4(q_y, mul4(q_vy, ahead));
+
+		if (any(STEER_PURSUE, b))
+		{
+			steer(sub4(aim_x, px), sub4(aim_y, py), speed, vx, vy, gx, gy);
+			blend(fx, fy, mul4(mask, load(weight_[STEER_PURSUE], i)), gx, gy);
+		}
+		if (any(STEER_EVADE, b))
+		{
+			steer(sub4(px, aim_x), sub4(py, aim_y), speed, vx, vy, gx, gy);
+			blend(fx, fy, mul4(mask, load(weight_[STEER_EVADE], i)), gx, gy);
+		}
+	}
+
+	if (any(STEER_WANDER, b))
+	{
+		// Jitter the wander point, pull it back onto its circle, and seek it
+		// from a point ahead; the jitter keeps the heading changing smoothly
+		__m128i seed = _mm_loadu_si128((__m128i const *)&seed_[i]);
+		F4 step = splat(params_.wander_jitter * dt);
+		F4 wx = add4(load(wander_x_, i), mul4(step, jitter(seed)));
+		F4 wy = add4(load(wander_y_, i), mul4(step, jitter(seed)));
+		scale_to(wx, wy, splat(params_.wander_radius));
+		_mm_storeu_si128((__m128i *)&seed_[i], seed);
+		store(wander_x_, i, wx);
+		store(wander_y_, i, wy);
+
+		F4 hx = vx, hy = vy;
+		scale_to(hx, hy, splat(params_.wander_distance));
+		steer(add4(hx, wx), add4(hy, wy), speed, vx, vy, gx, gy);
+		blend(fx, fy, load(weight_[STEER_WANDER], i), gx, gy);
+	}
+
+	if (walls_ && any(STEER_WALLS, b))
+	{
+		float d[4], wgx[4], wgy[4];
+		walls_->sample(&x_[i], &y_[i], 4, d, wgx, wgy);
+
+		// Push along the gradient, from nothing at wall_range up to max force at the wall
+		F4 range = splat(params_.wall_range);
+		F4 push = _mm_max_ps(zero, _mm_div_ps(sub4(range, _mm_loadu_ps(d)), range));
+		gx = _mm_loadu_ps(wgx);
+		gy = _mm_loadu_ps(wgy);
+		scale_to(gx, gy, mul4(push, load(max_force_, i)));
+		blend(fx, fy, load(weight_[STEER_WALLS], i), gx, gy);
+	}
+
+	if (any(STEER_SEPARATION, b) || any(STEER_ALIGNMENT, b) || any(STEER_COHESION, b))
+	{
+		size_t k = params_.max_neighbours;
+		F4 sep_x = zero, sep_y = zero, vel_x = zero, vel_y = zero, cen_x = zero, cen_y = zero, count = zero;
+		float nx[4], ny[4], nvx[4], nvy[4], has[4];
+
+		for (size_t j = 0; j < k; ++j)
+		{
+			// Gather the j-th neighbour of each lane (padding agents have none)
+			for (int l = 0; l < 4; ++l)
+			{
+				int32_t n = (i + l < count_) ? neighbours_[(i + l) * k + j] : -1;
+				has[l] = (n >= 0) ? 1.0f : 0.0f;
+				n = (n >= 0) ? n : (int32_t)(i + l);
+				nx[l] = x_[n];
+				ny[l] = y_[n];
+				nvx[l] = vx_[n];
+				nvy[l] = vy_[n];
+			}
+			F4 mask = _mm_loadu_ps(has);
+			if (_mm_movemask_ps(_mm_cmpgt_ps(mask, zero)) == 0)
+				break;		// lists are nearest first, so the rest are empty too
+
+			F4 n_x = _mm_loadu_ps(nx), n_y = _mm_loadu_ps(ny);
+			F4 dx = sub4(px, n_x), dy = sub4(py, n_y);
+			F4 inv = _mm_div_ps(mask, _mm_max_ps(add4(mul4(dx, dx), mul4(dy, dy)), splat(1.0e-4f)));
+			sep_x = add4(sep_x, mul4(dx, inv));
+			sep_y = add4(sep_y, mul4(dy, inv));
+			vel_x = add4(vel_x, mul4(mask, _mm_loadu_ps(nvx)));
+			vel_y = add4(vel_y, mul4(mask, _mm_loadu_ps(nvy)));
+			cen_x = add4(cen_x, mul4(mask, n_x));
+			cen_y = add4(cen_y, mul4(mask, n_y));
+			count = add4(count, mask);
+		}
+
+		F4 flocking = _mm_cmpgt_ps(count, zero);
+		F4 inv_count = _mm_and_ps(flocking, _mm_div_ps(splat(1.0f), _mm_max_ps(count, splat(1.0f))));
+
+		blend(fx, fy, load(weight_[STEER_SEPARATION], i), sep_x, sep_y);
+
+		gx = _mm_and_ps(flocking, sub4(mul4(vel_x, inv_count), vx));
+		gy = _mm_and_ps(flocking, sub4(mul4(vel_y, inv_count), vy));
+		blend(fx, fy, load(weight_[STEER_ALIGNMENT], i), gx, gy);
+
+		steer(sub4(mul4(cen_x, inv_count), px), sub4(mul4(cen_y, inv_count), py), speed, vx, vy, gx, gy);
+		blend(fx, fy, _mm_and_ps(flocking, load(weight_[STEER_COHESION], i)), gx, gy);
+	}
+
+	truncate(fx, fy, load(max_force_, i));
+	store(fx_, i, fx);
+	store(fy_, i, fy);
+}
+
+void Steering::integrate(float dt)
+{
+	F4 step = splat(dt);
+	for (size_t i = 0; i < x_.size(); i += 4)
+	{
+		F4 vx = add4(load(vx_, i), mul4(load(fx_, i), step));
+		F4 vy = add4(load(vy_, i), mul4(load(fy_, i), step));
+		truncate(vx, vy, load(max_speed_, i));
+		store(vx_, i, vx);
+		store(vy_, i, vy);
+		store(x_, i, add4(load(x_, i), mul4(vx, step)));
+		store(y_, i, add4(load(y_, i), mul4(vy, step)));
+	}
+}
@@ -0,0 +1,283 @@
+/* ********************************************************************************* *
+ * *  File: Sweep.cpp                                                              * *
+ * *  ---------------                                                              * *
+ * *  COPYRIGHT NOTICE                                                             * *
+ * *  ----------------                                                             * *
+ * *  (C)[2012] - [2015] Deakin University                                         * *
+ * *  All rights reserved.                                                         * *
+ * *  All information contained herein is, and remains the property of Deakin      * *
+ * *  University and the author (Tim Wilkin).                                      * *
+ * *  Dissemination of this information or reproduction of this material is        * *
+ * *  strictly forbidden unless prior written permission is obtained from Deakin   * *
+ * *  University.The right to create derivative works from this material is        * *
+ * *  hereby granted to students enrolled in SIT255, but only for the purposes of  * *
+ * *  assessment while an enrolled student at Deakin University.                   * *
+ * *                                                                               * *
+ * ********************************************************************************* */
+
+#include <algorithm>
+
+#include "physics/Sweep.h"
+
+using namespace physics;
+
+namespace {
+
+	// Earliest t in [0,1] at which |d + t m| = r, for a point starting outside the circle
+	bool sweep_point_circle(VECTOR2 const & d, VECTOR2 const & m, float r, float & t)
+	{
+		float a = inner_product(m, m);
+		float b = inner_product(d, m);
+		float c = inner_product(d, d) - r * r;
+
+		if (a <= 0.0f || b >= 0.0f)
+			return false;			// stationary or separating
+
+		float disc = b * b - a * c;
+		if (disc < 0.0f)
+			return false;
+
+		t = (-b - sqrt(disc)) / a;
+		return t >= 0.0f && t <= 1.0f;
+	}
+
+	POINT2 closest_point(Segment const & s, POINT2 const & c)
+	{
+		VECTOR2 e = s.end() - s.start();
+		float	ee = inner_product(e, e);
+		float	u = (ee > 0.0f) ? math::clamp(inner_product(VECTOR2(c - s.start()), e) / ee, 0.0f, 1.0f) : 0.0f;
+		return s.start() + e * u;
+	}
+
+	inline VECTOR2 safe_normal(VECTOR2 const & v, VECTOR2 const & fallback)
+	{
+		float len = v.length();
+		return (len > 1.0e-6f) ? VECTOR2(v / len) : fallback;
+	}
+
+} // close anonymous namespace
+
+
+bool physics::sweepCircleSegment(Circle const & c, VECTOR2 const & motion, Segment const & s, SweepHit & hit)
+{
+	hit = SweepHit();
+
+	POINT2	centre = c.origin();
+	float	r = c.radius();
+	VECTOR2	e = s.end() - s.start();
+	VECTOR2	wall_n = safe_normal(VECTOR2(-e.y, e.x), s.normal());
+
+	// Already touching at the start of the step
+	POINT2	q = closest_point(s, centre);
+	VECTOR2 dq = centre - q;
+	if (inner_product(dq, dq) <= r * r)
+	{
+		hit.toi = 0.0f;
+		hit.normal = safe_normal(dq, s.normal());
+		hit.point = q;
+		hit.hit = true;
+		return true;
+	}
+
+	float best = 2.0f;
+
+	// Segment interior: the centre reaches the line offset by r on its own side
+	float side = (inner_product(VECTOR2(centre - s.start()), wall_n) >= 0.0f) ? 1.0f : -1.0f;
+	VECTOR2 n = wall_n * side;
+	float	dist = inner_product(VECTOR2(centre - s.start()), n);
+	float	vel  = inner_product(motion, n);
+
+	if (vel < 0.0f && dist >= r)
+	{
+		float t = (dist - r) / -vel;
+		if (t <= 1.0f)
+		{
+			POINT2 at = centre + motion * t;
+			float  u = inner_product(VECTOR2(at - s.start()), e) / inner_product(e, e);
+			if (u >= 0.0f && u <= 1.0f)
+			{
+				best = t;
+				hit.normal = n;
+				hit.point = at - VECTOR2(n * r);
+			}
+		}
+	}
+
+	// End caps: the centre reaches a circle of radius r about either end point
+	POINT2 const * ends[2] = { &s.start(), &s.end() };
+	for (int i = 0; i < 2; ++i)
+	{
+		float t;
+		if (sweep_point_circle(centre - *ends[i], motion, r, t) && t < best)
+		{
+			POINT2 at = centre + motion * t;
+			best = t;
+			hit.normal = safe_normal(at - *ends[i], n);
+			hit.point = *ends[i];
+		}
+	}
+
+	if (best > 1.0f)
+		return false;
+
+	hit.toi = best;
+	hit.hit = true;
+	return true;
+}
+
+bool physics::sweepCircleCircle(Circle const & a, VECTOR2 const & motion_a,
+								Circle const & b, VECTOR2 const & motion_b,
+								SweepHit & hit)
+{
+	hit = SweepHit();
+
+	// Work in the frame of b: a moves by the relative motion against a static circle
+	VECTOR2 d = a.origin() - b.origin();
+	VECTOR2 m = motion_a - motion_b;
+	float	r = a.radius() + b.radius();
+	float	t = 0.0f;
+
+	if (inner_product(d, d) > r * r && !sweep_point_circle(d, m, r, t))
+		return false;
+
+	VECTOR2 n = safe_normal(d + m * t, VECTOR2(1, 0));
+
+	hit.toi = t;
+	hit.normal = n;
+	hit.point = (b.origin() + motion_b * t) + n * b.radius();
+	hit.hit = true;
+	return true;
+}
+
+bool physics::sweepAABB(AABB const & a, VECTOR2 const & motion_a,
+						AABB const & b, VECTOR2 const & motion_b,
+						SweepHit & hit)
+{
+	hit = SweepHit();
+
+	if (a.overlaps(b))
+	{
+		hit.toi = 0.0f;
+		hit.point = a.centre();
+		hit.hit = true;
+		return true;
+	}
+
+	// Slab test of the relative motion against the Minkowski sum of the boxes
+	VECTOR2 v = motion_a - motion_b;
+	float	t_enter = 0.0f, t_exit = 1.0f;
+	int		axis = -1;
+
+	for (int i = 0; i < 2; ++i)
+	{
+		float gap_lo = b.lo[i] - a.hi[i];	// a must travel +ve to reach b
+		float gap_hi = b.hi[i] - a.lo[i];	// a must travel -ve to reach b
+
+		if (v[i] == 0.0f)
+		{
+			if (gap_lo > 0.0f || gap_hi < 0.0f)
+				return false;
+			continue;
+		}
+
+		float t0 = gap_lo / v[i], t1 = gap_hi / v[i];
+		if (t0 > t1)
+			std::swap(t0, t1);
+
+		if (t0 > t_enter)
+		{
+			t_enter = t0;
+			axis = i;
+		}
+		t_exit = math::min(t_exit, t1);
+
+		if (t_enter > t_exit)
+			return false;
+	}
+
+	if (axis < 0)
+		return false;
+
+	hit.toi = t_enter;
+	hit.normal = (axis == 0) ? VECTOR2(-math::sgn(v.x), 0.0f) : VECTOR2(0.0f, -math::sgn(v.y));
+	hit.point = a.centre() + motion_a * t_enter;
+	hit.hit = true;
+	return true;
+}
+
+
+ContinuousCollision::ContinuousCollision(SegmentBVH const & walls)
+	: walls_(walls)
+{}
+
+void ContinuousCollision::solve(std::vector<Mover> const & movers, std::vector<Impact> & impacts)
+{
+	size_t n = movers.size();
+	impacts.assign(n, Impact());
+	bounds_.resize(n);
+	intervals_.resize(n);
+
+	for (size_t i = 0; i < n; ++i)
+	{
+		bounds_[i] = sweptBounds(AABB(movers[i].shape), movers[i].motion);
+		intervals_[i].lo = bounds_[i].lo.x;
+		intervals_[i].hi = bounds_[i].hi.x;
+		intervals_[i].mover = (int32_t)i;
+	}
+
+	// Movers against static walls
+	for (size_t i = 0; i < n; ++i)
+	{
+		Mover const & m = movers[i];
+		if (!(m.flags & CCD_ENABLED))
+			continue;
+
+		Impact & best = impacts[i];
+		walls_.query(bounds_[i], [&](size_t w)
+		{
+			SweepHit h;
+			if (sweepCircleSegment(m.shape, m.motion, walls_.segment(w), h) &&
+				(!best.hit.hit || h.toi < best.hit.toi))
+			{
+				best.hit = h;
+				best.wall = (int32_t)w;
+				best.other = -1;
+			}
+		});
+	}
+
+	// Mover pairs: sort-and-sweep on the swept x intervals
+	std::sort(intervals_.begin(), intervals_.end(),
+		[](Interval const & a, Interval const & b) { return a.lo < b.lo; });
+
+	for (size_t i = 0; i < n; ++i)
+	{
+		int32_t a = intervals_[i].mover;
+		for (size_t j = i + 1; j < n && intervals_[j].lo <= intervals_[i].hi; ++j)
+		{
+			int32_t b = intervals_[j].mover;
+			if (!((movers[a].flags | movers[b].flags) & CCD_ENABLED))
+				continue;
+			if (!bounds_[a].overlaps(bounds_[b]))
+				continue;
+
+			SweepHit h;
+			if (!sweepCircleCircle(movers[a].shape, movers[a].motion, movers[b].shape, movers[b].motion, h))
+				continue;
+
+			if (!impacts[a].hit.hit || h.toi < impacts[a].hit.toi)
+			{
+				impacts[a].hit = h;
+				impacts[a].wall = -1;
+				impacts[a].other = b;
+			}
+			if (!impacts[b].hit.hit || h.toi < impacts[b].hit.toi)
+			{
+				impacts[b].hit = h;
+				impacts[b].hit.normal = -h.normal;
+				impacts[b].wall = -1;
+				impacts[b].other = a;
+			}
+		}
+	}
+}
@@ -0,0 +1,520 @@
+/* ********************************************************************************* *
+ * *  File: Terrain.cpp                                                            * *
+ * *  -----------------                                                            * *
+ * *  COPYRIGHT NOTICE                                                             * *
+ * *  ----------------                                                             * *
+ * *  (C)[2012] - [2015] Deakin University                                         * *
+ * *  All rights reserved.                                                         * *
+ * *  All information contained herein is, and remains the property of Deakin      * *
+ * *  University and the author (Tim Wilkin).                                      * *
+ * *  Dissemination of this information or reproduction of this material is        * *
+ * *  strictly forbidden unless prior written permission is obtained from Deakin   * *
+ * *  University.The right to create derivative works from this material is        * *
+ * *  hereby granted to students enrolled in SIT255, but only for the purposes of  * *
+ * *  assessment while an enrolled student at Deakin University.                   * *
+ * *                                                                               * *
+ * ********************************************************************************* */
+
+#include <algorithm>
+#include <cmath>
+
+#include "level/Terrain.h"
+
+using namespace level;
+
+namespace {
+
+	// Geometric tolerance in world units for on-line tests and shared edges
+	const float		EPSILON = 1e-3f;
+
+	const size_t	MAX_BLAST_SIDES = 64;
+	const size_t	CLIP_CAPACITY = ConvexPolygon::MAX_VERTICES + MAX_BLAST_SIDES + 4;
+
+	/*
+	 * Clip a convex polygon against the half-plane nx*x + ny*y <= d (n unit).
+	 * Vertices within EPSILON of the line count as on it and are kept by both
+	 * sides, so the two halves of a split share their cut edge exactly.
+	 */
+	size_t clip(POINT2 const * in, size_t n, float nx, float ny, float d, POINT2 * out)
+	{
+		float	s[CLIP_CAPACITY];
+		for (size_t i = 0; i < n; ++i)
+		{
+			s[i] = nx * in[i].x + ny * in[i].y - d;
+			if (fabs(s[i]) < EPSILON)
+				s[i] = 0.0f;
+		}
+
+		size_t k = 0;
+		for (size_t i = 0; i < n; ++i)
+		{
+			size_t j = (i + 1) % n;
+			if (s[i] <= 0.0f)
+				out[k++] = in[i];
+			if ((s[i] < 0.0f && s[j] > 0.0f) || (s[i] > 0.0f && s[j] < 0.0f))
+			{
+				float t = s[i] / (s[i] - s[j]);
+				out[k++] = POINT2(in[i].x + (in[j].x - in[i].x) * t, in[i].y + (in[j].y - in[i].y) * t);
+			}
+		}
+		return k < 3 ? 0 : k;
+	}
+
+	float polygon_area(POINT2 const * p, size_t n)
+	{
+		float a = 0.0f;
+		for (size_t i = 0; i < n; ++i)
+			a += p[i].x * p[(i + 1) % n].y - p[(i + 1) % n].x * p[i].y;
+		return 0.5f * fabs(a);
+	}
+
+	/*
+	 * Drop the vertex spanning the smallest triangle until the polygon fits
+	 * ConvexPolygon. Removing a vertex of a convex polygon keeps it convex and
+	 * only shrinks it.
+	 */
+	size_t simplify(POINT2 * p, size_t n)
+	{
+		while (n > ConvexPolygon::MAX_VERTICES)
+		{
+			size_t	best = 0;
+			float	best_a = FLT_MAX;
+			for (size_t i = 0; i < n; ++i)
+			{
+				POINT2 const & a = p[(i + n - 1) % n];
+				POINT2 const & b = p[i];
+				POINT2 const & c = p[(i + 1) % n];
+				float area = fabs((b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x));
+				if (area < best_a)
+				{
+					best_a = area;
+					best = i;
+				}
+			}
+			std::copy(p + best + 1, p + n, p + best);
+			--n;
+		}
+		return n;
+	}
+
+	bool same_walls(physics::SegmentBVH const & bvh, std::vector<size_t> const & ids, std::vector<Segment> const & segs)
+	{
+		if (ids.size() != segs.size())
+			return false;
+		for (size_t i = 0; i < ids.size(); ++i)
+		{
+			Segment const & s = bvh.segment(ids[i]);
+			if (s.start().x != segs[i].start().x || s.start().y != segs[i].start().y ||
+				s.end().x != segs[i].end().x || s.end().y != segs[i].end().y)
+				return false;
+		}
+		return true;
+	}
+
+	inline int clampi(int v, int lo, int hi)
+	{
+		return v < lo ? lo : (v > hi ? hi : v);
+	}
+
+} // close anonymous namespace
+
+Terrain::Terrain()
+	: bucket_(1.0f),
+	  min_area_(1.0f),
+	  bw_(0),
+	  bh_(0),
+	  epoch_(0),
+	  built_(false)
+{}
+
+void Terrain::reset(AABB const & area, float bucket, float min_area)
+{
+	area_ = area;
+	bucket_ = bucket;
+	min_area_ = min_area;
+	bw_ = math::max(1, (int)ceil((area.hi.x - area.lo.x) / bucket));
+	bh_ = math::max(1, (int)ceil((area.hi.y - area.lo.y) / bucket));
+
+	pieces_.clear();
+	free_.clear();
+	buckets_.assign((size_t)bw_ * bh_, std::vector<int32_t>());
+	mark_.clear();
+	epoch_ = 0;
+	bvh_.build(std::vector<Segment>());
+	built_ = false;
+}
+
+size_t Terrain::add(ConvexPolygon const & piece)
+{
+	size_t id = insert(piece);
+	if (built_)
+	{
+		AABB changed;
+		patch(pieces_[id].bounds, changed);
+		notify(changed);
+	}
+	return id;
+}
+
+void Terrain::build()
+{
+	std::vector<Segment> all, segs;
+	for (size_t i = 0; i < pieces_.size(); ++i)
+	{
+		if (!pieces_[i].alive)
+			continue;
+
+		outline(i, segs);
+		pieces_[i].walls.clear();
+		for (size_t k = 0; k < segs.size(); ++k)
+		{
+			pieces_[i].walls.push_back(all.size());
+			all.push_back(segs[k]);
+		}
+	}
+	bvh_.build(all);
+	built_ = true;
+}
+
+AABB Terrain::blast(Circle const & c, size_t sides)
+{
+	if (!built_)
+		return AABB();
+
+	// Circumscribe the circle so that the blast removes at least its area
+	sides = math::min(math::max(sides, (size_t)3), MAX_BLAST_SIDES);
+	float	r = c.radius() / cos(math::PI / sides);
+	POINT2	poly[MAX_BLAST_SIDES];
+	for (size_t i = 0; i < sides; ++i)
+	{
+		float a = 2.0f * math::PI * i / sides;
+		poly[i] = POINT2(c.origin().x + r * cos(a), c.origin().y + r * sin(a));
+	}
+
+	std::vector<size_t> hit;
+	gather(AABB(c).inflate(r - c.radius() + EPSILON), hit);
+
+	AABB damaged, changed;
+	std::vector<ConvexPolygon> fragments;
+	for (size_t h = 0; h < hit.size(); ++h)
+	{
+		size_t id = hit[h];
+		bool touched;
+		fragments.clear();
+		subtract(pieces_[id].shape, poly, sides, fragments, touched);
+		if (!touched)
+			continue;
+
+		damaged.grow(pieces_[id].bounds);
+		for (size_t k = 0; k < pieces_[id].walls.size(); ++k)
+		{
+			changed.grow(AABB(bvh_.segment(pieces_[id].walls[k])));
+			bvh_.remove(pieces_[id].walls[k]);
+		}
+		erase(id);
+
+		for (size_t k = 0; k < fragments.size(); ++k)
+			insert(fragments[k]);
+	}
+
+	if (damaged.empty())
+		return AABB();
+
+	patch(damaged, changed);
+	notify(changed);
+	return changed;
+}
+
+void Terrain::patch(AABB const & damaged, AABB & changed)
+{
+	// Pieces touching the damage may have gained or lost shared edges
+	std::vector<size_t>		near;
+	std::vector<Segment>	segs;
+	gather(damaged.inflate(EPSILON), near);
+
+	for (size_t n = 0; n < near.size(); ++n)
+	{
+		Piece & p = pieces_[near[n]];
+		outline(near[n], segs);
+		if (same_walls(bvh_, p.walls, segs))
+			continue;
+
+		for (size_t k = 0; k < p.walls.size(); ++k)
+		{
+			changed.grow(AABB(bvh_.segment(p.walls[k])));
+			bvh_.remove(p.walls[k]);
+		}
+		p.walls.clear();
+		for (size_t k = 0; k < segs.size(); ++k)
+		{
+			changed.grow(AABB(segs[k]));
+			p.walls.push_back(bvh_.insert(segs[k]));
+		}
+	}
+
+	// Rebuild the tree once the unsorted overflow starts to cost more than it saves
+	if (bvh_.overflow() > math::max((size_t)256, bvh_.size() / 8))
+		bvh_.optimise();
+}
+
+void Terrain::notify(AABB const & changed)
+{
+	if (changed.empty())
+		return;
+	for (size_t i = 0; i < listeners_.size(); ++i)
+		listeners_[i]->terrainChanged(*this, changed);
+}
+
+void Terrain::subtract(ConvexPolygon const & piece, POINT2 const * blast, size_t sides,
+					   std::vector<ConvexPolygon> & out, bool & touched) const
+{
+	POINT2	rem[CLIP_CAPACITY], part[CLIP_CAPACITY], next[CLIP_CAPACITY];
+	size_t	n = piece.size();
+	for (size_t i = 0; i < n; ++i)
+		rem[i] = piece.vertex(i);
+
+	touched = false;
+	std::vector<ConvexPolygon> parts;
+	for (size_t i = 0; i < sides; ++i)
+	{
+		// Outward unit normal of the (counter clockwise) blast edge
+		POINT2 const & a = blast[i];
+		POINT2 const & b = blast[(i + 1) % sides];
+		float nx = b.y - a.y, ny = a.x - b.x;
+		float len = sqrt(nx * nx + ny * ny);
+		nx /= len;
+		ny /= len;
+		float d = nx * a.x + ny * a.y;
+
+		// Nothing left inside this edge: the blast misses the piece
+		size_t m = clip(rem, n, nx, ny, d, next);
+		if (m == 0)
+			return;
+
+		size_t k = clip(rem, n, -nx, -ny, -d, part);
+		if (k > 0)
+		{
+			k = simplify(part, k);
+			if (polygon_area(part, k) >= min_area_)
+			{
+				ConvexPolygon f(part, k);
+				if (f.size() >= 3)
+					parts.push_back(f);
+			}
+		}
+
+		std::copy(next, next + m, rem);
+		n = m;
+	}
+
+	// A graze along an edge leaves a degenerate intersection
+	if (polygon_area(rem, n) < EPSILON)
+		return;
+
+	touched = true;
+	out.insert(out.end(), parts.begin(), parts.end());
+}
+
+void Terrain::outline(size_t id, std::vector<Segment> & out) const
+{
+	out.clear();
+
+	ConvexPolygon const & s = pieces_[id].shape;
+	POINT2 c = s.centre();
+
+	std::vector<size_t> near;
+	gather(pieces_[id].bounds.inflate(EPSILON), near);
+
+	std::vector<std::pair<float, float>> cover;
+	for (size_t i = 0; i < s.size(); ++i)
+	{
+		POINT2 const & a = s.vertex(i);
+		POINT2 const & b = s.vertex(i + 1);
+		float dx = b.x - a.x, dy = b.y - a.y;
+		float len2 = dx * dx + dy * dy;
+		if (len2 < EPSILON * EPSILON)
+			continue;
+		float len = sqrt(len2);
+
+		// Parts of the edge covered by collinear, opposite edges of neighbours
+		cover.clear();
+		for (size_t q = 0; q < near.size(); ++q)
+		{
+			if (near[q] == id)
+				continue;
+			ConvexPolygon const & o = pieces_[near[q]].shape;
+			for (size_t j = 0; j < o.size(); ++j)
+			{
+				POINT2 const & c0 = o.vertex(j);
+				POINT2 const & c1 = o.vertex(j + 1);
+				if ((c1.x - c0.x) * dx + (c1.y - c0.y) * dy >= 0.0f)
+					continue;
+				if (fabs(dx * (c0.y - a.y) - dy * (c0.x - a.x)) > EPSILON * len ||
+					fabs(dx * (c1.y - a.y) - dy * (c1.x - a.x)) > EPSILON * len)
+					continue;
+
+				float t0 = ((c0.x - a.x) * dx + (c0.y - a.y) * dy) / len2;
+				float t1 = ((c1.x - a.x) * dx + (c1.y - a.y) * dy) / len2;
+				if (t0 > t1)
+					std::swap(t0, t1);
+				t0 = math::max(t0, 0.0f);
+				t1 = math::min(t1, 1.0f);
+				if (t1 > t0)
+					cover.push_back(std::make_pair(t0, t1));
+			}
+		}
+		std::sort(cover.begin(), cover.end());
+
+		VECTOR2 normal(dy, -dx);
+		if (normal.x * (a.x - c.x) + normal.y * (a.y - c.y) < 0.0f)
+			normal = -normal;
+
+		// Emit the uncovered intervals
+		float t = 0.0f, tol = EPSILON / len;
+		for (size_t k = 0; k <= cover.size(); ++k)
+		{
+			float u = (k < cover.size()) ? cover[k].first : 1.0f;
+			if (u > t + tol)
+			{
+				// Exact vertices at the edge ends keep corners shared between walls
+				POINT2 p0 = (t <= 0.0f) ? a : POINT2(a.x + dx * t, a.y + dy * t);
+				POINT2 p1 = (u >= 1.0f) ? b : POINT2(a.x + dx * u, a.y + dy * u);
+				out.push_back(Segment(p0, p1, normal));
+			}
+			if (k < cover.size())
+				t = math::max(t, cover[k].second);
+		}
+	}
+}
+
+size_t Terrain::insert(ConvexPolygon const & shape)
+{
+	size_t id;
+	if (!free_.empty())
+	{
+		id = free_.back();
+		free_.pop_back();
+	}
+	else
+	{
+		id = pieces_.size();
+		pieces_.push_back(Piece());
+		mark_.push_back(0);
+	}
+
+	Piece & p = pieces_[id];
+	p.shape = shape;
+	p.bounds = AABB(shape);
+	p.walls.clear();
+	p.alive = true;
+	link(id, true);
+	return id;
+}
+
+void Terrain::erase(size_t id)
+{
+	link(id, false);
+	pieces_[id].alive = false;
+	pieces_[id].walls.clear();
+	free_.push_back(id);
+}
+
+void Terrain::link(size_t id, bool on)
+{
+	AABB const & b = pieces_[id].bounds;
+	int x0 = clampi((int)floor((b.lo.x - area_.lo.x) / bucket_), 0, bw_ - 1);
+	int x1 = clampi((int)floor((b.hi.x - area_.lo.x) / bucket_), 0, bw_ - 1);
+	int y0 = clampi((int)floor((b.lo.y - area_.lo.y) / bucket_), 0, bh_ - 1);
+	int y1 = clampi((int)floor((b.hi.y - area_.lo.y) / bucket_), 0, bh_ - 1);
+
+	for (int y = y0; y <= y1; ++y)
+		for (int x = x0; x <= x1; ++x)
+		{
+			std::vector<int32_t> & bucket = buckets_[(size_t)y * bw_ + x];
+			if (on)
+			{
+				bucket.push_back((int32_t)id);
+				continue;
+			}
+			std::vector<int32_t>::iterator it = std::find(bucket.begin(), bucket.end(), (int32_t)id);
+			if (it != bucket.end())
+			{
+				*it = bucket.back();
+				bucket.pop_back();
+			}
+		}
+}
+
+void Terrain::gather(AABB const & box, std::vector<size_t> & out) const
+{
+	out.clear();
+	if (buckets_.empty())
+		return;
+
+	// Epoch marks dedupe pieces spanning several buckets without clearing
+	if (++epoch_ == 0)
+	{
+		std::fill(mark_.begin(), mark_.end(), 0);
+		epoch_ = 1;
+	}
+
+	int x0 = clampi((int)floor((box.lo.x - area_.lo.x) / bucket_), 0, bw_ - 1);
+	int x1 = clampi((int)floor((box.hi.x - area_.lo.x) / bucket_), 0, bw_ - 1);
+	int y0 = clampi((int)floor((box.lo.y - area_.lo.y) / bucket_), 0, bh_ - 1);
+	int y1 = clampi((int)floor((box.hi.y - area_.lo.y) / bucket_), 0, bh_ - 1);
+
+	for (int y = y0; y <= y1; ++y)
+		for (int x = x0; x <= x1; ++x)
+		{
+			std::vector<int32_t> const & bucket = buckets_[(size_t)y * bw_ + x];
+			for (size_t k = 0; k < bucket.size(); ++k)
+			{
+				size_t id = (size_t)bucket[k];
+				if (mark_[id] == epoch_)
+					continue;
+				mark_[id] = epoch_;
+				if (pieces_[id].bounds.overlaps(box))
+					out.push_back(id);
+			}
+		}
+}
+
+void Terrain::piecesNear(AABB const & box, std::vector<size_t> & out) const
+{
+	gather(box, out);
+}
+
+void Terrain::wallsNear(AABB const & box, std::vector<Segment> & out) const
+{
+	out.clear();
+	bvh_.query(box, [&](size_t i)
+	{
+		out.push_back(bvh_.segment(i));
+	});
+}
+
+void Terrain::addListener(TerrainListener * l)
+{
+	if (std::find(listeners_.begin(), listeners_.end(), l) == listeners_.end())
+		listeners_.push_back(l);
+}
+
+void Terrain::removeListener(TerrainListener * l)
+{
+	listeners_.erase(std::remove(listeners_.begin(), listeners_.end(), l), listeners_.end());
+}
+
+void DistanceFieldUpdater::terrainChanged(Terrain const & terrain, AABB const & region)
+{
+	// update() reaches band + cell around the region for cells, and band again for walls
+	terrain.wallsNear(region.inflate(2.0f * (field_.band() + field_.cell())), near_);
+	field_.update(near_, region);
+}
+
+void OccupancyUpdater::terrainChanged(Terrain const & terrain, AABB const & region)
+{
+	grid_.clearStatic(region);
+	terrain.piecesNear(region.inflate(grid_.cell()), near_);
+	for (size_t i = 0; i < near_.size(); ++i)
+		grid_.stamp(terrain.piece(near_[i]));
+}
@@ -0,0 +1,288 @@
+/* ********************************************************************************* *
+ * *  File: Trigger.cpp                                                            * *
+ * *  -----------------                                                            * *
+ * *  COPYRIGHT NOTICE                                                             * *
+ * *  ----------------                                                             * *
+ * *  (C)[2012] - [2015] Deakin University                                         * *
+ * *  All rights reserved.                                                         * *
+ * *  All information contained herein is, and remains the property of Deakin      * *
+ * *  University and the author (Tim Wilkin).                                      * *
+ * *  Dissemination of this information or reproduction of this material is        * *
+ * *  strictly forbidden unless prior written permission is obtained from Deakin   * *
+ * *  University.The right to create derivative works from this material is        * *
+ * *  hereby granted to students enrolled in SIT255, but only for the purposes of  * *
+ * *  assessment while an enrolled student at Deakin University.                   * *
+ * *                                                                               * *
+ * ********************************************************************************* */
+
+#include <algorithm>
+#include <cmath>
+
+#include "physics/Trigger.h"
+
+using namespace physics;
+
+
+TriggerSystem::TriggerSystem(float cell_size)
+	: cell_(cell_size)
+{}
+
+uint32_t TriggerSystem::addTrigger(Circle const & c, uint32_t user, uint32_t flags)
+{
+	Volume v;
+	v.shape = POLYGON_TYPE::CIRCLE;
+	v.bounds = AABB(c);
+	v.centre = c.origin();
+	v.radius = c.radius();
+	v.user = user;
+	v.flags = flags;
+	return insertTrigger(v);
+}
+
+uint32_t TriggerSystem::addTrigger(Rect const & r, uint32_t user, uint32_t flags)
+{
+	Volume v;
+	v.shape = POLYGON_TYPE::RECTANGLE;
+	v.bounds = AABB(r);
+	v.centre = v.bounds.centre();
+	v.radius = 0.0f;
+	v.user = user;
+	v.flags = flags;
+	return insertTrigger(v);
+}
+
+uint32_t TriggerSystem::insertTrigger(Volume const & v)
+{
+	uint32_t id;
+	if (!free_triggers_.empty())
+	{
+		id = free_triggers_.back();
+		free_triggers_.pop_back();
+		triggers_[id] = v;
+	}
+	else
+	{
+		id = (uint32_t)triggers_.size();
+		triggers_.push_back(v);
+	}
+	triggers_[id].alive = true;
+	triggers_[id].occupants.clear();
+	if (v.flags & TRIGGER_REPORT_STAY)
+		stay_triggers_.push_back(id);
+
+	int x0 = (int)floor(v.bounds.lo.x / cell_), x1 = (int)floor(v.bounds.hi.x / cell_);
+	int y0 = (int)floor(v.bounds.lo.y / cell_), y1 = (int)floor(v.bounds.hi.y / cell_);
+	for (int y = y0; y <= y1; ++y)
+		for (int x = x0; x <= x1; ++x)
+			grid_[key(x, y)].push_back(id);
+
+	// Agents already standing in the new volume must see an ENTER
+	for (size_t a = 0; a < agents_.size(); ++a)
+		if (agents_[a].alive && v.bounds.overlaps(AABB(Circle(agents_[a].position, agents_[a].radius))))
+			markDirty((uint32_t)a);
+
+	return id;
+}
+
+void TriggerSystem::removeTrigger(uint32_t id)
+{
+	Volume & v = triggers_[id];
+	if (!v.alive)
+		return;
+
+	int x0 = (int)floor(v.bounds.lo.x / cell_), x1 = (int)floor(v.bounds.hi.x / cell_);
+	int y0 = (int)floor(v.bounds.lo.y / cell_), y1 = (int)floor(v.bounds.hi.y / cell_);
+	for (int y = y0; y <= y1; ++y)
+		for (int x = x0; x <= x1; ++x)
+		{
+			std::vector<uint32_t> & cell = grid_[key(x, y)];
+			cell.erase(std::remove(cell.begin(), cell.end(), id), cell.end());
+		}
+
+	// Occupants are re-tested so they receive an EXIT on the next update
+	for (size_t i = 0; i < v.occupants.size(); ++i)
+		markDirty(v.occupants[i]);
+
+	if (v.flags & TRIGGER_REPORT_STAY)
+	{
+		std::vector<uint32_t>::iterator it = std::find(stay_triggers_.begin(), stay_triggers_.end(), id);
+		*it = stay_triggers_.back();
+		stay_triggers_.pop_back();
+	}
+
+	// The id is reused only after update() has sent the occupants' EXITs
+	v.alive = false;
+	removed_triggers_.push_back(id);
+}
+
+uint32_t TriggerSystem::addAgent(Circle const & shape)
+{
+	Agent a;
+	a.position = shape.origin();
+	a.radius = shape.radius();
+	a.alive = true;
+	a.dirty = false;
+
+	uint32_t id;
+	if (!free_agents_.empty())
+	{
+		id = free_agents_.back();
+		free_agents_.pop_back();
+		agents_[id] = a;
+	}
+	else
+	{
+		id = (uint32_t)agents_.size();
+		agents_.push_back(a);
+	}
+	markDirty(id);
+	return id;
+}
+
+void TriggerSystem::moveAgent(uint32_t id, POINT2 const & p)
+{
+	Agent & a = agents_[id];
+	if (a.position == p)
+		return;
+	a.position = p;
+	markDirty(id);
+}
+
+void TriggerSystem::removeAgent(uint32_t id)
+{
+	Agent & a = agents_[id];
+	if (!a.alive)
+		return;
+
+	// Emit exits immediately into this update's batch
+	for (size_t i = 0; i < a.inside.size(); ++i)
+	{
+		Volume & v = triggers_[a.inside[i]];
+		TriggerEvent e = { a.inside[i], id, v.user, TRIGGER_EVENT::EXIT };
+		events_[2].push_back(e);
+		leave(a.inside[i], id);
+	}
+	a.inside.clear();
+	a.alive = false;
+	free_agents_.push_back(id);
+}
+
+void TriggerSystem::markDirty(uint32_t agent)
+{
+	if (!agents_[agent].dirty)
+	{
+		agents_[agent].dirty = true;
+		dirty_.push_back(agent);
+	}
+}
+
+bool TriggerSystem::overlapsVolume(Volume const & v, Agent const & a) const
+{
+	if (v.shape == POLYGON_TYPE::CIRCLE)
+	{
+		VECTOR2 d = a.position - v.centre;
+		float	r = v.radius + a.radius;
+		return inner_product(d, d) <= r * r;
+	}
+
+	// Rect: distance from the agent centre to the closest point of the box
+	float cx = math::clamp(a.position.x, v.bounds.lo.x, v.bounds.hi.x);
+	float cy = math::clamp(a.position.y, v.bounds.lo.y, v.bounds.hi.y);
+	float dx = a.position.x - cx, dy = a.position.y - cy;
+	return dx * dx + dy * dy <= a.radius * a.radius;
+}
+
+void TriggerSystem::leave(uint32_t trigger, uint32_t agent)
+{
+	std::vector<uint32_t> & occ = triggers_[trigger].occupants;
+	std::vector<uint32_t>::iterator it = std::find(occ.begin(), occ.end(), agent);
+	if (it != occ.end())
+	{
+		*it = occ.back();
+		occ.pop_back();
+	}
+}
+
+void TriggerSystem::retest(uint32_t id)
+{
+	Agent & a = agents_[id];
+	a.dirty = false;
+	if (!a.alive)
+		return;
+
+	// Broad phase: triggers bucketed in the cells the agent touches
+	found_.clear();
+	AABB box = AABB(Circle(a.position, a.radius));
+	int x0 = (int)floor(box.lo.x / cell_), x1 = (int)floor(box.hi.x / cell_);
+	int y0 = (int)floor(box.lo.y / cell_), y1 = (int)floor(box.hi.y / cell_);
+	for (int y = y0; y <= y1; ++y)
+		for (int x = x0; x <= x1; ++x)
+		{
+			std::unordered_map<int64_t, std::vector<uint32_t> >::const_iterator c = grid_.find(key(x, y));
+			if (c == grid_.end())
+				continue;
+			for (size_t i = 0; i < c->second.size(); ++i)
+				if (overlapsVolume(triggers_[c->second[i]], a))
+					found_.push_back(c->second[i]);
+		}
+
+	std::sort(found_.begin(), found_.end());
+	found_.erase(std::unique(found_.begin(), found_.end()), found_.end());
+
+	// Merge the new overlap set against the cached one
+	size_t i = 0, j = 0;
+	while (i < found_.size() || j < a.inside.size())
+	{
+		if (j == a.inside.size() || (i < found_.size() && found_[i] < a.inside[j]))
+		{
+			uint32_t t = found_[i++];
+			TriggerEvent e = { t, id, triggers_[t].user, TRIGGER_EVENT::ENTER };
+			events_[0].push_back(e);
+			triggers_[t].occupants.push_back(id);
+		}
+		else if (i == found_.size() || a.inside[j] < found_[i])
+		{
+			uint32_t t = a.inside[j++];
+			TriggerEvent e = { t, id, triggers_[t].user, TRIGGER_EVENT::EXIT };
+			events_[2].push_back(e);
+			leave(t, id);
+		}
+		else
+		{
+			++i;
+			++j;
+		}
+	}
+
+	a.inside.swap(found_);
+}
+
+void TriggerSystem::update()
+{
+	for (size_t i = 0; i < dirty_.size(); ++i)
+		retest(dirty_[i]);
+	dirty_.clear();
+
+	// Removed triggers' occupants have had their EXITs; the ids are free now
+	free_triggers_.insert(free_triggers_.end(), removed_triggers_.begin(), removed_triggers_.end());
+	removed_triggers_.clear();
+
+	// STAY only for the triggers that asked for it
+	for (size_t k = 0; k < stay_triggers_.size(); ++k)
+	{
+		uint32_t t = stay_triggers_[k];
+		Volume const & v = triggers_[t];
+		for (size_t i = 0; i < v.occupants.size(); ++i)
+		{
+			TriggerEvent e = { t, v.occupants[i], v.user, TRIGGER_EVENT::STAY };
+			events_[1].push_back(e);
+		}
+	}
+
+	for (int k = 0; k < 3; ++k)
+	{
+		if (handlers_[k] && !events_[k].empty())
+			handlers_[k](events_[k].data(), events_[k].size());
+		events_[k].clear();
+	}
+}
@@ -0,0 +1,329 @@
+/* ********************************************************************************* *
+ * *  File: Utility.cpp                                                            * *
+ * *  -----------------                                                            * *
+ * *  COPYRIGHT NOTICE                                                             * *
+ * *  ----------------                                                             * *
+ * *  (C)[2012] - [2015] Deakin University                                         * *
+ * *  All rights reserved.                                                         * *
+ * *  All information contained herein is, and remains the property of Deakin      * *
+ * *  University and the author (Tim Wilkin).                                      * *
+ * *  Dissemination of this information or reproduction of this material is        * *
+ * *  strictly forbidden unless prior written permission is obtained from Deakin   * *
+ * *  University.The right to create derivative works from this material is        * *
+ * *  hereby granted to students enrolled in SIT255, but only for the purposes of  * *
+ * *  assessment while an enrolled student at Deakin University.                   * *
+ * *                                                                               * *
+ * ********************************************************************************* */
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <emmintrin.h>
+
+#include "ai/Utility.h"
+#include "core/Parallel.h"
+
+using namespace ai;
+
+namespace {
+
+	typedef __m128	F4;
+
+	inline F4 splat(float v)	{ return _mm_set1_ps(v); }
+	inline F4 add4(F4 a, F4 b)	{ return _mm_add_ps(a, b); }
+	inline F4 sub4(F4 a, F4 b)	{ return _mm_sub_ps(a, b); }
+	inline F4 mul4(F4 a, F4 b)	{ return _mm_mul_ps(a, b); }
+
+	inline F4 clamp01(F4 x)
+	{
+		return _mm_min_ps(splat(1.0f), _mm_max_ps(_mm_setzero_ps(), x));
+	}
+
+	inline F4 select(F4 mask, F4 a, F4 b)
+	{
+		return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+	}
+
+	/*
+	 * e^x to about 1e-7 relative: split x log2(e) into integer and
+	 * fraction, a degree 5 polynomial for 2^fraction, and the integer
+	 * written straight into the exponent bits.
+	 */
+	inline F4 exp4(F4 x)
+	{
+		x = _mm_min_ps(splat(87.0f), _mm_max_ps(splat(-87.0f), x));
+		F4 t = mul4(x, splat(1.44269504f));
+
+		__m128i i = _mm_cvttps_epi32(t);
+		F4 fi = _mm_cvtepi32_ps(i);
+		F4 above = _mm_cmpgt_ps(fi, t);		// truncated toward zero: floor negatives
+		fi = sub4(fi, _mm_and_ps(above, splat(1.0f)));
+		i = _mm_add_epi32(i, _mm_castps_si128(above));		// mask is -1 where above
+
+		F4 f = sub4(t, fi);
+		F4 p = splat(1.8775767e-3f);
+		p = add4(mul4(p, f), splat(8.9893397e-3f));
+		p = add4(mul4(p, f), splat(5.5826318e-2f));
+		p = add4(mul4(p, f), splat(2.4015361e-1f));
+		p = add4(mul4(p, f), splat(6.9315308e-1f));
+		p = add4(mul4(p, f), splat(9.9999994e-1f));
+
+		__m128i e = _mm_slli_epi32(_mm_add_epi32(i, _mm_set1_epi32(127)), 23);
+		return mul4(p, _mm_castsi128_ps(e));
+	}
+
+	/*
+	 * Curve shapes on four normalised inputs. Each is a functor so the
+	 * per-consideration loop below is compiled once per shape, with the
+	 * switch on the curve type outside it.
+	 */
+	struct Linear
+	{
+		F4 slope, offset;
+		explicit Linear(Curve const & c) : slope(splat(c.slope)), offset(splat(c.offset)) {}
+		F4 operator()(F4 x) const	{ return add4(mul4(x, slope), offset); }
+	};
+
+	struct Quadratic
+	{
+		F4 slope, centre, offset;
+		explicit Quadratic(Curve const & c) : slope(splat(c.slope)), centre(splat(c.centre)), offset(splat(c.offset)) {}
+		F4 operator()(F4 x) const
+		{
+			F4 d = sub4(x, centre);
+			return add4(mul4(mul4(d, d), slope), offset);
+		}
+	};
+
+	struct Logistic
+	{
+		F4 slope, centre;
+		explicit Logistic(Curve const & c) : slope(splat(-c.slope)), centre(splat(c.centre)) {}
+		F4 operator()(F4 x) const
+		{
+			return _mm_div_ps(splat(1.0f), add4(splat(1.0f), exp4(mul4(slope, sub4(x, centre)))));
+		}
+	};
+
+	struct Table
+	{
+		float const * table;
+		explicit Table(Curve const & c) : table(c.table) {}
+		F4 operator()(F4 x) const
+		{
+			// No gather in SSE2: index the table per lane
+			F4 t = mul4(x, splat((float)(Curve::TABLE_POINTS - 1)));
+			__m128i i = _mm_cvttps_epi32(_mm_min_ps(t, splat((float)(Curve::TABLE_POINTS - 2))));
+			F4 f = sub4(t, _mm_cvtepi32_ps(i));
+
+			int32_t k[4];
+			_mm_storeu_si128((__m128i *)k, i);
+			F4 a = _mm_setr_ps(table[k[0]], table[k[1]], table[k[2]], table[k[3]]);
+			F4 b = _mm_setr_ps(table[k[0] + 1], table[k[1] + 1], table[k[2] + 1], table[k[3] + 1]);
+			return add4(a, mul4(f, sub4(b, a)));
+		}
+	};
+
+	// score[i] *= curve(input[i]) for n (a multiple of four) agents
+	template <typename Shape>
+	inline void respond(Curve const & c, Shape const & shape, float const * input, float * score, size_t n)
+	{
+		float range = c.hi - c.lo;
+		F4 const lo = splat(c.lo),
+				 scale = splat((range != 0.0f) ? 1.0f / range : 0.0f);
+
+		for (size_t i = 0; i < n; i += 4)
+		{
+			F4 x = clamp01(mul4(sub4(_mm_loadu_ps(input + i), lo), scale));
+			_mm_storeu_ps(score + i, mul4(_mm_loadu_ps(score + i), clamp01(shape(x))));
+		}
+	}
+
+	inline void respond(Curve const & c, float const * input, float * score, size_t n)
+	{
+		switch (c.type)
+		{
+			case CURVE_LINEAR:		respond(c, Linear(c), input, score, n);		break;
+			case CURVE_QUADRATIC:	respond(c, Quadratic(c), input, score, n);	break;
+			case CURVE_LOGISTIC:	respond(c, Logistic(c), input, score, n);	break;
+			default:				respond(c, Table(c), input, score, n);		break;
+		}
+	}
+
+} // close anonymous namespace
+
+/*
+ * Curve
+ */
+
+const size_t Curve::TABLE_POINTS;
+
+Curve Curve::linear(float lo, float hi, float slope, float offset)
+{
+	Curve c = {};
+	c.type	 = CURVE_LINEAR;
+	c.lo	 = lo;
+	c.hi	 = hi;
+	c.slope	 = slope;
+	c.offset = offset;
+	return c;
+}
+
+Curve Curve::quadratic(float lo, float hi, float slope, float centre, float offset)
+{
+	Curve c = {};
+	c.type	 = CURVE_QUADRATIC;
+	c.lo	 = lo;
+	c.hi	 = hi;
+	c.slope	 = slope;
+	c.centre = centre;
+	c.offset = offset;
+	return c;
+}
+
+Curve Curve::logistic(float lo, float hi, float steepness, float midpoint)
+{
+	Curve c = {};
+	c.type	 = CURVE_LOGISTIC;
+	c.lo	 = lo;
+	c.hi	 = hi;
+	c.slope	 = steepness;
+	c.centre = midpoint;
+	return c;
+}
+
+Curve Curve::lookup(float lo, float hi, float const (&values)[TABLE_POINTS])
+{
+	Curve c = {};
+	c.type = CURVE_TABLE;
+	c.lo   = lo;
+	c.hi   = hi;
+	for (size_t i = 0; i < TABLE_POINTS; ++i)
+		c.table[i] = values[i];
+	return c;
+}
+
+float Curve::evaluate(float input) const
+{
+	float in[4]	   = { input, input, input, input },
+		  score[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	respond(*this, in, score, 4);
+	return score[0];
+}
+
+/*
+ * Utility
+ */
+
+const uint32_t Utility::NONE;
+const size_t Utility::BLOCK;
+
+Utility::Utility(size_t agents)
+	: count_(0),
+	  padded_(0)
+{
+	resize(agents);
+}
+
+void Utility::resize(size_t agents)
+{
+	count_	= agents;
+	padded_	= (agents + 3) & ~(size_t)3;
+	for (size_t k = 0; k < inputs_.size(); ++k)
+		inputs_[k].resize(padded_, 0.0f);
+	choice_.resize(padded_, NONE);
+	score_.resize(padded_, 0.0f);
+}
+
+Utility::InputId Utility::addInput()
+{
+	inputs_.push_back(std::vector<float>(padded_, 0.0f));
+	return (InputId)(inputs_.size() - 1);
+}
+
+Utility::ActionId Utility::addAction(float weight)
+{
+	Action a;
+	a.weight = weight;
+	actions_.push_back(a);
+	return (ActionId)(actions_.size() - 1);
+}
+
+void Utility::addConsideration(ActionId action, InputId input, Curve const & curve)
+{
+	assert(action < actions_.size() && input < inputs_.size());
+	Consideration c = { input, curve };
+	actions_[action].considerations.push_back(c);
+}
+
+void Utility::decide(float inertia)
+{
+	size_t blocks = (padded_ + BLOCK - 1) / BLOCK;
+	core::parallel_for(0, blocks, 1, [this, inertia](size_t first, size_t last)
+	{
+		for (size_t b = first; b < last; ++b)
+			block(b * BLOCK, (std::min)(padded_, (b + 1) * BLOCK), inertia);
+	});
+}
+
+void Utility::block(size_t first, size_t last, float inertia)
+{
+	// Running arg-max of the block and the action being scored
+	float	 best[BLOCK];
+	int32_t	 best_id[BLOCK];
+	float	 score[BLOCK];
+	size_t	 n = last - first;
+
+	for (size_t i = 0; i < n; ++i)
+	{
+		best[i]	   = 0.0f;
+		best_id[i] = (int32_t)NONE;
+	}
+
+	F4 const bonus = splat(1.0f + inertia);
+
+	for (size_t a = 0; a < actions_.size(); ++a)
+	{
+		Action const & action = actions_[a];
+		size_t k = action.considerations.size();
+
+		for (size_t i = 0; i < n; ++i)
+			score[i] = 1.0f;
+		for (size_t c = 0; c < k; ++c)
+		{
+			Consideration const & con = action.considerations[c];
+			respond(con.curve, &inputs_[con.input][first], score, n);
+		}
+
+		F4 const weight = splat(action.weight);
+		F4 const compensate = splat(k > 0 ? 1.0f - 1.0f / k : 0.0f);
+		__m128i const id = _mm_set1_epi32((int32_t)a);
+
+		for (size_t j = 0; j < n; j += 4)
+		{
+			// Make up for the product shrinking with each extra consideration
+			F4 s = _mm_loadu_ps(&score[j]);
+			s = add4(s, mul4(mul4(sub4(splat(1.0f), s), compensate), s));
+			s = mul4(s, weight);
+
+			__m128i previous = _mm_loadu_si128((__m128i const *)&choice_[first + j]);
+			F4 same = _mm_castsi128_ps(_mm_cmpeq_epi32(previous, id));
+			s = mul4(s, select(same, bonus, splat(1.0f)));
+
+			F4 current = _mm_loadu_ps(&best[j]);
+			F4 better = _mm_cmpgt_ps(s, current);
+			_mm_storeu_ps(&best[j], select(better, s, current));
+
+			__m128i ids = _mm_loadu_si128((__m128i const *)&best_id[j]);
+			__m128i take = _mm_castps_si128(better);
+			ids = _mm_or_si128(_mm_and_si128(take, id), _mm_andnot_si128(take, ids));
+			_mm_storeu_si128((__m128i *)&best_id[j], ids);
+		}
+	}
+
+	for (size_t i = 0; i < n; ++i)
+	{
+		choice_[first + i] = (ActionId)best_id[i];
+		score_[first + i]  = best[i];
+	}
+}
@@ -0,0 +1,343 @@
+/* ********************************************************************************* *
+ * *  File: VisibilityGraph.cpp                                                    * *
+ * *  -------------------------                                                    * *
+ * *  COPYRIGHT NOTICE                                                             * *
+ * *  ----------------                                                             * *
+ * *  (C)[2012] - [2015] Deakin University                                         * *
+ * *  All rights reserved.                                                         * *
+ * *  All information contained herein is, and remains the property of Deakin      * *
+ * *  University and the author (Tim Wilkin).                                      * *
+ * *  Dissemination of this information or reproduction of this material is        * *
+ * *  strictly forbidden unless prior written permission is obtained from Deakin   * *
+ * *  University.The right to create derivative works from this material is        * *
+ * *  hereby granted to students enrolled in SIT255, but only for the purposes of  * *
+ * *  assessment while an enrolled student at Deakin University.                   * *
+ * *                                                                               * *
+ * ********************************************************************************* */
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+#include "ai/VisibilityGraph.h"
+#include "core/Parallel.h"
+
+using namespace ai;
+using namespace level;
+
+namespace {
+
+	const double	PI = 3.14159265358979323846;
+
+	// Nodes sit this much further out than the hull corners, so they are never on a hull
+	const float		MARGIN = 1.01f;
+	const float		MARGIN_ABS = 1.0e-3f;
+
+	// Corners of the polygon round each end cap; the hull is 2 * CAP_CORNERS sided
+	const int		CAP_CORNERS = 4;
+	const size_t	HULL = 2 * CAP_CORNERS;
+
+	// Twice the signed area of abc, positive when counter clockwise
+	inline double orient(POINT2 const & a, POINT2 const & b, POINT2 const & c)
+	{
+		return ((double)b.x - a.x) * ((double)c.y - a.y) - ((double)b.y - a.y) * ((double)c.x - a.x);
+	}
+
+	// Do segments ab and cd cross at a point interior to both?
+	inline bool crosses(POINT2 const & a, POINT2 const & b, POINT2 const & c, POINT2 const & d)
+	{
+		double d1 = orient(a, b, c), d2 = orient(a, b, d);
+		if ((d1 > 0.0 && d2 > 0.0) || (d1 < 0.0 && d2 < 0.0) || (d1 == 0.0 && d2 == 0.0))
+			return false;
+		double d3 = orient(c, d, a), d4 = orient(c, d, b);
+		return (d3 > 0.0 && d4 < 0.0) || (d3 < 0.0 && d4 > 0.0);
+	}
+
+	inline float distance(POINT2 const & a, POINT2 const & b)
+	{
+		float dx = b.x - a.x, dy = b.y - a.y;
+		return sqrt(dx * dx + dy * dy);
+	}
+
+	// p + a d + b n
+	inline POINT2 offset(POINT2 const & p, VECTOR2 const & d, float a, VECTOR2 const & n, float b)
+	{
+		return POINT2(p.x + a * d.x + b * n.x, p.y + a * d.y + b * n.y);
+	}
+
+	inline double angle(POINT2 const & from, POINT2 const & to)
+	{
+		return atan2((double)to.y - from.y, (double)to.x - from.x);
+	}
+
+	// Angular span of a hull edge seen from the sweep centre
+	struct Span
+	{
+		double		lo, hi;
+		int32_t		edge;
+
+		bool operator<(Span const & s) const	{ return lo < s.lo; }
+	};
+
+	// Advance a visit stamp, clearing the stamp arrays when it wraps
+	void next_stamp(std::vector<uint32_t> & a, std::vector<uint32_t> & b, uint32_t & stamp)
+	{
+		if (++stamp == 0)
+		{
+			std::fill(a.begin(), a.end(), 0u);
+			std::fill(b.begin(), b.end(), 0u);
+			stamp = 1;
+		}
+	}
+
+} // close anonymous namespace
+
+VisibilityGraph::VisibilityGraph()
+	: inflated_(0),
+	  stamp_(0),
+	  expansions_(0)
+{}
+
+bool VisibilityGraph::inside(POINT2 const & p) const
+{
+	// Hulls are counter clockwise, so inside is left of every edge
+	for (size_t b = 0; b < corners_.size(); b += HULL)
+	{
+		bool in = true;
+		for (size_t k = 0; k < HULL && in; ++k)
+			in = orient(corners_[b + k], corners_[b + (k + 1) % HULL], p) > 0.0;
+		if (in)
+			return true;
+	}
+	return false;
+}
+
+void VisibilityGraph::build(std::vector<Segment> const & walls, InflatedWalls const & inflated)
+{
+	inflated_ = &inflated;
+	float r = inflated.radius();
+
+	// Each cap is bounded by CAP_CORNERS + 1 tangent lines, meeting at this distance from the end point
+	float half = (float)(PI / (2 * CAP_CORNERS));
+	float reach = r / cos(half);
+	float out = reach * MARGIN + MARGIN_ABS;
+
+	corners_.clear();
+	nodes_.clear();
+	for (size_t i = 0; i < walls.size(); ++i)
+	{
+		POINT2 p = walls[i].start(), q = walls[i].end();
+		float len = distance(p, q);
+		VECTOR2 d = (len > 0.0f) ? VECTOR2((q.x - p.x) / len, (q.y - p.y) / len) : VECTOR2(1.0f, 0.0f);
+		VECTOR2 n(-d.y, d.x);
+
+		// Counter clockwise: round the q end from -n to +n, then the p end back
+		for (int end = 0; end < 2; ++end)
+		{
+			POINT2 const & e = end ? p : q;
+			float sign = end ? -1.0f : 1.0f;
+			for (int k = 0; k < CAP_CORNERS; ++k)
+			{
+				float a = (2 * k + 1) * half - (float)(PI / 2);
+				float along = sign * cos(a), across = sign * sin(a);
+				corners_.push_back(offset(e, d, along * reach, n, across * reach));
+				nodes_.push_back(offset(e, d, along * out, n, across * out));
+			}
+		}
+	}
+
+	// Corners buried in another wall's hull can never be turned round
+	size_t kept = 0;
+	for (size_t i = 0; i < nodes_.size(); ++i)
+		if (!inside(nodes_[i]))
+			nodes_[kept++] = nodes_[i];
+	nodes_.resize(kept);
+
+	std::vector<std::vector<int32_t>> visible(nodes_.size());
+	core::parallel_for(0, nodes_.size(), 8, [&](size_t first, size_t last)
+	{
+		for (size_t v = first; v < last; ++v)
+			sweep((int32_t)v, visible[v]);
+	});
+
+	first_.assign(nodes_.size() + 1, 0);
+	adj_.clear();
+	length_.clear();
+	for (size_t v = 0; v < nodes_.size(); ++v)
+	{
+		for (size_t k = 0; k < visible[v].size(); ++k)
+		{
+			adj_.push_back(visible[v][k]);
+			length_.push_back(distance(nodes_[v], nodes_[visible[v][k]]));
+		}
+		first_[v + 1] = (uint32_t)adj_.size();
+	}
+
+	size_t n = nodes_.size() + 2;
+	g_.resize(n);
+	parent_.resize(n);
+	seen_.assign(n, 0);
+	closed_.assign(n, 0);
+	stamp_ = 0;
+}
+
+void VisibilityGraph::sweep(int32_t v, std::vector<int32_t> & out) const
+{
+	POINT2 const & c = nodes_[v];
+
+	// Targets in angle order
+	std::vector<std::pair<double, int32_t>> targets;
+	targets.reserve(nodes_.size());
+	for (size_t w = 0; w < nodes_.size(); ++w)
+		if ((int32_t)w != v)
+			targets.push_back(std::make_pair(angle(c, nodes_[w]), (int32_t)w));
+	std::sort(targets.begin(), targets.end());
+
+	// Edge spans, split where they straddle the -pi/pi seam
+	std::vector<Span> spans;
+	spans.reserve(corners_.size() + 8);
+	for (size_t e = 0; e < corners_.size(); ++e)
+	{
+		POINT2 const & a = corners_[e];
+		POINT2 const & b = corners_[e - e % HULL + (e + 1) % HULL];
+		if (orient(c, a, b) == 0.0)
+			continue;		// edge on end: it can only be grazed
+
+		double ta = angle(c, a), tb = angle(c, b);
+		Span s;
+		s.edge = (int32_t)e;
+		s.lo = math::min(ta, tb);
+		s.hi = math::max(ta, tb);
+		if (s.hi - s.lo <= PI)
+			spans.push_back(s);
+		else
+		{
+			double lo = s.lo;
+			s.lo = s.hi;
+			s.hi = PI;
+			spans.push_back(s);
+			s.lo = -PI;
+			s.hi = lo;
+			spans.push_back(s);
+		}
+	}
+	std::sort(spans.begin(), spans.end());
+
+	std::vector<Span> active;
+	size_t next = 0;
+	for (size_t t = 0; t < targets.size(); ++t)
+	{
+		double theta = targets[t].first;
+		while (next < spans.size() && spans[next].lo <= theta)
+			active.push_back(spans[next++]);
+		for (size_t i = 0; i < active.size(); )
+		{
+			if (active[i].hi < theta)
+			{
+				active[i] = active.back();
+				active.pop_back();
+			}
+			else
+				++i;
+		}
+
+		POINT2 const & w = nodes_[targets[t].second];
+		bool clear = true;
+		for (size_t i = 0; i < active.size() && clear; ++i)
+		{
+			size_t e = active[i].edge;
+			clear = !crosses(c, w, corners_[e], corners_[e - e % HULL + (e + 1) % HULL]);
+		}
+		if (clear)
+			out.push_back(targets[t].second);
+	}
+	std::sort(out.begin(), out.end());
+}
+
+bool VisibilityGraph::findPath(POINT2 const & start, POINT2 const & goal, std::vector<POINT2> & out, float * cost)
+{
+	out.clear();
+	expansions_ = 0;
+	if (!inflated_ || inflated_->blocked(start) || inflated_->blocked(goal))
+		return false;
+
+	if (inflated_->lineOfSight(start, goal))
+	{
+		out.push_back(start);
+		out.push_back(goal);
+		if (cost)
+			*cost = distance(start, goal);
+		return true;
+	}
+
+	// Which nodes the two ends see, in one batch
+	int32_t n = (int32_t)nodes_.size();
+	int32_t s = n, t = n + 1;
+	from_.assign((size_t)2 * n, start);
+	to_.resize((size_t)2 * n);
+	for (int32_t i = 0; i < n; ++i)
+	{
+		from_[n + i] = goal;
+		to_[i] = to_[n + i] = nodes_[i];
+	}
+	visible_.resize((size_t)2 * n);
+	if (n > 0)
+		inflated_->lineOfSight(&from_[0], &to_[0], &visible_[0], (size_t)2 * n);
+
+	next_stamp(seen_, closed_, stamp_);
+	open_.clear();
+	g_[s] = 0.0f;
+	parent_[s] = -1;
+	seen_[s] = stamp_;
+	open_.push_back(OpenNode(distance(start, goal), s));
+
+	while (!open_.empty())
+	{
+		std::pop_heap(open_.begin(), open_.end(), std::greater<OpenNode>());
+		int32_t u = open_.back().second;
+		open_.pop_back();
+		if (closed_[u] == stamp_)
+			continue;
+		closed_[u] = stamp_;
+		++expansions_;
+
+		if (u == t)
+		{
+			for (int32_t m = t; m >= 0; m = parent_[m])
+				out.push_back((m == s) ? start : (m == t) ? goal : nodes_[m]);
+			std::reverse(out.begin(), out.end());
+			if (cost)
+				*cost = g_[t];
+			return true;
+		}
+
+		auto relax = [&](int32_t m, float len)
+		{
+			if (closed_[m] == stamp_)
+				return;
+			float g = g_[u] + len;
+			if (seen_[m] != stamp_ || g < g_[m])
+			{
+				seen_[m] = stamp_;
+				g_[m] = g;
+				parent_[m] = u;
+				open_.push_back(OpenNode(g + ((m == t) ? 0.0f : distance(nodes_[m], goal)), m));
+				std::push_heap(open_.begin(), open_.end(), std::greater<OpenNode>());
+			}
+		};
+
+		if (u == s)
+		{
+			for (int32_t i = 0; i < n; ++i)
+				if (visible_[i])
+					relax(i, distance(start, nodes_[i]));
+			continue;
+		}
+
+		for (uint32_t k = first_[u]; k < first_[u + 1]; ++k)
+			relax(adj_[k], length_[k]);
+		if (visible_[n + u])
+			relax(t, distance(nodes_[u], goal));
+	}
+	return false;
+}
@@ -260,6 +260,10 @@ void WinCanvas::DrawPoly(Polytype const & p, unsigned long colour, unsigned int
 		case POLYGON_TYPE::TRIANGLE:
 			DrawTriangle(dynamic_cast<Triangle const &>(p), colour, width);
 			break;
+
+		case POLYGON_TYPE::CONVEX:
+			DrawConvex(dynamic_cast<ConvexPolygon const &>(p), colour, width);
+			break;
 	}
 }
 
@@ -278,6 +282,10 @@ void WinCanvas::DrawFilledPoly(Polytype const & p, unsigned long fill_colour, un
 		case POLYGON_TYPE::TRIANGLE:
 			DrawSolidTriangle(dynamic_cast<Triangle const &>(p), fill_colour, line_colour, width);
 			break;
+
+		case POLYGON_TYPE::CONVEX:
+			DrawSolidConvex(dynamic_cast<ConvexPolygon const &>(p), fill_colour, line_colour, width);
+			break;
 	}
 }
 
@@ -411,6 +419,60 @@ void WinCanvas::DrawSolidTriangle(Triangle const & t, unsigned long fill_rgb, un
 	DeleteObject(NewBrush);
 }
 
+void WinCanvas::DrawConvex(ConvexPolygon const & c, unsigned long line_rgb, int line_width)
+{
+	if (c.size() == 0)
+		return;
+
+	// Set border (outline) colour of the polygon
+	HPEN NewPen = CreatePen(PS_SOLID, line_width, line_rgb);
+	SelectObject(m_hdcBuffer, NewPen);
+
+	// create the set of points, closing the loop back to the first vertex
+	POINT pts[ConvexPolygon::MAX_VERTICES + 1];
+	size_t n = c.size();
+	for (size_t i = 0; i <= n; ++i)
+	{
+		pts[i].x = (long)c.vertex(i).x;
+		pts[i].y = (long)c.vertex(i).y;
+	}
+
+	// Move pen to starting position
+	MoveToEx(m_hdcBuffer, pts[0].x, pts[0].y, NULL);
+	// Call PolylineTo() with the n points (n+1 pairs of points) that form the polygon
+	PolylineTo(m_hdcBuffer, pts, (DWORD)(n + 1));
+
+	DeleteObject(NewPen);
+}
+
+void WinCanvas::DrawSolidConvex(ConvexPolygon const & c, unsigned long fill_rgb, unsigned long line_rgb, int line_width)
+{
+	if (c.size() == 0)
+		return;
+
+	// Set fill colour of the polygon
+	HBRUSH NewBrush = CreateSolidBrush(fill_rgb);
+	SelectObject(m_hdcBuffer, NewBrush);
+	// Set border (outline) colour of the polygon
+	HPEN NewPen = CreatePen(PS_SOLID, line_width, line_rgb);
+	SelectObject(m_hdcBuffer, NewPen);
+
+	// create the set of points
+	POINT pts[ConvexPolygon::MAX_VERTICES];
+	size_t n = c.size();
+	for (size_t i = 0; i < n; ++i)
+	{
+		pts[i].x = (long)c.vertex(i).x;
+		pts[i].y = (long)c.vertex(i).y;
+	}
+
+	// Call Polygon() with the n points that form the polygon
+	Polygon(m_hdcBuffer, pts, (int)n);
+
+	DeleteObject(NewPen);
+	DeleteObject(NewBrush);
+}
+
 void WinCanvas::DrawCircle(Circle const & c, unsigned long line_rgb, int line_width)
 {
 	HPEN NewPen = CreatePen (PS_SOLID, line_width, line_rgb);
@@ -40,11 +40,14 @@
 #include <string>
 
 #include <time.h>
+#include <utility>
 #include <vector>
 
 #include "ui\WinCanvas.h"
 #include "ui\WinTexture.h"
 #include "ui\InputState.h"
+#include "ai\Benchmarks.h"
+#include "core\FrameGraph.h"
 
 #include "..\Tank.h"
 
@@ -58,8 +61,23 @@ const unsigned int	WINDOW_HEIGHT = 400;
 
 
 // The main function of the program
-int main()
+int main(int argc, char * argv[])
 {
+	// Start the job system here so that this thread is its worker 0
+	core::JobSystem::instance();
+
+	// demo -bench: print the timing tables and exit without opening a window
+	if (argc > 1 && std::string(argv[1]) == "-bench")
+	{
+		ai::benchmarkPathfinding(std::cout);
+		ai::benchmarkSteering(std::cout);
+		ai::benchmarkLod(std::cout);
+		ai::benchmarkUtility(std::cout);
+		ai::benchmarkPlanning(std::cout);
+		ai::benchmarkScripts(std::cout);
+		ai::benchmarkDeterministicTicks(std::cout);
+		return 0;
+	}
 
 	/**************************************************************************
 	 *
@@ -77,26 +95,54 @@ int main()
 	InputState	  ui;
 	OpenUIHandler(ui);	// Initialise the input interface
 
-	Tank frank(300,200);
-
 	/*
- 	 *  Execute a trivial application loop with rendering of a message (so we know it works)
+	 *  The tank is double buffered so that frame n+1 can be simulated into one
+	 *  copy while frame n is drawn from the other. Each frame moves the tank
+	 *  forward (a pending plan request has one owner); drawing reads only the
+	 *  position, which the move leaves in place.
 	 */
+	Tank frank[2] = { Tank(300,200), Tank(300,200) };
+
 	float xpos = 0;
 	float ypos = WINDOW_HEIGHT/2.0;
 
-	while (wc.IsActive())
+	core::FrameGraph frames;
+	core::ResourceId input  = frames.resource("input");
+	core::ResourceId tanks  = frames.resource("tanks", true);
+	core::ResourceId canvas = frames.resource("canvas");
+
+	core::StageId simulate = frames.stage("simulate", [&](core::Frame const & f)
+	{
+		Tank & tank = frank[f.current()];
+		tank = std::move(frank[f.previous()]);
+		tank.update();
+		tank.handleInput(ui);
+	});
+	frames.reads(simulate, input);
+	frames.reads(simulate, tanks, core::VERSION_PREVIOUS);
+	frames.writes(simulate, tanks);
+
+	core::StageId render = frames.stage("render", [&](core::Frame const & f)
 	{
 		wc.Clear(255, 255, 255);
-	
-		frank.update();
-		frank.handleInput(ui);
-		frank.render(wc);
-
-		// display
+		frank[f.current()].render(wc);
 		wc.Write(int(xpos)%WINDOW_WIDTH, ypos, "Hello World", LRGB(255, 0, 0));
+	});
+	frames.reads(render, tanks);
+	frames.writes(render, canvas);
+
+	core::StageId present = frames.stage("present", [&](core::Frame const &)
+	{
 		wc.Display();
-	}
+	});
+	frames.writes(present, canvas);
+
+	/*
+ 	 *  Execute a trivial application loop with rendering of a message (so we know it works)
+	 */
+	while (wc.IsActive())
+		frames.submit();
+	frames.finish();
 	/**************************************************************************/
 
 